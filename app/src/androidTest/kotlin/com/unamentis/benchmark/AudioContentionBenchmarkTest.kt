@@ -0,0 +1,130 @@
+package com.unamentis.benchmark
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import com.unamentis.core.audio.AudioConfig
+import com.unamentis.core.audio.AudioDeadlineStats
+import com.unamentis.core.audio.AudioEngine
+import com.unamentis.data.model.LLMMessage
+import com.unamentis.services.llm.OnDeviceLLMService
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.cancelAndJoin
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.runBlocking
+import org.junit.After
+import org.junit.Assume.assumeTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import kotlin.math.PI
+import kotlin.math.sin
+
+/**
+ * Contention benchmark for audio callbacks during on-device LLM decoding.
+ *
+ * Drives the playback stream with a continuous tone (the callback is the
+ * audio driver, no microphone permission needed) while the LLM generates,
+ * once with inference threads on every core and once with a core reserved
+ * for audio. Callback deadline misses are logged for idle and decoding
+ * periods of each run.
+ *
+ * Skipped when no on-device model is installed.
+ */
+@RunWith(AndroidJUnit4::class)
+class AudioContentionBenchmarkTest {
+    private lateinit var audioEngine: AudioEngine
+    private lateinit var llmService: OnDeviceLLMService
+
+    @Before
+    fun setUp() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        audioEngine = AudioEngine()
+        audioEngine.initialize(AudioConfig())
+        llmService = OnDeviceLLMService(context)
+    }
+
+    @After
+    fun tearDown() {
+        llmService.unloadModel()
+        audioEngine.setAudioIsolation(true)
+        audioEngine.release()
+    }
+
+    /**
+     * Compare playback deadline misses with and without audio isolation.
+     */
+    @Test
+    fun benchmark_audioDeadlinesUnderDecodeLoad() =
+        runBlocking {
+            val modelPath = llmService.getAvailableModelPath()
+            assumeTrue("No on-device model installed", modelPath != null)
+
+            val shared = measure(isolated = false, modelPath = modelPath!!)
+            val isolated = measure(isolated = true, modelPath = modelPath)
+            Log.i(TAG, "All cores shared: ${shared.describe()}")
+            Log.i(TAG, "Audio core reserved: ${isolated.describe()}")
+
+            assert(shared.loadedCallbacks > 0 && isolated.loadedCallbacks > 0) {
+                "No audio callbacks ran while the model was decoding"
+            }
+        }
+
+    private suspend fun measure(
+        isolated: Boolean,
+        modelPath: String,
+    ): AudioDeadlineStats {
+        // The reservation applies from the next turn that finds the pool idle
+        audioEngine.setAudioIsolation(isolated)
+        llmService.unloadModel()
+        assert(llmService.loadModel(OnDeviceLLMService.ModelConfig(modelPath))) { "Model failed to load" }
+        audioEngine.resetDeadlineStats()
+
+        val tone =
+            FloatArray(CHUNK_FRAMES) { i ->
+                TONE_AMPLITUDE * sin(2.0 * PI * TONE_HZ * i / SAMPLE_RATE).toFloat()
+            }
+        val driver =
+            launch(Dispatchers.Default) {
+                while (isActive) {
+                    if (audioEngine.getQueuedPlaybackSeconds() < MIN_QUEUED_SECONDS) {
+                        audioEngine.queuePlayback(tone)
+                    }
+                    delay(FEED_INTERVAL_MS)
+                }
+            }
+
+        // Idle baseline first, then the same stream under decode load
+        delay(IDLE_MS)
+        repeat(GENERATIONS) {
+            llmService.streamCompletion(
+                messages = listOf(LLMMessage(role = "user", content = PROMPT)),
+                maxTokens = MAX_TOKENS,
+            ).collect { }
+        }
+
+        driver.cancelAndJoin()
+        audioEngine.stopPlayback()
+        return audioEngine.getDeadlineStats(capture = false)
+    }
+
+    private fun AudioDeadlineStats.describe(): String =
+        "idle $misses/$callbacks missed, decoding $loadedMisses/$loadedCallbacks missed, " +
+            "longest callback $maxCallbackUs us, longest gap $maxIntervalUs us"
+
+    private companion object {
+        const val TAG = "AudioContention"
+        const val SAMPLE_RATE = 16000
+        const val CHUNK_FRAMES = 1600 // 100 ms
+        const val TONE_HZ = 440.0
+        const val TONE_AMPLITUDE = 0.05f
+        const val MIN_QUEUED_SECONDS = 0.3f
+        const val FEED_INTERVAL_MS = 20L
+        const val IDLE_MS = 3000L
+        const val GENERATIONS = 3
+        const val MAX_TOKENS = 128
+        const val PROMPT = "Explain in a few paragraphs how photosynthesis works."
+    }
+}
@@ -0,0 +1,103 @@
+package com.unamentis.benchmark
+
+import android.os.Process
+import android.os.SystemClock
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import com.unamentis.data.model.LLMMessage
+import com.unamentis.services.llm.OnDeviceLLMService
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.runBlocking
+import org.junit.After
+import org.junit.Assume.assumeTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * Per-token latency versus idle CPU cost of the compute pool policy.
+ *
+ * For each poll level, with and without parking workers between turns,
+ * times a generation per token and then measures the CPU time the process
+ * burns while the model sits idle (as it does while the learner speaks).
+ *
+ * Skipped when no on-device model is installed.
+ */
+@RunWith(AndroidJUnit4::class)
+class ComputePoolBenchmarkTest {
+    private lateinit var llmService: OnDeviceLLMService
+
+    @Before
+    fun setUp() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        llmService = OnDeviceLLMService(context)
+    }
+
+    @After
+    fun tearDown() {
+        llmService.unloadModel()
+        llmService.configureComputePools(OnDeviceLLMService.ComputePoolConfig())
+    }
+
+    /**
+     * Compare poll levels and pausing between turns.
+     */
+    @Test
+    fun benchmark_tokenLatencyVersusIdleCpu() =
+        runBlocking {
+            val modelPath = llmService.getAvailableModelPath()
+            assumeTrue("No on-device model installed", modelPath != null)
+            assert(llmService.loadModel(OnDeviceLLMService.ModelConfig(modelPath!!))) { "Model failed to load" }
+
+            // Warm up weights and caches before timing anything
+            generate()
+
+            for (poll in POLL_LEVELS) {
+                for (pause in listOf(true, false)) {
+                    llmService.configureComputePools(OnDeviceLLMService.ComputePoolConfig(poll, pause))
+                    val msPerToken = generate()
+                    val idleCpuPercent = idleCpuPercent()
+                    Log.i(
+                        TAG,
+                        "poll $poll, pause ${if (pause) "on" else "off"}: " +
+                            "%.1f ms/token, idle CPU %.1f%%".format(msPerToken, idleCpuPercent),
+                    )
+                }
+            }
+
+            val stats = llmService.getComputePoolStats()
+            Log.i(TAG, "Pools: $stats")
+            assert(stats.turns > 0) { "No generation ran on a compute pool" }
+        }
+
+    private suspend fun generate(): Double {
+        var tokens = 0
+        val start = SystemClock.elapsedRealtimeNanos()
+        llmService.streamCompletion(
+            messages = listOf(LLMMessage(role = "user", content = PROMPT)),
+            maxTokens = MAX_TOKENS,
+        ).collect { tokens++ }
+        val elapsedMs = (SystemClock.elapsedRealtimeNanos() - start) / NANOS_PER_MS
+        return if (tokens > 0) elapsedMs / tokens else 0.0
+    }
+
+    // CPU used by the whole process while idle, as a share of one core
+    private suspend fun idleCpuPercent(): Double {
+        val cpuStart = Process.getElapsedCpuTime()
+        val wallStart = SystemClock.elapsedRealtime()
+        delay(IDLE_MS)
+        val cpuMs = Process.getElapsedCpuTime() - cpuStart
+        val wallMs = SystemClock.elapsedRealtime() - wallStart
+        return if (wallMs > 0) 100.0 * cpuMs / wallMs else 0.0
+    }
+
+    private companion object {
+        const val TAG = "ComputePoolBench"
+        val POLL_LEVELS = listOf(0, 50, 100)
+        const val IDLE_MS = 2000L
+        const val MAX_TOKENS = 64
+        const val NANOS_PER_MS = 1_000_000.0
+        const val PROMPT = "Explain in a few paragraphs how photosynthesis works."
+    }
+}
@@ -0,0 +1,149 @@
+package com.unamentis.benchmark
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import com.unamentis.core.audio.EndpointDetector
+import com.unamentis.core.audio.EndpointEvent
+import com.unamentis.core.audio.EndpointStats
+import com.unamentis.services.vad.SimpleVADService
+import org.junit.After
+import org.junit.Assume.assumeTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Endpoint latency on recorded utterances.
+ *
+ * Replays each fixture through the VAD and the native endpoint detector,
+ * once on audio cues alone and once with the fixture's transcript reported
+ * as the partial result when speech ends, and logs the latency
+ * distribution (silence after the last speech frame) and the number of
+ * premature endpoints (the turn ended before the learner finished).
+ *
+ * Fixtures are 16 kHz mono 16-bit WAV files, each with an optional
+ * transcript in a `.txt` file of the same name, pushed to the app's
+ * external files directory:
+ * ```
+ * adb push fixtures/. /sdcard/Android/data/<package>/files/endpoint_fixtures/
+ * ```
+ *
+ * Skipped when no fixtures are installed.
+ */
+@RunWith(AndroidJUnit4::class)
+class EndpointLatencyBenchmarkTest {
+    private lateinit var detector: EndpointDetector
+    private lateinit var fixtures: List<File>
+
+    @Before
+    fun setUp() {
+        val context = InstrumentationRegistry.getInstrumentation().targetContext
+        detector = EndpointDetector()
+        fixtures =
+            context.getExternalFilesDir(FIXTURE_DIR)
+                ?.listFiles { file -> file.extension == "wav" }
+                ?.sortedBy { it.name }
+                .orEmpty()
+    }
+
+    @After
+    fun tearDown() {
+        detector.release()
+    }
+
+    /**
+     * Compare endpoint latency with and without transcript cues.
+     */
+    @Test
+    fun benchmark_endpointLatencyOnFixtures() {
+        assumeTrue("No endpoint fixtures installed", fixtures.isNotEmpty())
+
+        for (withTranscript in listOf(false, true)) {
+            detector.resetStats()
+            var premature = 0
+            var missed = 0
+            for (fixture in fixtures) {
+                val transcript = File(fixture.path.removeSuffix(".wav") + ".txt")
+                val text = if (withTranscript && transcript.exists()) transcript.readText().trim() else null
+                when (replay(readWav(fixture), text)) {
+                    Outcome.PREMATURE -> premature++
+                    Outcome.MISSED -> missed++
+                    Outcome.ON_TIME -> {}
+                }
+            }
+            val mode = if (withTranscript) "audio + transcript" else "audio only"
+            Log.i(TAG, "$mode: ${detector.getStats().describe()}, premature $premature, missed $missed")
+        }
+
+        assert(detector.getStats().endpoints > 0) { "No fixture reached an endpoint" }
+    }
+
+    private enum class Outcome { ON_TIME, PREMATURE, MISSED }
+
+    private fun replay(
+        samples: FloatArray,
+        transcript: String?,
+    ): Outcome {
+        val frames = samples.toList().chunked(FRAME_SAMPLES) { it.toFloatArray() }
+        val vad = SimpleVADService()
+        val confidences = frames.map { vad.processAudio(it).confidence }
+        val lastSpeechFrame = confidences.indexOfLast { it >= SPEECH_CONFIDENCE }
+
+        detector.reset()
+        var outcome = Outcome.MISSED
+        frames.forEachIndexed { index, frame ->
+            if (index == lastSpeechFrame && transcript != null) {
+                detector.reportTranscript(transcript)
+            }
+            if (detector.process(frame, confidences[index]) == EndpointEvent.END_OF_UTTERANCE &&
+                outcome == Outcome.MISSED
+            ) {
+                outcome = if (index < lastSpeechFrame) Outcome.PREMATURE else Outcome.ON_TIME
+            }
+        }
+        // Trailing silence so every fixture can reach its endpoint
+        val silence = FloatArray(FRAME_SAMPLES)
+        repeat(TRAILING_SILENCE_FRAMES) {
+            if (detector.process(silence, 0f) == EndpointEvent.END_OF_UTTERANCE && outcome == Outcome.MISSED) {
+                outcome = Outcome.ON_TIME
+            }
+        }
+        return outcome
+    }
+
+    // Samples of the data chunk of a 16-bit PCM WAV file
+    private fun readWav(file: File): FloatArray {
+        val buffer = ByteBuffer.wrap(file.readBytes()).order(ByteOrder.LITTLE_ENDIAN)
+        buffer.position(WAV_HEADER_START)
+        while (buffer.remaining() >= CHUNK_HEADER_BYTES) {
+            val id = ByteArray(4).also { buffer.get(it) }
+            val size = buffer.int
+            if (String(id, Charsets.US_ASCII) == "data") {
+                val count = minOf(size, buffer.remaining()) / 2
+                return FloatArray(count) { buffer.short / PCM_SCALE }
+            }
+            buffer.position(minOf(buffer.limit(), buffer.position() + size))
+        }
+        return FloatArray(0)
+    }
+
+    private fun EndpointStats.describe(): String =
+        "$endpoints endpoints, latency mean $meanLatencyMs ms, p50 $p50LatencyMs ms, " +
+            "p90 $p90LatencyMs ms, max $maxLatencyMs ms, $punctuationEndpoints on transcript cues, " +
+            "$resumedPauses resumed pauses"
+
+    private companion object {
+        const val TAG = "EndpointLatency"
+        const val FIXTURE_DIR = "endpoint_fixtures"
+        const val FRAME_SAMPLES = 320 // 20 ms at 16 kHz
+        const val SPEECH_CONFIDENCE = 0.5f
+        const val TRAILING_SILENCE_FRAMES = 100 // 2 s
+        const val WAV_HEADER_START = 12 // After "RIFF", size, "WAVE"
+        const val CHUNK_HEADER_BYTES = 8
+        const val PCM_SCALE = 32768f
+    }
+}
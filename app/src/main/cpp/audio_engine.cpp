@@ -1,7 +1,11 @@
 #include "audio_engine.h"
+#include "pcm_ring.h"
+#include "thread_policy.h"
 #include <android/log.h>
+#include <chrono>
 #include <cstring>
 #include <algorithm>
+#include <ctime>
 
 #define LOG_TAG "UnaMentis-Audio"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -13,6 +17,29 @@ namespace unamentis {
 // Playback buffer size (2 seconds at 16kHz mono)
 static constexpr size_t PLAYBACK_BUFFER_SIZE = 16000 * 2;
 
+// Scratch for converting queued samples whose format differs from the queue
+static constexpr int32_t QUEUE_CONVERT_CHUNK = 256;
+
+static const char* formatName(SampleFormat format) {
+    return format == SampleFormat::I16 ? "I16" : "Float";
+}
+
+static oboe::AudioFormat toOboeFormat(SampleFormat format) {
+    return format == SampleFormat::I16 ? oboe::AudioFormat::I16 : oboe::AudioFormat::Float;
+}
+
+// Convert frames through a scratch buffer, handing each converted chunk on
+template <typename In, typename Out, typename Convert, typename Deliver>
+static void convertInChunks(const In* in, int32_t frames, int32_t channels,
+                            std::vector<Out>& scratch, Convert convert, Deliver deliver) {
+    const int32_t chunk = std::max<int32_t>(1, static_cast<int32_t>(scratch.size()) / channels);
+    for (int32_t done = 0; done < frames; done += chunk) {
+        const int32_t n = std::min(chunk, frames - done);
+        convert(in + static_cast<size_t>(done) * channels, scratch.data(), static_cast<size_t>(n) * channels);
+        deliver(scratch.data(), n);
+    }
+}
+
 AudioEngine::AudioEngine() {
     LOGI("AudioEngine created");
     playback_buffer_.resize(PLAYBACK_BUFFER_SIZE);
@@ -22,17 +49,47 @@ AudioEngine::~AudioEngine() {
     stopCapture();
     stopPlayback();
     closeStreams();
+    telemetry_.detach();
     LOGI("AudioEngine destroyed");
 }
 
 bool AudioEngine::initialize(const AudioConfig& config) {
     config_ = config;
 
-    // Pre-allocate conversion buffer for typical frame sizes
-    conversion_buffer_.resize(config_.frames_per_burst * 4);
+    // Pre-allocate conversion buffers for typical frame sizes
+    const size_t scratch = static_cast<size_t>(config_.frames_per_burst) * 4 * std::max(1, config_.channel_count);
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        capture_convert_.assign(scratch, 0.0f);
+        capture_convert_i16_.assign(scratch, 0);
+    }
+    {
+        std::lock_guard<std::mutex> lock(playback_mutex_);
+        playback_convert_.assign(scratch, 0.0f);
+        playback_convert_i16_.assign(scratch, 0);
+        loudness_work_.assign(scratch, 0.0f);
+    }
+
+    // Only the queue in the consumer's format is kept
+    {
+        std::lock_guard<std::mutex> lock(playback_mutex_);
+        if (config_.playback_format == SampleFormat::I16) {
+            playback_buffer_i16_.assign(PLAYBACK_BUFFER_SIZE, 0);
+            std::vector<float>().swap(playback_buffer_);
+        } else {
+            playback_buffer_.assign(PLAYBACK_BUFFER_SIZE, 0.0f);
+            std::vector<int16_t>().swap(playback_buffer_i16_);
+        }
+        playback_read_pos_ = 0;
+        playback_write_pos_ = 0;
+        updateQueuedSamples();
+        loudness_.configure(loudness_config_, config_.sample_rate, config_.channel_count);
+        loudness_drained_ = 0;
+    }
 
-    LOGI("AudioEngine initialized: sample_rate=%d, channels=%d, frames_per_burst=%d",
-         config_.sample_rate, config_.channel_count, config_.frames_per_burst);
+    LOGI("AudioEngine initialized: sample_rate=%d, channels=%d, frames_per_burst=%d, capture=%s, playback=%s",
+         config_.sample_rate, config_.channel_count, config_.frames_per_burst,
+         formatName(config_.capture_format), formatName(config_.playback_format));
 
     return true;
 }
@@ -45,15 +102,12 @@ bool AudioEngine::createCaptureStream() {
            ->setSharingMode(oboe::SharingMode::Exclusive)
            ->setSampleRate(config_.sample_rate)
            ->setChannelCount(config_.channel_count)
-           ->setFormat(oboe::AudioFormat::Float)
            ->setInputPreset(oboe::InputPreset::VoiceRecognition)
            ->setCallback(this)
            ->setFramesPerCallback(config_.frames_per_burst);
 
-    oboe::Result result = builder.openStream(capture_stream_);
-
-    if (result != oboe::Result::OK) {
-        LOGE("Failed to create capture stream: %s", oboe::convertToText(result));
+    if (!openStream(builder, config_.capture_format, capture_stream_, capture_stream_format_)) {
+        LOGE("Failed to create capture stream");
         return false;
     }
 
@@ -74,17 +128,25 @@ bool AudioEngine::createPlaybackStream() {
            ->setSharingMode(oboe::SharingMode::Exclusive)
            ->setSampleRate(config_.sample_rate)
            ->setChannelCount(config_.channel_count)
-           ->setFormat(oboe::AudioFormat::Float)
            ->setCallback(this)
            ->setFramesPerCallback(config_.frames_per_burst);
 
-    oboe::Result result = builder.openStream(playback_stream_);
-
-    if (result != oboe::Result::OK) {
-        LOGE("Failed to create playback stream: %s", oboe::convertToText(result));
+    if (!openStream(builder, config_.playback_format, playback_stream_, playback_stream_format_)) {
+        LOGE("Failed to create playback stream");
         return false;
     }
 
+    {
+        // Loudness runs on every callback whatever the formats, so its
+        // scratch covers a whole callback
+        const int32_t frames = std::max(playback_stream_->getFramesPerCallback(), config_.frames_per_burst);
+        const size_t samples = static_cast<size_t>(frames) * std::max(1, playback_stream_->getChannelCount());
+        std::lock_guard<std::mutex> lock(playback_mutex_);
+        if (loudness_work_.size() < samples) {
+            loudness_work_.assign(samples, 0.0f);
+        }
+    }
+
     LOGI("Playback stream created: format=%s, sample_rate=%d, buffer_capacity=%d",
          oboe::convertToText(playback_stream_->getFormat()),
          playback_stream_->getSampleRate(),
@@ -93,6 +155,60 @@ bool AudioEngine::createPlaybackStream() {
     return true;
 }
 
+bool AudioEngine::openStream(
+    oboe::AudioStreamBuilder& builder,
+    SampleFormat format,
+    std::shared_ptr<oboe::AudioStream>& stream,
+    SampleFormat& stream_format) {
+
+    // Ask for the consumer's format; the device may still pick the other one
+    builder.setFormat(toOboeFormat(format));
+    oboe::Result result = builder.openStream(stream);
+    if (result != oboe::Result::OK) {
+        LOGE("Failed to open stream: %s", oboe::convertToText(result));
+        return false;
+    }
+
+    const oboe::AudioFormat actual = stream->getFormat();
+    if (actual != oboe::AudioFormat::I16 && actual != oboe::AudioFormat::Float) {
+        LOGE("Unsupported stream format: %s", oboe::convertToText(actual));
+        stream->close();
+        stream.reset();
+        return false;
+    }
+    stream_format = actual == oboe::AudioFormat::I16 ? SampleFormat::I16 : SampleFormat::FLOAT;
+    if (stream_format != format) {
+        LOGW("Device chose %s instead of %s; converting in the callback",
+             formatName(stream_format), formatName(format));
+        reserveConversion(*stream);
+    }
+    return true;
+}
+
+void AudioEngine::reserveConversion(const oboe::AudioStream& stream) {
+    // Enough scratch for one callback so conversion doesn't split it
+    const int32_t frames = std::max(stream.getFramesPerCallback(), config_.frames_per_burst);
+    const size_t samples = static_cast<size_t>(frames) * std::max(1, stream.getChannelCount());
+    const auto grow = [samples](std::vector<float>& scratch, std::vector<int16_t>& scratch_i16) {
+        if (scratch.size() < samples) {
+            scratch.assign(samples, 0.0f);
+        }
+        if (scratch_i16.size() < samples) {
+            scratch_i16.assign(samples, 0);
+        }
+    };
+
+    // The other stream may be running, so only this direction's scratch is
+    // touched, under the lock its callback takes
+    if (stream.getDirection() == oboe::Direction::Input) {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        grow(capture_convert_, capture_convert_i16_);
+    } else {
+        std::lock_guard<std::mutex> lock(playback_mutex_);
+        grow(playback_convert_, playback_convert_i16_);
+    }
+}
+
 void AudioEngine::closeStreams() {
     if (capture_stream_) {
         capture_stream_->close();
@@ -109,20 +225,54 @@ bool AudioEngine::startCapture(AudioCallback callback, void* user_data) {
         LOGW("Already capturing");
         return false;
     }
+    if (config_.capture_format != SampleFormat::FLOAT) {
+        LOGE("Float capture callback but capture format is %s", formatName(config_.capture_format));
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        capture_callback_ = std::move(callback);
+        capture_callback_i16_ = nullptr;
+        user_data_ = user_data;
+    }
+    return startCaptureStream();
+}
+
+bool AudioEngine::startCapture(AudioCallbackI16 callback, void* user_data) {
+    if (is_capturing_.load()) {
+        LOGW("Already capturing");
+        return false;
+    }
+    if (config_.capture_format != SampleFormat::I16) {
+        LOGE("I16 capture callback but capture format is %s", formatName(config_.capture_format));
+        return false;
+    }
 
     {
         std::lock_guard<std::mutex> lock(callback_mutex_);
-        capture_callback_ = callback;
+        capture_callback_ = nullptr;
+        capture_callback_i16_ = std::move(callback);
         user_data_ = user_data;
     }
+    return startCaptureStream();
+}
 
+bool AudioEngine::startCaptureStream() {
     // Create capture stream if needed
     if (!capture_stream_ && !createCaptureStream()) {
         LOGE("Failed to create capture stream");
         return false;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        capture_frames_.store(0, std::memory_order_relaxed);
+        onset_detector_.reset();
+    }
+
     // Start the stream
+    capture_deadlines_.restartInterval();
     oboe::Result result = capture_stream_->requestStart();
     if (result != oboe::Result::OK) {
         LOGE("Failed to start capture stream: %s", oboe::convertToText(result));
@@ -130,6 +280,7 @@ bool AudioEngine::startCapture(AudioCallback callback, void* user_data) {
     }
 
     is_capturing_.store(true);
+    publishTelemetry();
     LOGI("Audio capture started");
 
     return true;
@@ -149,9 +300,11 @@ void AudioEngine::stopCapture() {
     {
         std::lock_guard<std::mutex> lock(callback_mutex_);
         capture_callback_ = nullptr;
+        capture_callback_i16_ = nullptr;
         user_data_ = nullptr;
     }
 
+    publishTelemetry();
     LOGI("Audio capture stopped");
 }
 
@@ -166,23 +319,63 @@ bool AudioEngine::queuePlayback(const float* audio_data, int32_t frame_count) {
         return false;
     }
 
-    // Queue audio data
+    // Queue audio data, converting if the queue holds int16
     {
         std::lock_guard<std::mutex> lock(playback_mutex_);
 
-        for (int32_t i = 0; i < frame_count; ++i) {
-            playback_buffer_[playback_write_pos_] = audio_data[i];
-            playback_write_pos_ = (playback_write_pos_ + 1) % PLAYBACK_BUFFER_SIZE;
+        if (config_.playback_format == SampleFormat::FLOAT) {
+            writeRing(playback_buffer_, playback_read_pos_, playback_write_pos_,
+                      audio_data, static_cast<size_t>(frame_count));
+        } else {
+            int16_t chunk[QUEUE_CONVERT_CHUNK];
+            for (int32_t done = 0; done < frame_count; done += QUEUE_CONVERT_CHUNK) {
+                const size_t n = static_cast<size_t>(std::min(QUEUE_CONVERT_CHUNK, frame_count - done));
+                floatToInt16(audio_data + done, chunk, n);
+                writeRing(playback_buffer_i16_, playback_read_pos_, playback_write_pos_, chunk, n);
+            }
+        }
+        updateQueuedSamples();
+    }
+
+    return startPlaybackStream();
+}
+
+bool AudioEngine::queuePlayback(const int16_t* audio_data, int32_t frame_count) {
+    if (!audio_data || frame_count <= 0) {
+        return false;
+    }
+
+    // Create playback stream if needed
+    if (!playback_stream_ && !createPlaybackStream()) {
+        LOGE("Failed to create playback stream");
+        return false;
+    }
 
-            // Handle buffer overflow by dropping oldest samples
-            if (playback_write_pos_ == playback_read_pos_) {
-                playback_read_pos_ = (playback_read_pos_ + 1) % PLAYBACK_BUFFER_SIZE;
+    // Queue audio data, converting if the queue holds float
+    {
+        std::lock_guard<std::mutex> lock(playback_mutex_);
+
+        if (config_.playback_format == SampleFormat::I16) {
+            writeRing(playback_buffer_i16_, playback_read_pos_, playback_write_pos_,
+                      audio_data, static_cast<size_t>(frame_count));
+        } else {
+            float chunk[QUEUE_CONVERT_CHUNK];
+            for (int32_t done = 0; done < frame_count; done += QUEUE_CONVERT_CHUNK) {
+                const size_t n = static_cast<size_t>(std::min(QUEUE_CONVERT_CHUNK, frame_count - done));
+                int16ToFloat(audio_data + done, chunk, n);
+                writeRing(playback_buffer_, playback_read_pos_, playback_write_pos_, chunk, n);
             }
         }
+        updateQueuedSamples();
     }
 
+    return startPlaybackStream();
+}
+
+bool AudioEngine::startPlaybackStream() {
     // Start playback if not already playing
     if (!is_playing_.load()) {
+        playback_deadlines_.restartInterval();
         oboe::Result result = playback_stream_->requestStart();
         if (result != oboe::Result::OK) {
             LOGE("Failed to start playback: %s", oboe::convertToText(result));
@@ -192,6 +385,7 @@ bool AudioEngine::queuePlayback(const float* audio_data, int32_t frame_count) {
         LOGI("Audio playback started");
     }
 
+    publishTelemetry();
     return true;
 }
 
@@ -211,16 +405,142 @@ void AudioEngine::stopPlayback() {
         std::lock_guard<std::mutex> lock(playback_mutex_);
         playback_read_pos_ = 0;
         playback_write_pos_ = 0;
+        updateQueuedSamples();
+        loudness_.flush();
+        loudness_drained_ = 0;
     }
 
+    publishTelemetry();
     LOGI("Audio playback stopped");
 }
 
+float AudioEngine::getQueuedPlaybackSeconds() {
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(playback_mutex_);
+        queued = (playback_write_pos_ + PLAYBACK_BUFFER_SIZE - playback_read_pos_) % PLAYBACK_BUFFER_SIZE;
+    }
+    return static_cast<float>(queued) / static_cast<float>(std::max(1, config_.sample_rate * config_.channel_count));
+}
+
+void AudioEngine::setOnsetConfig(const OnsetConfig& config) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    OnsetConfig onset_config = config;
+    onset_config.sample_rate = config_.sample_rate;
+    onset_detector_.configure(onset_config);
+    if (config.enabled && config_.channel_count != 1) {
+        LOGW("Onset detection needs mono capture; channel_count=%d", config_.channel_count);
+    }
+}
+
+int32_t AudioEngine::drainOnsets(OnsetEvent* out, int32_t capacity) {
+    return onset_detector_.drain(out, capacity);
+}
+
+void AudioEngine::setLoudnessConfig(const LoudnessConfig& config) {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+    loudness_config_ = config;
+    loudness_.configure(loudness_config_, config_.sample_rate, config_.channel_count);
+    loudness_drained_ = 0;
+    LOGI("Playback loudness %s: target %.1f LUFS, ceiling %.1f dBFS, look-ahead %.1f ms",
+         config.enabled ? "on" : "off", config.target_lufs, config.ceiling_db, config.lookahead_ms);
+}
+
+LoudnessStats AudioEngine::getLoudnessStats() {
+    std::lock_guard<std::mutex> lock(playback_mutex_);
+    return loudness_.getStats();
+}
+
+DeadlineStats AudioEngine::getDeadlineStats(bool capture) const {
+    return capture ? capture_deadlines_.stats() : playback_deadlines_.stats();
+}
+
+void AudioEngine::resetDeadlineStats() {
+    capture_deadlines_.reset();
+    playback_deadlines_.reset();
+    publishTelemetry();
+}
+
+bool AudioEngine::attachTelemetry(void* memory, size_t capacity) {
+    if (memory == nullptr) {
+        telemetry_.detach();
+        return true;
+    }
+    if (!telemetry_.attach(memory, capacity, TelemetryLayout::AUDIO, kTelemetryFields)) {
+        LOGE("Telemetry block needs %zu aligned bytes, got %zu",
+             TelemetryBlock::bytesFor(kTelemetryFields), capacity);
+        return false;
+    }
+    publishTelemetry();
+    return true;
+}
+
+void AudioEngine::publishTelemetry() {
+    telemetry_.publish([this](int64_t* values) {
+        const DeadlineStats capture = capture_deadlines_.stats();
+        const DeadlineStats playback = playback_deadlines_.stats();
+        values[0] = (is_capturing_.load() ? 1 : 0) | (is_playing_.load() ? 2 : 0);
+        values[1] = queued_samples_.load(std::memory_order_relaxed);
+        values[2] = capture_frames_.load(std::memory_order_relaxed);
+        values[3] = capture_xruns_.load(std::memory_order_relaxed);
+        values[4] = playback_xruns_.load(std::memory_order_relaxed);
+        values[5] = capture.misses + capture.loaded_misses;
+        values[6] = playback.misses + playback.loaded_misses;
+    });
+}
+
+void AudioEngine::updateQueuedSamples() {
+    // Caller holds playback_mutex_
+    queued_samples_.store(
+        static_cast<int64_t>((playback_write_pos_ + PLAYBACK_BUFFER_SIZE - playback_read_pos_) % PLAYBACK_BUFFER_SIZE),
+        std::memory_order_relaxed);
+}
+
 oboe::DataCallbackResult AudioEngine::onAudioReady(
     oboe::AudioStream* stream,
     void* audioData,
     int32_t numFrames) {
 
+    // Keep the callback thread off the cores inference runs on
+    thread_local bool promoted = false;
+    if (!promoted) {
+        promoted = true;
+        bool raised = promoteAudioThread();
+        LOGI("Audio callback thread: core %d, raised priority %s",
+             reservedAudioCore(), raised ? "yes" : "no");
+    }
+
+    const bool under_load = computeLoadActive();
+    auto start = std::chrono::steady_clock::now();
+    oboe::DataCallbackResult result = processAudio(stream, audioData, numFrames);
+    auto end = std::chrono::steady_clock::now();
+
+    const int64_t period_us =
+        static_cast<int64_t>(numFrames) * 1000000 / std::max(1, stream->getSampleRate());
+    const bool input = stream->getDirection() == oboe::Direction::Input;
+    DeadlineMonitor& monitor = input ? capture_deadlines_ : playback_deadlines_;
+    monitor.record(
+        std::chrono::duration_cast<std::chrono::microseconds>(start.time_since_epoch()).count(),
+        std::chrono::duration_cast<std::chrono::microseconds>(end.time_since_epoch()).count(),
+        period_us,
+        under_load);
+
+    if (telemetry_.attached()) {
+        // Not every backend counts xruns (OpenSL ES doesn't)
+        auto xruns = stream->getXRunCount();
+        if (xruns) {
+            (input ? capture_xruns_ : playback_xruns_).store(xruns.value(), std::memory_order_relaxed);
+        }
+        publishTelemetry();
+    }
+    return result;
+}
+
+oboe::DataCallbackResult AudioEngine::processAudio(
+    oboe::AudioStream* stream,
+    void* audioData,
+    int32_t numFrames) {
+
     if (stream->getDirection() == oboe::Direction::Input) {
         // Handle capture callback
         if (!is_capturing_.load()) {
@@ -228,10 +548,46 @@ oboe::DataCallbackResult AudioEngine::onAudioReady(
         }
 
         std::lock_guard<std::mutex> lock(callback_mutex_);
+        const int32_t channels = std::max(1, stream->getChannelCount());
+        const int64_t first_frame = capture_frames_.load(std::memory_order_relaxed);
+        capture_frames_.store(first_frame + numFrames, std::memory_order_relaxed);
+
+        // Onsets are found on float samples, sharing the float conversion when there is one
+        const bool onsets = onset_detector_.enabled() && channels == 1;
+        if (capture_stream_format_ == SampleFormat::FLOAT) {
+            if (onsets) {
+                detectOnsets(stream, static_cast<const float*>(audioData), numFrames,
+                             first_frame, first_frame, numFrames);
+            }
+        } else if (capture_callback_ || onsets) {
+            int64_t frame = first_frame;
+            convertInChunks(static_cast<const int16_t*>(audioData), numFrames, channels,
+                            capture_convert_, int16ToFloat,
+                            [&](const float* data, int32_t frames) {
+                                if (onsets) {
+                                    detectOnsets(stream, data, frames, frame, first_frame, numFrames);
+                                }
+                                if (capture_callback_) {
+                                    capture_callback_(data, frames, user_data_);
+                                }
+                                frame += frames;
+                            });
+        }
+
         if (capture_callback_) {
-            // Audio data is already float format (we requested Float in builder)
-            const float* floatData = static_cast<const float*>(audioData);
-            capture_callback_(floatData, numFrames, user_data_);
+            if (capture_stream_format_ == SampleFormat::FLOAT) {
+                capture_callback_(static_cast<const float*>(audioData), numFrames, user_data_);
+            }
+        } else if (capture_callback_i16_) {
+            if (capture_stream_format_ == SampleFormat::I16) {
+                capture_callback_i16_(static_cast<const int16_t*>(audioData), numFrames, user_data_);
+            } else {
+                convertInChunks(static_cast<const float*>(audioData), numFrames, channels,
+                                capture_convert_i16_, floatToInt16,
+                                [this](const int16_t* data, int32_t frames) {
+                                    capture_callback_i16_(data, frames, user_data_);
+                                });
+            }
         }
 
         return oboe::DataCallbackResult::Continue;
@@ -241,20 +597,52 @@ oboe::DataCallbackResult AudioEngine::onAudioReady(
             return oboe::DataCallbackResult::Stop;
         }
 
-        float* outputBuffer = static_cast<float*>(audioData);
-
         std::lock_guard<std::mutex> lock(playback_mutex_);
 
-        for (int32_t i = 0; i < numFrames; ++i) {
-            if (playback_read_pos_ != playback_write_pos_) {
-                outputBuffer[i] = playback_buffer_[playback_read_pos_];
-                playback_read_pos_ = (playback_read_pos_ + 1) % PLAYBACK_BUFFER_SIZE;
+        const int32_t channels = std::max(1, stream->getChannelCount());
+        if (loudness_.enabled()) {
+            const bool drained = renderLoudness(audioData, numFrames, channels);
+            updateQueuedSamples();
+            if (drained) {
+                is_playing_.store(false);
+                return oboe::DataCallbackResult::Stop;
+            }
+            return oboe::DataCallbackResult::Continue;
+        }
+
+        // Underruns are padded with silence; a format mismatch costs one conversion pass
+        const bool queue_i16 = config_.playback_format == SampleFormat::I16;
+        if (queue_i16 == (playback_stream_format_ == SampleFormat::I16)) {
+            const size_t count = static_cast<size_t>(numFrames) * channels;
+            if (queue_i16) {
+                readRing(playback_buffer_i16_, playback_read_pos_, playback_write_pos_,
+                         static_cast<int16_t*>(audioData), count);
             } else {
-                // Buffer underrun - output silence
-                outputBuffer[i] = 0.0f;
+                readRing(playback_buffer_, playback_read_pos_, playback_write_pos_,
+                         static_cast<float*>(audioData), count);
+            }
+        } else if (queue_i16) {
+            float* output = static_cast<float*>(audioData);
+            const int32_t chunk = std::max<int32_t>(1, static_cast<int32_t>(playback_convert_i16_.size()) / channels);
+            for (int32_t done = 0; done < numFrames; done += chunk) {
+                const size_t n = static_cast<size_t>(std::min(chunk, numFrames - done)) * channels;
+                readRing(playback_buffer_i16_, playback_read_pos_, playback_write_pos_,
+                         playback_convert_i16_.data(), n);
+                int16ToFloat(playback_convert_i16_.data(), output + static_cast<size_t>(done) * channels, n);
+            }
+        } else {
+            int16_t* output = static_cast<int16_t*>(audioData);
+            const int32_t chunk = std::max<int32_t>(1, static_cast<int32_t>(playback_convert_.size()) / channels);
+            for (int32_t done = 0; done < numFrames; done += chunk) {
+                const size_t n = static_cast<size_t>(std::min(chunk, numFrames - done)) * channels;
+                readRing(playback_buffer_, playback_read_pos_, playback_write_pos_,
+                         playback_convert_.data(), n);
+                floatToInt16(playback_convert_.data(), output + static_cast<size_t>(done) * channels, n);
             }
         }
 
+        updateQueuedSamples();
+
         // Check if we should stop (buffer empty)
         if (playback_read_pos_ == playback_write_pos_) {
             is_playing_.store(false);
@@ -265,6 +653,86 @@ oboe::DataCallbackResult AudioEngine::onAudioReady(
     }
 }
 
+void AudioEngine::detectOnsets(
+    oboe::AudioStream* stream,
+    const float* samples,
+    int32_t frames,
+    int64_t first_frame,
+    int64_t callback_first_frame,
+    int32_t callback_frames) {
+
+    int64_t onset = 0;
+    float level_db = 0.0f;
+    if (!onset_detector_.process(samples, frames, first_frame, onset, level_db)) {
+        return;
+    }
+
+    // Position in the stream's own frame count, which its timestamps use;
+    // it advances once this callback returns
+    const int64_t stream_frame = stream->getFramesRead() + (onset - callback_first_frame);
+    const double ns_per_frame = 1e9 / std::max(1, stream->getSampleRate());
+
+    OnsetEvent event;
+    event.frame = stream_frame;
+    event.level_db = level_db;
+    auto timestamp = stream->getTimestamp(CLOCK_MONOTONIC);
+    if (timestamp) {
+        // Hardware capture time of a known frame, extrapolated to the onset
+        const oboe::FrameTimestamp stamp = timestamp.value();
+        event.time_ns = stamp.timestamp + static_cast<int64_t>((stream_frame - stamp.position) * ns_per_frame);
+        event.precise = true;
+    } else {
+        // No timestamp (e.g. OpenSL ES): assume the buffer's last frame just arrived
+        timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const int64_t now_ns = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+        const int64_t behind = callback_first_frame + callback_frames - onset;
+        event.time_ns = now_ns - static_cast<int64_t>(behind * ns_per_frame);
+        event.precise = false;
+    }
+    onset_detector_.publish(event);
+}
+
+bool AudioEngine::renderLoudness(void* audioData, int32_t numFrames, int32_t channels) {
+    // Processing runs on float whatever the queue and device formats are
+    const bool queue_i16 = config_.playback_format == SampleFormat::I16;
+    size_t scratch = loudness_work_.size();
+    if (queue_i16) {
+        scratch = std::min(scratch, playback_convert_i16_.size());
+    }
+    const int32_t chunk = std::max<int32_t>(1, static_cast<int32_t>(scratch) / channels);
+    for (int32_t done = 0; done < numFrames; done += chunk) {
+        const size_t n = static_cast<size_t>(std::min(chunk, numFrames - done)) * channels;
+        const size_t offset = static_cast<size_t>(done) * channels;
+        float* work = loudness_work_.data();
+
+        size_t taken;
+        if (queue_i16) {
+            taken = readRing(playback_buffer_i16_, playback_read_pos_, playback_write_pos_,
+                             playback_convert_i16_.data(), n);
+            int16ToFloat(playback_convert_i16_.data(), work, n);
+        } else {
+            taken = readRing(playback_buffer_, playback_read_pos_, playback_write_pos_, work, n);
+        }
+        if (taken == n) {
+            loudness_drained_ = 0;
+        } else {
+            loudness_drained_ = (taken > 0 ? 0 : loudness_drained_) + static_cast<int32_t>(n - taken);
+        }
+
+        loudness_.process(work, static_cast<int32_t>(n));
+
+        if (playback_stream_format_ == SampleFormat::I16) {
+            floatToInt16(work, static_cast<int16_t*>(audioData) + offset, n);
+        } else {
+            std::copy(work, work + n, static_cast<float*>(audioData) + offset);
+        }
+    }
+
+    // Keep running until the look-ahead has played out the queue's tail
+    return playback_read_pos_ == playback_write_pos_ && loudness_drained_ >= loudness_.latencySamples();
+}
+
 void AudioEngine::onErrorBeforeClose(oboe::AudioStream* stream, oboe::Result result) {
     LOGE("Audio stream error before close: %s", oboe::convertToText(result));
 }
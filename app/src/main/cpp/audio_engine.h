@@ -8,6 +8,11 @@
 #include <mutex>
 #include <vector>
 #include <oboe/Oboe.h>
+#include "deadline_monitor.h"
+#include "loudness.h"
+#include "onset_detector.h"
+#include "sample_convert.h"
+#include "telemetry_block.h"
 
 namespace unamentis {
 
@@ -18,6 +23,8 @@ struct AudioConfig {
     int32_t sample_rate = 16000;      // 16kHz for STT compatibility
     int32_t channel_count = 1;         // Mono audio
     int32_t frames_per_burst = 192;    // ~12ms at 16kHz
+    SampleFormat capture_format = SampleFormat::FLOAT;   // Format delivered to the capture callback
+    SampleFormat playback_format = SampleFormat::FLOAT;  // Format the playback queue holds
 };
 
 /**
@@ -29,6 +36,15 @@ struct AudioConfig {
  */
 using AudioCallback = std::function<void(const float* audio_data, int32_t frame_count, void* user_data)>;
 
+/**
+ * Callback function for int16 audio data (capture_format I16).
+ *
+ * @param audio_data Pointer to audio samples (16-bit signed)
+ * @param frame_count Number of frames (samples for mono)
+ * @param user_data User-provided context pointer
+ */
+using AudioCallbackI16 = std::function<void(const int16_t* audio_data, int32_t frame_count, void* user_data)>;
+
 /**
  * Low-latency audio engine using Oboe.
  *
@@ -39,6 +55,14 @@ using AudioCallback = std::function<void(const float* audio_data, int32_t frame_
  * - Automatic AAudio/OpenSL ES selection
  * - Low-latency audio capture at 16kHz
  * - Configurable buffer sizes
+ * - Float or int16 capture and playback; streams are opened in the
+ *   consumer's format and, if the device picks the other one, converted
+ *   once in the callback with vectorized kernels
+ * - Speech onset detection on the capture thread, timed from the stream's
+ *   frame position rather than from when the app hears about it
+ * - Playback loudness normalization and look-ahead limiting, so audio from
+ *   different TTS providers can be queued as it arrives
+ * - Live counters in a shared telemetry block, readable without JNI calls
  * - Thread-safe callbacks
  */
 class AudioEngine : public oboe::AudioStreamCallback {
@@ -63,6 +87,11 @@ public:
      */
     bool startCapture(AudioCallback callback, void* user_data);
 
+    /**
+     * Start audio capture with int16 delivery (capture_format I16).
+     */
+    bool startCapture(AudioCallbackI16 callback, void* user_data);
+
     /**
      * Stop audio capture.
      */
@@ -77,11 +106,69 @@ public:
      */
     bool queuePlayback(const float* audio_data, int32_t frame_count);
 
+    /**
+     * Queue int16 audio data for playback.
+     *
+     * @param audio_data Audio samples to play (16-bit signed)
+     * @param frame_count Number of frames
+     * @return true if data was queued successfully
+     */
+    bool queuePlayback(const int16_t* audio_data, int32_t frame_count);
+
     /**
      * Stop audio playback and clear buffer.
      */
     void stopPlayback();
 
+    /**
+     * Get the duration of audio queued but not yet played, in seconds.
+     */
+    float getQueuedPlaybackSeconds();
+
+    /**
+     * Enable or tune speech onset detection on mono capture (off by default).
+     */
+    void setOnsetConfig(const OnsetConfig& config);
+
+    /**
+     * Take onsets detected since the last call.
+     *
+     * @return Number of events written to out
+     */
+    int32_t drainOnsets(OnsetEvent* out, int32_t capacity);
+
+    /**
+     * Set playback loudness normalization and limiting (enabled by default).
+     */
+    void setLoudnessConfig(const LoudnessConfig& config);
+
+    /**
+     * Get playback loudness and limiter state.
+     */
+    LoudnessStats getLoudnessStats();
+
+    /**
+     * Get callback deadline counters for the capture or playback stream.
+     */
+    DeadlineStats getDeadlineStats(bool capture) const;
+
+    /**
+     * Clear callback deadline counters for both streams.
+     */
+    void resetDeadlineStats();
+
+    /**
+     * Publish live counters into shared memory (see telemetry_block.h), or
+     * stop publishing when memory is null. Fields, in order:
+     * [flags (1 capturing, 2 playing), queuedPlaybackSamples, capturedFrames,
+     *  captureXRuns, playbackXRuns, captureDeadlineMisses, playbackDeadlineMisses]
+     *
+     * @return false if the memory can't hold the block
+     */
+    bool attachTelemetry(void* memory, size_t capacity);
+
+    static constexpr int32_t kTelemetryFields = 7;
+
     /**
      * Check if currently capturing.
      */
@@ -114,21 +201,65 @@ private:
     // Capture stream
     std::shared_ptr<oboe::AudioStream> capture_stream_;
     AudioCallback capture_callback_;
+    AudioCallbackI16 capture_callback_i16_;
     void* user_data_ = nullptr;
     std::mutex callback_mutex_;
+    SampleFormat capture_stream_format_ = SampleFormat::FLOAT;   // What the device delivers
+
+    // Onset detection (guarded by callback_mutex_; events are lock-free)
+    OnsetDetector onset_detector_;
+    std::atomic<int64_t> capture_frames_{0};   // Frames delivered since capture started (callback thread)
 
-    // Playback stream
+    // Playback stream; the queue holds playback_format samples
     std::shared_ptr<oboe::AudioStream> playback_stream_;
     std::vector<float> playback_buffer_;
+    std::vector<int16_t> playback_buffer_i16_;
     std::mutex playback_mutex_;
     size_t playback_read_pos_ = 0;
     size_t playback_write_pos_ = 0;
+    SampleFormat playback_stream_format_ = SampleFormat::FLOAT;  // What the device consumes
 
-    // Conversion buffer for int16 to float
-    std::vector<float> conversion_buffer_;
+    // Playback loudness processing (guarded by playback_mutex_)
+    LoudnessConfig loudness_config_;
+    LoudnessProcessor loudness_;
+    int32_t loudness_drained_ = 0;     // Silence fed since the queue ran dry
+    std::vector<float> loudness_work_; // Float samples being processed, one chunk per pass
+
+    // Scratch for converting between the device and consumer formats. The
+    // streams call back on separate threads, so each direction has its own,
+    // guarded by that direction's mutex.
+    std::vector<float> capture_convert_;
+    std::vector<int16_t> capture_convert_i16_;
+    std::vector<float> playback_convert_;
+    std::vector<int16_t> playback_convert_i16_;
+
+    // Callback deadline tracking, one per callback thread
+    DeadlineMonitor capture_deadlines_;
+    DeadlineMonitor playback_deadlines_;
+
+    // Live counters; the block is written from control and callback threads
+    TelemetryBlock telemetry_;
+    std::atomic<int64_t> queued_samples_{0};
+    std::atomic<int32_t> capture_xruns_{0};
+    std::atomic<int32_t> playback_xruns_{0};
+
+    oboe::DataCallbackResult processAudio(
+        oboe::AudioStream* stream,
+        void* audioData,
+        int32_t numFrames);
+    void publishTelemetry();
+    void updateQueuedSamples();
+    bool renderLoudness(void* audioData, int32_t numFrames, int32_t channels);
+    void detectOnsets(oboe::AudioStream* stream, const float* samples, int32_t frames,
+                      int64_t first_frame, int64_t callback_first_frame, int32_t callback_frames);
 
+    bool startCaptureStream();
+    bool startPlaybackStream();
     bool createCaptureStream();
     bool createPlaybackStream();
+    bool openStream(oboe::AudioStreamBuilder& builder, SampleFormat format,
+                    std::shared_ptr<oboe::AudioStream>& stream, SampleFormat& stream_format);
+    void reserveConversion(const oboe::AudioStream& stream);
     void closeStreams();
 };
 
@@ -1,6 +1,8 @@
 #include <jni.h>
 #include <android/log.h>
 #include "audio_engine.h"
+#include "telemetry_jni.h"
+#include "thread_policy.h"
 #include <memory>
 #include <map>
 
@@ -23,6 +25,77 @@ struct CallbackContext {
 // Store callback contexts
 static std::map<jlong, std::unique_ptr<CallbackContext>> g_callbacks;
 
+// Buffers engines publish live counters into
+static unamentis::TelemetryBuffers g_telemetry_buffers;
+
+// Attaches the calling audio thread to the JVM for one callback
+class ScopedJniEnv {
+public:
+    ScopedJniEnv() {
+        if (g_jvm == nullptr) {
+            LOGE("JavaVM not available");
+            return;
+        }
+
+        // Check if current thread is attached to JVM
+        jint result = g_jvm->GetEnv(reinterpret_cast<void**>(&env_), JNI_VERSION_1_6);
+
+        if (result == JNI_EDETACHED) {
+            // Attach current thread to JVM
+            JavaVMAttachArgs args;
+            args.version = JNI_VERSION_1_6;
+            args.name = const_cast<char*>("OboeAudioThread");
+            args.group = nullptr;
+
+            if (g_jvm->AttachCurrentThread(&env_, &args) != JNI_OK) {
+                LOGE("Failed to attach audio thread to JVM");
+                env_ = nullptr;
+                return;
+            }
+            needs_detach_ = true;
+        } else if (result != JNI_OK) {
+            LOGE("Failed to get JNIEnv: %d", result);
+            env_ = nullptr;
+        }
+    }
+
+    ~ScopedJniEnv() {
+        // Detach if we attached
+        if (needs_detach_) {
+            g_jvm->DetachCurrentThread();
+        }
+    }
+
+    ScopedJniEnv(const ScopedJniEnv&) = delete;
+    ScopedJniEnv& operator=(const ScopedJniEnv&) = delete;
+
+    JNIEnv* get() const { return env_; }
+
+private:
+    JNIEnv* env_ = nullptr;
+    bool needs_detach_ = false;
+};
+
+// Call the Java callback with the audio as a new array
+static void deliverToJava(CallbackContext* ctx, JNIEnv* env, jarray java_array) {
+    if (java_array == nullptr) {
+        LOGE("Failed to create audio array");
+        return;
+    }
+
+    // Call Java callback method
+    env->CallVoidMethod(ctx->java_object, ctx->callback_method, java_array);
+
+    // Check for exceptions
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        env->ExceptionClear();
+    }
+
+    // Clean up local reference
+    env->DeleteLocalRef(java_array);
+}
+
 extern "C" {
 
 JNIEXPORT jint JNICALL
@@ -60,7 +133,9 @@ Java_com_unamentis_core_audio_AudioEngine_nativeInitialize(
     jlong engine_ptr,
     jint sample_rate,
     jint channel_count,
-    jint frames_per_burst
+    jint frames_per_burst,
+    jint capture_format,
+    jint playback_format
 ) {
     auto it = g_engines.find(engine_ptr);
     if (it == g_engines.end()) {
@@ -72,6 +147,8 @@ Java_com_unamentis_core_audio_AudioEngine_nativeInitialize(
     config.sample_rate = sample_rate;
     config.channel_count = channel_count;
     config.frames_per_burst = frames_per_burst;
+    config.capture_format = static_cast<unamentis::SampleFormat>(capture_format);
+    config.playback_format = static_cast<unamentis::SampleFormat>(playback_format);
 
     bool success = it->second->initialize(config);
     return success ? JNI_TRUE : JNI_FALSE;
@@ -102,11 +179,13 @@ Java_com_unamentis_core_audio_AudioEngine_nativeStartCapture(
         return JNI_FALSE;
     }
 
-    // Get the callback method ID
+    // Get the callback method ID for the configured capture format
+    const bool capture_i16 = it->second->getConfig().capture_format == unamentis::SampleFormat::I16;
+    const char* method_name = capture_i16 ? "onNativeAudioDataI16" : "onNativeAudioData";
     jclass clazz = env->GetObjectClass(thiz);
-    context->callback_method = env->GetMethodID(clazz, "onNativeAudioData", "([F)V");
+    context->callback_method = env->GetMethodID(clazz, method_name, capture_i16 ? "([S)V" : "([F)V");
     if (context->callback_method == nullptr) {
-        LOGE("Failed to find onNativeAudioData method");
+        LOGE("Failed to find %s method", method_name);
         env->DeleteGlobalRef(context->java_object);
         return JNI_FALSE;
     }
@@ -116,66 +195,38 @@ Java_com_unamentis_core_audio_AudioEngine_nativeStartCapture(
     g_callbacks[engine_ptr] = std::move(context);
 
     // Define callback that will invoke Java method
-    auto callback = [ctx_ptr](const float* audio_data, int32_t frame_count, void* user_data) {
-        if (g_jvm == nullptr) {
-            LOGE("JavaVM not available");
-            return;
-        }
-
-        JNIEnv* callback_env = nullptr;
-        bool needs_detach = false;
-
-        // Check if current thread is attached to JVM
-        jint result = g_jvm->GetEnv(reinterpret_cast<void**>(&callback_env), JNI_VERSION_1_6);
-
-        if (result == JNI_EDETACHED) {
-            // Attach current thread to JVM
-            JavaVMAttachArgs args;
-            args.version = JNI_VERSION_1_6;
-            args.name = const_cast<char*>("OboeAudioThread");
-            args.group = nullptr;
-
-            if (g_jvm->AttachCurrentThread(&callback_env, &args) != JNI_OK) {
-                LOGE("Failed to attach audio thread to JVM");
-                return;
-            }
-            needs_detach = true;
-        } else if (result != JNI_OK) {
-            LOGE("Failed to get JNIEnv: %d", result);
-            return;
-        }
-
-        // Create float array and copy audio data
-        jfloatArray java_array = callback_env->NewFloatArray(frame_count);
-        if (java_array == nullptr) {
-            LOGE("Failed to create float array");
-            if (needs_detach) {
-                g_jvm->DetachCurrentThread();
-            }
-            return;
-        }
-
-        callback_env->SetFloatArrayRegion(java_array, 0, frame_count, audio_data);
-
-        // Call Java callback method
-        callback_env->CallVoidMethod(ctx_ptr->java_object, ctx_ptr->callback_method, java_array);
-
-        // Check for exceptions
-        if (callback_env->ExceptionCheck()) {
-            callback_env->ExceptionDescribe();
-            callback_env->ExceptionClear();
-        }
-
-        // Clean up local reference
-        callback_env->DeleteLocalRef(java_array);
-
-        // Detach if we attached
-        if (needs_detach) {
-            g_jvm->DetachCurrentThread();
-        }
-    };
-
-    bool success = it->second->startCapture(callback, ctx_ptr);
+    bool success;
+    if (capture_i16) {
+        success = it->second->startCapture(
+            unamentis::AudioCallbackI16([ctx_ptr](const int16_t* audio_data, int32_t frame_count, void*) {
+                ScopedJniEnv scoped;
+                JNIEnv* callback_env = scoped.get();
+                if (callback_env == nullptr) {
+                    return;
+                }
+                jshortArray java_array = callback_env->NewShortArray(frame_count);
+                if (java_array != nullptr) {
+                    callback_env->SetShortArrayRegion(java_array, 0, frame_count, audio_data);
+                }
+                deliverToJava(ctx_ptr, callback_env, java_array);
+            }),
+            ctx_ptr);
+    } else {
+        success = it->second->startCapture(
+            unamentis::AudioCallback([ctx_ptr](const float* audio_data, int32_t frame_count, void*) {
+                ScopedJniEnv scoped;
+                JNIEnv* callback_env = scoped.get();
+                if (callback_env == nullptr) {
+                    return;
+                }
+                jfloatArray java_array = callback_env->NewFloatArray(frame_count);
+                if (java_array != nullptr) {
+                    callback_env->SetFloatArrayRegion(java_array, 0, frame_count, audio_data);
+                }
+                deliverToJava(ctx_ptr, callback_env, java_array);
+            }),
+            ctx_ptr);
+    }
     if (!success) {
         // Clean up on failure
         env->DeleteGlobalRef(ctx_ptr->java_object);
@@ -238,6 +289,35 @@ Java_com_unamentis_core_audio_AudioEngine_nativeQueuePlayback(
     return success ? JNI_TRUE : JNI_FALSE;
 }
 
+/**
+ * Queue int16 audio for playback.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeQueuePlaybackI16(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr,
+    jshortArray audio_data
+) {
+    auto it = g_engines.find(engine_ptr);
+    if (it == g_engines.end()) {
+        LOGE("Invalid engine pointer: %lld", (long long)engine_ptr);
+        return JNI_FALSE;
+    }
+
+    jsize length = env->GetArrayLength(audio_data);
+    jshort* samples = env->GetShortArrayElements(audio_data, nullptr);
+    if (samples == nullptr) {
+        return JNI_FALSE;
+    }
+
+    bool success = it->second->queuePlayback(reinterpret_cast<const int16_t*>(samples), length);
+
+    env->ReleaseShortArrayElements(audio_data, samples, JNI_ABORT);
+
+    return success ? JNI_TRUE : JNI_FALSE;
+}
+
 /**
  * Stop audio playback.
  */
@@ -256,6 +336,231 @@ Java_com_unamentis_core_audio_AudioEngine_nativeStopPlayback(
     it->second->stopPlayback();
 }
 
+/**
+ * Get seconds of audio queued for playback.
+ */
+JNIEXPORT jfloat JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeGetQueuedPlaybackSeconds(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr
+) {
+    auto it = g_engines.find(engine_ptr);
+    if (it == g_engines.end()) {
+        return 0.0f;
+    }
+    return it->second->getQueuedPlaybackSeconds();
+}
+
+/**
+ * Reserve a core for audio, away from inference threads (process-wide).
+ */
+JNIEXPORT void JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeSetAudioIsolation(
+    JNIEnv* env,
+    jobject /* this */,
+    jboolean enabled
+) {
+    unamentis::setAudioIsolation(enabled == JNI_TRUE);
+    LOGI("Audio isolation %s (reserved core %d)",
+         enabled == JNI_TRUE ? "enabled" : "disabled", unamentis::reservedAudioCore());
+}
+
+/**
+ * Configure speech onset detection on the capture stream.
+ */
+JNIEXPORT void JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeSetOnsetDetection(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr,
+    jboolean enabled,
+    jfloat margin_db,
+    jfloat flux_db,
+    jint confirm_ms,
+    jint release_ms
+) {
+    auto it = g_engines.find(engine_ptr);
+    if (it == g_engines.end()) {
+        LOGE("Invalid engine pointer: %lld", (long long)engine_ptr);
+        return;
+    }
+
+    unamentis::OnsetConfig config;
+    config.enabled = enabled == JNI_TRUE;
+    config.margin_db = margin_db;
+    config.flux_db = flux_db;
+    config.confirm_ms = confirm_ms;
+    config.release_ms = release_ms;
+    it->second->setOnsetConfig(config);
+}
+
+/**
+ * Take detected onsets, three values per onset:
+ * [frame, monotonicNanos, precise (1/0), ...]
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeDrainOnsets(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr
+) {
+    unamentis::OnsetEvent events[unamentis::OnsetDetector::kMaxEvents];
+    int32_t count = 0;
+
+    auto it = g_engines.find(engine_ptr);
+    if (it != g_engines.end()) {
+        count = it->second->drainOnsets(events, unamentis::OnsetDetector::kMaxEvents);
+    }
+
+    jlong values[unamentis::OnsetDetector::kMaxEvents * 3];
+    for (int32_t i = 0; i < count; ++i) {
+        values[i * 3] = events[i].frame;
+        values[i * 3 + 1] = events[i].time_ns;
+        values[i * 3 + 2] = events[i].precise ? 1 : 0;
+    }
+
+    jlongArray result = env->NewLongArray(count * 3);
+    if (result != nullptr && count > 0) {
+        env->SetLongArrayRegion(result, 0, count * 3, values);
+    }
+    return result;
+}
+
+/**
+ * Configure playback loudness normalization and limiting.
+ */
+JNIEXPORT void JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeSetLoudness(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr,
+    jboolean enabled,
+    jfloat target_lufs,
+    jfloat max_gain_db,
+    jfloat ceiling_db,
+    jfloat lookahead_ms
+) {
+    auto it = g_engines.find(engine_ptr);
+    if (it == g_engines.end()) {
+        LOGE("Invalid engine pointer: %lld", (long long)engine_ptr);
+        return;
+    }
+
+    unamentis::LoudnessConfig config;
+    config.enabled = enabled == JNI_TRUE;
+    config.target_lufs = target_lufs;
+    config.max_gain_db = max_gain_db;
+    config.ceiling_db = ceiling_db;
+    config.lookahead_ms = lookahead_ms;
+    it->second->setLoudnessConfig(config);
+}
+
+/**
+ * Get playback loudness state:
+ * [shortTermLufs, gainDb, maxReductionDb, limitedSamples]
+ */
+JNIEXPORT jfloatArray JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeGetLoudnessStats(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr
+) {
+    jfloat values[4] = {-70.0f, 0.0f, 0.0f, 0.0f};
+
+    auto it = g_engines.find(engine_ptr);
+    if (it != g_engines.end()) {
+        unamentis::LoudnessStats stats = it->second->getLoudnessStats();
+        values[0] = stats.short_term_lufs;
+        values[1] = stats.gain_db;
+        values[2] = stats.max_reduction_db;
+        values[3] = static_cast<jfloat>(stats.limited_samples);
+    }
+
+    jfloatArray result = env->NewFloatArray(4);
+    if (result != nullptr) {
+        env->SetFloatArrayRegion(result, 0, 4, values);
+    }
+    return result;
+}
+
+/**
+ * Get callback deadline counters:
+ * [callbacks, misses, loadedCallbacks, loadedMisses, maxCallbackUs, maxIntervalUs]
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeGetDeadlineStats(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr,
+    jboolean capture
+) {
+    jlong values[6] = {0, 0, 0, 0, 0, 0};
+
+    auto it = g_engines.find(engine_ptr);
+    if (it != g_engines.end()) {
+        unamentis::DeadlineStats stats = it->second->getDeadlineStats(capture == JNI_TRUE);
+        values[0] = stats.callbacks;
+        values[1] = stats.misses;
+        values[2] = stats.loaded_callbacks;
+        values[3] = stats.loaded_misses;
+        values[4] = stats.max_callback_us;
+        values[5] = stats.max_interval_us;
+    }
+
+    jlongArray result = env->NewLongArray(6);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 6, values);
+    }
+    return result;
+}
+
+/**
+ * Clear callback deadline counters.
+ */
+JNIEXPORT void JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeResetDeadlineStats(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr
+) {
+    auto it = g_engines.find(engine_ptr);
+    if (it != g_engines.end()) {
+        it->second->resetDeadlineStats();
+    }
+}
+
+/**
+ * Publish live counters into a direct ByteBuffer (null stops publishing).
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_unamentis_core_audio_AudioEngine_nativeAttachTelemetry(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong engine_ptr,
+    jobject buffer
+) {
+    auto it = g_engines.find(engine_ptr);
+    if (it == g_engines.end()) {
+        return JNI_FALSE;
+    }
+
+    // Detach before the old buffer can be collected
+    it->second->attachTelemetry(nullptr, 0);
+    g_telemetry_buffers.release(env, engine_ptr);
+    if (buffer == nullptr) {
+        return JNI_TRUE;
+    }
+
+    jlong capacity = 0;
+    void* memory = g_telemetry_buffers.hold(env, engine_ptr, buffer, capacity);
+    if (memory == nullptr || !it->second->attachTelemetry(memory, static_cast<size_t>(capacity))) {
+        g_telemetry_buffers.release(env, engine_ptr);
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
 /**
  * Check if currently capturing.
  */
@@ -314,6 +619,7 @@ Java_com_unamentis_core_audio_AudioEngine_nativeDestroy(
 
     LOGI("Destroying native AudioEngine: %lld", (long long)engine_ptr);
     g_engines.erase(it);
+    g_telemetry_buffers.release(env, engine_ptr);
 }
 
 } // extern "C"
@@ -0,0 +1,473 @@
+// UnaMentis - DSP Kernel Microbenchmarks
+// ns/sample for each native audio kernel, checked against stored baselines
+//
+// Runs every kernel over several burst sizes, with buffers either 64-byte
+// aligned or offset by one sample, and reports the best ns/sample as
+// JSON. Given a baseline file, a kernel counts as regressed when it is
+// slower than its baseline by more than that kernel's allowed ratio, and
+// the exit status is 1.
+//
+// Usage:
+//   dsp_bench [--baseline FILE] [--write-baseline FILE] [--output FILE]
+//             [--filter NAME] [--bursts 32,192,...] [--min-time-ms N]
+
+#include "dsp_kernels.h"
+#include "endpoint_detector.h"
+#include "loudness.h"
+#include "onset_detector.h"
+#include "pcm_ring.h"
+#include "sample_convert.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef DSP_BENCH_FLAGS
+#define DSP_BENCH_FLAGS "unknown"
+#endif
+
+using namespace unamentis;
+
+namespace {
+
+constexpr int32_t kSampleRate = 16000;
+constexpr size_t kSignalSamples = kSampleRate * 4;   // 4 s of test signal per pass
+constexpr size_t kHotSamples = 4096;                  // Window the stateless kernels cycle over
+constexpr int32_t kRuns = 9;                          // Timed runs per case; the fastest is reported
+
+const char* architecture() {
+#if defined(__aarch64__)
+    return "arm64";
+#elif defined(__arm__)
+    return "arm";
+#elif defined(__x86_64__)
+    return "x86_64";
+#elif defined(__i386__)
+    return "x86";
+#else
+    return "unknown";
+#endif
+}
+
+const char* simdPath() {
+#if defined(UNAMENTIS_CONVERT_NEON)
+    return "neon";
+#elif defined(UNAMENTIS_CONVERT_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// 64-byte aligned storage, handed out either aligned or one element off
+template <typename T>
+class Buffer {
+public:
+    explicit Buffer(size_t count) : storage_((count + 1) * sizeof(T) + 64) {}
+
+    T* get(bool aligned) {
+        auto base = reinterpret_cast<uintptr_t>(storage_.data());
+        auto start = (base + 63) & ~static_cast<uintptr_t>(63);
+        T* p = reinterpret_cast<T*>(start);
+        return aligned ? p : p + 1;
+    }
+
+private:
+    std::vector<unsigned char> storage_;
+};
+
+// Speech-like test signal: voiced bursts with pauses, a few peaks over full scale
+std::vector<float> makeSignal() {
+    std::vector<float> signal(kSignalSamples);
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (size_t i = 0; i < signal.size(); ++i) {
+        const float t = static_cast<float>(i) / kSampleRate;
+        const bool voiced = (i / (kSampleRate / 4)) % 3 != 2;
+        const float tone = 0.3f * std::sin(2.0f * 3.14159265f * 150.0f * t) +
+                           0.1f * std::sin(2.0f * 3.14159265f * 900.0f * t);
+        signal[i] = voiced ? tone * (1.0f + 0.2f * noise(rng)) : 0.002f * noise(rng);
+        if (i % 4001 == 0) {
+            signal[i] = 1.4f;
+        }
+    }
+    return signal;
+}
+
+// Start of the burst covering sample i within the hot window. In the
+// engine a burst was just written by the previous stage, so it is in cache;
+// streaming 4 s of audio through L2 would time memory instead of the kernel.
+size_t hotOffset(size_t i, size_t burst) {
+    const size_t slots = std::max<size_t>(1, kHotSamples / burst);
+    return (i / burst % slots) * burst;
+}
+
+struct Case {
+    std::string kernel;
+    int32_t burst;
+    bool aligned;
+};
+
+struct Result {
+    Case c;
+    double ns_per_sample;
+};
+
+// Prepares a case and returns the pass to time; each pass processes
+// kSignalSamples samples in bursts
+using Pass = std::function<void()>;
+using Setup = std::function<Pass(int32_t burst, bool aligned)>;
+
+struct Kernel {
+    const char* name;
+    double max_ratio;                  // Allowed slowdown against the baseline
+    Setup setup;
+};
+
+float g_sink = 0.0f;                   // Keeps results observable so passes aren't optimized out
+
+std::vector<Kernel> makeKernels(const std::vector<float>& signal) {
+    std::vector<Kernel> kernels;
+
+    // Losing a SIMD path or adding work per sample costs 2x or more; the
+    // limits sit above run-to-run noise on a shared host, with more slack
+    // for the ring and detectors whose cost depends on burst bookkeeping.
+    // The endpoint detector takes a lock per call, which dominates small bursts.
+    kernels.push_back({"int16_to_float", 1.5, [&signal](int32_t burst, bool aligned) -> Pass {
+        auto in = std::make_shared<Buffer<int16_t>>(kHotSamples + burst);
+        auto out = std::make_shared<Buffer<float>>(kHotSamples + burst);
+        floatToInt16(signal.data(), in->get(aligned), kHotSamples + burst);
+        return [in, out, burst, aligned]() {
+            const int16_t* src = in->get(aligned);
+            float* dst = out->get(aligned);
+            for (size_t i = 0; i < kSignalSamples; i += burst) {
+                const size_t at = hotOffset(i, burst);
+                int16ToFloat(src + at, dst + at, std::min<size_t>(burst, kSignalSamples - i));
+            }
+            g_sink += dst[0];
+        };
+    }});
+
+    kernels.push_back({"float_to_int16", 1.5, [&signal](int32_t burst, bool aligned) -> Pass {
+        auto in = std::make_shared<Buffer<float>>(kHotSamples + burst);
+        auto out = std::make_shared<Buffer<int16_t>>(kHotSamples + burst);
+        std::copy(signal.begin(), signal.begin() + kHotSamples + burst, in->get(aligned));
+        return [in, out, burst, aligned]() {
+            const float* src = in->get(aligned);
+            int16_t* dst = out->get(aligned);
+            for (size_t i = 0; i < kSignalSamples; i += burst) {
+                const size_t at = hotOffset(i, burst);
+                floatToInt16(src + at, dst + at, std::min<size_t>(burst, kSignalSamples - i));
+            }
+            g_sink += dst[0];
+        };
+    }});
+
+    kernels.push_back({"peak_abs", 1.5, [&signal](int32_t burst, bool aligned) -> Pass {
+        auto in = std::make_shared<Buffer<float>>(kHotSamples + burst);
+        std::copy(signal.begin(), signal.begin() + kHotSamples + burst, in->get(aligned));
+        return [in, burst, aligned]() {
+            const float* src = in->get(aligned);
+            float peak = 0.0f;
+            for (size_t i = 0; i < kSignalSamples; i += burst) {
+                peak = std::max(peak, peakAbs(src + hotOffset(i, burst), std::min<size_t>(burst, kSignalSamples - i)));
+            }
+            g_sink += peak;
+        };
+    }});
+
+    kernels.push_back({"gain_ramp", 1.5, [&signal](int32_t burst, bool aligned) -> Pass {
+        auto buf = std::make_shared<Buffer<float>>(kHotSamples + burst);
+        std::copy(signal.begin(), signal.begin() + kHotSamples + burst, buf->get(aligned));
+        return [buf, burst, aligned]() {
+            float* data = buf->get(aligned);
+            // Alternate up and down so repeated passes stay in range
+            float gain = 1.0f;
+            float step = 1e-6f;
+            for (size_t i = 0; i < kSignalSamples; i += burst) {
+                const size_t n = std::min<size_t>(burst, kSignalSamples - i);
+                gain = applyGainRamp(data + hotOffset(i, burst), n, gain, step);
+                step = -step;
+            }
+            g_sink += data[0];
+        };
+    }});
+
+    kernels.push_back({"ring_write_read", 1.6, [&signal](int32_t burst, bool aligned) -> Pass {
+        auto in = std::make_shared<Buffer<float>>(kHotSamples + burst);
+        auto out = std::make_shared<Buffer<float>>(burst);
+        std::copy(signal.begin(), signal.begin() + kHotSamples + burst, in->get(aligned));
+        // Same capacity as the engine's playback queue; bursts that don't divide it wrap
+        auto ring = std::make_shared<std::vector<float>>(kSampleRate * 2);
+        return [in, out, ring, burst, aligned]() {
+            size_t read_pos = 0;
+            size_t write_pos = 0;
+            const float* src = in->get(aligned);
+            float* dst = out->get(aligned);
+            for (size_t i = 0; i < kSignalSamples; i += burst) {
+                const size_t n = std::min<size_t>(burst, kSignalSamples - i);
+                writeRing(*ring, read_pos, write_pos, src + hotOffset(i, burst), n);
+                readRing(*ring, read_pos, write_pos, dst, n);
+            }
+            g_sink += dst[0];
+        };
+    }});
+
+    kernels.push_back({"loudness_process", 1.5, [&signal](int32_t burst, bool aligned) -> Pass {
+        auto buf = std::make_shared<Buffer<float>>(signal.size());
+        auto processor = std::make_shared<LoudnessProcessor>();
+        processor->configure(LoudnessConfig(), kSampleRate, 1);
+        const float* source = signal.data();
+        return [buf, processor, source, burst, aligned]() {
+            float* data = buf->get(aligned);
+            std::copy(source, source + kSignalSamples, data);
+            for (size_t i = 0; i < kSignalSamples; i += burst) {
+                processor->process(data + i, static_cast<int32_t>(std::min<size_t>(burst, kSignalSamples - i)));
+            }
+            g_sink += data[kSignalSamples / 2];
+        };
+    }});
+
+    kernels.push_back({"onset_process", 1.5, [&signal](int32_t burst, bool aligned) -> Pass {
+        auto in = std::make_shared<Buffer<float>>(signal.size());
+        std::copy(signal.begin(), signal.end(), in->get(aligned));
+        auto detector = std::make_shared<OnsetDetector>();
+        OnsetConfig config;
+        config.enabled = true;
+        detector->configure(config);
+        return [in, detector, burst, aligned]() {
+            const float* src = in->get(aligned);
+            int64_t frame = 0;
+            float level = 0.0f;
+            int32_t onsets = 0;
+            for (size_t i = 0; i < kSignalSamples; i += burst) {
+                const int32_t n = static_cast<int32_t>(std::min<size_t>(burst, kSignalSamples - i));
+                onsets += detector->process(src + i, n, static_cast<int64_t>(i), frame, level) ? 1 : 0;
+            }
+            g_sink += static_cast<float>(onsets);
+        };
+    }});
+
+    kernels.push_back({"endpoint_process", 1.75, [&signal](int32_t burst, bool aligned) -> Pass {
+        auto in = std::make_shared<Buffer<float>>(signal.size());
+        std::copy(signal.begin(), signal.end(), in->get(aligned));
+        auto detector = std::make_shared<EndpointDetector>(EndpointConfig());
+        return [in, detector, burst, aligned]() {
+            const float* src = in->get(aligned);
+            int32_t events = 0;
+            detector->reset();
+            for (size_t i = 0; i < kSignalSamples; i += burst) {
+                const int32_t n = static_cast<int32_t>(std::min<size_t>(burst, kSignalSamples - i));
+                // Stand-in VAD: the test signal's voiced sections
+                const float probability = ((i / (kSampleRate / 4)) % 3 != 2) ? 0.9f : 0.1f;
+                events += detector->process(src + i, n, probability) != EndpointEvent::NONE ? 1 : 0;
+            }
+            g_sink += static_cast<float>(events);
+        };
+    }});
+
+    return kernels;
+}
+
+double timePass(const Pass& pass, double min_time_ms) {
+    using clock = std::chrono::steady_clock;
+    pass();   // Warm caches and any lazily built state
+
+    std::vector<double> runs;
+    for (int32_t run = 0; run < kRuns; ++run) {
+        int64_t passes = 0;
+        const auto start = clock::now();
+        double elapsed_ns = 0.0;
+        do {
+            pass();
+            ++passes;
+            elapsed_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        } while (elapsed_ns < min_time_ms * 1e6 / kRuns);
+        runs.push_back(elapsed_ns / (static_cast<double>(passes) * kSignalSamples));
+    }
+    // The fastest run is the one least disturbed by the scheduler
+    return *std::min_element(runs.begin(), runs.end());
+}
+
+std::string key(const Case& c) {
+    return c.kernel + " " + std::to_string(c.burst) + " " + (c.aligned ? "aligned" : "offset");
+}
+
+struct Baseline {
+    double ns_per_sample;
+    double max_ratio;
+};
+
+// Lines: kernel burst alignment ns_per_sample max_ratio ('#' starts a comment)
+bool readBaselines(const char* path, std::map<std::string, Baseline>& baselines) {
+    FILE* file = std::fopen(path, "r");
+    if (file == nullptr) {
+        std::fprintf(stderr, "Cannot read baseline %s\n", path);
+        return false;
+    }
+    char line[256];
+    while (std::fgets(line, sizeof(line), file) != nullptr) {
+        char kernel[64];
+        char alignment[16];
+        int burst = 0;
+        double ns = 0.0;
+        double ratio = 0.0;
+        if (line[0] == '#' ||
+            std::sscanf(line, "%63s %d %15s %lf %lf", kernel, &burst, alignment, &ns, &ratio) != 5) {
+            continue;
+        }
+        baselines[std::string(kernel) + " " + std::to_string(burst) + " " + alignment] = {ns, ratio};
+    }
+    std::fclose(file);
+    return true;
+}
+
+bool writeBaselines(const char* path, const std::vector<Result>& results,
+                    const std::map<std::string, double>& ratios) {
+    FILE* file = std::fopen(path, "w");
+    if (file == nullptr) {
+        std::fprintf(stderr, "Cannot write baseline %s\n", path);
+        return false;
+    }
+    std::fprintf(file, "# DSP kernel baselines (%s, %s, flags: %s)\n", architecture(), simdPath(), DSP_BENCH_FLAGS);
+    std::fprintf(file, "# kernel burst alignment ns_per_sample max_ratio\n");
+    for (const Result& r : results) {
+        std::fprintf(file, "%s %.4f %.2f\n", key(r.c).c_str(), r.ns_per_sample, ratios.at(r.c.kernel));
+    }
+    std::fclose(file);
+    return true;
+}
+
+std::vector<int32_t> parseBursts(const char* list) {
+    std::vector<int32_t> bursts;
+    for (const char* p = list; *p != '\0';) {
+        char* end = nullptr;
+        const long value = std::strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        if (value > 0) {
+            bursts.push_back(static_cast<int32_t>(value));
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return bursts;
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "Usage: dsp_bench [--baseline FILE] [--write-baseline FILE] [--output FILE]\n"
+                 "                 [--filter NAME] [--bursts 32,192,...] [--min-time-ms N]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* baseline_path = nullptr;
+    const char* write_path = nullptr;
+    const char* output_path = nullptr;
+    std::string filter;
+    // Oboe bursts range from a few ms on AAudio to 30 ms on OpenSL ES
+    std::vector<int32_t> bursts = {32, 192, 480, 1024};
+    double min_time_ms = 200.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--baseline" && has_value) {
+            baseline_path = argv[++i];
+        } else if (arg == "--write-baseline" && has_value) {
+            write_path = argv[++i];
+        } else if (arg == "--output" && has_value) {
+            output_path = argv[++i];
+        } else if (arg == "--filter" && has_value) {
+            filter = argv[++i];
+        } else if (arg == "--bursts" && has_value) {
+            bursts = parseBursts(argv[++i]);
+        } else if (arg == "--min-time-ms" && has_value) {
+            min_time_ms = std::max(1.0, std::atof(argv[++i]));
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (bursts.empty()) {
+        usage();
+        return 2;
+    }
+
+    std::map<std::string, Baseline> baselines;
+    if (baseline_path != nullptr && !readBaselines(baseline_path, baselines)) {
+        return 2;
+    }
+
+    const std::vector<float> signal = makeSignal();
+    std::vector<Kernel> kernels = makeKernels(signal);
+    std::map<std::string, double> ratios;
+    std::vector<Result> results;
+    for (const Kernel& kernel : kernels) {
+        if (!filter.empty() && std::string(kernel.name).find(filter) == std::string::npos) {
+            continue;
+        }
+        ratios[kernel.name] = kernel.max_ratio;
+        for (int32_t burst : bursts) {
+            for (bool aligned : {true, false}) {
+                const Case c = {kernel.name, burst, aligned};
+                const double ns = timePass(kernel.setup(burst, aligned), min_time_ms);
+                results.push_back({c, ns});
+                std::fprintf(stderr, "%-18s burst %5d %-8s %8.3f ns/sample\n",
+                             kernel.name, burst, aligned ? "aligned" : "offset", ns);
+            }
+        }
+    }
+
+    FILE* out = output_path != nullptr ? std::fopen(output_path, "w") : stdout;
+    if (out == nullptr) {
+        std::fprintf(stderr, "Cannot write %s\n", output_path);
+        return 2;
+    }
+
+    int32_t regressions = 0;
+    std::fprintf(out, "{\n  \"arch\": \"%s\",\n  \"simd\": \"%s\",\n  \"flags\": \"%s\",\n  \"results\": [\n",
+                 architecture(), simdPath(), DSP_BENCH_FLAGS);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(out, "    {\"kernel\": \"%s\", \"burst\": %d, \"alignment\": \"%s\", \"ns_per_sample\": %.4f",
+                     r.c.kernel.c_str(), r.c.burst, r.c.aligned ? "aligned" : "offset", r.ns_per_sample);
+        auto it = baselines.find(key(r.c));
+        if (it != baselines.end()) {
+            const double ratio = r.ns_per_sample / std::max(1e-9, it->second.ns_per_sample);
+            const bool regressed = ratio > it->second.max_ratio;
+            regressions += regressed ? 1 : 0;
+            std::fprintf(out, ", \"baseline_ns_per_sample\": %.4f, \"ratio\": %.3f, \"max_ratio\": %.2f, \"status\": \"%s\"",
+                         it->second.ns_per_sample, ratio, it->second.max_ratio, regressed ? "regressed" : "ok");
+            if (regressed) {
+                std::fprintf(stderr, "REGRESSED %s: %.3f ns/sample, %.2fx baseline (limit %.2fx)\n",
+                             key(r.c).c_str(), r.ns_per_sample, ratio, it->second.max_ratio);
+            }
+        } else if (baseline_path != nullptr) {
+            std::fprintf(out, ", \"status\": \"no_baseline\"");
+        }
+        std::fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ],\n  \"regressions\": %d\n}\n", regressions);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    if (write_path != nullptr && !writeBaselines(write_path, results, ratios)) {
+        return 2;
+    }
+    // Printed so the compiler can't drop the work
+    std::fprintf(stderr, "checksum %.3f\n", g_sink);
+    return regressions > 0 ? 1 : 0;
+}
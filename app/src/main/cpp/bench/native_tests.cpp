@@ -0,0 +1,833 @@
+// UnaMentis - Native Helper Tests
+// Host unit tests for the native helpers used by the engines
+//
+// The DSP processors and the token and text helpers never call into Oboe
+// or a model, so they are checked here without a device. The token helpers
+// still need llama.h for their token types and are only built when it is
+// available (NATIVE_TESTS_TOKEN_HELPERS). Exits with 1 when any check fails.
+//
+// Usage:
+//   native_tests [--filter NAME]
+
+#include "endpoint_detector.h"
+#include "loudness.h"
+#include "onset_detector.h"
+#include "sample_convert.h"
+
+#if defined(NATIVE_TESTS_TOKEN_HELPERS)
+#include "ngram_lookup.h"
+#include "prefix_cache.h"
+#include "response_cache.h"
+#include "stop_sequence_matcher.h"
+#include "transcript_stitcher.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace unamentis;
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "  %s:%d: CHECK(%s)\n", __FILE__, __LINE__, #condition); \
+            g_failures++;                                                       \
+        }                                                                       \
+    } while (0)
+
+// ---------------------------------------------------------------------------
+// EndpointDetector
+// ---------------------------------------------------------------------------
+
+constexpr int32_t kEndpointFrame = 320;    // 20 ms at 16 kHz
+
+// Feeds one speech frame per level (full-scale dBFS of a square wave),
+// reports the transcript, then feeds silence until the turn ends. Returns
+// the silence that took in ms, or -1 if the turn never ended.
+int endpointLatencyMs(EndpointDetector& detector, const std::vector<float>& levels_db,
+                      const std::string& transcript, bool end_of_generation) {
+    std::vector<float> frame(kEndpointFrame);
+    for (float level_db : levels_db) {
+        const float amplitude = std::pow(10.0f, level_db / 20.0f);
+        for (int32_t i = 0; i < kEndpointFrame; ++i) {
+            frame[i] = (i & 1) ? amplitude : -amplitude;
+        }
+        detector.process(frame.data(), kEndpointFrame, 1.0f);
+    }
+    if (!transcript.empty() || end_of_generation) {
+        detector.reportTranscript(transcript, end_of_generation);
+    }
+
+    std::fill(frame.begin(), frame.end(), 0.0f);
+    for (int32_t ms = 20; ms <= 3000; ms += 20) {
+        if (detector.process(frame.data(), kEndpointFrame, 0.0f) == EndpointEvent::END_OF_UTTERANCE) {
+            return ms;
+        }
+    }
+    return -1;
+}
+
+// Speech whose last frames sit 4 dB under its peak: neither tapered off
+// nor cut off, so the energy trend leaves the hangover alone
+std::vector<float> steadySpeech() {
+    std::vector<float> levels(12, -6.0f);
+    levels.insert(levels.end(), 4, -10.0f);
+    return levels;
+}
+
+void testEndpointBaseHangover() {
+    EndpointDetector detector;
+    CHECK(endpointLatencyMs(detector, steadySpeech(), "", false) == 600);
+    CHECK(detector.getStats().endpoints == 1);
+    CHECK(detector.getStats().punctuation_endpoints == 0);
+}
+
+void testEndpointPunctuationShortens() {
+    EndpointDetector detector;
+    // 1.5x the minimum hangover, rounded up to the next frame
+    CHECK(endpointLatencyMs(detector, steadySpeech(), "What is osmosis?", false) == 380);
+    CHECK(endpointLatencyMs(detector, steadySpeech(), "It is osmosis. ", false) == 380);
+    // End-of-generation ends on the minimum itself
+    CHECK(endpointLatencyMs(detector, steadySpeech(), "it is osmosis", true) == 260);
+    CHECK(detector.getStats().punctuation_endpoints == 3);
+}
+
+void testEndpointConjunctionExtends() {
+    EndpointDetector detector;
+    CHECK(endpointLatencyMs(detector, steadySpeech(), "It moves because", false) == 1200);
+    CHECK(endpointLatencyMs(detector, steadySpeech(), "Water, salt,", false) == 1200);
+    CHECK(endpointLatencyMs(detector, steadySpeech(), "I think... um", false) == 1200);
+    // A continuation word only counts as the whole last word
+    CHECK(endpointLatencyMs(detector, steadySpeech(), "It is the band", false) == 600);
+}
+
+void testEndpointTaperShortens() {
+    // Tail 20 dB under the peak: tapered off (0.8x)
+    std::vector<float> tapered(12, -6.0f);
+    tapered.insert(tapered.end(), 4, -26.0f);
+    EndpointDetector detector;
+    CHECK(endpointLatencyMs(detector, tapered, "", false) == 480);
+
+    // Stopped at full level: cut off mid-word (1.2x)
+    CHECK(endpointLatencyMs(detector, std::vector<float>(16, -6.0f), "", false) == 720);
+
+    // A finished sentence isn't stretched by a cut-off
+    CHECK(endpointLatencyMs(detector, std::vector<float>(16, -6.0f), "Done.", false) == 380);
+}
+
+void testEndpointShortBlipIsNotATurn() {
+    EndpointDetector detector;
+    // 40 ms of speech is under min_speech_ms
+    CHECK(endpointLatencyMs(detector, {-6.0f, -6.0f}, "", false) == -1);
+    CHECK(detector.getStats().endpoints == 0);
+}
+
+// ---------------------------------------------------------------------------
+// Sample conversion
+// ---------------------------------------------------------------------------
+
+// Repeats the cases so they hit both the vector loop and the scalar tail
+std::vector<int16_t> convertRepeated(const std::vector<float>& cases, size_t copies) {
+    std::vector<float> in;
+    for (size_t i = 0; i < copies; ++i) {
+        in.insert(in.end(), cases.begin(), cases.end());
+    }
+    std::vector<int16_t> out(in.size());
+    floatToInt16(in.data(), out.data(), in.size());
+    return out;
+}
+
+void testConvertRoundsToNearestEven() {
+    const float lsb = 1.0f / 32768.0f;
+    const std::vector<float> cases = {0.0f, 0.25f, -0.25f, 0.4f * lsb, 0.6f * lsb, 0.5f * lsb,
+                                      1.5f * lsb, -1.5f * lsb, -0.6f * lsb};
+    const std::vector<int16_t> expected = {0, 8192, -8192, 0, 1, 0, 2, -2, -1};
+
+    const std::vector<int16_t> out = convertRepeated(cases, 5);
+    for (size_t i = 0; i < out.size(); ++i) {
+        CHECK(out[i] == expected[i % expected.size()]);
+    }
+}
+
+void testConvertSaturates() {
+    const std::vector<float> cases = {1.0f, -1.0f, 1.5f, -1.5f, 1000.0f, -1000.0f, 32767.0f / 32768.0f};
+    const std::vector<int16_t> expected = {32767, -32768, 32767, -32768, 32767, -32768, 32767};
+
+    const std::vector<int16_t> out = convertRepeated(cases, 5);
+    for (size_t i = 0; i < out.size(); ++i) {
+        CHECK(out[i] == expected[i % expected.size()]);
+    }
+}
+
+void testConvertRoundTripsEveryInt16() {
+    std::vector<int16_t> in(65536);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = static_cast<int16_t>(static_cast<int32_t>(i) - 32768);
+    }
+    std::vector<float> floats(in.size());
+    std::vector<int16_t> out(in.size());
+    int16ToFloat(in.data(), floats.data(), in.size());
+    floatToInt16(floats.data(), out.data(), out.size());
+
+    CHECK(floats.front() == -1.0f);
+    CHECK(out == in);
+}
+
+// ---------------------------------------------------------------------------
+// LoudnessProcessor
+// ---------------------------------------------------------------------------
+
+constexpr int32_t kLoudnessRate = 48000;
+
+// Runs a 1 kHz sine through the processor in 10 ms callbacks and returns
+// the output peak after the look-ahead has filled
+float processSine(LoudnessProcessor& processor, float amplitude, float seconds) {
+    const int32_t block = kLoudnessRate / 100;
+    const int32_t total = static_cast<int32_t>(seconds * kLoudnessRate);
+    std::vector<float> buffer(block);
+    float peak = 0.0f;
+    for (int32_t start = 0; start < total; start += block) {
+        for (int32_t i = 0; i < block; ++i) {
+            buffer[i] = amplitude * std::sin(2.0f * 3.14159265f * 1000.0f * (start + i) / kLoudnessRate);
+        }
+        processor.process(buffer.data(), block);
+        for (float y : buffer) {
+            peak = std::max(peak, std::fabs(y));
+        }
+    }
+    return peak;
+}
+
+void testLoudnessLimiterHoldsCeiling() {
+    // No normalization, so only the limiter acts on the over-ceiling input
+    LoudnessConfig config;
+    config.max_gain_db = 0.0f;
+    LoudnessProcessor processor;
+    processor.configure(config, kLoudnessRate, 1);
+
+    const float ceiling = std::pow(10.0f, config.ceiling_db / 20.0f);
+    const float peak = processSine(processor, 1.0f, 1.0f);
+    CHECK(peak <= ceiling * 1.0001f);
+    CHECK(peak > ceiling * 0.97f);
+
+    const LoudnessStats stats = processor.getStats();
+    CHECK(stats.limited_samples > 0);
+    CHECK(std::fabs(stats.max_reduction_db + config.ceiling_db) < 0.1f);
+}
+
+void testLoudnessBoostsQuietSpeech() {
+    LoudnessProcessor processor;
+    processor.configure(LoudnessConfig(), kLoudnessRate, 1);
+
+    const float input = 0.02f;
+    const float peak = processSine(processor, input, 3.0f);
+    const LoudnessStats stats = processor.getStats();
+    CHECK(stats.short_term_lufs < -30.0f);
+    CHECK(stats.gain_db > 6.0f);
+    CHECK(stats.gain_db <= LoudnessConfig().max_gain_db);
+    CHECK(peak > input * 2.0f);
+}
+
+void testLoudnessCutsLoudSpeechUnderCeiling() {
+    LoudnessConfig config;
+    LoudnessProcessor processor;
+    processor.configure(config, kLoudnessRate, 1);
+
+    const float peak = processSine(processor, 1.0f, 1.0f);
+    const LoudnessStats stats = processor.getStats();
+    CHECK(stats.gain_db < -6.0f);
+    CHECK(stats.gain_db >= -config.max_gain_db);
+    CHECK(peak <= std::pow(10.0f, config.ceiling_db / 20.0f) * 1.0001f);
+}
+
+void testLoudnessLeavesSilenceAlone() {
+    LoudnessProcessor processor;
+    processor.configure(LoudnessConfig(), kLoudnessRate, 1);
+
+    CHECK(processSine(processor, 0.0f, 1.0f) == 0.0f);
+    CHECK(processor.getStats().gain_db == 0.0f);
+    CHECK(processor.getStats().limited_samples == 0);
+}
+
+// ---------------------------------------------------------------------------
+// OnsetDetector
+// ---------------------------------------------------------------------------
+
+constexpr int32_t kOnsetRate = 16000;
+
+// Low background noise (-66 dBFS RMS) from a fixed-seed generator
+std::vector<float> backgroundNoise(int32_t count) {
+    std::vector<float> samples(count);
+    uint32_t state = 12345;
+    for (float& s : samples) {
+        state = state * 1664525u + 1013904223u;
+        s = (static_cast<float>(state >> 8) / 16777216.0f - 0.5f) * 0.002f;
+    }
+    return samples;
+}
+
+// Feeds the signal in 192-frame callbacks and collects confirmed onsets
+std::vector<int64_t> detectOnsets(OnsetDetector& detector, const std::vector<float>& signal) {
+    std::vector<int64_t> onsets;
+    const int32_t burst = 192;
+    for (int32_t start = 0; start < static_cast<int32_t>(signal.size()); start += burst) {
+        const int32_t n = std::min(burst, static_cast<int32_t>(signal.size()) - start);
+        int64_t frame = 0;
+        float level = 0.0f;
+        if (detector.process(signal.data() + start, n, start, frame, level)) {
+            onsets.push_back(frame);
+        }
+    }
+    return onsets;
+}
+
+void enableOnsets(OnsetDetector& detector) {
+    OnsetConfig config;
+    config.enabled = true;
+    config.sample_rate = kOnsetRate;
+    detector.configure(config);
+}
+
+void testOnsetFrameAccuracy() {
+    // Half a second of room noise, then a voiced 220 Hz tone starting
+    // mid-hop and mid-callback
+    const int32_t start = kOnsetRate / 2 + 13;
+    std::vector<float> signal = backgroundNoise(kOnsetRate);
+    for (int32_t i = start; i < start + kOnsetRate / 5; ++i) {
+        signal[i] += 0.3f * std::sin(2.0f * 3.14159265f * 220.0f * (i - start) / kOnsetRate);
+    }
+
+    OnsetDetector detector;
+    enableOnsets(detector);
+    const std::vector<int64_t> onsets = detectOnsets(detector, signal);
+    CHECK(onsets.size() == 1);
+    // Within 1 ms of the true start
+    CHECK(!onsets.empty() && onsets[0] >= start && onsets[0] - start <= kOnsetRate / 1000);
+}
+
+void testOnsetIgnoresClick() {
+    // A 2.5 ms tap is shorter than confirm_ms
+    std::vector<float> signal = backgroundNoise(kOnsetRate);
+    for (int32_t i = 8000; i < 8040; ++i) {
+        signal[i] += (i & 1) ? 0.5f : -0.5f;
+    }
+
+    OnsetDetector detector;
+    enableOnsets(detector);
+    CHECK(detectOnsets(detector, signal).empty());
+}
+
+void testOnsetDisabledDoesNothing() {
+    std::vector<float> signal = backgroundNoise(kOnsetRate);
+    for (int32_t i = 8000; i < 12000; ++i) {
+        signal[i] += 0.3f * std::sin(2.0f * 3.14159265f * 220.0f * i / kOnsetRate);
+    }
+
+    OnsetDetector detector;
+    detector.configure(OnsetConfig());
+    CHECK(detectOnsets(detector, signal).empty());
+}
+
+#if defined(NATIVE_TESTS_TOKEN_HELPERS)
+
+using Tokens = std::vector<llama_token>;
+
+Tokens range(llama_token first, llama_token last) {
+    Tokens tokens;
+    for (llama_token t = first; t <= last; ++t) {
+        tokens.push_back(t);
+    }
+    return tokens;
+}
+
+Tokens concat(Tokens lhs, const Tokens& rhs) {
+    lhs.insert(lhs.end(), rhs.begin(), rhs.end());
+    return lhs;
+}
+
+// ---------------------------------------------------------------------------
+// TranscriptStitcher
+// ---------------------------------------------------------------------------
+
+void testStitcherFirstWindowVerbatim() {
+    TranscriptStitcher stitcher(2000);
+    stitcher.append(range(1, 10), 10000);
+    CHECK(stitcher.tokens() == range(1, 10));
+}
+
+void testStitcherJoinsOnSharedRun() {
+    // The second window repeats the last three tokens of the first
+    TranscriptStitcher stitcher(2000);
+    stitcher.append(range(1, 10), 10000);
+    stitcher.append(range(8, 12), 5000);
+    CHECK(stitcher.tokens() == range(1, 12));
+}
+
+void testStitcherIgnoresChanceMatch() {
+    // Only token 10 is shared, as a common word would be; the duration
+    // estimate (2 of the window's 5 tokens) decides the join instead
+    TranscriptStitcher stitcher(2000);
+    stitcher.append(range(1, 10), 10000);
+    stitcher.append({10, 20, 21, 22, 23}, 5000);
+    CHECK(stitcher.tokens() == concat(range(1, 10), {21, 22, 23}));
+}
+
+void testStitcherWithoutOverlapConcatenates() {
+    TranscriptStitcher stitcher(0);
+    stitcher.append(range(1, 5), 5000);
+    stitcher.append(range(4, 8), 5000);
+    CHECK(stitcher.tokens() == concat(range(1, 5), range(4, 8)));
+}
+
+void testStitcherReset() {
+    TranscriptStitcher stitcher(2000);
+    stitcher.append(range(1, 10), 10000);
+    stitcher.reset();
+    stitcher.append(range(8, 12), 5000);
+    CHECK(stitcher.tokens() == range(8, 12));
+}
+
+// ---------------------------------------------------------------------------
+// StopSequenceMatcher
+// ---------------------------------------------------------------------------
+
+void testStopWithoutPatternsPassesThrough() {
+    StopSequenceMatcher matcher;
+    std::string out;
+    CHECK(!matcher.feed("</s>", out));
+    CHECK(out == "</s>");
+}
+
+void testStopSpanningPieces() {
+    StopSequenceMatcher matcher;
+    matcher.setPatterns({"</s>"});
+    std::string out;
+
+    CHECK(!matcher.feed("Hello <", out));
+    CHECK(out == "Hello ");
+    CHECK(!matcher.feed("/s", out));
+    CHECK(out.empty());
+    CHECK(matcher.feed(">tail", out));
+    CHECK(out.empty());
+}
+
+void testStopReleasesDivergedPrefix() {
+    StopSequenceMatcher matcher;
+    matcher.setPatterns({"</s>"});
+    std::string out;
+
+    CHECK(!matcher.feed("a<", out));
+    CHECK(out == "a");
+    CHECK(!matcher.feed("b", out));
+    CHECK(out == "<b");
+}
+
+void testStopReleasesTextBeforeMatch() {
+    StopSequenceMatcher matcher;
+    matcher.setPatterns({"<|user|>", "<|im_end|>"});
+    std::string out;
+
+    CHECK(!matcher.feed("Answer.<|", out));
+    CHECK(out == "Answer.");
+    CHECK(matcher.feed("im_end|>", out));
+    CHECK(out.empty());
+
+    // A match resets the stream
+    CHECK(matcher.feed("ok<|user|>", out));
+    CHECK(out == "ok");
+}
+
+void testStopFlushReturnsHeldBytes() {
+    StopSequenceMatcher matcher;
+    matcher.setPatterns({"[INST]"});
+    std::string out;
+
+    CHECK(!matcher.feed("end [IN", out));
+    CHECK(out == "end ");
+    CHECK(matcher.flush() == "[IN");
+    CHECK(matcher.flush().empty());
+}
+
+// ---------------------------------------------------------------------------
+// NgramLookup
+// ---------------------------------------------------------------------------
+
+void testNgramDraftsContinuation() {
+    NgramLookup lookup(2, 3);
+    lookup.push(Tokens{1, 2, 3, 4, 1, 2});
+
+    Tokens draft;
+    CHECK(lookup.draft(3, draft) == 3);
+    CHECK(draft == (Tokens{3, 4, 1}));
+}
+
+void testNgramPrefersLongerMatch() {
+    // [5 1 2] occurred before and continues with 9; [1 2] last continued with 3
+    NgramLookup lookup(2, 3);
+    lookup.push(Tokens{5, 1, 2, 9, 1, 2, 3, 5, 1, 2});
+
+    Tokens draft;
+    CHECK(lookup.draft(1, draft) == 1);
+    CHECK(draft == (Tokens{9}));
+}
+
+void testNgramNoMatch() {
+    NgramLookup lookup(2, 3);
+    lookup.push(range(1, 8));
+
+    Tokens draft{42};
+    CHECK(lookup.draft(4, draft) == 0);
+    CHECK(draft.empty());
+}
+
+void testNgramSuffixDoesNotMatchItself() {
+    NgramLookup lookup(2, 2);
+    lookup.push(Tokens{1, 2});
+
+    Tokens draft;
+    CHECK(lookup.draft(4, draft) == 0);
+}
+
+void testNgramReset() {
+    NgramLookup lookup(2, 3);
+    lookup.push(Tokens{1, 2, 3, 1, 2});
+    lookup.reset();
+    CHECK(lookup.size() == 0);
+
+    Tokens draft;
+    lookup.push(Tokens{1, 2});
+    CHECK(lookup.draft(4, draft) == 0);
+}
+
+// ---------------------------------------------------------------------------
+// PrefixCache
+// ---------------------------------------------------------------------------
+
+void testPrefixDisabledWithoutSlots() {
+    PrefixCache cache(10, 0);
+    std::vector<llama_seq_id> released;
+    CHECK(!cache.enabled());
+    CHECK(cache.insert(range(1, 4), released) == -1);
+}
+
+void testPrefixMatchesSharedPrefix() {
+    PrefixCache cache(10, 2);
+    std::vector<llama_seq_id> released;
+    const llama_seq_id slot = cache.insert(range(1, 4), released);
+    CHECK(slot >= 10 && slot < 12);
+    CHECK(released.empty());
+
+    size_t length = 0;
+    CHECK(cache.match(Tokens{1, 2, 3, 9}, length) == slot);
+    CHECK(length == 3);
+    CHECK(cache.match(Tokens{7, 8}, length) == -1);
+    CHECK(length == 0);
+}
+
+void testPrefixCoveredPromptNeedsNoSlot() {
+    PrefixCache cache(10, 2);
+    std::vector<llama_seq_id> released;
+    cache.insert(range(1, 4), released);
+    CHECK(cache.insert(range(1, 2), released) == -1);
+    CHECK(cache.stats().cached_prompts == 1);
+    CHECK(cache.cachedTokens() == 4);
+}
+
+void testPrefixExtensionRefillsSlot() {
+    PrefixCache cache(10, 2);
+    std::vector<llama_seq_id> released;
+    const llama_seq_id slot = cache.insert(range(1, 4), released);
+
+    CHECK(cache.insert(range(1, 6), released) == slot);
+    CHECK(released == std::vector<llama_seq_id>{slot});
+    CHECK(cache.cachedTokens() == 6);
+
+    size_t length = 0;
+    CHECK(cache.match(range(1, 8), length) == slot);
+    CHECK(length == 6);
+}
+
+void testPrefixSharesBranchPoint() {
+    PrefixCache cache(10, 2);
+    std::vector<llama_seq_id> released;
+    const llama_seq_id a = cache.insert(Tokens{1, 2, 3, 4}, released);
+    const llama_seq_id b = cache.insert(Tokens{1, 2, 7, 8}, released);
+    CHECK(a != b && b >= 0);
+    CHECK(cache.cachedTokens() == 6);
+
+    size_t length = 0;
+    CHECK(cache.match(Tokens{1, 2, 7, 9}, length) == b);
+    CHECK(length == 3);
+}
+
+void testPrefixEvictsLeastRecent() {
+    PrefixCache cache(10, 2);
+    std::vector<llama_seq_id> released;
+    const llama_seq_id a = cache.insert(Tokens{1, 2, 3}, released);
+    const llama_seq_id b = cache.insert(Tokens{4, 5, 6}, released);
+
+    // Using the first prompt makes the second the eviction candidate
+    size_t length = 0;
+    cache.match(Tokens{1, 2, 3}, length);
+
+    const llama_seq_id c = cache.insert(Tokens{7, 8, 9}, released);
+    CHECK(c == b);
+    CHECK(released == std::vector<llama_seq_id>{b});
+    CHECK(cache.match(Tokens{4, 5, 6}, length) == -1);
+    CHECK(cache.match(Tokens{1, 2, 3}, length) == a);
+    CHECK(cache.stats().evictions == 1);
+    CHECK(cache.cachedTokens() == 6);
+}
+
+void testPrefixLookupCounters() {
+    PrefixCache cache(10, 1);
+    cache.recordLookup(12);
+    cache.recordLookup(0);
+
+    const PrefixCacheStats stats = cache.stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 1);
+    CHECK(stats.reused_tokens == 12);
+}
+
+// ---------------------------------------------------------------------------
+// ResponseCache
+// ---------------------------------------------------------------------------
+
+ResponseCacheConfig cacheConfig(size_t max_entries) {
+    ResponseCacheConfig config;
+    config.max_entries = max_entries;
+    return config;
+}
+
+bool cacheHit(ResponseCache& cache, const Tokens& prompt, const std::vector<float>& embedding = {},
+              int32_t max_tokens = 100) {
+    std::vector<std::string> pieces;
+    return cache.lookup(prompt, embedding, max_tokens, pieces);
+}
+
+void testCacheDisabledByDefault() {
+    ResponseCache cache;
+    cache.insert(range(1, 4), {}, {"a"}, 1);
+    CHECK(!cache.enabled());
+    CHECK(!cacheHit(cache, range(1, 4)));
+    CHECK(cache.stats().entries == 0);
+}
+
+void testCacheExactReplay() {
+    ResponseCache cache;
+    cache.configure(cacheConfig(4));
+    cache.insert(range(1, 4), {}, {"Osmosis ", "is ..."}, 3);
+
+    std::vector<std::string> pieces;
+    CHECK(cache.lookup(range(1, 4), {}, 100, pieces));
+    CHECK(pieces == (std::vector<std::string>{"Osmosis ", "is ..."}));
+    CHECK(!cacheHit(cache, range(1, 5)));
+    // A longer answer than the request allows doesn't count
+    CHECK(!cacheHit(cache, range(1, 4), {}, 2));
+
+    const ResponseCacheStats stats = cache.stats();
+    CHECK(stats.exact_hits == 1);
+    CHECK(stats.misses == 2);
+}
+
+void testCacheSimilarityThreshold() {
+    ResponseCache cache;
+    cache.configure(cacheConfig(4));
+    cache.insert(range(1, 4), {1.0f, 0.0f}, {"a"}, 1);
+
+    // cos = 0.994 and 0.707 against a 0.95 threshold
+    CHECK(cacheHit(cache, range(5, 9), {0.9f, 0.1f}));
+    CHECK(!cacheHit(cache, range(5, 9), {0.5f, 0.5f}));
+    // Other dimensions never match
+    CHECK(!cacheHit(cache, range(5, 9), {1.0f, 0.0f, 0.0f}));
+    CHECK(cache.stats().semantic_hits == 1);
+}
+
+void testCacheExpiredEntriesMiss() {
+    ResponseCacheConfig config = cacheConfig(4);
+    config.ttl_ms = 0;
+    ResponseCache cache;
+    cache.configure(config);
+    cache.insert(range(1, 4), {1.0f, 0.0f}, {"a"}, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    CHECK(!cacheHit(cache, range(1, 4)));
+    CHECK(!cacheHit(cache, range(5, 9), {1.0f, 0.0f}));
+    CHECK(cache.stats().entries == 0);
+}
+
+void testCacheExpiredMatchDoesNotShadowFresh() {
+    ResponseCache cache;
+    cache.configure(cacheConfig(4));
+    cache.insert(range(1, 4), {1.0f, 0.0f}, {"stale"}, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    cache.insert(range(5, 8), {0.96f, 0.28f}, {"fresh"}, 1);
+
+    // Only the first entry is past the TTL; it is the closer match
+    ResponseCacheConfig config = cacheConfig(4);
+    config.ttl_ms = 30;
+    cache.configure(config);
+
+    std::vector<std::string> pieces;
+    CHECK(cache.lookup(range(10, 12), {1.0f, 0.0f}, 100, pieces));
+    CHECK(pieces == std::vector<std::string>{"fresh"});
+    CHECK(cache.stats().entries == 1);
+}
+
+void testCacheEntryLimitEvictsLeastRecent() {
+    ResponseCache cache;
+    cache.configure(cacheConfig(2));
+    cache.insert(range(1, 2), {}, {"a"}, 1);
+    cache.insert(range(3, 4), {}, {"b"}, 1);
+    CHECK(cacheHit(cache, range(1, 2)));
+    cache.insert(range(5, 6), {}, {"c"}, 1);
+
+    CHECK(cache.stats().entries == 2);
+    CHECK(cacheHit(cache, range(1, 2)));
+    CHECK(!cacheHit(cache, range(3, 4)));
+    CHECK(cacheHit(cache, range(5, 6)));
+}
+
+void testCacheByteLimit() {
+    ResponseCache cache;
+    cache.configure(cacheConfig(8));
+    cache.insert(range(1, 2), {}, {std::string(200, 'a')}, 1);
+    const int64_t entry_bytes = cache.stats().bytes;
+
+    // Room for two such entries
+    ResponseCacheConfig config = cacheConfig(8);
+    config.max_bytes = static_cast<size_t>(entry_bytes) * 2 + entry_bytes / 2;
+    cache.configure(config);
+    cache.insert(range(3, 4), {}, {std::string(200, 'b')}, 1);
+    cache.insert(range(5, 6), {}, {std::string(200, 'c')}, 1);
+
+    const ResponseCacheStats stats = cache.stats();
+    CHECK(stats.entries == 2);
+    CHECK(stats.bytes <= static_cast<int64_t>(config.max_bytes));
+    CHECK(!cacheHit(cache, range(1, 2)));
+
+    // An answer bigger than the whole budget is not stored
+    cache.insert(range(7, 8), {}, {std::string(config.max_bytes, 'd')}, 1);
+    CHECK(!cacheHit(cache, range(7, 8)));
+    CHECK(cache.stats().entries == 2);
+}
+
+void testCacheContextChangeInvalidates() {
+    ResponseCache cache;
+    cache.configure(cacheConfig(4));
+    cache.setContext("biology/osmosis");
+    cache.insert(range(1, 4), {}, {"a"}, 1);
+
+    cache.setContext("biology/osmosis");
+    CHECK(cacheHit(cache, range(1, 4)));
+    cache.setContext("biology/diffusion");
+    CHECK(!cacheHit(cache, range(1, 4)));
+    CHECK(cache.stats().entries == 0);
+}
+
+#endif // NATIVE_TESTS_TOKEN_HELPERS
+
+struct Test {
+    const char* name;
+    std::function<void()> run;
+};
+
+const std::vector<Test>& tests() {
+    static const std::vector<Test> all = {
+        {"endpoint_base_hangover", testEndpointBaseHangover},
+        {"endpoint_punctuation_shortens", testEndpointPunctuationShortens},
+        {"endpoint_conjunction_extends", testEndpointConjunctionExtends},
+        {"endpoint_taper_shortens", testEndpointTaperShortens},
+        {"endpoint_short_blip_is_not_a_turn", testEndpointShortBlipIsNotATurn},
+        {"convert_rounds_to_nearest_even", testConvertRoundsToNearestEven},
+        {"convert_saturates", testConvertSaturates},
+        {"convert_round_trips_every_int16", testConvertRoundTripsEveryInt16},
+        {"loudness_limiter_holds_ceiling", testLoudnessLimiterHoldsCeiling},
+        {"loudness_boosts_quiet_speech", testLoudnessBoostsQuietSpeech},
+        {"loudness_cuts_loud_speech_under_ceiling", testLoudnessCutsLoudSpeechUnderCeiling},
+        {"loudness_leaves_silence_alone", testLoudnessLeavesSilenceAlone},
+        {"onset_frame_accuracy", testOnsetFrameAccuracy},
+        {"onset_ignores_click", testOnsetIgnoresClick},
+        {"onset_disabled_does_nothing", testOnsetDisabledDoesNothing},
+#if defined(NATIVE_TESTS_TOKEN_HELPERS)
+        {"stitcher_first_window_verbatim", testStitcherFirstWindowVerbatim},
+        {"stitcher_joins_on_shared_run", testStitcherJoinsOnSharedRun},
+        {"stitcher_ignores_chance_match", testStitcherIgnoresChanceMatch},
+        {"stitcher_without_overlap_concatenates", testStitcherWithoutOverlapConcatenates},
+        {"stitcher_reset", testStitcherReset},
+        {"stop_without_patterns_passes_through", testStopWithoutPatternsPassesThrough},
+        {"stop_spanning_pieces", testStopSpanningPieces},
+        {"stop_releases_diverged_prefix", testStopReleasesDivergedPrefix},
+        {"stop_releases_text_before_match", testStopReleasesTextBeforeMatch},
+        {"stop_flush_returns_held_bytes", testStopFlushReturnsHeldBytes},
+        {"ngram_drafts_continuation", testNgramDraftsContinuation},
+        {"ngram_prefers_longer_match", testNgramPrefersLongerMatch},
+        {"ngram_no_match", testNgramNoMatch},
+        {"ngram_suffix_does_not_match_itself", testNgramSuffixDoesNotMatchItself},
+        {"ngram_reset", testNgramReset},
+        {"prefix_disabled_without_slots", testPrefixDisabledWithoutSlots},
+        {"prefix_matches_shared_prefix", testPrefixMatchesSharedPrefix},
+        {"prefix_covered_prompt_needs_no_slot", testPrefixCoveredPromptNeedsNoSlot},
+        {"prefix_extension_refills_slot", testPrefixExtensionRefillsSlot},
+        {"prefix_shares_branch_point", testPrefixSharesBranchPoint},
+        {"prefix_evicts_least_recent", testPrefixEvictsLeastRecent},
+        {"prefix_lookup_counters", testPrefixLookupCounters},
+        {"cache_disabled_by_default", testCacheDisabledByDefault},
+        {"cache_exact_replay", testCacheExactReplay},
+        {"cache_similarity_threshold", testCacheSimilarityThreshold},
+        {"cache_expired_entries_miss", testCacheExpiredEntriesMiss},
+        {"cache_expired_match_does_not_shadow_fresh", testCacheExpiredMatchDoesNotShadowFresh},
+        {"cache_entry_limit_evicts_least_recent", testCacheEntryLimitEvictsLeastRecent},
+        {"cache_byte_limit", testCacheByteLimit},
+        {"cache_context_change_invalidates", testCacheContextChangeInvalidates},
+#endif
+    };
+    return all;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: %s [--filter NAME]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int run = 0;
+    int failed = 0;
+    for (const Test& test : tests()) {
+        if (filter != nullptr && std::strstr(test.name, filter) == nullptr) {
+            continue;
+        }
+        const int before = g_failures;
+        test.run();
+        run++;
+        if (g_failures != before) {
+            failed++;
+            std::fprintf(stderr, "FAIL %s\n", test.name);
+        } else {
+            std::printf("ok   %s\n", test.name);
+        }
+    }
+
+    std::printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+// UnaMentis - Cascade Model Implementation
+// Small first-pass model for LlamaInference's small/large cascade
+
+#include "cascade_model.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define LOG_TAG "CascadeModel"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace unamentis {
+
+// Token ids compared when checking that two vocabularies agree
+static constexpr int32_t kVocabProbeStride = 97;
+
+// Text of a token, for vocabulary comparison
+static std::string tokenPiece(const llama_vocab* vocab, llama_token token) {
+    char buf[64];
+    int32_t n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, true);
+    return n > 0 ? std::string(buf, n) : std::string();
+}
+
+CascadeModel::~CascadeModel() {
+    releaseContext();
+}
+
+bool CascadeModel::load(
+    const std::string& model_path,
+    const CascadeConfig& config,
+    const llama_model* large
+) {
+    releaseContext();
+    config_ = config;
+
+    llama_model_params model_params = llama_model_default_params();
+    model_params.n_gpu_layers = config.gpu_layers;
+    model_ = acquireSharedModel(model_path, model_params);
+    if (!model_) {
+        LOGE("Failed to load cascade model from: %s", model_path.c_str());
+        return false;
+    }
+
+    // The large model continues from the same prompt tokens
+    const llama_vocab* small_vocab = llama_model_get_vocab(model_->get());
+    const llama_vocab* large_vocab = llama_model_get_vocab(large);
+    const int32_t n_vocab = llama_vocab_n_tokens(small_vocab);
+    bool compatible = n_vocab == llama_vocab_n_tokens(large_vocab) &&
+                      llama_vocab_bos(small_vocab) == llama_vocab_bos(large_vocab);
+    for (llama_token id = 0; compatible && id < n_vocab; id += kVocabProbeStride) {
+        compatible = tokenPiece(small_vocab, id) == tokenPiece(large_vocab, id);
+    }
+    if (!compatible) {
+        LOGE("Cascade model vocabulary does not match the large model");
+        model_.reset();
+        return false;
+    }
+
+    if (!createContext()) {
+        model_.reset();
+        return false;
+    }
+    LOGI("Cascade model loaded: probe=%d tokens, min_p=%.2f, max_entropy=%.2f",
+         config_.probe_tokens, config_.min_probability, config_.max_mean_entropy);
+    return true;
+}
+
+bool CascadeModel::createContext() {
+    int n_threads = std::max(1, std::min(8, config_.n_threads));
+    llama_context_params ctx_params = llama_context_default_params();
+    ctx_params.n_ctx = config_.context_size;
+    ctx_params.n_threads = n_threads;
+    ctx_params.n_threads_batch = n_threads;
+
+    context_ = llama_init_from_model(model_->get(), ctx_params);
+    if (context_ == nullptr) {
+        LOGE("Failed to create cascade context");
+        return false;
+    }
+    if (threadpool_ != nullptr) {
+        llama_attach_threadpool(context_, threadpool_, threadpool_);
+    }
+    tokens_.clear();
+    logits_idx_ = -1;
+    return true;
+}
+
+void CascadeModel::setThreadpool(ggml_threadpool* pool) {
+    threadpool_ = pool;
+    if (context_ == nullptr) {
+        return;
+    }
+    if (pool != nullptr) {
+        llama_attach_threadpool(context_, pool, pool);
+    } else {
+        llama_detach_threadpool(context_);
+    }
+}
+
+void CascadeModel::releaseContext() {
+    if (context_ != nullptr) {
+        llama_free(context_);
+        context_ = nullptr;
+    }
+    tokens_.clear();
+    logits_idx_ = -1;
+}
+
+bool CascadeModel::start(const std::vector<llama_token>& prompt) {
+    if (!model_ || (context_ == nullptr && !createContext())) {
+        return false;
+    }
+    if (prompt.empty() || prompt.size() + config_.probe_tokens >= llama_n_ctx(context_)) {
+        return false;
+    }
+
+    // Keep the common prefix; always re-decode the last prompt token for logits
+    size_t n_keep = 0;
+    while (n_keep < tokens_.size() && n_keep < prompt.size() && tokens_[n_keep] == prompt[n_keep]) {
+        n_keep++;
+    }
+    n_keep = std::min(n_keep, prompt.size() - 1);
+    llama_memory_seq_rm(llama_get_memory(context_), 0, static_cast<llama_pos>(n_keep), -1);
+    tokens_.resize(n_keep);
+
+    const size_t n_batch = std::max<size_t>(1, llama_n_batch(context_));
+    llama_batch batch = llama_batch_init(static_cast<int32_t>(n_batch), 0, 1);
+    bool ok = true;
+    for (size_t begin = n_keep; begin < prompt.size() && ok; begin += n_batch) {
+        const size_t end = std::min(prompt.size(), begin + n_batch);
+        batch.n_tokens = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const int32_t k = batch.n_tokens++;
+            batch.token[k] = prompt[i];
+            batch.pos[k] = static_cast<llama_pos>(i);
+            batch.n_seq_id[k] = 1;
+            batch.seq_id[k][0] = 0;
+            batch.logits[k] = i + 1 == prompt.size();
+        }
+        ok = llama_decode(context_, batch) == 0;
+        logits_idx_ = batch.n_tokens - 1;
+    }
+    llama_batch_free(batch);
+
+    if (!ok) {
+        LOGW("Cascade prefill failed");
+        llama_memory_seq_rm(llama_get_memory(context_), 0, static_cast<llama_pos>(n_keep), -1);
+        logits_idx_ = -1;
+        return false;
+    }
+    tokens_ = prompt;
+    return true;
+}
+
+CascadeToken CascadeModel::predict() const {
+    CascadeToken result;
+    const float* logits = llama_get_logits_ith(context_, logits_idx_);
+    if (logits == nullptr) {
+        return result;
+    }
+
+    const int32_t n_vocab = llama_vocab_n_tokens(llama_model_get_vocab(model_->get()));
+    const float* top = std::max_element(logits, logits + n_vocab);
+    const float max_logit = *top;
+
+    // H = log Z - sum(p * (l - max)), with Z and p taken relative to the max
+    double z = 0.0;
+    double weighted = 0.0;
+    for (int32_t i = 0; i < n_vocab; ++i) {
+        const double shifted = logits[i] - max_logit;
+        const double e = std::exp(shifted);
+        z += e;
+        weighted += e * shifted;
+    }
+
+    result.token = static_cast<llama_token>(top - logits);
+    result.probability = static_cast<float>(1.0 / z);
+    result.entropy = static_cast<float>(std::log(z) - weighted / z);
+    return result;
+}
+
+bool CascadeModel::advance(llama_token token) {
+    llama_batch batch = llama_batch_init(1, 0, 1);
+    batch.n_tokens = 1;
+    batch.token[0] = token;
+    batch.pos[0] = static_cast<llama_pos>(tokens_.size());
+    batch.n_seq_id[0] = 1;
+    batch.seq_id[0][0] = 0;
+    batch.logits[0] = 1;
+
+    const bool ok = llama_decode(context_, batch) == 0;
+    llama_batch_free(batch);
+    if (ok) {
+        tokens_.push_back(token);
+        logits_idx_ = 0;
+    }
+    return ok;
+}
+
+bool CascadeModel::hasRoom() const {
+    return context_ != nullptr && tokens_.size() + 1 < llama_n_ctx(context_);
+}
+
+} // namespace unamentis
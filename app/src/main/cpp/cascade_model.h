@@ -0,0 +1,129 @@
+// UnaMentis - Cascade Model Header
+// Small first-pass model for LlamaInference's small/large cascade
+//
+// Most learner turns (acknowledgments, short factual answers, "repeat
+// that") don't need the largest model. The small model answers first; if
+// it is unsure within its first few tokens, the request escalates to the
+// large model, which reuses the same prompt tokens (the vocabularies must
+// match).
+
+#ifndef UNAMENTIS_CASCADE_MODEL_H
+#define UNAMENTIS_CASCADE_MODEL_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "llama.h"
+#include "shared_model.h"
+
+namespace unamentis {
+
+/**
+ * Escalation policy for the cascade.
+ */
+struct CascadeConfig {
+    int32_t context_size = 2048;       // Small model context window
+    int32_t gpu_layers = 99;           // Layers to offload to GPU (99 = all)
+    int32_t n_threads = 4;             // CPU threads
+    int32_t probe_tokens = 8;          // Tokens generated before deciding
+    float min_probability = 0.35f;     // Escalate if any probe token is less likely than this
+    float max_mean_entropy = 2.0f;     // Escalate if the probe's mean entropy (nats) exceeds this
+};
+
+/**
+ * Cascade counters.
+ */
+struct CascadeStats {
+    int64_t small_answers = 0;         // Requests answered by the small model
+    int64_t escalations = 0;           // Requests handed to the large model
+    int64_t small_tokens = 0;          // Tokens emitted by the small model
+    int64_t discarded_tokens = 0;      // Probe tokens thrown away on escalation
+    int64_t probe_us = 0;              // Time spent in probes that escalated
+};
+
+/**
+ * Greedy next-token prediction with its confidence.
+ */
+struct CascadeToken {
+    llama_token token = -1;
+    float probability = 0.0f;          // Softmax probability of the chosen token
+    float entropy = 0.0f;              // Entropy of the distribution in nats
+};
+
+/**
+ * Small model with its own context and a single sequence.
+ *
+ * The KV of the previous prompt is kept, so consecutive turns of a
+ * conversation only prefill what changed.
+ *
+ * Not thread-safe; used under LlamaInference's generation lock.
+ */
+class CascadeModel {
+public:
+    CascadeModel() = default;
+    ~CascadeModel();
+
+    CascadeModel(const CascadeModel&) = delete;
+    CascadeModel& operator=(const CascadeModel&) = delete;
+
+    /**
+     * Load the small model.
+     *
+     * @param large Model the cascade escalates to; the vocabularies must match
+     * @return true if loaded and compatible
+     */
+    bool load(const std::string& model_path, const CascadeConfig& config, const llama_model* large);
+
+    const CascadeConfig& config() const { return config_; }
+
+    /**
+     * Free the context (KV cache); the next start() recreates it.
+     */
+    void releaseContext();
+
+    /**
+     * Decode on a leased pool, now and in contexts created later.
+     *
+     * @param pool Pool owned by the caller, or nullptr to detach
+     */
+    void setThreadpool(ggml_threadpool* pool);
+
+    /**
+     * Prefill a prompt, reusing the common prefix with the previous one.
+     *
+     * @return true if the prompt fits and was decoded
+     */
+    bool start(const std::vector<llama_token>& prompt);
+
+    /**
+     * Predict the next token from the current logits.
+     */
+    CascadeToken predict() const;
+
+    /**
+     * Append a token to the sequence.
+     *
+     * @return true on success
+     */
+    bool advance(llama_token token);
+
+    /**
+     * Check whether another token fits in the context.
+     */
+    bool hasRoom() const;
+
+private:
+    std::shared_ptr<SharedModel> model_;
+    llama_context* context_ = nullptr;
+    ggml_threadpool* threadpool_ = nullptr;
+    CascadeConfig config_;
+    std::vector<llama_token> tokens_;  // Tokens whose KV is resident
+    int32_t logits_idx_ = -1;
+
+    bool createContext();
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_CASCADE_MODEL_H
@@ -0,0 +1,176 @@
+// UnaMentis - Compute Pool Implementation
+// ggml thread pools shared by the inference engines
+
+#include "compute_pool.h"
+#include "thread_policy.h"
+#include <android/log.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define LOG_TAG "ComputePool"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace unamentis {
+
+namespace {
+
+struct Pool {
+    ggml_threadpool* handle = nullptr;
+    int32_t n_threads = 0;
+    uint32_t poll = 0;
+    bool isolated = false;             // Created with the audio core excluded
+    bool busy = false;
+};
+
+std::mutex g_mutex;
+ComputePoolConfig g_config;
+ComputePoolStats g_stats;
+std::unique_ptr<Pool> g_shared;
+std::vector<std::unique_ptr<Pool>> g_private;
+
+std::unique_ptr<Pool> newPool(int32_t n_threads, uint32_t poll) {
+    ggml_threadpool_params params = ggml_threadpool_params_default(1);
+    const int32_t n_cores = fillComputeCpumask(params.cpumask, GGML_MAX_N_THREADS);
+    params.n_threads = std::max(1, std::min({8, n_threads, std::max(1, n_cores)}));
+    params.poll = poll;
+    // Workers may move between compute cores but never onto the audio core
+    params.strict_cpu = false;
+
+    auto pool = std::make_unique<Pool>();
+    pool->handle = ggml_threadpool_new(&params);
+    if (pool->handle == nullptr) {
+        LOGE("Failed to create thread pool");
+        return nullptr;
+    }
+    pool->n_threads = n_threads;
+    pool->poll = poll;
+    pool->isolated = audioIsolationEnabled();
+    g_stats.pools_created++;
+    LOGI("Thread pool: %d workers on %d cores, poll %u (audio core %d)",
+         params.n_threads, n_cores, poll, reservedAudioCore());
+    return pool;
+}
+
+void freePool(std::unique_ptr<Pool>& pool) {
+    if (pool) {
+        ggml_threadpool_free(pool->handle);
+        pool.reset();
+    }
+}
+
+// Whether an idle pool can serve a turn of n_threads under the current policy
+bool fits(const Pool& pool, int32_t n_threads) {
+    return pool.n_threads >= n_threads && pool.poll == g_config.poll &&
+           pool.isolated == audioIsolationEnabled();
+}
+
+// Called with g_mutex held
+Pool* acquirePool(int32_t n_threads) {
+    g_stats.turns++;
+
+    // The shared pool, rebuilt while idle if it is too small or its policy changed
+    if (!g_shared || !g_shared->busy) {
+        if (g_shared && !fits(*g_shared, n_threads)) {
+            freePool(g_shared);
+        }
+        if (!g_shared) {
+            g_shared = newPool(n_threads, g_config.poll);
+        }
+        if (g_shared) {
+            g_shared->busy = true;
+            g_stats.shared_turns++;
+            return g_shared.get();
+        }
+        return nullptr;
+    }
+
+    // Shared pool busy with the other engine: reuse or start a private one
+    for (auto& pool : g_private) {
+        if (!pool->busy && fits(*pool, n_threads)) {
+            pool->busy = true;
+            return pool.get();
+        }
+    }
+    std::unique_ptr<Pool> pool = newPool(n_threads, g_config.poll);
+    if (!pool) {
+        return nullptr;
+    }
+    pool->busy = true;
+    g_private.push_back(std::move(pool));
+    return g_private.back().get();
+}
+
+// Called with g_mutex held
+void releasePool(ggml_threadpool* handle) {
+    if (g_shared && g_shared->handle == handle) {
+        g_shared->busy = false;
+    }
+    for (auto& pool : g_private) {
+        if (pool->handle == handle) {
+            pool->busy = false;
+        }
+    }
+
+    if (g_config.pause_between_turns) {
+        ggml_threadpool_pause(handle);
+        g_stats.pauses++;
+    }
+
+    // Once the shared pool is free, idle private pools are surplus
+    if (!g_shared || !g_shared->busy) {
+        auto it = g_private.begin();
+        while (it != g_private.end()) {
+            if (!(*it)->busy) {
+                freePool(*it);
+                it = g_private.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void configureComputePools(const ComputePoolConfig& config) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_config = config;
+    g_config.poll = std::min<uint32_t>(config.poll, 100);
+    LOGI("Compute pools: poll %u, pause between turns %s",
+         g_config.poll, g_config.pause_between_turns ? "on" : "off");
+}
+
+ComputePoolStats getComputePoolStats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    ComputePoolStats stats = g_stats;
+    stats.live_pools = (g_shared ? 1 : 0) + static_cast<int32_t>(g_private.size());
+    return stats;
+}
+
+ComputeLease::ComputeLease(int32_t n_threads, AttachFn attach) : attach_(std::move(attach)) {
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Pool* pool = acquirePool(std::max(1, n_threads));
+        pool_ = pool != nullptr ? pool->handle : nullptr;
+    }
+    // Without a pool ggml falls back to per-graph workers
+    if (pool_ != nullptr && attach_) {
+        attach_(pool_);
+    }
+}
+
+ComputeLease::~ComputeLease() {
+    if (pool_ != nullptr) {
+        if (attach_) {
+            attach_(nullptr);
+        }
+        std::lock_guard<std::mutex> lock(g_mutex);
+        releasePool(pool_);
+    }
+}
+
+} // namespace unamentis
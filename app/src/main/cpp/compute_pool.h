@@ -0,0 +1,79 @@
+// UnaMentis - Compute Pool Header
+// ggml thread pools shared by the inference engines
+//
+// Engines lease a pool for each turn of compute (a generation, an ASR
+// chunk) instead of letting every context keep its own workers. The first
+// engine to start a turn gets the shared pool; an engine starting while
+// it is busy gets a private pool, which is freed once both are idle again.
+//
+// Workers poll aggressively while a turn runs, so decode steps don't pay a
+// wake-up each, and are parked between turns so they don't spin while the
+// user speaks or reads. Pool workers are restricted to the compute cores
+// of the thread policy, which leaves the audio core to the Oboe callback.
+
+#ifndef UNAMENTIS_COMPUTE_POOL_H
+#define UNAMENTIS_COMPUTE_POOL_H
+
+#include <cstdint>
+#include <functional>
+#include "ggml-cpu.h"
+#include "llama.h"
+
+namespace unamentis {
+
+/**
+ * Process-wide pool policy.
+ */
+struct ComputePoolConfig {
+    uint32_t poll = 100;               // ggml poll level during a turn (0 = sleep at once, 100 = spin hardest)
+    bool pause_between_turns = true;   // Park workers when a lease ends
+};
+
+/**
+ * Pool usage counters.
+ */
+struct ComputePoolStats {
+    int64_t turns = 0;                 // Leases granted
+    int64_t shared_turns = 0;          // Leases served by the shared pool
+    int64_t pools_created = 0;         // Pools started (shared recreations and private pools)
+    int64_t pauses = 0;                // Times workers were parked between turns
+    int32_t live_pools = 0;            // Pools currently allocated
+};
+
+/**
+ * Apply a pool policy. Existing pools are rebuilt with a new poll level
+ * (or audio isolation setting) the next time a turn finds them idle.
+ */
+void configureComputePools(const ComputePoolConfig& config);
+
+/**
+ * Get pool usage counters.
+ */
+ComputePoolStats getComputePoolStats();
+
+/**
+ * A pool leased for one turn of compute.
+ *
+ * The attach callback is called with the pool when the lease starts and
+ * with nullptr when it ends; engines attach/detach it on their contexts.
+ */
+class ComputeLease {
+public:
+    using AttachFn = std::function<void(ggml_threadpool*)>;
+
+    ComputeLease(int32_t n_threads, AttachFn attach);
+    ~ComputeLease();
+
+    ComputeLease(const ComputeLease&) = delete;
+    ComputeLease& operator=(const ComputeLease&) = delete;
+
+    ggml_threadpool* pool() const { return pool_; }
+
+private:
+    ggml_threadpool* pool_ = nullptr;
+    AttachFn attach_;
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_COMPUTE_POOL_H
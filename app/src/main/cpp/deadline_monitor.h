@@ -0,0 +1,116 @@
+// UnaMentis - Audio Deadline Monitor
+// Counts audio callbacks that overran their period or arrived late
+//
+// A callback misses its deadline when it runs longer than the audio it
+// delivers, or when it starts more than one period late (a burst was
+// skipped). Each callback is attributed to periods with or without
+// inference load so the two can be compared.
+
+#ifndef UNAMENTIS_DEADLINE_MONITOR_H
+#define UNAMENTIS_DEADLINE_MONITOR_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace unamentis {
+
+/**
+ * Audio callback deadline counters.
+ */
+struct DeadlineStats {
+    int64_t callbacks = 0;             // Callbacks without inference running
+    int64_t misses = 0;                // Missed deadlines without inference running
+    int64_t loaded_callbacks = 0;      // Callbacks while an engine was decoding
+    int64_t loaded_misses = 0;         // Missed deadlines while an engine was decoding
+    int64_t max_callback_us = 0;       // Longest callback
+    int64_t max_interval_us = 0;       // Longest gap between callback starts
+};
+
+/**
+ * Deadline tracking for one callback thread.
+ *
+ * record() is called from the callback thread only; stats() and reset()
+ * may be called from any thread.
+ */
+class DeadlineMonitor {
+public:
+    /**
+     * Record one callback.
+     *
+     * @param start_us Callback start on a monotonic clock
+     * @param end_us Callback end on the same clock
+     * @param period_us Duration of the audio the callback handled
+     * @param under_load Whether inference was running
+     */
+    void record(int64_t start_us, int64_t end_us, int64_t period_us, bool under_load) {
+        const int64_t duration = end_us - start_us;
+        const int64_t previous = last_start_us_.exchange(start_us, std::memory_order_relaxed);
+        const int64_t interval = previous > 0 ? start_us - previous : 0;
+
+        const bool missed = duration > period_us || interval > 2 * period_us;
+        if (under_load) {
+            loaded_callbacks_.fetch_add(1, std::memory_order_relaxed);
+            if (missed) {
+                loaded_misses_.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            callbacks_.fetch_add(1, std::memory_order_relaxed);
+            if (missed) {
+                misses_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        raise(max_callback_us_, duration);
+        raise(max_interval_us_, interval);
+    }
+
+    DeadlineStats stats() const {
+        DeadlineStats result;
+        result.callbacks = callbacks_.load(std::memory_order_relaxed);
+        result.misses = misses_.load(std::memory_order_relaxed);
+        result.loaded_callbacks = loaded_callbacks_.load(std::memory_order_relaxed);
+        result.loaded_misses = loaded_misses_.load(std::memory_order_relaxed);
+        result.max_callback_us = max_callback_us_.load(std::memory_order_relaxed);
+        result.max_interval_us = max_interval_us_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    /**
+     * Don't count the gap before the next callback (the stream was stopped).
+     */
+    void restartInterval() {
+        last_start_us_.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Clear counters; the next callback starts a new interval.
+     */
+    void reset() {
+        callbacks_.store(0, std::memory_order_relaxed);
+        misses_.store(0, std::memory_order_relaxed);
+        loaded_callbacks_.store(0, std::memory_order_relaxed);
+        loaded_misses_.store(0, std::memory_order_relaxed);
+        max_callback_us_.store(0, std::memory_order_relaxed);
+        max_interval_us_.store(0, std::memory_order_relaxed);
+        last_start_us_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> callbacks_{0};
+    std::atomic<int64_t> misses_{0};
+    std::atomic<int64_t> loaded_callbacks_{0};
+    std::atomic<int64_t> loaded_misses_{0};
+    std::atomic<int64_t> max_callback_us_{0};
+    std::atomic<int64_t> max_interval_us_{0};
+    std::atomic<int64_t> last_start_us_{0};
+
+    static void raise(std::atomic<int64_t>& target, int64_t value) {
+        int64_t current = target.load(std::memory_order_relaxed);
+        while (value > current &&
+               !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_DEADLINE_MONITOR_H
@@ -0,0 +1,88 @@
+// UnaMentis - DSP Kernels
+// Vectorized gain and peak helpers for the playback path
+//
+// NEON (AArch64) and SSE2 paths handle four samples per step with a scalar
+// tail. Header-only, like sample_convert.h, so host benchmarks can use them
+// without Oboe.
+
+#ifndef UNAMENTIS_DSP_KERNELS_H
+#define UNAMENTIS_DSP_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define UNAMENTIS_DSP_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UNAMENTIS_DSP_SSE2 1
+#endif
+
+namespace unamentis {
+
+/**
+ * Largest absolute sample value.
+ */
+inline float peakAbs(const float* in, size_t count) {
+    float peak = 0.0f;
+    size_t i = 0;
+#if defined(UNAMENTIS_DSP_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4) {
+        acc = vmaxq_f32(acc, vabsq_f32(vld1q_f32(in + i)));
+    }
+    peak = vmaxvq_f32(acc);
+#elif defined(UNAMENTIS_DSP_SSE2)
+    // Clearing the sign bit gives the absolute value
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        acc = _mm_max_ps(acc, _mm_and_ps(_mm_loadu_ps(in + i), abs_mask));
+    }
+    acc = _mm_max_ps(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_max_ps(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    peak = _mm_cvtss_f32(acc);
+#endif
+    for (; i < count; ++i) {
+        const float a = std::fabs(in[i]);
+        peak = a > peak ? a : peak;
+    }
+    return peak;
+}
+
+/**
+ * Multiply samples in place by a gain that moves linearly from gain by step
+ * per sample.
+ *
+ * @return Gain for the sample after the last one
+ */
+inline float applyGainRamp(float* samples, size_t count, float gain, float step) {
+    size_t i = 0;
+#if defined(UNAMENTIS_DSP_NEON)
+    const float lanes[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t g = vmlaq_n_f32(vdupq_n_f32(gain), vld1q_f32(lanes), step);
+    const float32x4_t advance = vdupq_n_f32(step * 4.0f);
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(samples + i, vmulq_f32(vld1q_f32(samples + i), g));
+        g = vaddq_f32(g, advance);
+    }
+#elif defined(UNAMENTIS_DSP_SSE2)
+    __m128 g = _mm_add_ps(_mm_set1_ps(gain),
+                          _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(step)));
+    const __m128 advance = _mm_set1_ps(step * 4.0f);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+        g = _mm_add_ps(g, advance);
+    }
+#endif
+    // The tail works from the start gain, so rounding in the vector lanes stays local
+    for (; i < count; ++i) {
+        samples[i] *= gain + step * static_cast<float>(i);
+    }
+    return gain + step * static_cast<float>(count);
+}
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_DSP_KERNELS_H
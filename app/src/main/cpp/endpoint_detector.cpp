@@ -0,0 +1,264 @@
+// UnaMentis - Endpoint Detector Implementation
+// Decides when the learner has finished speaking
+
+#include "endpoint_detector.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <numeric>
+
+namespace unamentis {
+
+// Gaps shorter than this are part of normal speech rhythm, not pauses
+static constexpr int64_t kMinPauseMs = 150;
+
+// Hangover after a sentence-final transcript, relative to the minimum
+static constexpr float kCompleteFactor = 1.5f;
+
+// Energy trend into a pause
+static constexpr size_t kTailFrames = 4;
+static constexpr float kTaperDb = 6.0f;          // Tail this far under the recent peak: tapered off
+static constexpr float kCutOffDb = 3.0f;         // Tail within this of the peak: cut off mid-word
+static constexpr float kTaperFactor = 0.8f;
+static constexpr float kCutOffFactor = 1.2f;
+
+// A resumed pause raises the hangover past its own length
+static constexpr float kResumedPauseFactor = 1.25f;
+
+// Words that leave a sentence open when it stops on them
+static const char* const kContinuationWords[] = {
+    "and", "but", "or", "so", "because", "then", "if", "that", "which",
+    "the", "a", "an", "to", "of", "with", "um", "uh", "er", "erm", "like",
+};
+
+EndpointDetector::EndpointDetector(const EndpointConfig& config) : config_(config) {}
+
+void EndpointDetector::configure(const EndpointConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    clearTurnLocked();
+}
+
+EndpointEvent EndpointDetector::process(const float* samples, int32_t count, float speech_probability) {
+    if (samples == nullptr || count <= 0) {
+        return EndpointEvent::NONE;
+    }
+
+    float sum_squares = 0.0f;
+    for (int32_t i = 0; i < count; ++i) {
+        sum_squares += samples[i] * samples[i];
+    }
+    const float rms = std::sqrt(sum_squares / static_cast<float>(count));
+    const float db = 20.0f * std::log10(std::max(rms, 1e-6f));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool speech = speech_probability >= config_.speech_threshold;
+
+    // Noise floor follows quiet frames down fast and up slowly
+    if (!speech) {
+        noise_floor_db_ += (db - noise_floor_db_) * (db < noise_floor_db_ ? 0.3f : 0.02f);
+    }
+
+    // A borderline frame well above the noise floor doesn't count as silence
+    const bool voiced = speech ||
+        (in_turn_ && speech_probability >= 0.5f * config_.speech_threshold &&
+         db > noise_floor_db_ + config_.energy_margin_db);
+
+    if (voiced) {
+        recent_db_.push_back(db);
+        if (recent_db_.size() > kTrendFrames) {
+            recent_db_.pop_front();
+        }
+    }
+
+    if (!in_turn_) {
+        if (!speech) {
+            speech_samples_ = 0;
+            recent_db_.clear();
+            return EndpointEvent::NONE;
+        }
+        speech_samples_ += count;
+        if (toMs(speech_samples_) < config_.min_speech_ms) {
+            return EndpointEvent::NONE;
+        }
+        in_turn_ = true;
+        position_ = speech_samples_;
+        last_speech_end_ = position_;
+        return EndpointEvent::SPEECH_START;
+    }
+
+    position_ += count;
+    if (voiced) {
+        if (in_pause_) {
+            const int64_t pause = position_ - count - last_speech_end_;
+            if (toMs(pause) >= kMinPauseMs) {
+                longest_resumed_pause_ = std::max(longest_resumed_pause_, pause);
+                stats_.resumed_pauses++;
+            }
+            in_pause_ = false;
+            // The transcript cues described the speech before the pause
+            text_cue_ = TextCue::NONE;
+            end_of_generation_ = false;
+        }
+        speech_samples_ += count;
+        last_speech_end_ = position_;
+        return EndpointEvent::NONE;
+    }
+
+    if (!in_pause_) {
+        in_pause_ = true;
+        energy_factor_ = energyFactorLocked();
+    }
+    const int64_t silence = position_ - last_speech_end_;
+    if (toMs(silence) >= hangoverMsLocked()) {
+        endTurnLocked(silence);
+        return EndpointEvent::END_OF_UTTERANCE;
+    }
+    return EndpointEvent::NONE;
+}
+
+void EndpointDetector::reportTranscript(const std::string& text, bool end_of_generation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!in_turn_) {
+        return;
+    }
+    text_cue_ = classifyText(text);
+    end_of_generation_ = end_of_generation;
+}
+
+void EndpointDetector::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clearTurnLocked();
+}
+
+EndpointStats EndpointDetector::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EndpointStats stats = stats_;
+    if (latencies_ms_.empty()) {
+        return stats;
+    }
+
+    std::vector<int64_t> sorted = latencies_ms_;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    stats.mean_latency_ms = std::accumulate(sorted.begin(), sorted.end(), int64_t{0}) /
+        static_cast<int64_t>(n);
+    stats.p50_latency_ms = sorted[(n - 1) / 2];
+    stats.p90_latency_ms = sorted[(n - 1) * 9 / 10];
+    stats.max_latency_ms = sorted.back();
+    return stats;
+}
+
+void EndpointDetector::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = EndpointStats();
+    latencies_ms_.clear();
+}
+
+int32_t EndpointDetector::hangoverMsLocked() const {
+    float hangover = static_cast<float>(config_.base_hangover_ms);
+    const bool complete = end_of_generation_ || text_cue_ == TextCue::COMPLETE;
+
+    if (end_of_generation_) {
+        hangover = static_cast<float>(config_.min_hangover_ms);
+    } else if (text_cue_ == TextCue::COMPLETE) {
+        hangover = config_.min_hangover_ms * kCompleteFactor;
+    } else if (text_cue_ == TextCue::CONTINUING) {
+        hangover = static_cast<float>(config_.max_hangover_ms);
+    }
+
+    // A cut-off doesn't outweigh a finished sentence
+    if (in_pause_ && !end_of_generation_ && !(complete && energy_factor_ > 1.0f)) {
+        hangover *= energy_factor_;
+    }
+
+    // Adapt to a speaker who has already paused this long and carried on
+    if (!complete && longest_resumed_pause_ > 0) {
+        hangover = std::max(hangover, toMs(longest_resumed_pause_) * kResumedPauseFactor);
+    }
+
+    const float lower = static_cast<float>(config_.min_hangover_ms);
+    const float upper = static_cast<float>(std::max(config_.min_hangover_ms, config_.max_hangover_ms));
+    return static_cast<int32_t>(std::clamp(hangover, lower, upper));
+}
+
+void EndpointDetector::endTurnLocked(int64_t silence_samples) {
+    const int64_t latency_ms = toMs(silence_samples);
+    stats_.endpoints++;
+    if (end_of_generation_ || text_cue_ == TextCue::COMPLETE) {
+        stats_.punctuation_endpoints++;
+    }
+    if (latencies_ms_.size() >= kMaxLatencies) {
+        latencies_ms_.erase(latencies_ms_.begin());
+    }
+    latencies_ms_.push_back(latency_ms);
+    clearTurnLocked();
+}
+
+void EndpointDetector::clearTurnLocked() {
+    in_turn_ = false;
+    position_ = 0;
+    speech_samples_ = 0;
+    in_pause_ = false;
+    longest_resumed_pause_ = 0;
+    text_cue_ = TextCue::NONE;
+    end_of_generation_ = false;
+    recent_db_.clear();
+}
+
+float EndpointDetector::energyFactorLocked() const {
+    if (recent_db_.size() <= kTailFrames) {
+        return 1.0f;
+    }
+    const float peak = *std::max_element(recent_db_.begin(), recent_db_.end());
+    const float tail = std::accumulate(recent_db_.end() - kTailFrames, recent_db_.end(), 0.0f) /
+        static_cast<float>(kTailFrames);
+    if (tail < peak - kTaperDb) {
+        return kTaperFactor;
+    }
+    // Stopped at full level: likely cut off mid-thought
+    if (recent_db_.back() > peak - kCutOffDb) {
+        return kCutOffFactor;
+    }
+    return 1.0f;
+}
+
+EndpointDetector::TextCue EndpointDetector::classifyText(const std::string& text) {
+    size_t end = text.find_last_not_of(" \t\n\r");
+    if (end == std::string::npos) {
+        return TextCue::NONE;
+    }
+
+    // A trailing ellipsis or clause punctuation leaves the sentence open
+    if (end >= 2 && text.compare(end - 2, 3, "...") == 0) {
+        return TextCue::CONTINUING;
+    }
+    const char last = text[end];
+    if (last == '.' || last == '?' || last == '!') {
+        return TextCue::COMPLETE;
+    }
+    if (last == ',' || last == ';' || last == ':' || last == '-') {
+        return TextCue::CONTINUING;
+    }
+
+    size_t start = end;
+    while (start > 0 && std::isalpha(static_cast<unsigned char>(text[start - 1]))) {
+        --start;
+    }
+    std::string word = text.substr(start, end - start + 1);
+    for (char& c : word) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    for (const char* candidate : kContinuationWords) {
+        if (word == candidate) {
+            return TextCue::CONTINUING;
+        }
+    }
+    return TextCue::NONE;
+}
+
+int64_t EndpointDetector::toMs(int64_t samples) const {
+    return config_.sample_rate > 0 ? samples * 1000 / config_.sample_rate : 0;
+}
+
+} // namespace unamentis
@@ -0,0 +1,143 @@
+// UnaMentis - Endpoint Detector Header
+// Decides when the learner has finished speaking
+//
+// Instead of waiting out a fixed silence, the detector picks the hangover
+// (silence needed to end the turn) per pause from the cues at hand:
+// - partial transcripts: sentence-final punctuation or end-of-generation
+//   shorten it, a trailing comma, conjunction or filler lengthens it
+// - energy trend: speech that tapered off before the pause shortens it,
+//   speech cut off at full level lengthens it
+// - the speaker's own pauses: once someone resumes after a long pause, the
+//   hangover grows so their thinking pauses no longer end the turn
+//
+// Time is counted in samples, so results on recorded audio don't depend on
+// how fast it is fed.
+
+#ifndef UNAMENTIS_ENDPOINT_DETECTOR_H
+#define UNAMENTIS_ENDPOINT_DETECTOR_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace unamentis {
+
+/**
+ * Endpointing thresholds.
+ */
+struct EndpointConfig {
+    int32_t sample_rate = 16000;
+    float speech_threshold = 0.5f;     // VAD probability that counts as speech
+    int32_t min_speech_ms = 60;        // Speech needed before a turn can end
+    int32_t base_hangover_ms = 600;    // Silence that ends a turn without other cues
+    int32_t min_hangover_ms = 250;     // After a complete sentence or end-of-generation
+    int32_t max_hangover_ms = 1200;    // Upper bound for hesitant speakers
+    float energy_margin_db = 6.0f;     // Frames this far over the noise floor aren't silence
+};
+
+/**
+ * Result of feeding one frame.
+ */
+enum class EndpointEvent : int32_t {
+    NONE = 0,
+    SPEECH_START = 1,                  // The turn began
+    END_OF_UTTERANCE = 2,              // The turn ended; the detector is ready for the next
+};
+
+/**
+ * Endpoint counters. Latency is the silence between the last speech frame
+ * and the endpoint.
+ */
+struct EndpointStats {
+    int64_t endpoints = 0;             // Turns ended
+    int64_t resumed_pauses = 0;        // Pauses the speaker broke before the hangover ran out
+    int64_t punctuation_endpoints = 0; // Turns ended early on a transcript cue
+    int64_t mean_latency_ms = 0;
+    int64_t p50_latency_ms = 0;
+    int64_t p90_latency_ms = 0;
+    int64_t max_latency_ms = 0;
+};
+
+/**
+ * Adaptive end-of-utterance detection.
+ *
+ * Thread-safe: frames and transcripts may arrive on different threads.
+ */
+class EndpointDetector {
+public:
+    EndpointDetector() = default;
+    explicit EndpointDetector(const EndpointConfig& config);
+
+    /**
+     * Replace the thresholds; the current turn is dropped.
+     */
+    void configure(const EndpointConfig& config);
+
+    /**
+     * Feed one capture frame.
+     *
+     * @param samples Mono samples in [-1, 1]
+     * @param count Number of samples
+     * @param speech_probability VAD speech probability for the frame
+     * @return Event raised by this frame
+     */
+    EndpointEvent process(const float* samples, int32_t count, float speech_probability);
+
+    /**
+     * Report the latest partial transcript of the current turn.
+     *
+     * @param text Transcript so far
+     * @param end_of_generation Whether the recognizer emitted end-of-generation
+     */
+    void reportTranscript(const std::string& text, bool end_of_generation);
+
+    /**
+     * Drop the current turn (e.g. when capture stops).
+     */
+    void reset();
+
+    EndpointStats getStats() const;
+    void resetStats();
+
+private:
+    // Hint from the latest transcript
+    enum class TextCue { NONE, COMPLETE, CONTINUING };
+
+    static constexpr size_t kTrendFrames = 16;     // Frame energies kept for the trend
+    static constexpr size_t kMaxLatencies = 512;   // Endpoint latencies kept for percentiles
+
+    mutable std::mutex mutex_;
+    EndpointConfig config_;
+
+    // Turn state (in samples since the turn started)
+    bool in_turn_ = false;
+    int64_t position_ = 0;
+    int64_t speech_samples_ = 0;
+    int64_t last_speech_end_ = 0;      // End of the last speech frame
+    bool in_pause_ = false;
+    int64_t longest_resumed_pause_ = 0;
+    TextCue text_cue_ = TextCue::NONE;
+    bool end_of_generation_ = false;
+    float energy_factor_ = 1.0f;       // Hangover scale from the energy trend into the current pause
+
+    // Energy tracking (dBFS)
+    float noise_floor_db_ = -60.0f;
+    std::deque<float> recent_db_;
+
+    // Counters (guarded by mutex_)
+    EndpointStats stats_;
+    std::vector<int64_t> latencies_ms_;
+
+    int32_t hangoverMsLocked() const;
+    void endTurnLocked(int64_t silence_samples);
+    void clearTurnLocked();
+    float energyFactorLocked() const;
+    static TextCue classifyText(const std::string& text);
+    int64_t toMs(int64_t samples) const;
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_ENDPOINT_DETECTOR_H
@@ -0,0 +1,192 @@
+#include <jni.h>
+#include <android/log.h>
+#include "endpoint_detector.h"
+#include <memory>
+#include <map>
+#include <mutex>
+#include <string>
+
+#define LOG_TAG "UnaMentis-Endpoint"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// Store detector instances by pointer address
+static std::map<jlong, std::shared_ptr<unamentis::EndpointDetector>> g_detectors;
+static std::mutex g_detectors_mutex;
+
+static std::shared_ptr<unamentis::EndpointDetector> findDetector(jlong detector_ptr) {
+    std::lock_guard<std::mutex> lock(g_detectors_mutex);
+    auto it = g_detectors.find(detector_ptr);
+    if (it == g_detectors.end()) {
+        LOGE("Invalid detector pointer: %lld", (long long)detector_ptr);
+        return nullptr;
+    }
+    return it->second;
+}
+
+extern "C" {
+
+/**
+ * Create an endpoint detector.
+ *
+ * @return Pointer to detector instance (as long)
+ */
+JNIEXPORT jlong JNICALL
+Java_com_unamentis_core_audio_EndpointDetector_nativeCreate(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jint sample_rate,
+    jfloat speech_threshold,
+    jint min_speech_ms,
+    jint base_hangover_ms,
+    jint min_hangover_ms,
+    jint max_hangover_ms
+) {
+    unamentis::EndpointConfig config;
+    config.sample_rate = sample_rate;
+    config.speech_threshold = speech_threshold;
+    config.min_speech_ms = min_speech_ms;
+    config.base_hangover_ms = base_hangover_ms;
+    config.min_hangover_ms = min_hangover_ms;
+    config.max_hangover_ms = max_hangover_ms;
+
+    auto detector = std::make_shared<unamentis::EndpointDetector>(config);
+    jlong ptr = reinterpret_cast<jlong>(detector.get());
+    {
+        std::lock_guard<std::mutex> lock(g_detectors_mutex);
+        g_detectors[ptr] = std::move(detector);
+    }
+
+    LOGI("Endpoint detector created: hangover %d-%d ms (base %d)",
+         min_hangover_ms, max_hangover_ms, base_hangover_ms);
+    return ptr;
+}
+
+/**
+ * Feed one capture frame.
+ *
+ * @return 0 = nothing, 1 = speech start, 2 = end of utterance
+ */
+JNIEXPORT jint JNICALL
+Java_com_unamentis_core_audio_EndpointDetector_nativeProcess(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong detector_ptr,
+    jfloatArray samples,
+    jfloat speech_probability
+) {
+    auto detector = findDetector(detector_ptr);
+    if (!detector) {
+        return 0;
+    }
+
+    jsize length = env->GetArrayLength(samples);
+    jfloat* data = env->GetFloatArrayElements(samples, nullptr);
+    if (data == nullptr) {
+        return 0;
+    }
+    unamentis::EndpointEvent event = detector->process(data, length, speech_probability);
+    env->ReleaseFloatArrayElements(samples, data, JNI_ABORT);
+    return static_cast<jint>(event);
+}
+
+/**
+ * Report the latest partial transcript of the current turn.
+ */
+JNIEXPORT void JNICALL
+Java_com_unamentis_core_audio_EndpointDetector_nativeReportTranscript(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong detector_ptr,
+    jstring text,
+    jboolean end_of_generation
+) {
+    auto detector = findDetector(detector_ptr);
+    if (!detector || text == nullptr) {
+        return;
+    }
+
+    const char* chars = env->GetStringUTFChars(text, nullptr);
+    if (chars == nullptr) {
+        return;
+    }
+    std::string transcript(chars);
+    env->ReleaseStringUTFChars(text, chars);
+    detector->reportTranscript(transcript, end_of_generation == JNI_TRUE);
+}
+
+/**
+ * Drop the current turn.
+ */
+JNIEXPORT void JNICALL
+Java_com_unamentis_core_audio_EndpointDetector_nativeReset(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong detector_ptr
+) {
+    auto detector = findDetector(detector_ptr);
+    if (detector) {
+        detector->reset();
+    }
+}
+
+/**
+ * Get endpoint counters:
+ * [endpoints, resumedPauses, punctuationEndpoints, meanLatencyMs, p50LatencyMs, p90LatencyMs, maxLatencyMs]
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_core_audio_EndpointDetector_nativeGetStats(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong detector_ptr
+) {
+    jlong values[7] = {0, 0, 0, 0, 0, 0, 0};
+
+    auto detector = findDetector(detector_ptr);
+    if (detector) {
+        unamentis::EndpointStats stats = detector->getStats();
+        values[0] = stats.endpoints;
+        values[1] = stats.resumed_pauses;
+        values[2] = stats.punctuation_endpoints;
+        values[3] = stats.mean_latency_ms;
+        values[4] = stats.p50_latency_ms;
+        values[5] = stats.p90_latency_ms;
+        values[6] = stats.max_latency_ms;
+    }
+
+    jlongArray result = env->NewLongArray(7);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 7, values);
+    }
+    return result;
+}
+
+/**
+ * Clear endpoint counters.
+ */
+JNIEXPORT void JNICALL
+Java_com_unamentis_core_audio_EndpointDetector_nativeResetStats(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong detector_ptr
+) {
+    auto detector = findDetector(detector_ptr);
+    if (detector) {
+        detector->resetStats();
+    }
+}
+
+/**
+ * Destroy an endpoint detector.
+ */
+JNIEXPORT void JNICALL
+Java_com_unamentis_core_audio_EndpointDetector_nativeDestroy(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong detector_ptr
+) {
+    std::lock_guard<std::mutex> lock(g_detectors_mutex);
+    g_detectors.erase(detector_ptr);
+}
+
+} // extern "C"
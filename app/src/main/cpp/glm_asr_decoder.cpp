@@ -2,8 +2,11 @@
 // On-device ASR decoder using llama.cpp for embedding-to-text generation
 
 #include "glm_asr_decoder.h"
+#include "thread_policy.h"
 #include <android/log.h>
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 
@@ -15,6 +18,15 @@
 
 namespace unamentis {
 
+// The ONNX pipeline always encodes a 30 s window into a fixed token block
+static constexpr int32_t kAudioWindowMs = 30000;
+
+// Rows kept past the detected end of speech (encoder receptive field)
+static constexpr int32_t kTrimMarginTokens = 2;
+
+// Squared norm below which an embedding row counts as empty
+static constexpr float kEmptyRowNorm = 1e-12f;
+
 // Helper function to clear a batch
 static void asr_batch_clear(llama_batch& batch) {
     batch.n_tokens = 0;
@@ -44,6 +56,7 @@ GLMASRDecoder::GLMASRDecoder() {
 
 GLMASRDecoder::~GLMASRDecoder() {
     unloadModel();
+    telemetry_.detach();
     LOGI("GLMASRDecoder destroyed");
 }
 
@@ -69,7 +82,8 @@ bool GLMASRDecoder::loadModel(const std::string& model_path, const GLMASRDecoder
 
     // Load model
     LOGI("Loading model file (this may take a while)...");
-    model_ = llama_model_load_from_file(model_path.c_str(), model_params);
+    shared_model_ = acquireSharedModel(model_path, model_params);
+    model_ = shared_model_ ? shared_model_->get() : nullptr;
     if (model_ == nullptr) {
         LOGE("Failed to load model from: %s", model_path.c_str());
         llama_backend_free();
@@ -78,27 +92,50 @@ bool GLMASRDecoder::loadModel(const std::string& model_path, const GLMASRDecoder
     LOGI("Model loaded successfully, n_embd=%d", llama_model_n_embd(model_));
 
     // Create context
-    int n_threads = std::max(1, std::min(8, config.n_threads));
+    if (!createContext()) {
+        shared_model_.reset();
+        model_ = nullptr;
+        llama_backend_free();
+        return false;
+    }
+
+    is_loaded_.store(true);
+    is_hibernated_.store(false);
+    publishTelemetry();
+    LOGI("GLM-ASR decoder ready");
+    return true;
+}
+
+bool GLMASRDecoder::createContext() {
+    int n_threads = std::max(1, std::min(8, config_.n_threads));
     llama_context_params ctx_params = llama_context_default_params();
-    ctx_params.n_ctx = config.context_size;
+    ctx_params.n_ctx = config_.context_size;
     ctx_params.n_threads = n_threads;
     ctx_params.n_threads_batch = n_threads;
 
-    LOGD("Creating context with %d threads, context size: %d", n_threads, config.context_size);
+    // Long-form windows decode side by side on their own sequences
+    ctx_params.n_seq_max = static_cast<uint32_t>(std::max(1, config_.max_parallel_windows));
+    ctx_params.kv_unified = config_.max_parallel_windows > 1;
+
+    LOGD("Creating context with %d threads, context size: %d", n_threads, config_.context_size);
     context_ = llama_init_from_model(model_, ctx_params);
     if (context_ == nullptr) {
         LOGE("Failed to create context");
-        llama_model_free(model_);
-        model_ = nullptr;
-        llama_backend_free();
         return false;
     }
-
-    is_loaded_.store(true);
-    LOGI("GLM-ASR decoder ready with %d threads", n_threads);
     return true;
 }
 
+ComputeLease GLMASRDecoder::leaseThreadpool() {
+    return ComputeLease(config_.n_threads, [this](ggml_threadpool* pool) {
+        if (pool != nullptr) {
+            llama_attach_threadpool(context_, pool, pool);
+        } else {
+            llama_detach_threadpool(context_);
+        }
+    });
+}
+
 void GLMASRDecoder::unloadModel() {
     // Don't lock if already unloaded
     if (!is_loaded_.load()) {
@@ -115,16 +152,354 @@ void GLMASRDecoder::unloadModelLocked() {
         context_ = nullptr;
     }
 
-    if (model_ != nullptr) {
-        llama_model_free(model_);
-        model_ = nullptr;
-    }
+    // The weights stay loaded while LlamaInference still uses them
+    shared_model_.reset();
+    model_ = nullptr;
 
     llama_backend_free();
     is_loaded_.store(false);
+    is_hibernated_.store(false);
+    hibernate_snapshot_.clear();
+    hibernate_snapshot_.shrink_to_fit();
+    context_tokens_.clear();
+    pending_context_.clear();
+    long_form_queue_.clear();
+    long_form_queued_.store(0);
+    long_form_stitcher_.reset();
+    allowed_tokens_.clear();
+    publishTelemetry();
     LOGI("GLM-ASR decoder unloaded");
 }
 
+bool GLMASRDecoder::hibernate(bool snapshot_state) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (!is_loaded_.load() || is_hibernated_.load()) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const size_t state_bytes = llama_state_get_size(context_);
+
+    // Keep only the used KV cells of the decode sequence, not the whole buffer
+    hibernate_snapshot_.clear();
+    if (snapshot_state) {
+        hibernate_snapshot_.resize(llama_state_seq_get_size(context_, 0));
+        size_t written = llama_state_seq_get_data(
+            context_, hibernate_snapshot_.data(), hibernate_snapshot_.size(), 0);
+        hibernate_snapshot_.resize(written);
+    }
+    hibernate_snapshot_.shrink_to_fit();
+    if (!snapshot_state) {
+        forgetResidentContext();
+    }
+
+    // Frees the KV cache and compute buffers; weights stay mapped
+    llama_free(context_);
+    context_ = nullptr;
+    is_hibernated_.store(true);
+    publishTelemetry();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    hibernate_stats_.state_bytes = static_cast<int64_t>(state_bytes);
+    hibernate_stats_.model_bytes = static_cast<int64_t>(llama_model_size(model_));
+    hibernate_stats_.snapshot_bytes = static_cast<int64_t>(hibernate_snapshot_.size());
+    hibernate_stats_.hibernate_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    LOGI("Hibernated: released %zu state bytes, kept %zu snapshot bytes",
+         state_bytes, hibernate_snapshot_.size());
+    return true;
+}
+
+bool GLMASRDecoder::resume() {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    return resumeLocked();
+}
+
+bool GLMASRDecoder::resumeLocked() {
+    if (!is_hibernated_.load()) {
+        return is_loaded_.load();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!createContext()) {
+        LOGE("Failed to resume from hibernation");
+        return false;
+    }
+
+    if (!hibernate_snapshot_.empty()) {
+        if (llama_state_seq_set_data(context_, hibernate_snapshot_.data(),
+                                     hibernate_snapshot_.size(), 0) == 0) {
+            LOGW("Failed to restore hibernate snapshot");
+            forgetResidentContext();
+        }
+        hibernate_snapshot_.clear();
+        hibernate_snapshot_.shrink_to_fit();
+    }
+    is_hibernated_.store(false);
+    publishTelemetry();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    hibernate_stats_.resume_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    LOGI("Resumed from hibernation in %.1f ms", hibernate_stats_.resume_us / 1000.0);
+    return true;
+}
+
+bool GLMASRDecoder::reconfigure(int32_t context_size, int32_t n_threads) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (!is_loaded_.load()) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (n_threads > 0) {
+        config_.n_threads = n_threads;
+    }
+    const int32_t threads = std::max(1, std::min(8, config_.n_threads));
+    const bool resize = context_size > 0 && context_size != config_.context_size;
+
+    // A hibernated decoder picks the new settings up when it resumes
+    if (is_hibernated_.load()) {
+        if (resize) {
+            config_.context_size = context_size;
+        }
+        return true;
+    }
+    if (!resize) {
+        llama_set_n_threads(context_, threads, threads);
+        LOGI("Reconfigured: %d threads", threads);
+        return true;
+    }
+
+    // Carry the rolling transcript context over if it fits
+    std::vector<uint8_t> carried;
+    llama_memory_seq_rm(llama_get_memory(context_), 0, static_cast<llama_pos>(context_tokens_.size()), -1);
+    if (!context_tokens_.empty() && static_cast<int32_t>(context_tokens_.size()) < context_size) {
+        carried.resize(llama_state_seq_get_size(context_, 0));
+        carried.resize(llama_state_seq_get_data(context_, carried.data(), carried.size(), 0));
+    }
+
+    llama_context* previous = context_;
+    const int32_t previous_size = config_.context_size;
+    config_.context_size = context_size;
+    if (!createContext()) {
+        context_ = previous;
+        config_.context_size = previous_size;
+        return false;
+    }
+    llama_free(previous);
+
+    if (carried.empty() ||
+        llama_state_seq_set_data(context_, carried.data(), carried.size(), 0) == 0) {
+        forgetResidentContext();
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    LOGI("Reconfigured: context %d, %d threads, carried %zu tokens in %.1f ms",
+         context_size, threads, context_tokens_.size(),
+         std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1000.0);
+    return true;
+}
+
+ASRHibernateStats GLMASRDecoder::getHibernateStats() {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    return hibernate_stats_;
+}
+
+void GLMASRDecoder::setRollingContext(int32_t max_tokens) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    config_.rolling_context_tokens = std::max(0, max_tokens);
+    if (config_.rolling_context_tokens == 0) {
+        context_tokens_.clear();
+        pending_context_.clear();
+    }
+    LOGI("Rolling transcript context: %d tokens", config_.rolling_context_tokens);
+}
+
+void GLMASRDecoder::clearRollingContext() {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    context_tokens_.clear();
+    pending_context_.clear();
+}
+
+int32_t GLMASRDecoder::getRollingContextSize() {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    return static_cast<int32_t>(context_tokens_.size() + pending_context_.size());
+}
+
+void GLMASRDecoder::setAllowedTokens(const std::vector<llama_token>& tokens) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    setAllowedTokensLocked(tokens);
+}
+
+int32_t GLMASRDecoder::restrictVocabToCharset(const std::string& charset) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    if (model_ == nullptr) {
+        return 0;
+    }
+
+    std::vector<llama_token> tokens;
+    if (!charset.empty()) {
+        std::array<bool, 256> allowed_bytes{};
+        bool any_multibyte = false;
+        for (unsigned char c : charset) {
+            allowed_bytes[c] = true;
+            any_multibyte = any_multibyte || c >= 0x80;
+        }
+        if (any_multibyte) {
+            for (int32_t c = 0x80; c < 256; ++c) {
+                allowed_bytes[c] = true;
+            }
+        }
+
+        const int32_t n_vocab = llama_vocab_n_tokens(llama_model_get_vocab(model_));
+        for (llama_token token = 0; token < n_vocab; ++token) {
+            const std::string piece = detokenize(token);
+            if (piece.empty()) {
+                continue;
+            }
+            bool ok = true;
+            for (unsigned char c : piece) {
+                if (!allowed_bytes[c]) {
+                    ok = false;
+                    break;
+                }
+            }
+            if (ok) {
+                tokens.push_back(token);
+            }
+        }
+    }
+
+    setAllowedTokensLocked(std::move(tokens));
+    return static_cast<int32_t>(allowed_tokens_.size());
+}
+
+void GLMASRDecoder::setAllowedTokensLocked(std::vector<llama_token> tokens) {
+    allowed_tokens_.clear();
+    if (tokens.empty() || model_ == nullptr) {
+        LOGI("Output vocabulary unrestricted");
+        return;
+    }
+
+    const llama_vocab* vocab = llama_model_get_vocab(model_);
+    const int32_t n_vocab = llama_vocab_n_tokens(vocab);
+
+    // Generation must still be able to end
+    for (llama_token token = 0; token < n_vocab; ++token) {
+        if (llama_vocab_is_eog(vocab, token)) {
+            tokens.push_back(token);
+        }
+    }
+
+    tokens.erase(std::remove_if(tokens.begin(), tokens.end(),
+                                [n_vocab](llama_token t) { return t < 0 || t >= n_vocab; }),
+                 tokens.end());
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+
+    allowed_tokens_ = std::move(tokens);
+    LOGI("Output vocabulary restricted to %zu of %d tokens", allowed_tokens_.size(), n_vocab);
+}
+
+llama_token GLMASRDecoder::sampleGreedy(llama_sampler* sampler, int32_t idx) {
+    const auto start = std::chrono::steady_clock::now();
+    llama_token best = -1;
+
+    const float* logits = allowed_tokens_.empty() ? nullptr : llama_get_logits_ith(context_, idx);
+    if (logits == nullptr) {
+        best = llama_sampler_sample(sampler, context_, idx);
+    } else {
+        // Argmax over the allowed rows only (ids are sorted, so reads stay forward)
+        best = allowed_tokens_[0];
+        float best_logit = logits[best];
+        for (llama_token token : allowed_tokens_) {
+            if (logits[token] > best_logit) {
+                best_logit = logits[token];
+                best = token;
+            }
+        }
+    }
+
+    sample_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    samples_.fetch_add(1);
+    return best;
+}
+
+bool GLMASRDecoder::decodeStep(llama_batch& batch) {
+    const auto start = std::chrono::steady_clock::now();
+    const bool ok = llama_decode(context_, batch) == 0;
+    step_us_.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    step_tokens_.fetch_add(batch.n_tokens);
+    return ok;
+}
+
+void GLMASRDecoder::forgetResidentContext() {
+    // The KV no longer holds the prefix; prefill it again on the next decode
+    context_tokens_.insert(context_tokens_.end(), pending_context_.begin(), pending_context_.end());
+    pending_context_.swap(context_tokens_);
+    context_tokens_.clear();
+}
+
+llama_pos GLMASRDecoder::prepareRollingContext(int32_t reserve) {
+    llama_memory_t memory = llama_get_memory(context_);
+
+    // Drop the previous utterance's audio and output, keep the prefix
+    llama_memory_seq_rm(memory, 0, static_cast<llama_pos>(context_tokens_.size()), -1);
+
+    // Fit the prefix into both the token budget and the context window
+    const int32_t budget = std::max(0, std::min(
+        config_.rolling_context_tokens, config_.context_size - reserve));
+
+    if (pending_context_.size() > static_cast<size_t>(budget)) {
+        pending_context_.erase(pending_context_.begin(),
+                               pending_context_.end() - budget);
+    }
+
+    const size_t total = context_tokens_.size() + pending_context_.size();
+    if (total > static_cast<size_t>(budget)) {
+        const llama_pos evict = static_cast<llama_pos>(total - budget);
+        if (llama_memory_can_shift(memory)) {
+            // Slide the retained tokens down instead of recomputing them
+            llama_memory_seq_rm(memory, 0, 0, evict);
+            llama_memory_seq_add(memory, 0, evict, -1, -evict);
+            context_tokens_.erase(context_tokens_.begin(), context_tokens_.begin() + evict);
+        } else {
+            llama_memory_clear(memory, true);
+            context_tokens_.erase(context_tokens_.begin(), context_tokens_.begin() + evict);
+            forgetResidentContext();
+        }
+    }
+
+    // Prefill only the text that is new since the last decode
+    if (!pending_context_.empty()) {
+        const int32_t n_pending = static_cast<int32_t>(pending_context_.size());
+        llama_batch batch = llama_batch_init(n_pending, 0, 1);
+        for (int32_t i = 0; i < n_pending; ++i) {
+            asr_batch_add_token(batch, pending_context_[i],
+                                static_cast<llama_pos>(context_tokens_.size()) + i, {0}, false);
+        }
+
+        if (llama_decode(context_, batch) == 0) {
+            context_tokens_.insert(context_tokens_.end(),
+                                   pending_context_.begin(), pending_context_.end());
+        } else {
+            LOGW("Failed to prefill rolling context, continuing without it");
+            llama_memory_seq_rm(memory, 0, static_cast<llama_pos>(context_tokens_.size()), -1);
+        }
+        llama_batch_free(batch);
+        pending_context_.clear();
+    }
+
+    return static_cast<llama_pos>(context_tokens_.size());
+}
+
 int32_t GLMASRDecoder::getEmbeddingDim() const {
     if (model_ == nullptr) {
         return 0;
@@ -132,10 +507,67 @@ int32_t GLMASRDecoder::getEmbeddingDim() const {
     return llama_model_n_embd(model_);
 }
 
+int32_t GLMASRDecoder::meaningfulTokens(
+    const float* embeddings,
+    int32_t num_tokens,
+    int32_t embedding_dim,
+    int32_t audio_duration_ms
+) const {
+    if (!config_.trim_padding || embeddings == nullptr || num_tokens <= 1 || embedding_dim <= 0) {
+        return num_tokens;
+    }
+
+    int32_t end = num_tokens;
+
+    if (audio_duration_ms > 0) {
+        // Round up so a partial token at the end of speech is kept
+        int64_t covered = (static_cast<int64_t>(audio_duration_ms) * num_tokens
+                           + kAudioWindowMs - 1) / kAudioWindowMs;
+        end = static_cast<int32_t>(std::min<int64_t>(covered, num_tokens));
+    } else {
+        // Padded silence encodes to a run of near-identical rows at the tail
+        const float* last = embeddings + static_cast<size_t>(num_tokens - 1) * embedding_dim;
+        double last_norm = 0.0;
+        for (int32_t d = 0; d < embedding_dim; ++d) {
+            last_norm += static_cast<double>(last[d]) * last[d];
+        }
+
+        while (end > 1) {
+            const float* row = embeddings + static_cast<size_t>(end - 2) * embedding_dim;
+            double dot = 0.0;
+            double norm = 0.0;
+            for (int32_t d = 0; d < embedding_dim; ++d) {
+                dot += static_cast<double>(row[d]) * last[d];
+                norm += static_cast<double>(row[d]) * row[d];
+            }
+
+            bool padding;
+            if (norm < kEmptyRowNorm || last_norm < kEmptyRowNorm) {
+                padding = norm < kEmptyRowNorm && last_norm < kEmptyRowNorm;
+            } else {
+                padding = dot / std::sqrt(norm * last_norm) >= config_.padding_similarity;
+            }
+            if (!padding) {
+                break;
+            }
+            --end;
+        }
+
+        // A block that is all padding (or none) is left untouched
+        if (end <= 1) {
+            return num_tokens;
+        }
+    }
+
+    return std::max(1, std::min(num_tokens, end + kTrimMarginTokens));
+}
+
 bool GLMASRDecoder::injectEmbeddings(
     const float* embeddings,
     int32_t num_tokens,
-    int32_t embedding_dim
+    int32_t embedding_dim,
+    llama_pos start_pos,
+    llama_seq_id seq_id
 ) {
     if (context_ == nullptr || model_ == nullptr) {
         LOGE("Cannot inject embeddings: model not loaded");
@@ -160,8 +592,9 @@ bool GLMASRDecoder::injectEmbeddings(
     }
 
     // Validate num_tokens does not exceed the context size
-    if (num_tokens > config_.context_size) {
-        LOGE("num_tokens (%d) exceeds context size (%d)", num_tokens, config_.context_size);
+    if (start_pos + num_tokens > config_.context_size) {
+        LOGE("num_tokens (%d) at position %d exceeds context size (%d)",
+             num_tokens, start_pos, config_.context_size);
         return false;
     }
 
@@ -177,9 +610,9 @@ bool GLMASRDecoder::injectEmbeddings(
     batch.n_tokens = num_tokens;
 
     for (int32_t i = 0; i < num_tokens; ++i) {
-        batch.pos[i] = static_cast<llama_pos>(i);
+        batch.pos[i] = start_pos + static_cast<llama_pos>(i);
         batch.n_seq_id[i] = 1;
-        batch.seq_id[i][0] = 0;
+        batch.seq_id[i][0] = seq_id;
         batch.logits[i] = 0;
     }
 
@@ -207,7 +640,8 @@ void GLMASRDecoder::decodeFromEmbeddings(
     int32_t num_tokens,
     int32_t embedding_dim,
     int32_t max_output_tokens,
-    ASRTokenCallback callback
+    ASRTokenCallback callback,
+    int32_t audio_duration_ms
 ) {
     if (!is_loaded_.load()) {
         LOGE("Cannot decode: model not loaded");
@@ -217,16 +651,47 @@ void GLMASRDecoder::decodeFromEmbeddings(
 
     std::lock_guard<std::mutex> lock(generation_mutex_);
 
+    // Text generation on shared weights pauses while the learner is heard
+    PriorityScope priority(shared_model_.get());
+    ComputeLoadScope compute_load;
+
+    // Transparently wake up after a low-memory hibernate
+    if (is_hibernated_.load() && !resumeLocked()) {
+        callback("", true);
+        return;
+    }
+    ComputeLease compute_lease = leaseThreadpool();
+
     is_generating_.store(true);
     stop_requested_.store(false);
 
+    // Telemetry shows the decode finished however this returns
+    struct PublishOnExit {
+        GLMASRDecoder* self;
+        ~PublishOnExit() { self->publishTelemetry(); }
+    } publish_on_exit{this};
+
     LOGD("Starting ASR decode with %d audio tokens, dim=%d", num_tokens, embedding_dim);
 
-    // Reset context for new generation
-    resetContext();
+    // Skip the padded tail of the fixed-size window
+    int32_t n_inject = meaningfulTokens(embeddings, num_tokens, embedding_dim, audio_duration_ms);
+    last_injected_tokens_.store(n_inject);
+    startDecodeTelemetry();
+    if (n_inject < num_tokens) {
+        LOGD("Trimmed audio embeddings: injecting %d of %d", n_inject, num_tokens);
+    }
+
+    // Reset context for new generation, keeping the transcript prefix if enabled
+    const bool rolling = config_.rolling_context_tokens > 0;
+    llama_pos start_pos = 0;
+    if (rolling) {
+        start_pos = prepareRollingContext(n_inject + max_output_tokens);
+    } else {
+        resetContext();
+    }
 
     // Inject audio embeddings
-    if (!injectEmbeddings(embeddings, num_tokens, embedding_dim)) {
+    if (!injectEmbeddings(embeddings, n_inject, embedding_dim, start_pos, 0)) {
         LOGE("Failed to inject embeddings");
         is_generating_.store(false);
         callback("", true);
@@ -243,8 +708,9 @@ void GLMASRDecoder::decodeFromEmbeddings(
     llama_batch token_batch = llama_batch_init(1, 0, 1);
 
     // Generation loop - continue from the injected embeddings
-    int32_t n_cur = num_tokens;
+    int32_t n_cur = start_pos + n_inject;
     int32_t n_gen = 0;
+    std::vector<llama_token> transcript;
 
     while (n_gen < max_output_tokens) {
         // Check for stop request
@@ -256,7 +722,7 @@ void GLMASRDecoder::decodeFromEmbeddings(
         // Sample next token
         // For the first iteration, sample from the last position of injected embeddings
         // For subsequent iterations, sample from the last generated token
-        llama_token new_token = llama_sampler_sample(sampler, context_, -1);
+        llama_token new_token = sampleGreedy(sampler, -1);
 
         // Check for end of generation
         if (llama_vocab_is_eog(vocab, new_token)) {
@@ -267,9 +733,14 @@ void GLMASRDecoder::decodeFromEmbeddings(
         // Decode token to text
         std::string token_text = detokenize(new_token);
 
+        if (rolling) {
+            transcript.push_back(new_token);
+        }
+
         // Emit token
         if (!token_text.empty()) {
             n_gen++;
+            recordTokens(1);
             callback(token_text, false);
         }
 
@@ -278,7 +749,7 @@ void GLMASRDecoder::decodeFromEmbeddings(
         asr_batch_add_token(token_batch, new_token, n_cur, {0}, true);
 
         // Process the new token
-        if (llama_decode(context_, token_batch) != 0) {
+        if (!decodeStep(token_batch)) {
             LOGE("Decode failed during generation");
             break;
         }
@@ -290,18 +761,216 @@ void GLMASRDecoder::decodeFromEmbeddings(
     llama_sampler_free(sampler);
     llama_batch_free(token_batch);
 
-    LOGI("ASR generation complete: %d tokens generated", n_gen);
+    // This transcript becomes context for the next utterance
+    if (rolling) {
+        pending_context_ = std::move(transcript);
+    }
+
+    LOGI("ASR generation complete: %d tokens generated, %.2f ms/token decode step, "
+         "%.1f us/token greedy choice over %zu tokens", n_gen,
+         step_tokens_.load() > 0 ? step_us_.load() / 1000.0 / step_tokens_.load() : 0.0,
+         samples_.load() > 0 ? sample_ns_.load() / 1000.0 / samples_.load() : 0.0,
+         allowed_tokens_.empty() ? static_cast<size_t>(llama_vocab_n_tokens(vocab))
+                                 : allowed_tokens_.size());
     is_generating_.store(false);
 
     // Final callback to signal completion
     callback("", true);
 }
 
+void GLMASRDecoder::beginLongForm(int32_t overlap_ms) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    long_form_queue_.clear();
+    long_form_queued_.store(0);
+    long_form_stitcher_ = TranscriptStitcher(overlap_ms);
+    long_form_ok_ = true;
+    stop_requested_.store(false);
+    publishTelemetry();
+    LOGI("Long-form transcription started (overlap=%dms)", overlap_ms);
+}
+
+bool GLMASRDecoder::addLongFormWindow(
+    const float* embeddings,
+    int32_t num_tokens,
+    int32_t embedding_dim,
+    int32_t audio_duration_ms
+) {
+    if (!is_loaded_.load()) {
+        LOGE("Cannot add long-form window: model not loaded");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (embeddings == nullptr || num_tokens <= 0 || embedding_dim != getEmbeddingDim()) {
+        LOGE("Invalid long-form window: %d tokens, dim=%d", num_tokens, embedding_dim);
+        return false;
+    }
+
+    // Only the meaningful prefix is kept; the last window is usually short
+    LongFormWindow window;
+    window.num_tokens = meaningfulTokens(embeddings, num_tokens, embedding_dim, audio_duration_ms);
+    window.duration_ms = audio_duration_ms;
+    window.embeddings.assign(
+        embeddings, embeddings + static_cast<size_t>(window.num_tokens) * embedding_dim);
+    long_form_queue_.push_back(std::move(window));
+    long_form_queued_.store(static_cast<int32_t>(long_form_queue_.size()));
+    publishTelemetry();
+
+    if (static_cast<int32_t>(long_form_queue_.size()) >= std::max(1, config_.max_parallel_windows)) {
+        long_form_ok_ = decodeLongFormGroup() && long_form_ok_;
+    }
+    return long_form_ok_;
+}
+
+std::string GLMASRDecoder::finishLongForm() {
+    if (!is_loaded_.load()) {
+        return "";
+    }
+
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (!long_form_queue_.empty()) {
+        long_form_ok_ = decodeLongFormGroup() && long_form_ok_;
+    }
+
+    std::string text;
+    for (llama_token token : long_form_stitcher_.tokens()) {
+        text += detokenize(token);
+    }
+
+    LOGI("Long-form transcription finished: %zu tokens%s",
+         long_form_stitcher_.tokens().size(), long_form_ok_ ? "" : " (with errors)");
+    long_form_stitcher_.reset();
+    return text;
+}
+
+bool GLMASRDecoder::decodeLongFormGroup() {
+    PriorityScope priority(shared_model_.get());
+    ComputeLoadScope compute_load;
+
+    if (is_hibernated_.load() && !resumeLocked()) {
+        long_form_queue_.clear();
+        long_form_queued_.store(0);
+        publishTelemetry();
+        return false;
+    }
+    ComputeLease compute_lease = leaseThreadpool();
+
+    const int32_t max_out = config_.max_output_tokens;
+    const llama_vocab* vocab = llama_model_get_vocab(model_);
+    llama_memory_t memory = llama_get_memory(context_);
+
+    is_generating_.store(true);
+    startDecodeTelemetry();
+
+    // The group takes over the whole cache; any transcript prefix is re-prefilled later
+    llama_memory_clear(memory, true);
+    forgetResidentContext();
+
+    struct WindowState {
+        llama_seq_id seq = 0;
+        llama_pos pos = 0;
+        llama_token next = 0;
+        int32_t batch_index = -1;
+        bool done = false;
+        std::vector<llama_token> tokens;
+    };
+
+    llama_sampler* sampler = llama_sampler_init_greedy();
+    llama_batch batch = llama_batch_init(std::max(1, config_.max_parallel_windows), 0, 1);
+    bool ok = true;
+
+    size_t first = 0;
+    while (first < long_form_queue_.size() && ok) {
+        // As many windows as the sequences and the shared cache allow
+        std::vector<WindowState> states;
+        int32_t used = 0;
+        for (size_t w = first; w < long_form_queue_.size(); ++w) {
+            const int32_t need = long_form_queue_[w].num_tokens + max_out;
+            if (static_cast<int32_t>(states.size()) >= std::max(1, config_.max_parallel_windows) ||
+                (!states.empty() && used + need > config_.context_size)) {
+                break;
+            }
+            used += need;
+
+            WindowState state;
+            state.seq = static_cast<llama_seq_id>(states.size());
+            states.push_back(state);
+        }
+
+        // Prefill each window on its own sequence and take its first token
+        for (size_t i = 0; i < states.size() && ok; ++i) {
+            const LongFormWindow& window = long_form_queue_[first + i];
+            ok = injectEmbeddings(window.embeddings.data(), window.num_tokens,
+                                  getEmbeddingDim(), 0, states[i].seq);
+            states[i].pos = window.num_tokens;
+            states[i].next = sampleGreedy(sampler, -1);
+        }
+
+        // One batched decode step advances every unfinished window
+        while (ok && !stop_requested_.load()) {
+            asr_batch_clear(batch);
+            for (WindowState& state : states) {
+                if (state.done) {
+                    continue;
+                }
+                if (llama_vocab_is_eog(vocab, state.next) ||
+                    static_cast<int32_t>(state.tokens.size()) >= max_out) {
+                    state.done = true;
+                    continue;
+                }
+                state.tokens.push_back(state.next);
+                state.batch_index = batch.n_tokens;
+                asr_batch_add_token(batch, state.next, state.pos++, {state.seq}, true);
+            }
+            if (batch.n_tokens == 0) {
+                break;
+            }
+            recordTokens(batch.n_tokens);
+
+            if (!decodeStep(batch)) {
+                LOGE("Long-form decode failed");
+                ok = false;
+                break;
+            }
+
+            for (WindowState& state : states) {
+                if (!state.done) {
+                    state.next = sampleGreedy(sampler, state.batch_index);
+                }
+            }
+        }
+
+        // Windows arrive in order, so they can be stitched as they finish
+        for (size_t i = 0; i < states.size(); ++i) {
+            long_form_stitcher_.append(states[i].tokens, long_form_queue_[first + i].duration_ms);
+            llama_memory_seq_rm(memory, states[i].seq, -1, -1);
+        }
+
+        LOGD("Decoded %zu long-form windows in parallel", states.size());
+        first += states.size();
+        if (stop_requested_.load()) {
+            LOGI("Long-form transcription stopped by request");
+            ok = false;
+        }
+    }
+
+    llama_sampler_free(sampler);
+    llama_batch_free(batch);
+    long_form_queue_.clear();
+    long_form_queued_.store(0);
+    is_generating_.store(false);
+    publishTelemetry();
+    return ok;
+}
+
 std::string GLMASRDecoder::decodeFromEmbeddingsSync(
     const float* embeddings,
     int32_t num_tokens,
     int32_t embedding_dim,
-    int32_t max_output_tokens
+    int32_t max_output_tokens,
+    int32_t audio_duration_ms
 ) {
     std::string result;
 
@@ -312,12 +981,78 @@ std::string GLMASRDecoder::decodeFromEmbeddingsSync(
         max_output_tokens,
         [&result](const std::string& content, bool /* is_done */) {
             result += content;
-        }
+        },
+        audio_duration_ms
     );
 
     return result;
 }
 
+bool GLMASRDecoder::attachTelemetry(void* memory, size_t capacity) {
+    if (memory == nullptr) {
+        telemetry_.detach();
+        return true;
+    }
+    if (!telemetry_.attach(memory, capacity, TelemetryLayout::ASR, kTelemetryFields)) {
+        LOGE("Telemetry block needs %zu aligned bytes, got %zu",
+             TelemetryBlock::bytesFor(kTelemetryFields), capacity);
+        return false;
+    }
+    publishTelemetry();
+    return true;
+}
+
+void GLMASRDecoder::startDecodeTelemetry() {
+    decode_tokens_.store(0);
+    first_token_us_.store(0);
+    tokens_per_s_milli_.store(0);
+    step_us_.store(0);
+    step_tokens_.store(0);
+    sample_ns_.store(0);
+    samples_.store(0);
+    decodes_.fetch_add(1);
+    publishTelemetry();
+}
+
+void GLMASRDecoder::recordTokens(int32_t count) {
+    const int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    total_tokens_.fetch_add(count);
+    const int32_t previous = decode_tokens_.fetch_add(count);
+    if (previous == 0) {
+        // The rate leaves out the audio prefill before the first token
+        first_token_us_.store(now_us);
+    } else {
+        const int64_t elapsed_us = now_us - first_token_us_.load();
+        if (elapsed_us > 0) {
+            tokens_per_s_milli_.store(static_cast<int64_t>(previous) * 1000000000LL / elapsed_us);
+        }
+    }
+    publishTelemetry();
+}
+
+void GLMASRDecoder::publishTelemetry() {
+    telemetry_.publish([this](int64_t* values) {
+        if (!is_loaded_.load()) {
+            values[0] = 0;
+        } else if (is_hibernated_.load()) {
+            values[0] = 3;
+        } else {
+            values[0] = is_generating_.load() ? 2 : 1;
+        }
+        values[1] = decode_tokens_.load();
+        values[2] = tokens_per_s_milli_.load();
+        values[3] = decodes_.load();
+        values[4] = total_tokens_.load();
+        values[5] = long_form_queued_.load();
+        values[6] = last_injected_tokens_.load();
+        const int64_t step_tokens = step_tokens_.load();
+        const int64_t samples = samples_.load();
+        values[7] = step_tokens > 0 ? step_us_.load() / step_tokens : 0;
+        values[8] = samples > 0 ? sample_ns_.load() / samples : 0;
+    });
+}
+
 void GLMASRDecoder::stopGeneration() {
     stop_requested_.store(true);
     LOGI("ASR stop requested");
@@ -14,7 +14,12 @@
 #include <functional>
 #include <atomic>
 #include <mutex>
+#include <memory>
 #include "llama.h"
+#include "compute_pool.h"
+#include "shared_model.h"
+#include "telemetry_block.h"
+#include "transcript_stitcher.h"
 
 namespace unamentis {
 
@@ -27,6 +32,21 @@ struct GLMASRDecoderConfig {
     int32_t n_threads = 4;             // Number of CPU threads
     int32_t max_output_tokens = 256;   // Maximum tokens to generate
     float temperature = 0.0f;          // Sampling temperature (0 = greedy)
+    bool trim_padding = true;          // Inject only the embeddings that carry audio
+    float padding_similarity = 0.995f; // Cosine similarity to the last row that marks padding
+    int32_t rolling_context_tokens = 0; // Previous transcript tokens kept ahead of the audio (0 = off)
+    int32_t max_parallel_windows = 4;  // Long-form windows decoded together (separate sequences)
+};
+
+/**
+ * Footprint and timing of the last hibernate/resume cycle.
+ */
+struct ASRHibernateStats {
+    int64_t state_bytes = 0;           // Context state (KV cache) released by hibernate
+    int64_t model_bytes = 0;           // Weight bytes that stayed mapped
+    int64_t snapshot_bytes = 0;        // Decoder state kept in memory across hibernate
+    int64_t hibernate_us = 0;          // Time spent hibernating
+    int64_t resume_us = 0;             // Time spent recreating the context
 };
 
 /**
@@ -50,6 +70,8 @@ using ASRTokenCallback = std::function<void(const std::string& content, bool is_
  * 3. Embed Head: adapted features -> token embeddings [1, 375, 4096]
  *
  * This decoder takes the final embeddings [375, 4096] and generates text.
+ * The block always covers a 30 s window; for shorter utterances the tail is
+ * padding, which is trimmed before injection (see meaningfulTokens()).
  *
  * Thread Safety:
  * - Model loading/unloading must be done from single thread
@@ -105,13 +127,16 @@ public:
      * @param embedding_dim Dimension of each embedding (e.g., 4096)
      * @param max_output_tokens Maximum number of text tokens to generate
      * @param callback Function called for each generated token
+     * @param audio_duration_ms True length of the audio in the window, or 0 to
+     *                          detect trailing padding from the embeddings
      */
     void decodeFromEmbeddings(
         const float* embeddings,
         int32_t num_tokens,
         int32_t embedding_dim,
         int32_t max_output_tokens,
-        ASRTokenCallback callback
+        ASRTokenCallback callback,
+        int32_t audio_duration_ms = 0
     );
 
     /**
@@ -121,15 +146,118 @@ public:
      * @param num_tokens Number of audio tokens
      * @param embedding_dim Dimension of each embedding
      * @param max_output_tokens Maximum tokens to generate
+     * @param audio_duration_ms True length of the audio, or 0 to detect padding
      * @return Transcribed text, or empty string on error
      */
     std::string decodeFromEmbeddingsSync(
         const float* embeddings,
         int32_t num_tokens,
         int32_t embedding_dim,
-        int32_t max_output_tokens
+        int32_t max_output_tokens,
+        int32_t audio_duration_ms = 0
+    );
+
+    /**
+     * Number of leading embeddings that carry audio.
+     *
+     * With a known duration the count follows from the fixed 30 s window.
+     * Otherwise trailing rows that are (near) zero or almost identical to
+     * the last row are treated as encoder output for padded silence.
+     * A few rows of margin are kept for the encoder's receptive field.
+     *
+     * @return Token count to inject, in [1, num_tokens]
+     */
+    int32_t meaningfulTokens(
+        const float* embeddings,
+        int32_t num_tokens,
+        int32_t embedding_dim,
+        int32_t audio_duration_ms
+    ) const;
+
+    /**
+     * Keep up to max_tokens of previous transcript as a KV-resident prefix.
+     *
+     * Each decode appends the previous utterance's text to the prefix,
+     * evicts the oldest tokens with a position shift when it grows past
+     * max_tokens, and injects the new audio after it. Only the new text is
+     * prefilled; the retained prefix is never recomputed.
+     *
+     * @param max_tokens Prefix budget in tokens (0 disables and clears)
+     */
+    void setRollingContext(int32_t max_tokens);
+
+    /**
+     * Forget the retained transcript (e.g. when the topic changes).
+     */
+    void clearRollingContext();
+
+    /**
+     * Number of transcript tokens currently retained.
+     */
+    int32_t getRollingContextSize();
+
+    /**
+     * Restrict greedy decoding to a subset of the vocabulary.
+     *
+     * Transcripts of a known language only use a fraction of a multilingual
+     * vocabulary; the argmax then scans only these rows instead of building
+     * full-vocabulary candidates each step. End-of-generation tokens are
+     * always allowed.
+     *
+     * @param tokens Allowed token ids (empty = full vocabulary)
+     */
+    void setAllowedTokens(const std::vector<llama_token>& tokens);
+
+    /**
+     * Allow only tokens whose text is made of the given characters.
+     *
+     * Bytes are matched individually; if the charset contains any non-ASCII
+     * character, all non-ASCII bytes are accepted so multi-byte sequences
+     * split across tokens are not excluded.
+     *
+     * @param charset UTF-8 characters a transcript may contain (empty = no restriction)
+     * @return Number of allowed tokens (0 = unrestricted)
+     */
+    int32_t restrictVocabToCharset(const std::string& charset);
+
+    /**
+     * Start a long-form transcription.
+     *
+     * Windows added with addLongFormWindow() are decoded in groups of up to
+     * max_parallel_windows, each on its own sequence within one batched
+     * decode loop, and the overlapping transcripts are stitched.
+     *
+     * @param overlap_ms Audio shared by consecutive windows
+     */
+    void beginLongForm(int32_t overlap_ms);
+
+    /**
+     * Add the embeddings of the next window (copied).
+     * Decodes a group as soon as enough windows are queued.
+     *
+     * @param embeddings Flattened embedding array of one window
+     * @param num_tokens Number of audio tokens in the window
+     * @param embedding_dim Dimension of each embedding
+     * @param audio_duration_ms Audio length of the window
+     * @return false if the window was rejected or decoding failed
+     */
+    bool addLongFormWindow(
+        const float* embeddings,
+        int32_t num_tokens,
+        int32_t embedding_dim,
+        int32_t audio_duration_ms
     );
 
+    /**
+     * Decode the remaining windows and return the stitched transcript.
+     */
+    std::string finishLongForm();
+
+    /**
+     * Number of embeddings injected by the last decode (after trimming).
+     */
+    int32_t getLastInjectedTokens() const { return last_injected_tokens_.load(); }
+
     /**
      * Request generation to stop.
      * Safe to call from any thread.
@@ -141,22 +269,149 @@ public:
      */
     bool isGenerating() const { return is_generating_.load(); }
 
+    /**
+     * Release the context (KV cache and compute buffers) but keep the model.
+     *
+     * The weights stay mmap'd so their clean pages can be reclaimed by the
+     * kernel without a full reload. Decoding resumes automatically.
+     *
+     * @param snapshot_state Keep the decoder's used KV cells in memory and
+     *                       restore them on resume
+     * @return true if the decoder was hibernated by this call
+     */
+    bool hibernate(bool snapshot_state);
+
+    /**
+     * Recreate the context after hibernate().
+     *
+     * @return true if the context is ready
+     */
+    bool resume();
+
+    /**
+     * Check if the decoder is hibernated.
+     */
+    bool isHibernated() const { return is_hibernated_.load(); }
+
+    /**
+     * Change the context size and/or thread count without reloading weights.
+     *
+     * A thread change alone applies immediately. A new context size
+     * recreates only the llama_context; the rolling transcript context is
+     * carried over when it fits, otherwise it is prefilled again on the
+     * next decode.
+     *
+     * @param context_size New context window (<= 0 keeps the current one)
+     * @param n_threads New thread count (<= 0 keeps the current one)
+     * @return true if the new settings are in effect
+     */
+    bool reconfigure(int32_t context_size, int32_t n_threads);
+
+    /**
+     * Get footprint and timing of the last hibernate/resume cycle.
+     */
+    ASRHibernateStats getHibernateStats();
+
+    /**
+     * Publish live counters into shared memory (see telemetry_block.h), or
+     * stop publishing when memory is null. Fields, in order:
+     * [state (0 unloaded, 1 idle, 2 decoding, 3 hibernated), decodeTokens,
+     *  milliTokensPerSecond, decodes, totalTokens, queuedLongFormWindows,
+     *  injectedAudioTokens, stepMicrosPerToken, sampleNanosPerToken]
+     * The decode fields describe the current decode, or the last one while
+     * idle; a long-form group counts as one decode. The last two split a
+     * generated token's cost between the llama_decode step (per token in
+     * the batch) and the greedy choice, so restricting the vocabulary can
+     * be compared with the full vocabulary on a device.
+     *
+     * @return false if the memory can't hold the block
+     */
+    bool attachTelemetry(void* memory, size_t capacity);
+
+    static constexpr int32_t kTelemetryFields = 9;
+
 private:
     // llama.cpp state
+    std::shared_ptr<SharedModel> shared_model_;  // Weights, possibly shared with LlamaInference
     llama_model* model_ = nullptr;
     llama_context* context_ = nullptr;
     GLMASRDecoderConfig config_;
 
     // Thread-safety state
     std::atomic<bool> is_loaded_{false};
+    std::atomic<bool> is_hibernated_{false};
     std::atomic<bool> is_generating_{false};
     std::atomic<bool> stop_requested_{false};
+    std::atomic<int32_t> last_injected_tokens_{0};
     std::mutex generation_mutex_;
 
+    // Rolling transcript context (guarded by generation_mutex_)
+    std::vector<llama_token> context_tokens_;   // Resident at positions [0, size)
+    std::vector<llama_token> pending_context_;  // Last transcript, not yet prefilled
+
+    // Restricted output vocabulary, sorted (guarded by generation_mutex_)
+    std::vector<llama_token> allowed_tokens_;
+
+    // Long-form transcription (guarded by generation_mutex_)
+    struct LongFormWindow {
+        std::vector<float> embeddings;
+        int32_t num_tokens = 0;
+        int32_t duration_ms = 0;
+    };
+    std::vector<LongFormWindow> long_form_queue_;
+    TranscriptStitcher long_form_stitcher_{0};
+    bool long_form_ok_ = true;
+
+    // Hibernate state (guarded by generation_mutex_)
+    std::vector<uint8_t> hibernate_snapshot_;
+    ASRHibernateStats hibernate_stats_;
+
+    // Live counters published to telemetry_ (see attachTelemetry)
+    TelemetryBlock telemetry_;
+    std::atomic<int32_t> decode_tokens_{0};
+    std::atomic<int64_t> first_token_us_{0};
+    std::atomic<int64_t> tokens_per_s_milli_{0};
+    std::atomic<int64_t> decodes_{0};
+    std::atomic<int64_t> total_tokens_{0};
+    std::atomic<int32_t> long_form_queued_{0};
+    std::atomic<int64_t> step_us_{0};       // llama_decode time of the generation steps
+    std::atomic<int64_t> step_tokens_{0};   // Tokens those steps decoded
+    std::atomic<int64_t> sample_ns_{0};     // Time spent in sampleGreedy
+    std::atomic<int64_t> samples_{0};       // sampleGreedy calls
+
     // Helper methods
     std::string detokenize(llama_token token);
     void resetContext();
     void unloadModelLocked();
+    bool createContext();
+    ComputeLease leaseThreadpool();
+    bool resumeLocked();
+    void forgetResidentContext();
+    void setAllowedTokensLocked(std::vector<llama_token> tokens);
+    void startDecodeTelemetry();
+    void recordTokens(int32_t count);
+    bool decodeStep(llama_batch& batch);
+    void publishTelemetry();
+
+    /**
+     * Greedy token choice for the output at batch index idx, limited to
+     * allowed_tokens_ when a restriction is set. Timed into sample_ns_.
+     */
+    llama_token sampleGreedy(llama_sampler* sampler, int32_t idx);
+
+    /**
+     * Bring the retained transcript up to date in the KV cache and drop
+     * everything after it.
+     *
+     * @param reserve Positions needed after the prefix (audio + output)
+     * @return Position at which the audio is injected
+     */
+    llama_pos prepareRollingContext(int32_t reserve);
+
+    /**
+     * Decode the queued long-form windows in parallel and stitch them.
+     */
+    bool decodeLongFormGroup();
 
     /**
      * Inject embeddings directly into the model context.
@@ -167,12 +422,16 @@ private:
      * @param embeddings Flattened embedding array
      * @param num_tokens Number of tokens
      * @param embedding_dim Embedding dimension
+     * @param start_pos Position of the first embedding
+     * @param seq_id Sequence the embeddings belong to
      * @return true if injection succeeded
      */
     bool injectEmbeddings(
         const float* embeddings,
         int32_t num_tokens,
-        int32_t embedding_dim
+        int32_t embedding_dim,
+        llama_pos start_pos,
+        llama_seq_id seq_id
     );
 };
 
@@ -7,6 +7,8 @@
 #include <memory>
 #include <mutex>
 #include "glm_asr_decoder.h"
+#include "sample_convert.h"
+#include "telemetry_jni.h"
 
 #define LOG_TAG "GLMASRDecoderJNI"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -20,6 +22,9 @@ static JavaVM* g_jvm = nullptr;
 static std::map<jlong, std::shared_ptr<unamentis::GLMASRDecoder>> g_decoders;
 static std::mutex g_decoders_mutex;
 
+// Buffers decoders publish live counters into
+static unamentis::TelemetryBuffers g_telemetry_buffers;
+
 // Callback context for streaming ASR output
 struct ASRCallbackContext {
     jobject callback_object;
@@ -74,6 +79,16 @@ static JNIEnv* getJNIEnv(bool* needs_detach) {
     return env;
 }
 
+// Look up a decoder and take a reference that keeps it alive for the call
+static std::shared_ptr<unamentis::GLMASRDecoder> findDecoder(jlong context_ptr) {
+    if (context_ptr == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(g_decoders_mutex);
+    auto it = g_decoders.find(context_ptr);
+    return it != g_decoders.end() ? it->second : nullptr;
+}
+
 // Called when native library is loaded
 extern "C" JNIEXPORT jint JNICALL
 JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
@@ -135,7 +150,8 @@ Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeDecodeEmbeddings(
     jint num_tokens,
     jint embedding_dim,
     jint max_output_tokens,
-    jobject callback
+    jobject callback,
+    jint audio_duration_ms
 ) {
     if (context_ptr == 0) {
         LOGE("Invalid decoder context pointer");
@@ -170,8 +186,8 @@ Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeDecodeEmbeddings(
         return;
     }
 
-    LOGD("nativeDecodeEmbeddings: num_tokens=%d, embd_dim=%d, max_out=%d",
-         num_tokens, embedding_dim, max_output_tokens);
+    LOGD("nativeDecodeEmbeddings: num_tokens=%d, embd_dim=%d, max_out=%d, duration=%dms",
+         num_tokens, embedding_dim, max_output_tokens, audio_duration_ms);
 
     // Create callback context with global reference
     auto callback_ctx = std::make_shared<ASRCallbackContext>(env, callback);
@@ -240,7 +256,8 @@ Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeDecodeEmbeddings(
                     g_jvm->DetachCurrentThread();
                 }
             }
-        }
+        },
+        audio_duration_ms
     );
 }
 
@@ -253,7 +270,8 @@ Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeDecodeEmbeddingsS
     jfloatArray embeddings,
     jint num_tokens,
     jint embedding_dim,
-    jint max_output_tokens
+    jint max_output_tokens,
+    jint audio_duration_ms
 ) {
     if (context_ptr == 0) {
         LOGE("Invalid decoder context pointer");
@@ -293,7 +311,8 @@ Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeDecodeEmbeddingsS
         embd_ptr,
         num_tokens,
         embedding_dim,
-        max_output_tokens
+        max_output_tokens,
+        audio_duration_ms
     );
 
     // Release Java array
@@ -324,7 +343,7 @@ Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeStopDecoder(
 // Free decoder
 extern "C" JNIEXPORT void JNICALL
 Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeFreeDecoder(
-    JNIEnv* /* env */,
+    JNIEnv* env,
     jobject /* thiz */,
     jlong context_ptr
 ) {
@@ -332,12 +351,22 @@ Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeFreeDecoder(
         return;
     }
 
-    std::lock_guard<std::mutex> lock(g_decoders_mutex);
-    auto it = g_decoders.find(context_ptr);
-    if (it != g_decoders.end()) {
+    std::shared_ptr<unamentis::GLMASRDecoder> decoder;
+    {
+        std::lock_guard<std::mutex> lock(g_decoders_mutex);
+        auto it = g_decoders.find(context_ptr);
+        if (it == g_decoders.end()) {
+            return;
+        }
         LOGI("Freeing GLM-ASR decoder for handle: %ld", static_cast<long>(context_ptr));
+        decoder = it->second;
         g_decoders.erase(it);
     }
+
+    // An in-flight decode keeps the decoder alive, so stop it publishing
+    // before its buffer can be collected
+    decoder->attachTelemetry(nullptr, 0);
+    g_telemetry_buffers.release(env, context_ptr);
 }
 
 // Check if decoder is loaded
@@ -396,3 +425,250 @@ Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeGetEmbeddingDim(
     }
     return 0;
 }
+
+// Change decoder context size and/or threads without reloading (<= 0 keeps a setting)
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeReconfigureDecoder(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jint context_size,
+    jint n_threads
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (!decoder) {
+        return JNI_FALSE;
+    }
+
+    return decoder->reconfigure(context_size, n_threads) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Free the decoder's KV cache and compute buffers but keep the model mapped
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeHibernateDecoder(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jboolean snapshot_state
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (!decoder) {
+        return JNI_FALSE;
+    }
+
+    return decoder->hibernate(snapshot_state == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Recreate the decoder context after hibernate
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeResumeDecoder(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (!decoder) {
+        return JNI_FALSE;
+    }
+
+    return decoder->resume() ? JNI_TRUE : JNI_FALSE;
+}
+
+// Publish live counters into a direct ByteBuffer (null stops publishing)
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeAttachTelemetry(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jobject buffer
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (!decoder) {
+        return JNI_FALSE;
+    }
+
+    // Detach before the old buffer can be collected
+    decoder->attachTelemetry(nullptr, 0);
+    g_telemetry_buffers.release(env, context_ptr);
+    if (buffer == nullptr) {
+        return JNI_TRUE;
+    }
+
+    jlong capacity = 0;
+    void* memory = g_telemetry_buffers.hold(env, context_ptr, buffer, capacity);
+    if (memory == nullptr || !decoder->attachTelemetry(memory, static_cast<size_t>(capacity))) {
+        g_telemetry_buffers.release(env, context_ptr);
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+// Get hibernate counters:
+// [stateBytes, modelBytes, snapshotBytes, hibernateUs, resumeUs]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeGetDecoderHibernateStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[5] = {0, 0, 0, 0, 0};
+
+    auto decoder = findDecoder(context_ptr);
+    if (decoder) {
+        unamentis::ASRHibernateStats stats = decoder->getHibernateStats();
+        values[0] = stats.state_bytes;
+        values[1] = stats.model_bytes;
+        values[2] = stats.snapshot_bytes;
+        values[3] = stats.hibernate_us;
+        values[4] = stats.resume_us;
+    }
+
+    jlongArray result = env->NewLongArray(5);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 5, values);
+    }
+    return result;
+}
+
+// Keep up to max_tokens of previous transcript as decoding context (0 = off)
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeSetRollingContext(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jint max_tokens
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (decoder) {
+        decoder->setRollingContext(max_tokens);
+    }
+}
+
+// Forget the retained transcript context
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeClearRollingContext(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (decoder) {
+        decoder->clearRollingContext();
+    }
+}
+
+// Start a long-form transcription over overlapping windows
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeBeginLongForm(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jint overlap_ms
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (decoder) {
+        decoder->beginLongForm(overlap_ms);
+    }
+}
+
+// Queue the embeddings of the next long-form window
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeAddLongFormWindow(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jfloatArray embeddings,
+    jint num_tokens,
+    jint embedding_dim,
+    jint audio_duration_ms
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (!decoder) {
+        LOGE("Decoder not found for handle: %ld", static_cast<long>(context_ptr));
+        return JNI_FALSE;
+    }
+
+    jsize embd_len = env->GetArrayLength(embeddings);
+    jsize expected_len = num_tokens * embedding_dim;
+    if (embd_len < expected_len) {
+        LOGE("Embeddings array too small: got %d, expected %d", embd_len, expected_len);
+        return JNI_FALSE;
+    }
+
+    jfloat* embd_ptr = env->GetFloatArrayElements(embeddings, nullptr);
+    if (embd_ptr == nullptr) {
+        LOGE("Failed to get embeddings array");
+        return JNI_FALSE;
+    }
+
+    bool ok = decoder->addLongFormWindow(embd_ptr, num_tokens, embedding_dim, audio_duration_ms);
+    env->ReleaseFloatArrayElements(embeddings, embd_ptr, JNI_ABORT);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// Decode the remaining windows and return the stitched transcript
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeFinishLongForm(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (!decoder) {
+        return env->NewStringUTF("");
+    }
+
+    std::string result = decoder->finishLongForm();
+    return env->NewStringUTF(result.c_str());
+}
+
+// Restrict decoding to tokens made of the given characters (null/empty = full vocabulary)
+extern "C" JNIEXPORT jint JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeRestrictVocabulary(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring charset
+) {
+    auto decoder = findDecoder(context_ptr);
+    if (!decoder) {
+        return 0;
+    }
+
+    std::string chars;
+    if (charset != nullptr) {
+        const char* chars_cstr = env->GetStringUTFChars(charset, nullptr);
+        chars = chars_cstr;
+        env->ReleaseStringUTFChars(charset, chars_cstr);
+    }
+
+    return decoder->restrictVocabToCharset(chars);
+}
+
+// Convert little-endian 16-bit PCM bytes to float samples in [-1, 1)
+extern "C" JNIEXPORT jfloatArray JNICALL
+Java_com_unamentis_services_stt_GLMASROnDeviceSTTService_nativeInt16ToFloat(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jbyteArray audio_data
+) {
+    const jsize count = env->GetArrayLength(audio_data) / 2;
+    jfloatArray result = env->NewFloatArray(count);
+    if (result == nullptr || count == 0) {
+        return result;
+    }
+
+    // Android ABIs are little-endian, so the bytes are already int16 samples
+    void* in = env->GetPrimitiveArrayCritical(audio_data, nullptr);
+    void* out = env->GetPrimitiveArrayCritical(result, nullptr);
+    if (in != nullptr && out != nullptr) {
+        unamentis::int16ToFloat(static_cast<const int16_t*>(in), static_cast<float*>(out), count);
+    }
+    if (out != nullptr) {
+        env->ReleasePrimitiveArrayCritical(result, out, 0);
+    }
+    if (in != nullptr) {
+        env->ReleasePrimitiveArrayCritical(audio_data, in, JNI_ABORT);
+    }
+    return result;
+}
@@ -2,9 +2,17 @@
 // On-device LLM inference using llama.cpp (b7263+ API)
 
 #include "llama_inference.h"
+#include "ngram_lookup.h"
+#include "thread_policy.h"
 #include <android/log.h>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <functional>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <thread>
 
 #define LOG_TAG "LlamaInference"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -14,6 +22,27 @@
 
 namespace unamentis {
 
+// Documents shorter than this are cheaper to prefill than to load
+static constexpr size_t kMinDocumentTokens = 64;
+
+// Background compaction scheduling. A step holds generation_mutex_, so it
+// is kept to a small prefill chunk that a waiting turn can sit out.
+static constexpr size_t kCompactionChunkTokens = 32;  // Tokens prefilled per step
+static constexpr int kCompactionNice = 10;            // Calling thread's niceness while compacting
+static constexpr int kCompactionYieldMs = 5;          // Poll interval while a request waits
+
+// Bytes hashed from each end of the model file for its fingerprint
+static constexpr size_t kFingerprintBlockBytes = 1 << 20;
+
+// FNV-1a over a byte string, optionally continuing an earlier hash
+static uint64_t fnv1a(const std::string& text, uint64_t hash = 14695981039346656037ULL) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 // Helper functions for batch management (matching iOS implementation)
 static void llama_batch_clear(llama_batch& batch) {
     batch.n_tokens = 0;
@@ -42,6 +71,7 @@ LlamaInference::LlamaInference() {
 
 LlamaInference::~LlamaInference() {
     unloadModel();
+    telemetry_.detach();
     LOGI("LlamaInference destroyed");
 }
 
@@ -50,7 +80,7 @@ bool LlamaInference::loadModel(const std::string& model_path, const LlamaConfig&
 
     if (is_loaded_.load()) {
         LOGW("Model already loaded, unloading first");
-        unloadModel();
+        unloadModelLocked();
     }
 
     LOGI("Loading model from: %s", model_path.c_str());
@@ -67,7 +97,9 @@ bool LlamaInference::loadModel(const std::string& model_path, const LlamaConfig&
 
     // Load model
     LOGI("Loading model file (this may take a while)...");
-    model_ = llama_model_load_from_file(model_path.c_str(), model_params);
+    // Stats readers don't take generation_mutex_, so the handle is swapped atomically
+    std::atomic_store(&shared_model_, acquireSharedModel(model_path, model_params));
+    model_ = shared_model_ ? shared_model_->get() : nullptr;
     if (model_ == nullptr) {
         LOGE("Failed to load model from: %s", model_path.c_str());
         llama_backend_free();
@@ -75,28 +107,223 @@ bool LlamaInference::loadModel(const std::string& model_path, const LlamaConfig&
     }
     LOGI("Model loaded successfully");
 
+    // Document KV files are only valid for this exact model
+    model_fingerprint_ = modelFingerprint(model_path, model_);
+
+    // Prefix slots take the sequence ids after the session pool
+    prefix_cache_ = std::make_unique<PrefixCache>(
+        static_cast<llama_seq_id>(std::max(1, config_.max_sessions)), config_.prefix_cache_slots);
+    updatePrefixCacheStats();
+
     // Create context
+    if (!createContext()) {
+        std::atomic_store(&shared_model_, std::shared_ptr<SharedModel>());
+        model_ = nullptr;
+        llama_backend_free();
+        return false;
+    }
+
+    is_loaded_.store(true);
+    is_hibernated_.store(false);
+    publishTelemetry();
+    LOGI("Model and context ready");
+    return true;
+}
+
+bool LlamaInference::createContext() {
+    context_ = newContext(model_, config_);
+    return context_ != nullptr;
+}
+
+llama_context* LlamaInference::newContext(llama_model* model, const LlamaConfig& config) const {
     int n_threads = std::max(1, std::min(8, config.n_threads));
     llama_context_params ctx_params = llama_context_default_params();
     ctx_params.n_ctx = config.context_size;
     ctx_params.n_threads = n_threads;
     ctx_params.n_threads_batch = n_threads;
+    // Sessions, cached prefixes, the scratch sequence for document blocks
+    // and the compaction sequence share one unified KV buffer so any of
+    // them can use the full window and copied prefixes share cells
+    ctx_params.n_seq_max = static_cast<uint32_t>(compactionSequence() + 1);
+    ctx_params.kv_unified = true;
 
     LOGD("Creating context with %d threads, context size: %d", n_threads, config.context_size);
-    context_ = llama_init_from_model(model_, ctx_params);
-    if (context_ == nullptr) {
+    llama_context* context = llama_init_from_model(model, ctx_params);
+    if (context == nullptr) {
         LOGE("Failed to create context");
-        llama_model_free(model_);
-        model_ = nullptr;
-        llama_backend_free();
+    }
+    return context;
+}
+
+void LlamaInference::attachThreadpool(ggml_threadpool* pool) {
+    if (context_ != nullptr) {
+        if (pool != nullptr) {
+            llama_attach_threadpool(context_, pool, pool);
+        } else {
+            llama_detach_threadpool(context_);
+        }
+    }
+    if (cascade_) {
+        cascade_->setThreadpool(pool);
+    }
+}
+
+ComputeLease LlamaInference::leaseThreadpool(int32_t n_threads) {
+    return ComputeLease(n_threads, [this](ggml_threadpool* pool) { attachThreadpool(pool); });
+}
+
+void LlamaInference::holdCompute(ComputeTurn& turn) {
+    if (!turn.load) {
+        turn.load.emplace();
+    }
+    turn.lease.emplace(config_.n_threads, [this](ggml_threadpool* pool) { attachThreadpool(pool); });
+}
+
+std::string LlamaInference::modelFingerprint(const std::string& model_path, const llama_model* model) {
+    // GGUF name plus the file's size, mtime and first and last MiB: two
+    // files that share an architecture and parameter count still differ
+    // here, and so does the same file re-downloaded or requantized
+    char name[256] = {0};
+    if (llama_model_meta_val_str(model, "general.name", name, sizeof(name)) < 0) {
+        llama_model_desc(model, name, sizeof(name));
+    }
+    uint64_t hash = fnv1a(name);
+
+    struct stat info = {};
+    if (stat(model_path.c_str(), &info) == 0) {
+        const uint64_t identity[] = {static_cast<uint64_t>(info.st_size),
+                                     static_cast<uint64_t>(info.st_mtime)};
+        hash = fnv1a(std::string(reinterpret_cast<const char*>(identity), sizeof(identity)), hash);
+
+        FILE* file = fopen(model_path.c_str(), "rb");
+        if (file != nullptr) {
+            std::string block(kFingerprintBlockBytes, '\0');
+            const off_t tail = std::max<off_t>(0, info.st_size - static_cast<off_t>(block.size()));
+            for (off_t offset : {static_cast<off_t>(0), tail}) {
+                if (fseeko(file, offset, SEEK_SET) == 0) {
+                    block.resize(fread(&block[0], 1, kFingerprintBlockBytes, file));
+                    hash = fnv1a(block, hash);
+                    block.resize(kFingerprintBlockBytes);
+                }
+            }
+            fclose(file);
+        }
+    } else {
+        LOGW("Cannot stat %s; model fingerprint uses metadata only", model_path.c_str());
+    }
+
+    char fingerprint[17];
+    snprintf(fingerprint, sizeof(fingerprint), "%016llx", static_cast<unsigned long long>(hash));
+    return fingerprint;
+}
+
+bool LlamaInference::swapModel(
+    const std::string& model_path,
+    const std::vector<std::string>& stop_sequences
+) {
+    if (!is_loaded_.load()) {
+        LOGE("Cannot swap: no model loaded");
+        return false;
+    }
+    bool expected = false;
+    if (!is_swapping_.compare_exchange_strong(expected, true)) {
+        LOGW("Model swap already in progress");
         return false;
     }
 
-    is_loaded_.store(true);
-    LOGI("Model and context ready with %d threads", n_threads);
+    auto start = std::chrono::steady_clock::now();
+    LlamaConfig config;
+    {
+        std::lock_guard<std::mutex> lock(generation_mutex_);
+        config = config_;
+    }
+
+    // Load the replacement while the current model keeps serving
+    llama_model_params model_params = llama_model_default_params();
+    model_params.n_gpu_layers = config.gpu_layers;
+    LOGI("Loading replacement model from: %s", model_path.c_str());
+    std::shared_ptr<SharedModel> next_model = acquireSharedModel(model_path, model_params);
+    llama_context* next_context = next_model ? newContext(next_model->get(), config) : nullptr;
+    if (next_context == nullptr) {
+        LOGE("Failed to load replacement model from: %s", model_path.c_str());
+        is_swapping_.store(false);
+        return false;
+    }
+    const int64_t load_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    int64_t handover_us = 0;
+    int64_t overlap_bytes = 0;
+    std::shared_ptr<SharedModel> previous;
+    {
+        // Waits for the in-flight generation to drain
+        std::lock_guard<std::mutex> lock(generation_mutex_);
+        auto handover_start = std::chrono::steady_clock::now();
+
+        if (!is_loaded_.load()) {
+            LOGW("Model unloaded during swap, discarding replacement");
+            llama_free(next_context);
+            is_swapping_.store(false);
+            return false;
+        }
+
+        // Both models and contexts are resident at this point
+        overlap_bytes = static_cast<int64_t>(llama_model_size(next_model->get())) +
+                        static_cast<int64_t>(llama_state_get_size(next_context));
+        if (model_ != nullptr && shared_model_.get() != next_model.get()) {
+            overlap_bytes += static_cast<int64_t>(llama_model_size(model_));
+        }
+        if (context_ != nullptr) {
+            overlap_bytes += static_cast<int64_t>(llama_state_get_size(context_));
+        }
+
+        // A compaction in progress holds tokens and logits of the old model
+        compaction_cancel_.store(true);
+        compaction_tokens_ = 0;
+
+        // Everything keyed to the old weights goes: session KV and snapshots,
+        // cached prefixes and responses, document blocks and the cascade
+        // (whose vocabulary was checked against the old model)
+        cascade_.reset();
+        resetContext();
+        response_cache_.clear();
+        documents_.clear();
+        if (context_ != nullptr) {
+            llama_free(context_);
+        }
+
+        context_ = next_context;
+        previous = std::atomic_exchange(&shared_model_, next_model);
+        model_ = next_model->get();
+        model_fingerprint_ = modelFingerprint(model_path, model_);
+        stop_matcher_.setPatterns(stop_sequences);
+        is_hibernated_.store(false);
+
+        handover_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - handover_start).count();
+    }
+    // Unmap the old weights outside the lock, unless another engine shares them
+    previous.reset();
+    is_swapping_.store(false);
+
+    LOGI("Model swapped: loaded in %.1f ms, handover %.1f ms, peak overlap %lld MB",
+         load_us / 1000.0, handover_us / 1000.0,
+         static_cast<long long>(overlap_bytes / (1024 * 1024)));
+
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    swap_stats_.swaps++;
+    swap_stats_.load_us = load_us;
+    swap_stats_.handover_us = handover_us;
+    swap_stats_.overlap_bytes = overlap_bytes;
+    document_stats_.registered_documents = 0;
     return true;
 }
 
+SwapStats LlamaInference::getSwapStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return swap_stats_;
+}
+
 void LlamaInference::unloadModel() {
     // Don't lock if already unloaded
     if (!is_loaded_.load()) {
@@ -104,22 +331,220 @@ void LlamaInference::unloadModel() {
     }
 
     std::lock_guard<std::mutex> lock(generation_mutex_);
+    unloadModelLocked();
+}
+
+void LlamaInference::unloadModelLocked() {
+    // Session snapshots and cached responses are only valid for this model
+    cascade_.reset();
+    resetContext();
+    response_cache_.clear();
+    documents_.clear();
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        document_stats_.registered_documents = 0;
+    }
 
     if (context_ != nullptr) {
         llama_free(context_);
         context_ = nullptr;
     }
 
-    if (model_ != nullptr) {
-        llama_model_free(model_);
-        model_ = nullptr;
-    }
+    // The weights stay loaded while GLMASRDecoder still uses them
+    std::atomic_store(&shared_model_, std::shared_ptr<SharedModel>());
+    model_ = nullptr;
 
     llama_backend_free();
     is_loaded_.store(false);
+    is_hibernated_.store(false);
+    publishTelemetry();
     LOGI("Model unloaded");
 }
 
+bool LlamaInference::hibernate(bool snapshot_sessions) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (!is_loaded_.load() || is_hibernated_.load()) {
+        return false;
+    }
+
+    // A compaction in progress loses its sequence with the context
+    compaction_cancel_.store(true);
+    compaction_tokens_ = 0;
+
+    // The cascade model's KV goes too; its next request prefills again
+    if (cascade_) {
+        cascade_->releaseContext();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const size_t state_bytes = llama_state_get_size(context_);
+
+    // Snapshot resident sessions to disk so they can be restored on demand;
+    // otherwise forget their KV and let the next turn prefill again
+    int32_t snapshotted = 0;
+    for (auto& entry : sessions_) {
+        Session& session = entry.second;
+        if (session.seq_id < 0) {
+            continue;
+        }
+        if (snapshot_sessions) {
+            evictSession(entry.first, session);
+            snapshotted += session.has_snapshot ? 1 : 0;
+        } else {
+            session.seq_id = -1;
+            session.tokens.clear();
+            session.tokens.shrink_to_fit();
+        }
+    }
+
+    // Cached prefixes live only in the KV cache
+    if (prefix_cache_) {
+        prefix_cache_->clear();
+        updatePrefixCacheStats();
+    }
+
+    // Frees the KV cache and compute buffers; weights stay mapped
+    llama_free(context_);
+    context_ = nullptr;
+    is_hibernated_.store(true);
+    updateSessionCounts();
+    publishTelemetry();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        hibernate_stats_.state_bytes = static_cast<int64_t>(state_bytes);
+        hibernate_stats_.model_bytes = static_cast<int64_t>(llama_model_size(model_));
+        hibernate_stats_.snapshotted_sessions = snapshotted;
+        hibernate_stats_.hibernate_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    }
+
+    LOGI("Hibernated: released %zu state bytes, %d sessions snapshotted", state_bytes, snapshotted);
+    return true;
+}
+
+bool LlamaInference::resume() {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    return resumeLocked();
+}
+
+bool LlamaInference::resumeLocked() {
+    if (!is_hibernated_.load()) {
+        return is_loaded_.load();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!createContext()) {
+        LOGE("Failed to resume from hibernation");
+        return false;
+    }
+    is_hibernated_.store(false);
+    publishTelemetry();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    int64_t resume_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        hibernate_stats_.resume_us = resume_us;
+    }
+
+    // Sessions are restored from their snapshots lazily when next used
+    LOGI("Resumed from hibernation in %.1f ms", resume_us / 1000.0);
+    return true;
+}
+
+bool LlamaInference::reconfigure(int32_t context_size, int32_t n_threads) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (!is_loaded_.load()) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (n_threads > 0) {
+        config_.n_threads = n_threads;
+    }
+    const int32_t threads = std::max(1, std::min(8, config_.n_threads));
+    const bool resize = context_size > 0 && context_size != config_.context_size;
+
+    // A hibernated engine picks the new settings up when it resumes
+    if (is_hibernated_.load()) {
+        if (resize) {
+            config_.context_size = context_size;
+        }
+        return true;
+    }
+    if (!resize) {
+        llama_set_n_threads(context_, threads, threads);
+        LOGI("Reconfigured: %d threads", threads);
+        return true;
+    }
+
+    LlamaConfig next_config = config_;
+    next_config.context_size = context_size;
+    llama_context* next_context = newContext(model_, next_config);
+    if (next_context == nullptr) {
+        return false;
+    }
+
+    // Carry the active session's KV over if it fits; other sessions go to
+    // their snapshots and are restored lazily
+    std::vector<uint8_t> carried;
+    auto active = sessions_.find(active_session_);
+    Session* session = active != sessions_.end() && active->second.seq_id >= 0 ? &active->second : nullptr;
+    if (session != nullptr && !session->tokens.empty() &&
+        static_cast<int32_t>(session->tokens.size()) < context_size) {
+        carried.resize(llama_state_seq_get_size(context_, session->seq_id));
+        carried.resize(llama_state_seq_get_data(context_, carried.data(), carried.size(), session->seq_id));
+    }
+    for (auto& entry : sessions_) {
+        if (entry.second.seq_id >= 0 && (&entry.second != session || carried.empty())) {
+            evictSession(entry.first, entry.second);
+        }
+    }
+    clearPrefixCache();
+    compaction_cancel_.store(true);
+    compaction_tokens_ = 0;
+
+    llama_free(context_);
+    context_ = next_context;
+    config_.context_size = context_size;
+
+    size_t n_carried = 0;
+    if (!carried.empty()) {
+        if (llama_state_seq_set_data(context_, carried.data(), carried.size(), session->seq_id) == 0) {
+            LOGW("Failed to carry session '%s' into the new context", active_session_.c_str());
+            session->tokens.clear();
+        } else {
+            n_carried = session->tokens.size();
+        }
+    }
+    updateSessionCounts();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    const int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    LOGI("Reconfigured: context %d, %d threads, carried %zu tokens in %.1f ms",
+         context_size, threads, n_carried, elapsed_us / 1000.0);
+
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    reconfigure_stats_.reconfigures++;
+    reconfigure_stats_.carried_tokens = static_cast<int64_t>(n_carried);
+    reconfigure_stats_.reconfigure_us = elapsed_us;
+    return true;
+}
+
+ReconfigureStats LlamaInference::getReconfigureStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return reconfigure_stats_;
+}
+
+HibernateStats LlamaInference::getHibernateStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return hibernate_stats_;
+}
+
 void LlamaInference::generate(
     const std::string& prompt,
     int32_t max_tokens,
@@ -132,15 +557,38 @@ void LlamaInference::generate(
         return;
     }
 
+    // Background compaction yields between its steps while this waits
+    foreground_waiters_.fetch_add(1);
     std::lock_guard<std::mutex> lock(generation_mutex_);
+    foreground_waiters_.fetch_sub(1);
+    ComputeTurn compute_turn;
+    compute_turn.load.emplace();
+
+    // Transparently wake up after a low-memory hibernate
+    if (is_hibernated_.load() && !resumeLocked()) {
+        callback("", true);
+        return;
+    }
+    holdCompute(compute_turn);
+
+    // Telemetry shows idle again however this returns
+    struct IdleOnExit {
+        LlamaInference* self;
+        ~IdleOnExit() { self->setPhase(Phase::IDLE); }
+    } idle_on_exit{this};
 
     is_generating_.store(true);
     stop_requested_.store(false);
+    response_tokens_.store(0);
+    first_token_us_.store(0);
+    tokens_per_s_milli_.store(0);
+    generations_.fetch_add(1);
 
     LOGD("Starting generation with prompt length: %zu chars", prompt.length());
 
-    // Tokenize input
-    std::vector<llama_token> tokens = tokenize(prompt, true);
+    // Tokenize input, locating any registered document in it
+    DocumentSplice splice;
+    std::vector<llama_token> tokens = tokenizePrompt(prompt, splice);
     LOGD("Tokenized to %zu tokens", tokens.size());
 
     // Handle empty prompt edge case
@@ -150,137 +598,1131 @@ void LlamaInference::generate(
         callback("", true);
         return;
     }
+    prompt_tokens_.store(static_cast<int32_t>(tokens.size()));
+    setPhase(Phase::PREFILL);
 
-    // Reset context for new generation
-    resetContext();
+    // Replay a cached answer to the same (or a sufficiently similar) query
+    std::vector<float> query_embedding;
+    {
+        std::lock_guard<std::mutex> query_lock(query_mutex_);
+        query_embedding.swap(query_embedding_);
+    }
+    const bool use_cache = response_cache_.enabled();
+    if (use_cache) {
+        std::vector<std::string> cached;
+        if (response_cache_.lookup(tokens, query_embedding, max_tokens, cached)) {
+            LOGI("Response cache hit: replaying %zu pieces", cached.size());
+            for (const std::string& piece : cached) {
+                callback(piece, false);
+            }
+            is_generating_.store(false);
+            callback("", true);
+            return;
+        }
+    }
+
+    int32_t n_gen = 0;
+    bool stop_matched = false;
+    bool finished = false;  // Ended by EOG or a stop string rather than budget/stop/error
+    std::vector<std::string> emitted;
+
+    // Emit a token's text through the stop-sequence matcher.
+    // Returns true when a stop string completed with this token.
+    stop_matcher_.reset();
+    std::string visible;
+    auto emit = [&](const std::string& token_text) -> bool {
+        if (token_text.empty()) {
+            return false;
+        }
+        n_gen++;
+        recordToken(response_tokens_.fetch_add(1) + 1);
+        bool stopped = stop_matcher_.feed(token_text, visible);
+        if (!visible.empty()) {
+            if (use_cache) {
+                emitted.push_back(visible);
+            }
+            callback(visible, false);
+        }
+        return stopped;
+    };
+
+    // Release held-back text, cache complete answers and signal completion
+    auto complete = [&]() {
+        if (!stop_matched) {
+            std::string held = stop_matcher_.flush();
+            if (!held.empty()) {
+                if (use_cache) {
+                    emitted.push_back(held);
+                }
+                callback(held, false);
+            }
+        }
+
+        // Only complete answers are worth replaying
+        if (use_cache && finished && !stop_requested_.load()) {
+            response_cache_.insert(tokens, query_embedding, emitted, n_gen);
+        }
+
+        is_generating_.store(false);
+        callback("", true);
+    };
+
+    // The small model answers first and hands over to this one when unsure
+    if (cascade_ && runCascade(tokens, max_tokens, emit, finished, stop_matched, compute_turn)) {
+        complete();
+        return;
+    }
+
+    // Resolve the active session; its resident KV covers a prefix of the prompt
+    Session* session = acquireSession(active_session_);
+    if (session == nullptr) {
+        LOGE("No KV sequence available for session '%s'", active_session_.c_str());
+        is_generating_.store(false);
+        callback("", true);
+        return;
+    }
+    const llama_seq_id seq = session->seq_id;
+    llama_memory_t memory = llama_get_memory(context_);
 
-    // Create batch for processing with dynamic capacity based on token count
-    // Use at least 1 to avoid zero-capacity allocation, and ensure room for generation
-    const size_t batch_capacity = std::max<size_t>(1, tokens.size());
-    llama_batch batch = llama_batch_init(static_cast<int32_t>(batch_capacity), 0, 1);
+    // Keep the longest common prefix; always re-decode at least the last
+    // prompt token so there are logits to sample from
+    size_t n_keep = 0;
+    while (n_keep < session->tokens.size() && n_keep < tokens.size() &&
+           session->tokens[n_keep] == tokens[n_keep]) {
+        n_keep++;
+    }
+    n_keep = std::min(n_keep, tokens.size() - 1);
 
-    // Add prompt tokens to batch
-    llama_batch_clear(batch);
-    for (size_t i = 0; i < tokens.size() && i < batch_capacity; ++i) {
-        llama_batch_add(batch, tokens[i], static_cast<llama_pos>(i), {0}, false);
+    // Another workflow may have prefilled a longer shared preamble; copy it
+    // by reference (the cells are shared, not duplicated)
+    const bool use_prefix_cache = prefix_cache_ && prefix_cache_->enabled();
+    if (use_prefix_cache) {
+        size_t n_shared = 0;
+        llama_seq_id slot = prefix_cache_->match(tokens, n_shared);
+        n_shared = std::min(n_shared, tokens.size() - 1);
+        if (slot >= 0 && n_shared > n_keep) {
+            llama_memory_seq_rm(memory, seq, -1, -1);
+            llama_memory_seq_cp(memory, slot, seq, 0, static_cast<llama_pos>(n_shared));
+            session->tokens.assign(tokens.begin(), tokens.begin() + n_shared);
+            LOGD("Prefix cache: copied %zu tokens from seq %d", n_shared, slot);
+            prefix_cache_->recordLookup(n_shared - n_keep);
+            n_keep = n_shared;
+        } else {
+            prefix_cache_->recordLookup(0);
+        }
+        updatePrefixCacheStats();
     }
-    // Enable logits for last token (guard against empty prompt)
-    if (!tokens.empty()) {
-        batch.logits[batch.n_tokens - 1] = 1;
+
+    // Speculation settings are fixed for the duration of this call
+    const bool use_lookup = config_.lookup_decoding;
+    const int32_t draft_max = use_lookup ? std::max(1, config_.lookup_draft_max) : 0;
+
+    // Make room in the shared KV buffer by evicting other sessions if needed
+    ensureKvBudget(static_cast<int32_t>(tokens.size()) + max_tokens + draft_max, active_session_);
+    updateSessionCounts();
+
+    // A document block that isn't resident yet is loaded, not prefilled
+    const bool load_document = splice.document != nullptr && n_keep < splice.start + splice.length;
+    if (load_document) {
+        n_keep = std::min(n_keep, splice.start);
     }
 
+    llama_memory_seq_rm(memory, seq, static_cast<llama_pos>(n_keep), -1);
+    session->tokens.resize(n_keep);
+
+    // Room for the sampled token plus a full speculative draft
+    llama_batch batch = llama_batch_init(1 + draft_max, 0, 1);
+
     // Process prompt
     LOGD("Processing prompt through decoder...");
-    if (llama_decode(context_, batch) != 0) {
+    size_t prefill_from = n_keep;
+    size_t n_spliced = 0;
+    bool prompt_ok = true;
+    if (load_document) {
+        prompt_ok = prefill(seq, tokens, n_keep, splice.start, nullptr);
+        if (prompt_ok && spliceDocument(splice, seq)) {
+            prefill_from = splice.start + splice.length;
+            n_spliced = splice.length;
+        } else {
+            prefill_from = splice.start;
+        }
+    }
+
+    const size_t n_prefill = tokens.size() - n_keep - n_spliced;
+    LOGD("Session '%s' (seq %d): reusing %zu tokens, loading %zu, prefilling %zu",
+         active_session_.c_str(), seq, n_keep, n_spliced, n_prefill);
+
+    int32_t logits_idx = 0;
+    prompt_ok = prompt_ok && prefill(seq, tokens, prefill_from, tokens.size(), &logits_idx);
+    if (!prompt_ok) {
         LOGE("Initial decode failed");
+        llama_memory_seq_rm(memory, seq, static_cast<llama_pos>(n_keep), -1);
         llama_batch_free(batch);
         is_generating_.store(false);
         callback("", true);
         return;
     }
+    session->tokens.assign(tokens.begin(), tokens.end());
     LOGD("Prompt processed, starting generation...");
 
+    // Remember this prompt so other sessions can start from its prefix
+    if (use_prefix_cache && static_cast<int32_t>(tokens.size()) >= config_.prefix_cache_min_tokens) {
+        std::vector<llama_seq_id> released;
+        llama_seq_id slot = prefix_cache_->insert(tokens, released);
+        for (llama_seq_id stale : released) {
+            llama_memory_seq_rm(memory, stale, -1, -1);
+        }
+        if (slot >= 0) {
+            llama_memory_seq_cp(memory, seq, slot, 0, static_cast<llama_pos>(tokens.size()));
+        }
+        updatePrefixCacheStats();
+    }
+
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        session_stats_.prefill_tokens += static_cast<int64_t>(n_prefill);
+        session_stats_.reused_tokens += static_cast<int64_t>(n_keep);
+    }
+
     // Get vocab for new API
     const llama_vocab* vocab = llama_model_get_vocab(model_);
 
     // Create greedy sampler (matching iOS implementation)
     llama_sampler* sampler = llama_sampler_init_greedy();
 
+    // Index the prompt so replies that quote it can be drafted
+    NgramLookup lookup(config_.lookup_ngram_min, config_.lookup_ngram_max);
+    if (use_lookup) {
+        lookup.push(tokens);
+    }
+    std::vector<llama_token> draft;
+
     // Generation loop
+    const int32_t n_end = static_cast<int32_t>(tokens.size()) + max_tokens;
     int32_t n_cur = static_cast<int32_t>(tokens.size());
-    int32_t n_gen = 0;
-    std::vector<char> temp_invalid_chars;
+    int64_t n_drafted = 0;
+    int64_t n_accepted = 0;
+    int64_t n_decodes = 0;
+    bool done = false;
 
-    while (n_cur < static_cast<int32_t>(tokens.size()) + max_tokens) {
+    while (!done && n_cur < n_end) {
         // Check for stop request
         if (stop_requested_.load()) {
             LOGI("Generation stopped by request");
             break;
         }
 
+        // Let the ASR decoder on the same weights finish first, and don't
+        // run ahead of playback
+        yieldToAsr();
+        paceToConsumer(compute_turn);
+
         // Sample next token using greedy sampler
-        llama_token new_token = llama_sampler_sample(sampler, context_, batch.n_tokens - 1);
+        llama_token new_token = llama_sampler_sample(sampler, context_, logits_idx);
 
         // Check for end of generation
         if (llama_vocab_is_eog(vocab, new_token)) {
             LOGD("End of generation token received");
+            finished = true;
             break;
         }
 
-        // Decode token to text
-        std::string token_text = detokenize(new_token);
+        // Decode token to text and stop on the token that completes a stop string
+        if (emit(detokenize(new_token))) {
+            LOGD("Stop sequence matched");
+            stop_matched = finished = true;
+            break;
+        }
 
-        // Handle multi-byte UTF-8 characters
-        if (!token_text.empty()) {
-            n_gen++;
-            callback(token_text, false);
+        // Propose a continuation from earlier n-grams, within the token budget
+        draft.clear();
+        if (use_lookup) {
+            lookup.push(new_token);
+            lookup.draft(std::min(draft_max, n_end - n_cur - 1), draft);
         }
 
-        // Prepare next batch
+        // Prepare next batch: the sampled token followed by any draft tokens,
+        // with logits at every position so each draft token can be verified
         llama_batch_clear(batch);
-        llama_batch_add(batch, new_token, n_cur, {0}, true);
+        llama_batch_add(batch, new_token, n_cur, {seq}, true);
+        for (size_t i = 0; i < draft.size(); ++i) {
+            llama_batch_add(batch, draft[i], n_cur + 1 + static_cast<llama_pos>(i), {seq}, true);
+        }
 
         if (llama_decode(context_, batch) != 0) {
             LOGE("Decode failed during generation");
+            llama_memory_seq_rm(memory, seq, n_cur, -1);
             break;
         }
+        n_decodes++;
 
         n_cur++;
+        session->tokens.push_back(new_token);
+        logits_idx = 0;
+
+        if (draft.empty()) {
+            continue;
+        }
+
+        // Verify the draft: accept tokens while they match the greedy choice.
+        // The first mismatch is re-sampled from its logits at the loop head.
+        n_drafted += static_cast<int64_t>(draft.size());
+        size_t accepted = 0;
+        while (accepted < draft.size()) {
+            llama_token expected = llama_sampler_sample(
+                sampler, context_, static_cast<int32_t>(accepted));
+            if (expected != draft[accepted]) {
+                break;
+            }
+            if (llama_vocab_is_eog(vocab, expected)) {
+                LOGD("End of generation token accepted from draft");
+                finished = done = true;
+                break;
+            }
+            if (stop_requested_.load()) {
+                done = true;
+                break;
+            }
+
+            accepted++;
+            if (emit(detokenize(expected))) {
+                LOGD("Stop sequence matched in draft");
+                stop_matched = finished = done = true;
+                break;
+            }
+
+            lookup.push(expected);
+        }
+
+        for (size_t i = 0; i < accepted; ++i) {
+            session->tokens.push_back(draft[i]);
+        }
+
+        n_accepted += static_cast<int64_t>(accepted);
+        n_cur += static_cast<int32_t>(accepted);
+        logits_idx = static_cast<int32_t>(accepted);
+
+        // Drop KV entries for rejected draft tokens
+        if (accepted < draft.size()) {
+            llama_memory_seq_rm(memory, seq, n_cur, -1);
+        }
     }
 
     // Cleanup
     llama_sampler_free(sampler);
     llama_batch_free(batch);
 
-    LOGI("Generation complete: %d tokens generated", n_gen);
-    is_generating_.store(false);
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        lookup_stats_.drafted_tokens += n_drafted;
+        lookup_stats_.accepted_tokens += n_accepted;
+        lookup_stats_.decode_calls += n_decodes;
+        lookup_stats_.generated_tokens += n_gen;
+        pacing_stats_.generated_tokens += n_gen;
+    }
+
+    if (use_lookup) {
+        LOGI("Generation complete: %d tokens generated in %lld decodes, "
+             "draft acceptance %lld/%lld (%.1f%%)",
+             n_gen, static_cast<long long>(n_decodes),
+             static_cast<long long>(n_accepted), static_cast<long long>(n_drafted),
+             n_drafted > 0 ? 100.0 * n_accepted / n_drafted : 0.0);
+    } else {
+        LOGI("Generation complete: %d tokens generated", n_gen);
+    }
 
     // Final callback to signal completion
-    callback("", true);
+    complete();
 }
 
-void LlamaInference::stopGeneration() {
-    stop_requested_.store(true);
-    LOGI("Stop requested");
-}
+bool LlamaInference::prefill(
+    llama_seq_id seq,
+    const std::vector<llama_token>& tokens,
+    size_t from,
+    size_t to,
+    int32_t* logits_idx
+) {
+    const size_t n_batch = std::max<size_t>(1, llama_n_batch(context_));
+    llama_batch batch = llama_batch_init(static_cast<int32_t>(std::min(n_batch, std::max<size_t>(1, to - from))), 0, 1);
 
-std::vector<llama_token> LlamaInference::tokenize(const std::string& text, bool add_special) {
-    // Get vocab from model (new b7263+ API)
-    const llama_vocab* vocab = llama_model_get_vocab(model_);
+    bool ok = true;
+    for (size_t begin = from; begin < to && ok; begin += n_batch) {
+        yieldToAsr();
+        const size_t end = std::min(to, begin + n_batch);
+        llama_batch_clear(batch);
+        for (size_t i = begin; i < end; ++i) {
+            llama_batch_add(batch, tokens[i], static_cast<llama_pos>(i), {seq}, false);
+        }
+        if (logits_idx != nullptr && end == to) {
+            batch.logits[batch.n_tokens - 1] = 1;
+            *logits_idx = batch.n_tokens - 1;
+        }
+        ok = llama_decode(context_, batch) == 0;
+    }
 
-    int32_t n_tokens_max = static_cast<int32_t>(text.length()) + 2;
-    std::vector<llama_token> tokens(n_tokens_max);
+    llama_batch_free(batch);
+    return ok;
+}
 
-    // New API: llama_tokenize(vocab, text, text_len, tokens, n_tokens_max, add_special, parse_special)
-    int32_t n_tokens = llama_tokenize(
-        vocab,
-        text.c_str(),
-        static_cast<int32_t>(text.length()),
-        tokens.data(),
-        n_tokens_max,
-        add_special,
-        false  // parse_special
-    );
+std::vector<llama_token> LlamaInference::tokenizePrompt(
+    const std::string& prompt,
+    DocumentSplice& splice
+) {
+    // Longest registered document that appears verbatim
+    size_t at = std::string::npos;
+    for (const auto& entry : documents_) {
+        const Document& document = entry.second;
+        if (splice.document != nullptr && document.text.size() <= splice.document->text.size()) {
+            continue;
+        }
+        size_t found = prompt.find(document.text);
+        if (found != std::string::npos) {
+            splice.document = &document;
+            splice.key = entry.first;
+            at = found;
+        }
+    }
 
-    if (n_tokens < 0) {
-        // Buffer too small, resize and retry
-        tokens.resize(-n_tokens);
-        n_tokens = llama_tokenize(
-            vocab,
-            text.c_str(),
-            static_cast<int32_t>(text.length()),
-            tokens.data(),
-            static_cast<int32_t>(tokens.size()),
-            add_special,
-            false
-        );
+    if (splice.document == nullptr) {
+        return tokenize(prompt, true);
     }
 
-    tokens.resize(std::max(0, n_tokens));
+    // Tokenize around the document so its tokens match the stored block
+    std::vector<llama_token> tokens = tokenize(prompt.substr(0, at), true);
+    splice.start = tokens.size();
+    splice.length = splice.document->tokens.size();
+    tokens.insert(tokens.end(), splice.document->tokens.begin(), splice.document->tokens.end());
+
+    std::vector<llama_token> suffix = tokenize(prompt.substr(at + splice.document->text.size()), false);
+    tokens.insert(tokens.end(), suffix.begin(), suffix.end());
+
+    // The last prompt token is always decoded for its logits
+    if (splice.start + splice.length == tokens.size()) {
+        splice.length--;
+    }
     return tokens;
 }
 
-std::string LlamaInference::detokenize(llama_token token) {
+bool LlamaInference::spliceDocument(const DocumentSplice& splice, llama_seq_id seq) {
+    auto start = std::chrono::steady_clock::now();
+    llama_memory_t memory = llama_get_memory(context_);
+    const llama_seq_id scratch = scratchSequence();
+    const llama_pos at = static_cast<llama_pos>(splice.start);
+
+    if (at > 0 && !llama_memory_can_shift(memory)) {
+        LOGW("Cannot place document '%s' at position %d without KV shifting",
+             splice.key.c_str(), at);
+        return false;
+    }
+
+    // Load the block at positions [0, n) in the scratch sequence
+    const std::vector<llama_token>& expected = splice.document->tokens;
+    std::vector<llama_token> stored(expected.size());
+    size_t n_stored = 0;
+    const std::string path = documentPath(splice.key);
+    if (llama_state_seq_load_file(context_, path.c_str(), scratch,
+                                  stored.data(), stored.size(), &n_stored) == 0 ||
+        n_stored != expected.size() || !std::equal(expected.begin(), expected.end(), stored.begin())) {
+        LOGW("Document block '%s' missing or stale, prefilling instead", splice.key.c_str());
+        llama_memory_seq_rm(memory, scratch, -1, -1);
+        return false;
+    }
+
+    // Move it to the document's place in the prompt and share it with seq
+    if (at > 0) {
+        llama_memory_seq_add(memory, scratch, 0, -1, at);
+    }
+    llama_memory_seq_cp(memory, scratch, seq, at, at + static_cast<llama_pos>(splice.length));
+    llama_memory_seq_rm(memory, scratch, -1, -1);
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    document_stats_.splices++;
+    document_stats_.spliced_tokens += static_cast<int64_t>(splice.length);
+    document_stats_.last_splice_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    return true;
+}
+
+std::string LlamaInference::precomputeDocument(const std::string& text) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (!is_loaded_.load() || config_.document_cache_dir.empty()) {
+        LOGE("Cannot precompute document: model not loaded or no cache directory");
+        return "";
+    }
+    if (is_hibernated_.load() && !resumeLocked()) {
+        return "";
+    }
+    ComputeLease compute_lease = leaseThreadpool(config_.n_threads);
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(fnv1a(text)));
+
+    Document document;
+    document.text = text;
+    document.tokens = tokenize(text, false);
+    if (document.tokens.size() < kMinDocumentTokens ||
+        document.tokens.size() + 1 >= llama_n_ctx(context_)) {
+        LOGW("Document of %zu tokens not worth precomputing or too long", document.tokens.size());
+        return "";
+    }
+
+    // Reuse the KV file from an earlier session when it exists
+    const std::string path = documentPath(key);
+    FILE* existing = fopen(path.c_str(), "rb");
+    if (existing != nullptr) {
+        fclose(existing);
+        LOGI("Document '%s' already precomputed (%zu tokens)", key, document.tokens.size());
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        const llama_seq_id scratch = scratchSequence();
+        llama_memory_t memory = llama_get_memory(context_);
+
+        ensureKvBudget(static_cast<int32_t>(document.tokens.size()), active_session_);
+        updateSessionCounts();
+
+        bool ok = prefill(scratch, document.tokens, 0, document.tokens.size(), nullptr) &&
+                  llama_state_seq_save_file(context_, path.c_str(), scratch,
+                                            document.tokens.data(), document.tokens.size()) > 0;
+        llama_memory_seq_rm(memory, scratch, -1, -1);
+        if (!ok) {
+            LOGE("Failed to precompute document '%s'", key);
+            std::remove(path.c_str());
+            return "";
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        LOGI("Precomputed document '%s': %zu tokens in %.1f ms", key, document.tokens.size(),
+             std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1000.0);
+
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        document_stats_.precomputed_tokens += static_cast<int64_t>(document.tokens.size());
+    }
+
+    documents_[key] = std::move(document);
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    document_stats_.registered_documents = static_cast<int32_t>(documents_.size());
+    return key;
+}
+
+void LlamaInference::removeDocument(const std::string& key) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (documents_.erase(key) > 0 && !config_.document_cache_dir.empty()) {
+        std::remove(documentPath(key).c_str());
+    }
+
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    document_stats_.registered_documents = static_cast<int32_t>(documents_.size());
+}
+
+DocumentStats LlamaInference::getDocumentStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return document_stats_;
+}
+
+std::string LlamaInference::documentPath(const std::string& key) const {
+    return config_.document_cache_dir + "/doc_" + key + "_" + model_fingerprint_ + ".kv";
+}
+
+llama_seq_id LlamaInference::scratchSequence() const {
+    return static_cast<llama_seq_id>(
+        std::max(1, config_.max_sessions) + std::max(0, config_.prefix_cache_slots));
+}
+
+bool LlamaInference::runCompactionStep(const std::function<bool()>& step) {
+    // Let waiting foreground requests take the lock first
+    bool yielded = false;
+    while (foreground_waiters_.load() > 0 && !compaction_cancel_.load()) {
+        yielded = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(kCompactionYieldMs));
+    }
+    if (yielded) {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        compaction_stats_.yields++;
+    }
+
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    if (compaction_cancel_.load() || !is_loaded_.load() || is_hibernated_.load()) {
+        return false;
+    }
+    yieldToAsr();
+
+    // Leave half the cores to the rest of the app
+    const int32_t n_threads = std::max(1, std::min(8, config_.n_threads));
+    const int32_t n_low = std::max(1, n_threads / 2);
+    ComputeLease compute_lease = leaseThreadpool(n_low);
+    llama_set_n_threads(context_, n_low, n_low);
+    bool ok = step();
+    llama_set_n_threads(context_, n_threads, n_threads);
+    return ok;
+}
+
+std::string LlamaInference::compactSession(
+    const std::string& session_id,
+    const std::string& summary_prompt,
+    const std::string& prefix_before,
+    const std::string& prefix_after,
+    int32_t max_summary_tokens
+) {
+    if (!is_loaded_.load() || max_summary_tokens <= 0) {
+        return "";
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    compaction_cancel_.store(false);
+
+    // On Linux this applies to the calling thread only; the leased pool
+    // workers keep their normal priority
+    const int previous_nice = getpriority(PRIO_PROCESS, 0);
+    setpriority(PRIO_PROCESS, 0, kCompactionNice);
+
+    const llama_seq_id seq = compactionSequence();
+    std::vector<llama_token> tokens;
+    size_t n_prompt = 0;
+    int32_t logits_idx = 0;
+
+    // Reserve the compaction sequence
+    bool ok = runCompactionStep([&]() {
+        tokens = tokenize(summary_prompt, true);
+        n_prompt = tokens.size();
+        const int32_t n_needed = static_cast<int32_t>(n_prompt) + max_summary_tokens;
+        if (n_prompt == 0 || n_needed >= static_cast<int32_t>(llama_n_ctx(context_))) {
+            LOGW("Compaction prompt of %zu tokens does not fit", n_prompt);
+            return false;
+        }
+        llama_memory_seq_rm(llama_get_memory(context_), seq, -1, -1);
+        compaction_tokens_ = n_needed;
+
+        auto active = sessions_.find(active_session_);
+        const int32_t n_active = active != sessions_.end() && active->second.seq_id >= 0
+            ? static_cast<int32_t>(active->second.tokens.size()) : 0;
+        ensureKvBudget(n_active, active_session_);
+        updateSessionCounts();
+        return true;
+    });
+
+    // Prefill the summarization prompt one chunk per step. Foreground turns
+    // decode between steps and overwrite the context's logits, so every
+    // token is sampled in the same step as the decode that produced it and
+    // only the sampled token carries over.
+    llama_sampler* sampler = llama_sampler_init_greedy();
+    llama_token next = 0;
+    for (size_t from = 0; ok && from < n_prompt; from += kCompactionChunkTokens) {
+        const size_t to = std::min(n_prompt, from + kCompactionChunkTokens);
+        ok = runCompactionStep([&]() {
+            if (!prefill(seq, tokens, from, to, to == n_prompt ? &logits_idx : nullptr)) {
+                return false;
+            }
+            if (to == n_prompt) {
+                next = llama_sampler_sample(sampler, context_, logits_idx);
+            }
+            return true;
+        });
+    }
+
+    // Greedy summary, one token per step
+    std::string summary;
+    StopSequenceMatcher stop_matcher;
+    bool finished = false;
+    for (int32_t i = 0; ok && !finished && i < max_summary_tokens; ++i) {
+        ok = runCompactionStep([&]() {
+            if (i == 0) {
+                stop_matcher.setPatterns(stop_matcher_.patterns());
+            }
+            const llama_token token = next;
+            if (llama_vocab_is_eog(llama_model_get_vocab(model_), token)) {
+                finished = true;
+                return true;
+            }
+
+            std::string piece;
+            finished = stop_matcher.feed(detokenize(token), piece);
+            summary += piece;
+            if (finished) {
+                return true;
+            }
+
+            tokens.push_back(token);
+            if (!prefill(seq, tokens, tokens.size() - 1, tokens.size(), &logits_idx)) {
+                return false;
+            }
+            next = llama_sampler_sample(sampler, context_, logits_idx);
+            return true;
+        });
+    }
+    llama_sampler_free(sampler);
+    if (ok && !finished) {
+        summary += stop_matcher.flush();
+    }
+    const size_t n_summary = tokens.size() - n_prompt;
+
+    // Release the compaction sequence
+    {
+        std::lock_guard<std::mutex> lock(generation_mutex_);
+        if (context_ != nullptr && !is_hibernated_.load()) {
+            llama_memory_seq_rm(llama_get_memory(context_), seq, -1, -1);
+        }
+        compaction_tokens_ = 0;
+    }
+
+    const size_t first = summary.find_first_not_of(" \t\n");
+    const size_t last = summary.find_last_not_of(" \t\n");
+    summary = first == std::string::npos ? "" : summary.substr(first, last - first + 1);
+    ok = ok && !summary.empty();
+
+    // Rebuild the session's KV for the compacted prompt, resuming after any
+    // turn that ran in between
+    std::vector<llama_token> target;
+    size_t n_rebuilt = 0;
+    for (bool done = !ok; !done && ok;) {
+        ok = runCompactionStep([&]() {
+            if (target.empty()) {
+                target = tokenize(prefix_before + summary + prefix_after, true);
+            }
+            auto it = sessions_.find(session_id);
+            if (it == sessions_.end() || it->second.seq_id < 0) {
+                // Not resident; the next turn prefills the compacted prompt
+                done = true;
+                return true;
+            }
+            Session& session = it->second;
+
+            size_t n_keep = 0;
+            while (n_keep < session.tokens.size() && n_keep < target.size() &&
+                   session.tokens[n_keep] == target[n_keep]) {
+                n_keep++;
+            }
+            if (n_keep == target.size()) {
+                done = true;
+                return true;
+            }
+            if (n_rebuilt == 0) {
+                ensureKvBudget(static_cast<int32_t>(target.size()), session_id);
+                updateSessionCounts();
+            }
+
+            const size_t to = std::min(target.size(), n_keep + kCompactionChunkTokens);
+            llama_memory_seq_rm(llama_get_memory(context_), session.seq_id,
+                                static_cast<llama_pos>(n_keep), -1);
+            session.tokens.resize(n_keep);
+            if (!prefill(session.seq_id, target, n_keep, to, nullptr)) {
+                llama_memory_seq_rm(llama_get_memory(context_), session.seq_id,
+                                    static_cast<llama_pos>(n_keep), -1);
+                return false;
+            }
+            session.tokens.assign(target.begin(), target.begin() + to);
+            n_rebuilt += to - n_keep;
+            return true;
+        });
+    }
+
+    setpriority(PRIO_PROCESS, 0, previous_nice);
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    compaction_stats_.summarized_tokens += static_cast<int64_t>(n_prompt);
+    compaction_stats_.summary_tokens += static_cast<int64_t>(n_summary);
+    compaction_stats_.rebuilt_tokens += static_cast<int64_t>(n_rebuilt);
+    if (!ok) {
+        compaction_stats_.aborted++;
+        LOGW("Compaction of session '%s' aborted", session_id.c_str());
+        return "";
+    }
+    compaction_stats_.compactions++;
+    compaction_stats_.last_compaction_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    LOGI("Compacted session '%s': %zu prompt tokens -> %zu summary tokens, %zu rebuilt in %lld ms",
+         session_id.c_str(), n_prompt, n_summary, n_rebuilt,
+         static_cast<long long>(compaction_stats_.last_compaction_ms));
+    return summary;
+}
+
+void LlamaInference::cancelCompaction() {
+    compaction_cancel_.store(true);
+}
+
+CompactionStats LlamaInference::getCompactionStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return compaction_stats_;
+}
+
+void LlamaInference::yieldToAsr() {
+    if (!shared_model_ || !shared_model_->priorityActive()) {
+        return;
+    }
+    const int64_t waited_us = shared_model_->yieldToPriority();
+
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    shared_model_stats_.yields++;
+    shared_model_stats_.yield_us += waited_us;
+}
+
+SharedModelStats LlamaInference::getSharedModelStats() {
+    std::shared_ptr<SharedModel> shared = std::atomic_load(&shared_model_);
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    SharedModelStats stats = shared_model_stats_;
+    // Not counting the local copy
+    stats.model_users = shared ? static_cast<int32_t>(shared.use_count() - 1) : 0;
+    return stats;
+}
+
+bool LlamaInference::loadCascadeModel(const std::string& model_path, const CascadeConfig& config) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (!is_loaded_.load()) {
+        LOGE("Cannot load cascade model: large model not loaded");
+        return false;
+    }
+
+    auto cascade = std::make_unique<CascadeModel>();
+    if (!cascade->load(model_path, config, model_)) {
+        return false;
+    }
+    cascade_ = std::move(cascade);
+    return true;
+}
+
+void LlamaInference::unloadCascadeModel() {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    cascade_.reset();
+}
+
+CascadeStats LlamaInference::getCascadeStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return cascade_stats_;
+}
+
+bool LlamaInference::runCascade(
+    const std::vector<llama_token>& tokens,
+    int32_t max_tokens,
+    const std::function<bool(const std::string&)>& emit,
+    bool& finished,
+    bool& stop_matched,
+    ComputeTurn& turn
+) {
+    auto start = std::chrono::steady_clock::now();
+    if (!cascade_->start(tokens)) {
+        return false;
+    }
+
+    const CascadeConfig& policy = cascade_->config();
+    const int32_t n_probe = std::max(1, std::min(policy.probe_tokens, max_tokens));
+    const llama_vocab* vocab = llama_model_get_vocab(model_);
+
+    // Probe: generate a few tokens without emitting them and judge confidence
+    std::vector<llama_token> probe;
+    float min_probability = 1.0f;
+    float entropy_sum = 0.0f;
+    bool probe_done = false;
+    while (static_cast<int32_t>(probe.size()) < n_probe && !stop_requested_.load()) {
+        yieldToAsr();
+        CascadeToken next = cascade_->predict();
+        if (next.token < 0) {
+            return false;
+        }
+        min_probability = std::min(min_probability, next.probability);
+        entropy_sum += next.entropy;
+        if (llama_vocab_is_eog(vocab, next.token)) {
+            probe_done = true;
+            break;
+        }
+        probe.push_back(next.token);
+        if (!cascade_->hasRoom() || !cascade_->advance(next.token)) {
+            return false;
+        }
+    }
+
+    const int32_t n_judged = static_cast<int32_t>(probe.size()) + (probe_done ? 1 : 0);
+    const float mean_entropy = entropy_sum / static_cast<float>(std::max(1, n_judged));
+    if (min_probability < policy.min_probability || mean_entropy > policy.max_mean_entropy) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        LOGD("Cascade escalating: min_p=%.2f mean_entropy=%.2f", min_probability, mean_entropy);
+
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        cascade_stats_.escalations++;
+        cascade_stats_.discarded_tokens += static_cast<int64_t>(probe.size());
+        cascade_stats_.probe_us +=
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        return false;
+    }
+
+    // Confident: release the probe and keep going with the small model
+    int32_t n_emitted = 0;
+    bool done = probe_done;
+    for (llama_token token : probe) {
+        n_emitted++;
+        if (emit(detokenize(token))) {
+            stop_matched = done = true;
+            break;
+        }
+    }
+    while (!done && n_emitted < max_tokens && !stop_requested_.load()) {
+        yieldToAsr();
+        paceToConsumer(turn);
+        CascadeToken next = cascade_->predict();
+        if (next.token < 0 || llama_vocab_is_eog(vocab, next.token)) {
+            done = next.token >= 0;
+            break;
+        }
+        n_emitted++;
+        if (emit(detokenize(next.token))) {
+            stop_matched = done = true;
+            break;
+        }
+        if (!cascade_->hasRoom() || !cascade_->advance(next.token)) {
+            break;
+        }
+    }
+    finished = done;
+
+    LOGI("Cascade answered with the small model: %d tokens (min_p=%.2f, mean_entropy=%.2f)",
+         n_emitted, min_probability, mean_entropy);
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    cascade_stats_.small_answers++;
+    cascade_stats_.small_tokens += n_emitted;
+    pacing_stats_.generated_tokens += n_emitted;
+    return true;
+}
+
+PrefixCacheStats LlamaInference::getPrefixCacheStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return prefix_cache_stats_;
+}
+
+void LlamaInference::configureResponseCache(const ResponseCacheConfig& config) {
+    response_cache_.configure(config);
+    LOGI("Response cache: max_entries=%zu, max_bytes=%zu, ttl=%lldms, threshold=%.2f",
+         config.max_entries, config.max_bytes,
+         static_cast<long long>(config.ttl_ms), config.similarity_threshold);
+}
+
+void LlamaInference::setResponseCacheContext(const std::string& context_key) {
+    response_cache_.setContext(context_key);
+}
+
+void LlamaInference::setQueryEmbedding(const float* embedding, int32_t dim) {
+    std::lock_guard<std::mutex> lock(query_mutex_);
+    if (embedding == nullptr || dim <= 0) {
+        query_embedding_.clear();
+        return;
+    }
+    query_embedding_.assign(embedding, embedding + dim);
+}
+
+void LlamaInference::setStopSequences(const std::vector<std::string>& stop_sequences) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    stop_matcher_.setPatterns(stop_sequences);
+    response_cache_.clear();
+    LOGI("Stop sequences set: %zu", stop_matcher_.patterns().size());
+}
+
+void LlamaInference::setLookupDecoding(bool enabled, int32_t ngram_max, int32_t draft_max) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+    config_.lookup_decoding = enabled;
+    config_.lookup_ngram_max = std::max(config_.lookup_ngram_min, ngram_max);
+    config_.lookup_draft_max = std::max(1, draft_max);
+    LOGI("Prompt-lookup decoding %s (ngram_max=%d, draft_max=%d)",
+         enabled ? "enabled" : "disabled", config_.lookup_ngram_max, config_.lookup_draft_max);
+}
+
+LookupStats LlamaInference::getLookupStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return lookup_stats_;
+}
+
+void LlamaInference::resetLookupStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    lookup_stats_ = LookupStats();
+}
+
+void LlamaInference::stopGeneration() {
+    stop_requested_.store(true);
+    {
+        // Wake a generation that is waiting for playback to drain
+        std::lock_guard<std::mutex> lock(pacing_mutex_);
+    }
+    pacing_cv_.notify_all();
+    LOGI("Stop requested");
+}
+
+void LlamaInference::configurePacing(const PacingConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(pacing_mutex_);
+        pacing_config_ = config;
+        pacing_config_.low_watermark_s = std::min(config.low_watermark_s, config.high_watermark_s);
+    }
+    pacing_cv_.notify_all();
+    LOGI("Pacing: high=%.1fs, low=%.1fs", config.high_watermark_s, pacing_config_.low_watermark_s);
+}
+
+void LlamaInference::reportConsumerLag(float queued_seconds) {
+    {
+        std::lock_guard<std::mutex> lock(pacing_mutex_);
+        consumer_lag_s_ = std::max(0.0f, queued_seconds);
+        lag_reported_at_ = std::chrono::steady_clock::now();
+    }
+    pacing_cv_.notify_all();
+    consumer_lag_ms_.store(static_cast<int32_t>(std::lround(std::max(0.0f, queued_seconds) * 1000.0f)));
+    publishTelemetry();
+}
+
+void LlamaInference::bargeIn() {
+    int64_t discarded = 0;
+    {
+        std::lock_guard<std::mutex> lock(pacing_mutex_);
+        // Playback drained at real time since the last report
+        const float elapsed_s = std::chrono::duration<float>(
+            std::chrono::steady_clock::now() - lag_reported_at_).count();
+        const float unspoken_s = std::max(0.0f, consumer_lag_s_ - elapsed_s);
+        discarded = std::min<int64_t>(
+            response_tokens_.load(),
+            std::lround(unspoken_s * pacing_config_.speech_tokens_per_second));
+        consumer_lag_s_ = 0.0f;
+    }
+    consumer_lag_ms_.store(0);
+    stopGeneration();
+
+    LOGI("Barge-in: ~%lld generated tokens discarded", static_cast<long long>(discarded));
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    pacing_stats_.barge_ins++;
+    pacing_stats_.discarded_tokens += discarded;
+}
+
+PacingStats LlamaInference::getPacingStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return pacing_stats_;
+}
+
+void LlamaInference::paceToConsumer(ComputeTurn& turn) {
+    std::unique_lock<std::mutex> lock(pacing_mutex_);
+    const float high = pacing_config_.high_watermark_s;
+    auto drained_at = [&](float watermark) {
+        return lag_reported_at_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<float>(consumer_lag_s_ - watermark));
+    };
+    if (high <= 0.0f || std::chrono::steady_clock::now() >= drained_at(high)) {
+        return;
+    }
+
+    // No decode runs while paused, so the pool goes back (parked, or to an
+    // ASR turn) and audio misses stop counting as under load. New reports
+    // or a stop re-evaluate the deadline.
+    pacing_pauses_.fetch_add(1);
+    setPhase(Phase::PAUSED);
+    auto start = std::chrono::steady_clock::now();
+    turn.lease.reset();
+    turn.load.reset();
+    while (!stop_requested_.load() && pacing_config_.high_watermark_s > 0.0f &&
+           std::chrono::steady_clock::now() < drained_at(pacing_config_.low_watermark_s)) {
+        pacing_cv_.wait_until(lock, drained_at(pacing_config_.low_watermark_s));
+    }
+    lock.unlock();
+    holdCompute(turn);
+    setPhase(Phase::DECODE);
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    const int64_t paused_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    LOGD("Paused %.1f ms for playback to drain", paused_us / 1000.0);
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    pacing_stats_.pauses++;
+    pacing_stats_.paused_us += paused_us;
+}
+
+bool LlamaInference::attachTelemetry(void* memory, size_t capacity) {
+    if (memory == nullptr) {
+        telemetry_.detach();
+        return true;
+    }
+    if (!telemetry_.attach(memory, capacity, TelemetryLayout::LLM, kTelemetryFields)) {
+        LOGE("Telemetry block needs %zu aligned bytes, got %zu",
+             TelemetryBlock::bytesFor(kTelemetryFields), capacity);
+        return false;
+    }
+    publishTelemetry();
+    return true;
+}
+
+void LlamaInference::setPhase(Phase phase) {
+    phase_.store(static_cast<int32_t>(phase));
+    publishTelemetry();
+}
+
+void LlamaInference::recordToken(int32_t response_tokens) {
+    const int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    total_tokens_.fetch_add(1);
+    if (response_tokens == 1) {
+        // The rate leaves out time to first token, which prefill dominates
+        first_token_us_.store(now_us);
+        phase_.store(static_cast<int32_t>(Phase::DECODE));
+    } else {
+        const int64_t elapsed_us = now_us - first_token_us_.load();
+        if (elapsed_us > 0) {
+            tokens_per_s_milli_.store(static_cast<int64_t>(response_tokens - 1) * 1000000000LL / elapsed_us);
+        }
+    }
+    publishTelemetry();
+}
+
+void LlamaInference::publishTelemetry() {
+    telemetry_.publish([this](int64_t* values) {
+        if (!is_loaded_.load()) {
+            values[0] = 0;
+        } else if (is_hibernated_.load()) {
+            values[0] = 5;
+        } else {
+            values[0] = phase_.load();
+        }
+        values[1] = response_tokens_.load();
+        values[2] = tokens_per_s_milli_.load();
+        values[3] = total_tokens_.load();
+        values[4] = generations_.load();
+        values[5] = prompt_tokens_.load();
+        values[6] = consumer_lag_ms_.load();
+        values[7] = pacing_pauses_.load();
+    });
+}
+
+std::vector<llama_token> LlamaInference::tokenize(const std::string& text, bool add_special) {
+    // Get vocab from model (new b7263+ API)
+    const llama_vocab* vocab = llama_model_get_vocab(model_);
+
+    int32_t n_tokens_max = static_cast<int32_t>(text.length()) + 2;
+    std::vector<llama_token> tokens(n_tokens_max);
+
+    // New API: llama_tokenize(vocab, text, text_len, tokens, n_tokens_max, add_special, parse_special)
+    int32_t n_tokens = llama_tokenize(
+        vocab,
+        text.c_str(),
+        static_cast<int32_t>(text.length()),
+        tokens.data(),
+        n_tokens_max,
+        add_special,
+        false  // parse_special
+    );
+
+    if (n_tokens < 0) {
+        // Buffer too small, resize and retry
+        tokens.resize(-n_tokens);
+        n_tokens = llama_tokenize(
+            vocab,
+            text.c_str(),
+            static_cast<int32_t>(text.length()),
+            tokens.data(),
+            static_cast<int32_t>(tokens.size()),
+            add_special,
+            false
+        );
+    }
+
+    tokens.resize(std::max(0, n_tokens));
+    return tokens;
+}
+
+std::string LlamaInference::detokenize(llama_token token) {
     // Get vocab from model (new b7263+ API)
     const llama_vocab* vocab = llama_model_get_vocab(model_);
 
@@ -308,6 +1750,260 @@ void LlamaInference::resetContext() {
             llama_memory_clear(memory, true);
         }
     }
+
+    for (const auto& entry : sessions_) {
+        if (entry.second.has_snapshot) {
+            std::remove(snapshotPath(entry.first).c_str());
+        }
+    }
+    sessions_.clear();
+    updateSessionCounts();
+    clearPrefixCache();
+
+    compaction_cancel_.store(true);
+    compaction_tokens_ = 0;
+}
+
+void LlamaInference::clearPrefixCache() {
+    if (!prefix_cache_) {
+        return;
+    }
+    if (context_ != nullptr) {
+        llama_memory_t memory = llama_get_memory(context_);
+        llama_seq_id slot;
+        while ((slot = prefix_cache_->evictLeastRecent()) >= 0) {
+            llama_memory_seq_rm(memory, slot, -1, -1);
+        }
+    }
+    prefix_cache_->clear();
+    updatePrefixCacheStats();
+}
+
+bool LlamaInference::switchSession(const std::string& session_id) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    if (!is_loaded_.load()) {
+        LOGE("Cannot switch session: model not loaded");
+        return false;
+    }
+
+    if (is_hibernated_.load() && !resumeLocked()) {
+        return false;
+    }
+
+    active_session_ = session_id;
+    Session* session = acquireSession(session_id);
+    if (session == nullptr) {
+        LOGE("Failed to make session '%s' resident", session_id.c_str());
+        return false;
+    }
+
+    updateSessionCounts();
+    LOGI("Switched to session '%s' (seq %d, %zu tokens resident)",
+         session_id.c_str(), session->seq_id, session->tokens.size());
+    return true;
+}
+
+void LlamaInference::dropSession(const std::string& session_id) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end()) {
+        return;
+    }
+
+    if (it->second.seq_id >= 0 && context_ != nullptr) {
+        llama_memory_seq_rm(llama_get_memory(context_), it->second.seq_id, -1, -1);
+    }
+    if (it->second.has_snapshot) {
+        std::remove(snapshotPath(session_id).c_str());
+    }
+    sessions_.erase(it);
+    updateSessionCounts();
+    LOGI("Dropped session '%s'", session_id.c_str());
+}
+
+int32_t LlamaInference::trimSessions(int32_t max_resident) {
+    std::lock_guard<std::mutex> lock(generation_mutex_);
+
+    int32_t resident = 0;
+    for (const auto& entry : sessions_) {
+        if (entry.second.seq_id >= 0) {
+            resident++;
+        }
+    }
+
+    int32_t evicted = 0;
+    while (resident > std::max(0, max_resident) && evictLeastRecentSession(active_session_)) {
+        resident--;
+        evicted++;
+    }
+
+    updateSessionCounts();
+    LOGI("Trimmed %d sessions, %d resident", evicted, resident);
+    return evicted;
+}
+
+SessionStats LlamaInference::getSessionStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return session_stats_;
+}
+
+LlamaInference::Session* LlamaInference::acquireSession(const std::string& session_id) {
+    Session& session = sessions_[session_id];
+    session.last_used = ++session_clock_;
+
+    if (session.seq_id >= 0) {
+        return &session;
+    }
+
+    llama_seq_id seq = allocateSequence(session_id);
+    if (seq < 0) {
+        return nullptr;
+    }
+    session.seq_id = seq;
+    session.tokens.clear();
+
+    if (session.has_snapshot) {
+        // Restore the evicted KV state instead of re-prefilling it
+        const std::string path = snapshotPath(session_id);
+        std::vector<llama_token> restored(llama_n_ctx(context_));
+        size_t n_restored = 0;
+        if (llama_state_seq_load_file(context_, path.c_str(), seq,
+                                      restored.data(), restored.size(), &n_restored) > 0) {
+            restored.resize(n_restored);
+            session.tokens = std::move(restored);
+            LOGI("Restored session '%s' from snapshot (%zu tokens)",
+                 session_id.c_str(), n_restored);
+            std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+            session_stats_.restores++;
+        } else {
+            LOGW("Failed to restore session '%s', starting empty", session_id.c_str());
+            llama_memory_seq_rm(llama_get_memory(context_), seq, -1, -1);
+        }
+        std::remove(path.c_str());
+        session.has_snapshot = false;
+    }
+
+    return &session;
+}
+
+llama_seq_id LlamaInference::allocateSequence(const std::string& keep_id) {
+    const int32_t n_seq = std::max(1, config_.max_sessions);
+
+    for (;;) {
+        std::vector<bool> used(n_seq, false);
+        for (const auto& entry : sessions_) {
+            if (entry.second.seq_id >= 0) {
+                used[entry.second.seq_id] = true;
+            }
+        }
+        for (int32_t seq = 0; seq < n_seq; ++seq) {
+            if (!used[seq]) {
+                return seq;
+            }
+        }
+        if (!evictLeastRecentSession(keep_id)) {
+            return -1;
+        }
+    }
+}
+
+bool LlamaInference::evictLeastRecentSession(const std::string& keep_id) {
+    auto victim = sessions_.end();
+    for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+        if (it->first == keep_id || it->second.seq_id < 0) {
+            continue;
+        }
+        if (victim == sessions_.end() || it->second.last_used < victim->second.last_used) {
+            victim = it;
+        }
+    }
+
+    if (victim == sessions_.end()) {
+        return false;
+    }
+
+    evictSession(victim->first, victim->second);
+    return true;
+}
+
+void LlamaInference::evictSession(const std::string& session_id, Session& session) {
+    if (!config_.session_cache_dir.empty() && !session.tokens.empty()) {
+        const std::string path = snapshotPath(session_id);
+        size_t written = llama_state_seq_save_file(
+            context_, path.c_str(), session.seq_id,
+            session.tokens.data(), session.tokens.size());
+        session.has_snapshot = written > 0;
+        if (!session.has_snapshot) {
+            LOGW("Failed to snapshot session '%s'", session_id.c_str());
+        }
+    }
+
+    llama_memory_seq_rm(llama_get_memory(context_), session.seq_id, -1, -1);
+    LOGD("Evicted session '%s' from seq %d (%zu tokens, snapshot=%d)",
+         session_id.c_str(), session.seq_id, session.tokens.size(), session.has_snapshot);
+
+    session.seq_id = -1;
+    session.tokens.clear();
+    session.tokens.shrink_to_fit();
+
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    session_stats_.evictions++;
+}
+
+void LlamaInference::ensureKvBudget(int32_t n_needed, const std::string& keep_id) {
+    const int32_t n_ctx = static_cast<int32_t>(llama_n_ctx(context_));
+
+    for (;;) {
+        int32_t n_used = compaction_tokens_;
+        n_used += prefix_cache_ ? prefix_cache_->cachedTokens() : 0;
+        for (const auto& entry : sessions_) {
+            if (entry.first != keep_id && entry.second.seq_id >= 0) {
+                n_used += static_cast<int32_t>(entry.second.tokens.size());
+            }
+        }
+        if (n_used + n_needed <= n_ctx) {
+            return;
+        }
+
+        // Cached prefixes are cheaper to lose than a session's conversation
+        llama_seq_id slot = prefix_cache_ ? prefix_cache_->evictLeastRecent() : -1;
+        if (slot >= 0) {
+            llama_memory_seq_rm(llama_get_memory(context_), slot, -1, -1);
+            updatePrefixCacheStats();
+            continue;
+        }
+        if (!evictLeastRecentSession(keep_id)) {
+            return;
+        }
+    }
+}
+
+void LlamaInference::updateSessionCounts() {
+    int32_t resident = 0;
+    int32_t snapshots = 0;
+    for (const auto& entry : sessions_) {
+        resident += entry.second.seq_id >= 0 ? 1 : 0;
+        snapshots += entry.second.has_snapshot ? 1 : 0;
+    }
+
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    session_stats_.resident_sessions = resident;
+    session_stats_.snapshot_sessions = snapshots;
+}
+
+void LlamaInference::updatePrefixCacheStats() {
+    const PrefixCacheStats stats = prefix_cache_ ? prefix_cache_->stats() : PrefixCacheStats();
+
+    std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+    prefix_cache_stats_ = stats;
+}
+
+std::string LlamaInference::snapshotPath(const std::string& session_id) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/session_%016zx.kv", std::hash<std::string>{}(session_id));
+    return config_.session_cache_dir + name;
 }
 
 } // namespace unamentis
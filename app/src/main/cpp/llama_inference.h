@@ -12,8 +12,21 @@
 #include <vector>
 #include <functional>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include "llama.h"
+#include "cascade_model.h"
+#include "compute_pool.h"
+#include "prefix_cache.h"
+#include "shared_model.h"
+#include "response_cache.h"
+#include "stop_sequence_matcher.h"
+#include "telemetry_block.h"
+#include "thread_policy.h"
 
 namespace unamentis {
 
@@ -26,6 +39,147 @@ struct LlamaConfig {
     int32_t n_threads = 4;             // Number of CPU threads
     float temperature = 0.7f;          // Sampling temperature
     int32_t max_tokens = 512;          // Maximum tokens to generate
+
+    // Prompt-lookup speculative decoding (no draft model)
+    bool lookup_decoding = false;      // Draft from n-grams already in prompt/output
+    int32_t lookup_ngram_min = 2;      // Shortest suffix n-gram to match
+    int32_t lookup_ngram_max = 4;      // Longest suffix n-gram to match
+    int32_t lookup_draft_max = 8;      // Maximum draft tokens verified per decode
+
+    // Warm session pool (one KV sequence per learner session)
+    int32_t max_sessions = 1;          // Sessions kept resident in the context
+    std::string session_cache_dir;     // Snapshot directory for evicted sessions ("" = discard)
+
+    // Shared prompt-prefix cache (radix tree over extra KV sequences)
+    int32_t prefix_cache_slots = 0;    // Cached prompts kept resident (0 = disabled)
+    int32_t prefix_cache_min_tokens = 32; // Shorter prompts are not worth a slot
+
+    // Precomputed KV for curriculum documents
+    std::string document_cache_dir;    // Persistent directory for document KV ("" = disabled)
+};
+
+/**
+ * Speculation counters for prompt-lookup decoding.
+ * Accumulated across generate() calls until reset.
+ */
+struct LookupStats {
+    int64_t drafted_tokens = 0;        // Draft tokens submitted for verification
+    int64_t accepted_tokens = 0;       // Draft tokens that matched the model
+    int64_t decode_calls = 0;          // llama_decode calls during generation
+    int64_t generated_tokens = 0;      // Tokens emitted during generation
+
+    float acceptanceRate() const {
+        return drafted_tokens > 0
+            ? static_cast<float>(accepted_tokens) / static_cast<float>(drafted_tokens)
+            : 0.0f;
+    }
+};
+
+/**
+ * Session pool counters.
+ */
+struct SessionStats {
+    int32_t resident_sessions = 0;     // Sessions whose KV is in the context
+    int32_t snapshot_sessions = 0;     // Sessions evicted to a disk snapshot
+    int64_t prefill_tokens = 0;        // Prompt tokens decoded
+    int64_t reused_tokens = 0;         // Prompt tokens served from resident KV
+    int64_t evictions = 0;             // Sessions evicted from the context
+    int64_t restores = 0;              // Sessions restored from a snapshot
+};
+
+/**
+ * Precomputed document counters.
+ */
+struct DocumentStats {
+    int32_t registered_documents = 0;  // Documents available for splicing
+    int64_t precomputed_tokens = 0;    // Document tokens prefilled to build KV files
+    int64_t splices = 0;               // Prompts that loaded a document block
+    int64_t spliced_tokens = 0;        // Prompt tokens loaded instead of prefilled
+    int64_t last_splice_us = 0;        // Time to load and place the last block
+};
+
+/**
+ * Background conversation compaction counters.
+ */
+struct CompactionStats {
+    int64_t compactions = 0;           // Completed compactions
+    int64_t aborted = 0;               // Compactions cancelled or failed
+    int64_t summarized_tokens = 0;     // Summarization prompt tokens prefilled
+    int64_t summary_tokens = 0;        // Summary tokens generated
+    int64_t rebuilt_tokens = 0;        // Compacted prefix tokens prefilled into sessions
+    int64_t yields = 0;                // Steps deferred to a foreground request
+    int64_t last_compaction_ms = 0;    // Wall time of the last completed compaction
+};
+
+/**
+ * Weight sharing with the ASR decoder.
+ */
+struct SharedModelStats {
+    int32_t model_users = 0;           // Engines holding the loaded weights (2 when shared)
+    int64_t yields = 0;                // Decode steps paused for ASR
+    int64_t yield_us = 0;              // Time spent paused for ASR
+};
+
+/**
+ * Timing and footprint of the last hot model swap.
+ */
+struct SwapStats {
+    int64_t swaps = 0;                 // Completed swaps
+    int64_t load_us = 0;               // Background load of the replacement
+    int64_t handover_us = 0;           // Time requests were blocked during the switch
+    int64_t overlap_bytes = 0;         // Peak weights + state resident while both models were loaded
+};
+
+/**
+ * Pacing of generation to a slower consumer such as TTS playback.
+ *
+ * Decoding pauses while the consumer holds more than the high watermark
+ * of unspoken output and resumes once it drains below the low one.
+ *
+ * A paused generation keeps the generation lock. Every call that takes
+ * it (loadModel, swapModel, unloadModel, hibernate, resume, reconfigure,
+ * generate, precomputeDocument, removeDocument, compaction,
+ * load/unloadCascadeModel, setStopSequences, setLookupDecoding,
+ * switchSession, dropSession, trimSessions) blocks until the pause ends:
+ * until the lag drains below the low watermark, pacing is disabled, or
+ * stopGeneration() or bargeIn() is called. Call stopGeneration() first
+ * to get the lock without waiting for playback.
+ */
+struct PacingConfig {
+    float high_watermark_s = 0.0f;       // Queued seconds that pause decoding (0 = disabled)
+    float low_watermark_s = 0.0f;        // Queued seconds at which decoding resumes
+    float speech_tokens_per_second = 3.5f; // Spoken rate, used to estimate discarded tokens
+};
+
+/**
+ * Back-pressure and barge-in counters.
+ */
+struct PacingStats {
+    int64_t pauses = 0;                // Times decoding waited for the consumer
+    int64_t paused_us = 0;             // Total time spent waiting
+    int64_t barge_ins = 0;             // Interruptions reported by the consumer
+    int64_t discarded_tokens = 0;      // Estimated generated-but-unspoken tokens at barge-in
+    int64_t generated_tokens = 0;      // Tokens emitted, for the discarded ratio
+};
+
+/**
+ * Timing of the last context reconfiguration.
+ */
+struct ReconfigureStats {
+    int64_t reconfigures = 0;          // Context rebuilds without a model reload
+    int64_t carried_tokens = 0;        // Active session tokens kept across the last rebuild
+    int64_t reconfigure_us = 0;        // Time the last rebuild took
+};
+
+/**
+ * Footprint and timing of the last hibernate/resume cycle.
+ */
+struct HibernateStats {
+    int64_t state_bytes = 0;           // Context state (KV cache) released by hibernate
+    int64_t model_bytes = 0;           // Weight bytes that stayed mapped
+    int32_t snapshotted_sessions = 0;  // Sessions saved to disk on hibernate
+    int64_t hibernate_us = 0;          // Time spent hibernating
+    int64_t resume_us = 0;             // Time spent recreating the context
 };
 
 /**
@@ -106,27 +260,491 @@ public:
      */
     bool isGenerating() const { return is_generating_.load(); }
 
+    /**
+     * Configure pacing of generation to the consumer's playback. While a
+     * generation is paused, calls that need the generation lock wait for
+     * it (see PacingConfig).
+     */
+    void configurePacing(const PacingConfig& config);
+
+    /**
+     * Report how many seconds of generated output the consumer has yet to
+     * play. The estimate drains in real time between reports, so a
+     * consumer that stops reporting never stalls generation.
+     * Safe to call from any thread.
+     */
+    void reportConsumerLag(float queued_seconds);
+
+    /**
+     * The user interrupted playback: count the output that will never be
+     * spoken and stop generating.
+     * Safe to call from any thread.
+     */
+    void bargeIn();
+
+    /**
+     * Get back-pressure and barge-in counters.
+     */
+    PacingStats getPacingStats();
+
+    /**
+     * Publish live counters into shared memory (see telemetry_block.h), or
+     * stop publishing when memory is null. Fields, in order:
+     * [state (0 unloaded, 1 idle, 2 prefilling, 3 decoding, 4 paused for
+     *  playback, 5 hibernated), responseTokens, milliTokensPerSecond,
+     *  totalTokens, generations, promptTokens, consumerLagMs, pacingPauses]
+     * The response fields describe the current generation, or the last one
+     * while idle; the rate is measured from the first token.
+     *
+     * @return false if the memory can't hold the block
+     */
+    bool attachTelemetry(void* memory, size_t capacity);
+
+    static constexpr int32_t kTelemetryFields = 8;
+
+    /**
+     * Replace the loaded model without an unavailable period.
+     *
+     * The replacement model and context are loaded on the calling thread
+     * while the current model keeps serving. The switch then happens
+     * between requests: an in-flight generation finishes first, and the
+     * old model is released right after. Sessions, cached prefixes and
+     * responses, documents and any cascade model are dropped because they
+     * belong to the old weights; context settings are kept.
+     *
+     * @param model_path Path to the replacement .gguf file
+     * @param stop_sequences Stop strings for the new model's prompt format
+     * @return true if the new model is serving
+     */
+    bool swapModel(const std::string& model_path, const std::vector<std::string>& stop_sequences);
+
+    /**
+     * Get timing and footprint of the last model swap.
+     */
+    SwapStats getSwapStats();
+
+    /**
+     * Change the context size and/or thread count without reloading weights.
+     *
+     * A thread change alone applies immediately. A new context size
+     * recreates only the llama_context: the active session's KV is
+     * carried over when it fits, other resident sessions are snapshotted
+     * (or forgotten without a session cache) and cached prefixes are
+     * dropped.
+     *
+     * @param context_size New context window (<= 0 keeps the current one)
+     * @param n_threads New thread count (<= 0 keeps the current one)
+     * @return true if the new settings are in effect
+     */
+    bool reconfigure(int32_t context_size, int32_t n_threads);
+
+    /**
+     * Get timing of the last context reconfiguration.
+     */
+    ReconfigureStats getReconfigureStats();
+
+    /**
+     * Release the context (KV cache and compute buffers) but keep the model.
+     *
+     * The weights stay mmap'd, so under memory pressure the kernel can drop
+     * their clean pages without a full reload. Resident sessions are
+     * snapshotted to session_cache_dir when requested, otherwise forgotten.
+     * generate() and switchSession() resume automatically.
+     *
+     * @param snapshot_sessions Save resident session KV to disk first
+     * @return true if the engine was hibernated by this call
+     */
+    bool hibernate(bool snapshot_sessions);
+
+    /**
+     * Recreate the context after hibernate(). Sessions are restored lazily.
+     *
+     * @return true if the context is ready
+     */
+    bool resume();
+
+    /**
+     * Check if the engine is hibernated.
+     */
+    bool isHibernated() const { return is_hibernated_.load(); }
+
+    /**
+     * Get footprint and timing of the last hibernate/resume cycle.
+     */
+    HibernateStats getHibernateStats();
+
     /**
      * Get the context size of the loaded model.
      */
     int32_t getContextSize() const { return config_.context_size; }
 
+    /**
+     * Make a session the target of subsequent generate() calls.
+     *
+     * Each session owns a KV sequence in the shared context. generate()
+     * only prefills the part of the prompt that differs from what the
+     * session already holds, so switching back to a resident session
+     * costs no prefill. When the pool is full, or the context runs out of
+     * room, the least recently used session is snapshotted to
+     * session_cache_dir and evicted; it is restored from disk on return.
+     *
+     * @param session_id Caller-defined session key ("" is the default session)
+     * @return true if the session is resident and ready
+     */
+    bool switchSession(const std::string& session_id);
+
+    /**
+     * Forget a session and its snapshot.
+     */
+    void dropSession(const std::string& session_id);
+
+    /**
+     * Evict least recently used sessions until at most max_resident remain.
+     * The active session is never evicted. Intended for memory pressure.
+     *
+     * @return Number of sessions evicted
+     */
+    int32_t trimSessions(int32_t max_resident);
+
+    /**
+     * Get session pool counters.
+     */
+    SessionStats getSessionStats();
+
+    /**
+     * Precompute and persist the KV state of a curriculum document.
+     *
+     * The KV file is keyed by a hash of the text and of the loaded model, so
+     * it is reused across sessions and app restarts and rebuilt only when
+     * either changes. Once registered, any prompt passed to generate() that
+     * contains the document text verbatim loads this block from disk at the
+     * document's position instead of prefilling it.
+     *
+     * Each block is computed on its own, so document tokens don't attend to
+     * the text before them; the text after the document attends normally.
+     *
+     * @param text Document text exactly as it will appear in prompts
+     * @return Document key, or "" on failure
+     */
+    std::string precomputeDocument(const std::string& text);
+
+    /**
+     * Unregister a document and delete its KV file.
+     */
+    void removeDocument(const std::string& key);
+
+    /**
+     * Get precomputed document counters.
+     */
+    DocumentStats getDocumentStats();
+
+    /**
+     * Summarize old conversation turns and rebuild a session's KV for the
+     * compacted prompt.
+     *
+     * Meant to run on a background thread between turns. The work is done
+     * in short steps (a prefill chunk of at most 32 tokens or one summary
+     * token each) on half the decode threads; a generate() call that
+     * arrives in the meantime waits for at most the current step and runs
+     * before the next one. Only the calling thread's priority is lowered;
+     * the pool workers doing the decode run at normal priority. The summary
+     * is produced in a dedicated sequence with greedy decoding, then
+     * prefix_before + summary + prefix_after is prefilled into the session
+     * so the next turn starts from a short, warm prefix.
+     *
+     * @param session_id Session whose KV receives the compacted prefix
+     * @param summary_prompt Formatted prompt asking for the summary
+     * @param prefix_before Compacted prompt text before the summary
+     * @param prefix_after Compacted prompt text after the summary
+     * @param max_summary_tokens Summary length limit
+     * @return Summary text, or "" if cancelled or failed
+     */
+    std::string compactSession(
+        const std::string& session_id,
+        const std::string& summary_prompt,
+        const std::string& prefix_before,
+        const std::string& prefix_after,
+        int32_t max_summary_tokens
+    );
+
+    /**
+     * Cancel a running compaction at its next step.
+     * Safe to call from any thread.
+     */
+    void cancelCompaction();
+
+    /**
+     * Get background compaction counters.
+     */
+    CompactionStats getCompactionStats();
+
+    /**
+     * Get weight-sharing counters.
+     *
+     * Loading the GGUF that GLMASRDecoder already uses shares its weights
+     * instead of loading a second copy; generation then pauses between
+     * tokens whenever the decoder is transcribing.
+     */
+    SharedModelStats getSharedModelStats();
+
+    /**
+     * Load a small model that answers first (small/large cascade).
+     *
+     * generate() runs the small model for a few probe tokens. If every
+     * probe token is likely enough and the mean entropy is low, the small
+     * model finishes the answer; otherwise the probe is discarded and the
+     * loaded (large) model answers from the same prompt tokens.
+     *
+     * @param model_path Small GGUF sharing the large model's vocabulary
+     * @param config Context settings and escalation thresholds
+     * @return true if loaded and compatible
+     */
+    bool loadCascadeModel(const std::string& model_path, const CascadeConfig& config);
+
+    /**
+     * Unload the cascade model; every request goes to the large model.
+     */
+    void unloadCascadeModel();
+
+    /**
+     * Get cascade counters.
+     */
+    CascadeStats getCascadeStats();
+
+    /**
+     * Get prompt-prefix cache counters.
+     */
+    PrefixCacheStats getPrefixCacheStats();
+
+    /**
+     * Configure the response cache in front of generate().
+     *
+     * Completed responses (ended by EOG or a stop string) are stored and
+     * replayed through the callback when the same prompt, or a query whose
+     * embedding is similar enough, is seen again in the same context.
+     *
+     * @param config Cache limits; max_entries == 0 disables caching
+     */
+    void configureResponseCache(const ResponseCacheConfig& config);
+
+    /**
+     * Set the context that cached responses belong to (e.g. curriculum topic).
+     * Changing it invalidates responses cached under the previous context.
+     */
+    void setResponseCacheContext(const std::string& context_key);
+
+    /**
+     * Provide an embedding of the next query for semantic cache lookup.
+     * Consumed by the next generate() call.
+     */
+    void setQueryEmbedding(const float* embedding, int32_t dim);
+
+    /**
+     * Get response cache counters.
+     */
+    ResponseCacheStats getResponseCacheStats() { return response_cache_.stats(); }
+
+    /**
+     * Set strings that terminate generation when they appear in the output.
+     *
+     * Matching runs on the detokenized byte stream, so a stop string split
+     * across tokens ends generation on the token that completes it. The stop
+     * string itself and anything after it are never emitted, and only the
+     * bytes that might begin a stop string are held back from the callback.
+     *
+     * @param stop_sequences Stop strings (empty clears them)
+     */
+    void setStopSequences(const std::vector<std::string>& stop_sequences);
+
+    /**
+     * Enable or disable prompt-lookup speculative decoding.
+     *
+     * When enabled, generate() proposes continuations by matching the
+     * recent suffix against n-grams from the prompt and prior output,
+     * and verifies up to draft_max tokens per llama_decode. Output is
+     * identical to plain greedy decoding.
+     *
+     * @param enabled Whether to speculate
+     * @param ngram_max Longest suffix n-gram to match
+     * @param draft_max Maximum draft tokens per verification step
+     */
+    void setLookupDecoding(bool enabled, int32_t ngram_max, int32_t draft_max);
+
+    /**
+     * Get speculation counters accumulated since the last reset.
+     */
+    LookupStats getLookupStats();
+
+    /**
+     * Reset speculation counters.
+     */
+    void resetLookupStats();
+
 private:
     // llama.cpp state
+    std::shared_ptr<SharedModel> shared_model_;  // Weights, possibly shared with GLMASRDecoder
     llama_model* model_ = nullptr;
     llama_context* context_ = nullptr;
     LlamaConfig config_;
 
     // Thread-safety state
     std::atomic<bool> is_loaded_{false};
+    std::atomic<bool> is_hibernated_{false};
     std::atomic<bool> is_generating_{false};
     std::atomic<bool> stop_requested_{false};
+    std::atomic<bool> is_swapping_{false};
     std::mutex generation_mutex_;
 
+    // Consumer back-pressure; the lag is as reported at lag_reported_at_
+    PacingConfig pacing_config_;
+    float consumer_lag_s_ = 0.0f;
+    std::chrono::steady_clock::time_point lag_reported_at_;
+    std::atomic<int32_t> response_tokens_{0};
+    std::mutex pacing_mutex_;
+    std::condition_variable pacing_cv_;
+
+    // Background compaction yields while foreground requests wait for the lock
+    std::atomic<int32_t> foreground_waiters_{0};
+    std::atomic<bool> compaction_cancel_{false};
+    int32_t compaction_tokens_ = 0;            // KV reserved by the compaction sequence (generation_mutex_)
+
+    // Stop strings checked against streamed output (guarded by generation_mutex_)
+    StopSequenceMatcher stop_matcher_;
+
+    // Cached responses (internally synchronized)
+    ResponseCache response_cache_;
+
+    // Embedding for the next query (guarded by query_mutex_)
+    std::vector<float> query_embedding_;
+    std::mutex query_mutex_;
+
+    // Session pool (guarded by generation_mutex_)
+    struct Session {
+        llama_seq_id seq_id = -1;              // -1 when not resident
+        std::vector<llama_token> tokens;       // Tokens whose KV is in seq_id
+        uint64_t last_used = 0;                // LRU clock value
+        bool has_snapshot = false;             // Evicted state saved on disk
+    };
+    std::map<std::string, Session> sessions_;
+    std::string active_session_;
+    uint64_t session_clock_ = 0;
+
+    // Cached prompt prefixes in sequences after the session pool (guarded by generation_mutex_)
+    std::unique_ptr<PrefixCache> prefix_cache_;
+
+    // Registered documents by key (guarded by generation_mutex_)
+    struct Document {
+        std::string text;
+        std::vector<llama_token> tokens;       // Tokenized without BOS, as stored in the KV file
+    };
+    std::map<std::string, Document> documents_;
+    std::string model_fingerprint_;
+
+    // Location of a registered document inside a tokenized prompt
+    struct DocumentSplice {
+        const Document* document = nullptr;
+        std::string key;
+        size_t start = 0;                      // Prompt position of the first document token
+        size_t length = 0;                     // Document tokens to load
+    };
+
+    // Small first-pass model (guarded by generation_mutex_)
+    std::unique_ptr<CascadeModel> cascade_;
+
+    // Live counters published to telemetry_ (see attachTelemetry)
+    enum class Phase : int32_t { IDLE = 1, PREFILL = 2, DECODE = 3, PAUSED = 4 };
+    TelemetryBlock telemetry_;
+    std::atomic<int32_t> phase_{static_cast<int32_t>(Phase::IDLE)};
+    std::atomic<int64_t> first_token_us_{0};
+    std::atomic<int64_t> tokens_per_s_milli_{0};
+    std::atomic<int64_t> total_tokens_{0};
+    std::atomic<int64_t> generations_{0};
+    std::atomic<int32_t> prompt_tokens_{0};
+    std::atomic<int32_t> consumer_lag_ms_{0};
+    std::atomic<int64_t> pacing_pauses_{0};
+
+    // Speculation and session counters (guarded by stats_mutex_)
+    LookupStats lookup_stats_;
+    SessionStats session_stats_;
+    HibernateStats hibernate_stats_;
+    DocumentStats document_stats_;
+    CompactionStats compaction_stats_;
+    SharedModelStats shared_model_stats_;
+    CascadeStats cascade_stats_;
+    SwapStats swap_stats_;
+    ReconfigureStats reconfigure_stats_;
+    PacingStats pacing_stats_;
+    PrefixCacheStats prefix_cache_stats_;      // Copy of prefix_cache_->stats() (see updatePrefixCacheStats)
+    std::mutex stats_mutex_;
+
+    // Compute a generation holds; pacing pauses hand it back while waiting
+    struct ComputeTurn {
+        std::optional<ComputeLoadScope> load;
+        std::optional<ComputeLease> lease;
+    };
+
     // Helper methods
     std::vector<llama_token> tokenize(const std::string& text, bool add_special);
     std::string detokenize(llama_token token);
     void resetContext();
+    bool createContext();
+    void attachThreadpool(ggml_threadpool* pool);
+    ComputeLease leaseThreadpool(int32_t n_threads);
+    void holdCompute(ComputeTurn& turn);
+    llama_context* newContext(llama_model* model, const LlamaConfig& config) const;
+    static std::string modelFingerprint(const std::string& model_path, const llama_model* model);
+    void unloadModelLocked();
+    bool resumeLocked();
+
+    // Session pool helpers (generation_mutex_ held)
+    Session* acquireSession(const std::string& session_id);
+    llama_seq_id allocateSequence(const std::string& keep_id);
+    bool evictLeastRecentSession(const std::string& keep_id);
+    void evictSession(const std::string& session_id, Session& session);
+    void ensureKvBudget(int32_t n_needed, const std::string& keep_id);
+    void clearPrefixCache();
+    void yieldToAsr();
+    void paceToConsumer(ComputeTurn& turn);
+    void setPhase(Phase phase);
+    void recordToken(int32_t response_tokens);
+    void publishTelemetry();
+
+    /**
+     * Answer with the cascade model unless its probe is unsure.
+     *
+     * @return true if the small model answered (output went through emit)
+     */
+    bool runCascade(
+        const std::vector<llama_token>& tokens,
+        int32_t max_tokens,
+        const std::function<bool(const std::string&)>& emit,
+        bool& finished,
+        bool& stop_matched,
+        ComputeTurn& turn
+    );
+
+    // Document helpers (generation_mutex_ held)
+    std::vector<llama_token> tokenizePrompt(const std::string& prompt, DocumentSplice& splice);
+    bool spliceDocument(const DocumentSplice& splice, llama_seq_id seq);
+    std::string documentPath(const std::string& key) const;
+    llama_seq_id scratchSequence() const;
+
+    // Compaction helpers
+    llama_seq_id compactionSequence() const { return scratchSequence() + 1; }
+    bool runCompactionStep(const std::function<bool()>& step);
+
+    /**
+     * Decode tokens[from, to) into seq in chunks of at most n_batch.
+     *
+     * @param logits_idx If non-null, request logits for the last token and
+     *                   receive its index in the final chunk
+     * @return true on success (an empty range succeeds)
+     */
+    bool prefill(llama_seq_id seq, const std::vector<llama_token>& tokens,
+                 size_t from, size_t to, int32_t* logits_idx);
+    std::string snapshotPath(const std::string& session_id) const;
+    void updateSessionCounts();
+    void updatePrefixCacheStats();
 };
 
 } // namespace unamentis
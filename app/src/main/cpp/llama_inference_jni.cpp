@@ -3,10 +3,14 @@
 
 #include <jni.h>
 #include <android/log.h>
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 #include "llama_inference.h"
+#include "telemetry_jni.h"
 
 #define LOG_TAG "LlamaInferenceJNI"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -22,6 +26,9 @@ static JavaVM* g_jvm = nullptr;
 static std::map<jlong, std::shared_ptr<unamentis::LlamaInference>> g_engines;
 static std::mutex g_engines_mutex;
 
+// Buffers engines publish live counters into
+static unamentis::TelemetryBuffers g_telemetry_buffers;
+
 // Callback context for token streaming
 struct TokenCallbackContext {
     jobject callback_object;
@@ -80,6 +87,46 @@ static JNIEnv* getJNIEnv(bool* needs_detach) {
     return env;
 }
 
+// Look up an engine and take a reference that keeps it alive for the call
+static std::shared_ptr<unamentis::LlamaInference> findEngine(jlong context_ptr) {
+    if (context_ptr == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(g_engines_mutex);
+    auto it = g_engines.find(context_ptr);
+    return it != g_engines.end() ? it->second : nullptr;
+}
+
+// Copy a Java string into a std::string (empty for null)
+static std::string toStdString(JNIEnv* env, jstring j_str) {
+    if (j_str == nullptr) {
+        return std::string();
+    }
+    const char* cstr = env->GetStringUTFChars(j_str, nullptr);
+    std::string result(cstr);
+    env->ReleaseStringUTFChars(j_str, cstr);
+    return result;
+}
+
+// Copy a Java String[] into a vector, skipping null elements
+static std::vector<std::string> toStringVector(JNIEnv* env, jobjectArray j_array) {
+    std::vector<std::string> result;
+    if (j_array == nullptr) {
+        return result;
+    }
+    jsize count = env->GetArrayLength(j_array);
+    result.reserve(count);
+    for (jsize i = 0; i < count; ++i) {
+        auto j_str = static_cast<jstring>(env->GetObjectArrayElement(j_array, i));
+        if (j_str == nullptr) {
+            continue;
+        }
+        result.push_back(toStdString(env, j_str));
+        env->DeleteLocalRef(j_str);
+    }
+    return result;
+}
+
 // Load model
 extern "C" JNIEXPORT jlong JNICALL
 Java_com_unamentis_services_llm_OnDeviceLLMService_nativeLoadModel(
@@ -88,14 +135,16 @@ Java_com_unamentis_services_llm_OnDeviceLLMService_nativeLoadModel(
     jstring model_path,
     jint context_size,
     jint gpu_layers,
-    jint n_threads
+    jint n_threads,
+    jint max_sessions,
+    jstring session_cache_dir,
+    jint prefix_cache_slots,
+    jstring document_cache_dir
 ) {
-    const char* path_cstr = env->GetStringUTFChars(model_path, nullptr);
-    std::string path(path_cstr);
-    env->ReleaseStringUTFChars(model_path, path_cstr);
+    std::string path = toStdString(env, model_path);
 
-    LOGI("nativeLoadModel: path=%s, ctx=%d, gpu=%d, threads=%d",
-         path.c_str(), context_size, gpu_layers, n_threads);
+    LOGI("nativeLoadModel: path=%s, ctx=%d, gpu=%d, threads=%d, sessions=%d, prefixes=%d",
+         path.c_str(), context_size, gpu_layers, n_threads, max_sessions, prefix_cache_slots);
 
     auto engine = std::make_shared<unamentis::LlamaInference>();
 
@@ -103,6 +152,10 @@ Java_com_unamentis_services_llm_OnDeviceLLMService_nativeLoadModel(
     config.context_size = context_size;
     config.gpu_layers = gpu_layers;
     config.n_threads = n_threads;
+    config.max_sessions = max_sessions;
+    config.session_cache_dir = toStdString(env, session_cache_dir);
+    config.prefix_cache_slots = prefix_cache_slots;
+    config.document_cache_dir = toStdString(env, document_cache_dir);
 
     if (!engine->loadModel(path, config)) {
         LOGE("Failed to load model");
@@ -243,7 +296,7 @@ Java_com_unamentis_services_llm_OnDeviceLLMService_nativeStopGeneration(
 // Free model
 extern "C" JNIEXPORT void JNICALL
 Java_com_unamentis_services_llm_OnDeviceLLMService_nativeFreeModel(
-    JNIEnv* /* env */,
+    JNIEnv* env,
     jobject /* thiz */,
     jlong context_ptr
 ) {
@@ -251,12 +304,22 @@ Java_com_unamentis_services_llm_OnDeviceLLMService_nativeFreeModel(
         return;
     }
 
-    std::lock_guard<std::mutex> lock(g_engines_mutex);
-    auto it = g_engines.find(context_ptr);
-    if (it != g_engines.end()) {
+    std::shared_ptr<unamentis::LlamaInference> engine;
+    {
+        std::lock_guard<std::mutex> lock(g_engines_mutex);
+        auto it = g_engines.find(context_ptr);
+        if (it == g_engines.end()) {
+            return;
+        }
         LOGI("Freeing model for handle: %ld", static_cast<long>(context_ptr));
+        engine = it->second;
         g_engines.erase(it);
     }
+
+    // An in-flight generate() keeps the engine alive, so stop it publishing
+    // before its buffer can be collected
+    engine->attachTelemetry(nullptr, 0);
+    g_telemetry_buffers.release(env, context_ptr);
 }
 
 // Check if model is loaded
@@ -296,3 +359,760 @@ Java_com_unamentis_services_llm_OnDeviceLLMService_nativeIsGenerating(
     }
     return JNI_FALSE;
 }
+
+// Enable or disable prompt-lookup speculative decoding
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeSetLookupDecoding(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jboolean enabled,
+    jint ngram_max,
+    jint draft_max
+) {
+    if (context_ptr == 0) {
+        return;
+    }
+
+    std::shared_ptr<unamentis::LlamaInference> engine;
+    {
+        std::lock_guard<std::mutex> lock(g_engines_mutex);
+        auto it = g_engines.find(context_ptr);
+        if (it == g_engines.end()) {
+            return;
+        }
+        engine = it->second;
+    }
+
+    // Takes the generation lock, so call outside g_engines_mutex
+    engine->setLookupDecoding(enabled == JNI_TRUE, ngram_max, draft_max);
+}
+
+// Get speculation counters: [drafted, accepted, decodeCalls, generated]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetLookupStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[4] = {0, 0, 0, 0};
+
+    if (context_ptr != 0) {
+        std::lock_guard<std::mutex> lock(g_engines_mutex);
+        auto it = g_engines.find(context_ptr);
+        if (it != g_engines.end()) {
+            unamentis::LookupStats stats = it->second->getLookupStats();
+            values[0] = stats.drafted_tokens;
+            values[1] = stats.accepted_tokens;
+            values[2] = stats.decode_calls;
+            values[3] = stats.generated_tokens;
+        }
+    }
+
+    jlongArray result = env->NewLongArray(4);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 4, values);
+    }
+    return result;
+}
+
+// Set stop strings that end generation
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeSetStopSequences(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jobjectArray stop_sequences
+) {
+    if (context_ptr == 0) {
+        return;
+    }
+
+    std::vector<std::string> sequences = toStringVector(env, stop_sequences);
+
+    std::shared_ptr<unamentis::LlamaInference> engine;
+    {
+        std::lock_guard<std::mutex> lock(g_engines_mutex);
+        auto it = g_engines.find(context_ptr);
+        if (it == g_engines.end()) {
+            return;
+        }
+        engine = it->second;
+    }
+
+    engine->setStopSequences(sequences);
+}
+
+// Make a learner session the target of subsequent generations
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeSwitchSession(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring session_id
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return JNI_FALSE;
+    }
+    return engine->switchSession(toStdString(env, session_id)) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Forget a learner session and its snapshot
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeDropSession(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring session_id
+) {
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        engine->dropSession(toStdString(env, session_id));
+    }
+}
+
+// Evict least recently used sessions to disk
+extern "C" JNIEXPORT jint JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeTrimSessions(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jint max_resident
+) {
+    auto engine = findEngine(context_ptr);
+    return engine ? engine->trimSessions(max_resident) : 0;
+}
+
+// Get session counters:
+// [resident, snapshots, prefillTokens, reusedTokens, evictions, restores]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetSessionStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[6] = {0, 0, 0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::SessionStats stats = engine->getSessionStats();
+        values[0] = stats.resident_sessions;
+        values[1] = stats.snapshot_sessions;
+        values[2] = stats.prefill_tokens;
+        values[3] = stats.reused_tokens;
+        values[4] = stats.evictions;
+        values[5] = stats.restores;
+    }
+
+    jlongArray result = env->NewLongArray(6);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 6, values);
+    }
+    return result;
+}
+
+// Get prompt-prefix cache counters:
+// [hits, misses, reusedTokens, cachedPrompts, cachedTokens, evictions]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetPrefixCacheStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[6] = {0, 0, 0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::PrefixCacheStats stats = engine->getPrefixCacheStats();
+        values[0] = stats.hits;
+        values[1] = stats.misses;
+        values[2] = stats.reused_tokens;
+        values[3] = stats.cached_prompts;
+        values[4] = stats.cached_tokens;
+        values[5] = stats.evictions;
+    }
+
+    jlongArray result = env->NewLongArray(6);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 6, values);
+    }
+    return result;
+}
+
+// Precompute a document's KV block; returns its key or "" on failure
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativePrecomputeDocument(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring text
+) {
+    std::string key;
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        key = engine->precomputeDocument(toStdString(env, text));
+    }
+    return env->NewStringUTF(key.c_str());
+}
+
+// Unregister a document and delete its KV file
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeRemoveDocument(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring key
+) {
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        engine->removeDocument(toStdString(env, key));
+    }
+}
+
+// Get precomputed document counters:
+// [registeredDocuments, precomputedTokens, splices, splicedTokens, lastSpliceUs]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetDocumentStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[5] = {0, 0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::DocumentStats stats = engine->getDocumentStats();
+        values[0] = stats.registered_documents;
+        values[1] = stats.precomputed_tokens;
+        values[2] = stats.splices;
+        values[3] = stats.spliced_tokens;
+        values[4] = stats.last_splice_us;
+    }
+
+    jlongArray result = env->NewLongArray(5);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 5, values);
+    }
+    return result;
+}
+
+// Summarize old turns and rebuild the session KV; blocks, returns "" if cancelled
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeCompactSession(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring session_id,
+    jstring summary_prompt,
+    jstring prefix_before,
+    jstring prefix_after,
+    jint max_summary_tokens
+) {
+    std::string summary;
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        summary = engine->compactSession(
+            toStdString(env, session_id),
+            toStdString(env, summary_prompt),
+            toStdString(env, prefix_before),
+            toStdString(env, prefix_after),
+            max_summary_tokens);
+    }
+    return env->NewStringUTF(summary.c_str());
+}
+
+// Cancel a running compaction
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeCancelCompaction(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        engine->cancelCompaction();
+    }
+}
+
+// Get compaction counters:
+// [compactions, aborted, summarizedTokens, summaryTokens, rebuiltTokens, yields, lastCompactionMs]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetCompactionStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[7] = {0, 0, 0, 0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::CompactionStats stats = engine->getCompactionStats();
+        values[0] = stats.compactions;
+        values[1] = stats.aborted;
+        values[2] = stats.summarized_tokens;
+        values[3] = stats.summary_tokens;
+        values[4] = stats.rebuilt_tokens;
+        values[5] = stats.yields;
+        values[6] = stats.last_compaction_ms;
+    }
+
+    jlongArray result = env->NewLongArray(7);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 7, values);
+    }
+    return result;
+}
+
+// Get weight-sharing counters: [modelUsers, yields, yieldUs]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetSharedModelStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[3] = {0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::SharedModelStats stats = engine->getSharedModelStats();
+        values[0] = stats.model_users;
+        values[1] = stats.yields;
+        values[2] = stats.yield_us;
+    }
+
+    jlongArray result = env->NewLongArray(3);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 3, values);
+    }
+    return result;
+}
+
+// Load the small model of the small/large cascade
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeLoadCascadeModel(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring model_path,
+    jint context_size,
+    jint n_threads,
+    jint probe_tokens,
+    jfloat min_probability,
+    jfloat max_mean_entropy
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return JNI_FALSE;
+    }
+
+    unamentis::CascadeConfig config;
+    config.context_size = context_size;
+    config.n_threads = n_threads;
+    config.probe_tokens = probe_tokens;
+    config.min_probability = min_probability;
+    config.max_mean_entropy = max_mean_entropy;
+    return engine->loadCascadeModel(toStdString(env, model_path), config) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Unload the cascade model
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeUnloadCascadeModel(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        engine->unloadCascadeModel();
+    }
+}
+
+// Get cascade counters: [smallAnswers, escalations, smallTokens, discardedTokens, probeUs]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetCascadeStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[5] = {0, 0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::CascadeStats stats = engine->getCascadeStats();
+        values[0] = stats.small_answers;
+        values[1] = stats.escalations;
+        values[2] = stats.small_tokens;
+        values[3] = stats.discarded_tokens;
+        values[4] = stats.probe_us;
+    }
+
+    jlongArray result = env->NewLongArray(5);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 5, values);
+    }
+    return result;
+}
+
+// Load a replacement model in the background and switch to it between requests
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeSwapModel(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring model_path,
+    jobjectArray stop_sequences
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return JNI_FALSE;
+    }
+    return engine->swapModel(toStdString(env, model_path), toStringVector(env, stop_sequences))
+        ? JNI_TRUE : JNI_FALSE;
+}
+
+// Get model swap stats: [swaps, loadUs, handoverUs, overlapBytes]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetSwapStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[4] = {0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::SwapStats stats = engine->getSwapStats();
+        values[0] = stats.swaps;
+        values[1] = stats.load_us;
+        values[2] = stats.handover_us;
+        values[3] = stats.overlap_bytes;
+    }
+
+    jlongArray result = env->NewLongArray(4);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 4, values);
+    }
+    return result;
+}
+
+// Configure pacing to playback (highWatermark <= 0 disables it)
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeConfigurePacing(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jfloat high_watermark_s,
+    jfloat low_watermark_s,
+    jfloat speech_tokens_per_second
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return;
+    }
+
+    unamentis::PacingConfig config;
+    config.high_watermark_s = high_watermark_s;
+    config.low_watermark_s = low_watermark_s;
+    config.speech_tokens_per_second = speech_tokens_per_second;
+    engine->configurePacing(config);
+}
+
+// Report seconds of generated output still waiting to be played
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeReportConsumerLag(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jfloat queued_seconds
+) {
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        engine->reportConsumerLag(queued_seconds);
+    }
+}
+
+// Record a barge-in and stop generation
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeBargeIn(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        engine->bargeIn();
+    }
+}
+
+// Get pacing counters: [pauses, pausedUs, bargeIns, discardedTokens, generatedTokens]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetPacingStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[5] = {0, 0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::PacingStats stats = engine->getPacingStats();
+        values[0] = stats.pauses;
+        values[1] = stats.paused_us;
+        values[2] = stats.barge_ins;
+        values[3] = stats.discarded_tokens;
+        values[4] = stats.generated_tokens;
+    }
+
+    jlongArray result = env->NewLongArray(5);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 5, values);
+    }
+    return result;
+}
+
+// Publish live counters into a direct ByteBuffer (null stops publishing)
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeAttachTelemetry(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jobject buffer
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return JNI_FALSE;
+    }
+
+    // Detach before the old buffer can be collected
+    engine->attachTelemetry(nullptr, 0);
+    g_telemetry_buffers.release(env, context_ptr);
+    if (buffer == nullptr) {
+        return JNI_TRUE;
+    }
+
+    jlong capacity = 0;
+    void* memory = g_telemetry_buffers.hold(env, context_ptr, buffer, capacity);
+    if (memory == nullptr || !engine->attachTelemetry(memory, static_cast<size_t>(capacity))) {
+        g_telemetry_buffers.release(env, context_ptr);
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+// Set the process-wide compute pool policy (poll 0-100)
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeConfigureComputePools(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jint poll,
+    jboolean pause_between_turns
+) {
+    unamentis::ComputePoolConfig config;
+    config.poll = static_cast<uint32_t>(std::max(0, static_cast<int>(poll)));
+    config.pause_between_turns = pause_between_turns == JNI_TRUE;
+    unamentis::configureComputePools(config);
+}
+
+// Get compute pool counters: [turns, sharedTurns, poolsCreated, pauses, livePools]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetComputePoolStats(
+    JNIEnv* env,
+    jobject /* thiz */
+) {
+    unamentis::ComputePoolStats stats = unamentis::getComputePoolStats();
+    jlong values[5] = {stats.turns, stats.shared_turns, stats.pools_created, stats.pauses, stats.live_pools};
+
+    jlongArray result = env->NewLongArray(5);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 5, values);
+    }
+    return result;
+}
+
+// Configure the response cache (maxEntries == 0 disables it)
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeConfigureResponseCache(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jint max_entries,
+    jlong max_bytes,
+    jlong ttl_ms,
+    jfloat similarity_threshold
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return;
+    }
+
+    unamentis::ResponseCacheConfig config;
+    config.max_entries = static_cast<size_t>(std::max(0, static_cast<int>(max_entries)));
+    config.max_bytes = static_cast<size_t>(std::max<jlong>(0, max_bytes));
+    config.ttl_ms = ttl_ms;
+    config.similarity_threshold = similarity_threshold;
+    engine->configureResponseCache(config);
+}
+
+// Set the context cached responses belong to; changing it invalidates them
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeSetResponseCacheContext(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jstring context_key
+) {
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        engine->setResponseCacheContext(toStdString(env, context_key));
+    }
+}
+
+// Provide the embedding of the next query for semantic cache lookup
+extern "C" JNIEXPORT void JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeSetQueryEmbedding(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jfloatArray embedding
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return;
+    }
+
+    if (embedding == nullptr) {
+        engine->setQueryEmbedding(nullptr, 0);
+        return;
+    }
+
+    jsize dim = env->GetArrayLength(embedding);
+    jfloat* values = env->GetFloatArrayElements(embedding, nullptr);
+    if (values == nullptr) {
+        return;
+    }
+    engine->setQueryEmbedding(values, dim);
+    env->ReleaseFloatArrayElements(embedding, values, JNI_ABORT);
+}
+
+// Get response cache counters: [exactHits, semanticHits, misses, entries, bytes]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetResponseCacheStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[5] = {0, 0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::ResponseCacheStats stats = engine->getResponseCacheStats();
+        values[0] = stats.exact_hits;
+        values[1] = stats.semantic_hits;
+        values[2] = stats.misses;
+        values[3] = stats.entries;
+        values[4] = stats.bytes;
+    }
+
+    jlongArray result = env->NewLongArray(5);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 5, values);
+    }
+    return result;
+}
+
+// Change context size and/or threads without reloading the model (<= 0 keeps a setting)
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeReconfigure(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jint context_size,
+    jint n_threads
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return JNI_FALSE;
+    }
+    return engine->reconfigure(context_size, n_threads) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Get reconfigure counters: [reconfigures, carriedTokens, reconfigureUs]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetReconfigureStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[3] = {0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::ReconfigureStats stats = engine->getReconfigureStats();
+        values[0] = stats.reconfigures;
+        values[1] = stats.carried_tokens;
+        values[2] = stats.reconfigure_us;
+    }
+
+    jlongArray result = env->NewLongArray(3);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 3, values);
+    }
+    return result;
+}
+
+// Free the KV cache and compute buffers but keep the model mapped
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeHibernate(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr,
+    jboolean snapshot_sessions
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return JNI_FALSE;
+    }
+    return engine->hibernate(snapshot_sessions == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Recreate the context after hibernate
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeResume(
+    JNIEnv* /* env */,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    auto engine = findEngine(context_ptr);
+    if (!engine) {
+        return JNI_FALSE;
+    }
+    return engine->resume() ? JNI_TRUE : JNI_FALSE;
+}
+
+// Get hibernate counters:
+// [stateBytes, modelBytes, snapshottedSessions, hibernateUs, resumeUs]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_unamentis_services_llm_OnDeviceLLMService_nativeGetHibernateStats(
+    JNIEnv* env,
+    jobject /* thiz */,
+    jlong context_ptr
+) {
+    jlong values[5] = {0, 0, 0, 0, 0};
+
+    auto engine = findEngine(context_ptr);
+    if (engine) {
+        unamentis::HibernateStats stats = engine->getHibernateStats();
+        values[0] = stats.state_bytes;
+        values[1] = stats.model_bytes;
+        values[2] = stats.snapshotted_sessions;
+        values[3] = stats.hibernate_us;
+        values[4] = stats.resume_us;
+    }
+
+    jlongArray result = env->NewLongArray(5);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 5, values);
+    }
+    return result;
+}
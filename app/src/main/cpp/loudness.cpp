@@ -0,0 +1,266 @@
+// UnaMentis - Loudness Processor Implementation
+// Streaming loudness normalization and look-ahead peak limiting for playback
+
+#include "loudness.h"
+#include "dsp_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace unamentis {
+
+// Blocks under this are silence and don't move the gain
+static constexpr float kAbsoluteGateLufs = -70.0f;
+
+// Blocks this far under the running estimate are pauses or breaths
+static constexpr float kRelativeGateLu = 20.0f;
+
+// Gain time constants: cut fast so a loud provider doesn't blast, boost slowly
+static constexpr float kCutTimeS = 0.2f;
+static constexpr float kBoostTimeS = 1.5f;
+
+// Held gain this close to unity counts as unity
+static constexpr float kUnityEpsilon = 1e-4f;
+
+static float toLufs(double mean_square) {
+    return -0.691f + 10.0f * static_cast<float>(std::log10(std::max(mean_square, 1e-12)));
+}
+
+void LoudnessProcessor::configure(const LoudnessConfig& config, int32_t sample_rate, int32_t channel_count) {
+    config_ = config;
+    channels_ = std::max(1, channel_count);
+    sample_rate_ = static_cast<float>(std::max(1, sample_rate));
+
+    // BS.1770 K-weighting, derived for the stream's rate
+    const double pi = 3.14159265358979323846;
+    {
+        const double f0 = 1681.974450955533;
+        const double gain_db = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(pi * f0 / sample_rate_);
+        const double vh = std::pow(10.0, gain_db / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelf_.b0 = static_cast<float>((vh + vb * k / q + k * k) / a0);
+        shelf_.b1 = static_cast<float>(2.0 * (k * k - vh) / a0);
+        shelf_.b2 = static_cast<float>((vh - vb * k / q + k * k) / a0);
+        shelf_.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+        shelf_.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(pi * f0 / sample_rate_);
+        const double a0 = 1.0 + k / q + k * k;
+        highpass_.b0 = 1.0f;
+        highpass_.b1 = -2.0f;
+        highpass_.b2 = 1.0f;
+        highpass_.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+        highpass_.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+    }
+    shelf_state_.assign(channels_, BiquadState());
+    highpass_state_.assign(channels_, BiquadState());
+
+    block_samples_ = std::max(1, static_cast<int32_t>(sample_rate_ / 10.0f)) * channels_;
+    block_fill_ = 0;
+    block_energy_ = 0.0;
+    block_ms_.assign(kShortTermBlocks, 0.0f);
+    block_index_ = 0;
+    short_term_lufs_ = kAbsoluteGateLufs;
+
+    gain_ = 1.0f;
+    gain_step_ = 0.0f;
+    gain_target_db_ = 0.0f;
+    gain_db_ = 0.0f;
+
+    const float lookahead_ms = std::clamp(config_.lookahead_ms, 0.0f, kMaxLookaheadMs);
+    const int32_t lookahead = static_cast<int32_t>(std::lround(lookahead_ms * sample_rate_ / 1000.0f));
+    const size_t length = static_cast<size_t>(lookahead + 1) * channels_ - (channels_ - 1);
+    ceiling_ = std::pow(10.0f, config_.ceiling_db / 20.0f);
+    release_coef_ = 1.0f - std::exp(-1000.0f / (std::max(1.0f, config_.release_ms) * sample_rate_ * channels_));
+    delay_.assign(length, 0.0f);
+    held_.assign(length, 1.0f);
+    min_index_.assign(length, 0);
+    min_value_.assign(length, 1.0f);
+    flush();
+    resetStats();
+}
+
+void LoudnessProcessor::process(float* samples, int32_t count) {
+    if (!config_.enabled || samples == nullptr || count <= 0 || delay_.empty()) {
+        return;
+    }
+
+    // Work in pieces that end on measurement block boundaries, so each gain
+    // ramp spans exactly one block
+    for (int32_t done = 0; done < count;) {
+        const int32_t n = std::min(count - done, block_samples_ - block_fill_);
+        float* piece = samples + done;
+
+        measure(piece, n);
+        if (gain_step_ != 0.0f || gain_ != 1.0f) {
+            gain_ = applyGainRamp(piece, static_cast<size_t>(n), gain_, gain_step_);
+        }
+        if (block_fill_ == block_samples_) {
+            finishBlock();
+        }
+        limit(piece, n);
+        done += n;
+    }
+}
+
+void LoudnessProcessor::flush() {
+    std::fill(delay_.begin(), delay_.end(), 0.0f);
+    std::fill(held_.begin(), held_.end(), 1.0f);
+    held_sum_ = static_cast<double>(held_.size());
+    held_gain_ = 1.0f;
+    min_head_ = 0;
+    min_size_ = 0;
+    pos_ = 0;
+    idle_samples_ = static_cast<int64_t>(held_.size());
+}
+
+LoudnessStats LoudnessProcessor::getStats() const {
+    LoudnessStats stats;
+    stats.short_term_lufs = short_term_lufs_;
+    stats.gain_db = gain_db_;
+    stats.max_reduction_db = max_reduction_db_;
+    stats.limited_samples = limited_samples_;
+    return stats;
+}
+
+void LoudnessProcessor::resetStats() {
+    max_reduction_db_ = 0.0f;
+    limited_samples_ = 0;
+}
+
+float LoudnessProcessor::filter(const Biquad& q, BiquadState& s, float x) {
+    const float y = q.b0 * x + q.b1 * s.x1 + q.b2 * s.x2 - q.a1 * s.y1 - q.a2 * s.y2;
+    s.x2 = s.x1;
+    s.x1 = x;
+    s.y2 = s.y1;
+    s.y1 = y;
+    return y;
+}
+
+void LoudnessProcessor::measure(const float* samples, int32_t count) {
+    // The filters are recursive, so this stays scalar
+    int32_t channel = block_fill_ % channels_;
+    double energy = 0.0;
+    for (int32_t i = 0; i < count; ++i) {
+        const float k = filter(highpass_, highpass_state_[channel], filter(shelf_, shelf_state_[channel], samples[i]));
+        energy += static_cast<double>(k) * k;
+        channel = channel + 1 == channels_ ? 0 : channel + 1;
+    }
+    block_energy_ += energy;
+    block_fill_ += count;
+}
+
+void LoudnessProcessor::finishBlock() {
+    // Mean square per channel, summed over channels (BS.1770 weights 1.0 for front channels)
+    const double frames = static_cast<double>(block_samples_ / channels_);
+    const double mean_square = block_energy_ / frames;
+    const float block_lufs = toLufs(mean_square);
+    block_energy_ = 0.0;
+    block_fill_ = 0;
+
+    const bool measured = short_term_lufs_ > kAbsoluteGateLufs;
+    const bool valid =
+        block_lufs > kAbsoluteGateLufs && (!measured || block_lufs > short_term_lufs_ - kRelativeGateLu);
+    block_ms_[block_index_] = valid ? static_cast<float>(mean_square) : 0.0f;
+    block_index_ = (block_index_ + 1) % kShortTermBlocks;
+
+    if (valid) {
+        double sum = 0.0;
+        int32_t n = 0;
+        for (float ms : block_ms_) {
+            if (ms > 0.0f) {
+                sum += ms;
+                ++n;
+            }
+        }
+        short_term_lufs_ = toLufs(sum / std::max(1, n));
+        gain_target_db_ = std::clamp(config_.target_lufs - short_term_lufs_, -config_.max_gain_db, config_.max_gain_db);
+
+        const float block_s = 0.1f;
+        const float time_s = gain_target_db_ < gain_db_ ? kCutTimeS : kBoostTimeS;
+        gain_db_ += (gain_target_db_ - gain_db_) * (1.0f - std::exp(-block_s / time_s));
+    }
+
+    // Ramp to the new gain over the next block (zero step when unchanged)
+    const float target = std::pow(10.0f, gain_db_ / 20.0f);
+    gain_step_ = (target - gain_) / static_cast<float>(block_samples_);
+}
+
+void LoudnessProcessor::passThrough(float* samples, int32_t count) {
+    const int32_t length = static_cast<int32_t>(delay_.size());
+    for (int32_t i = 0; i < count; ++i) {
+        pos_ = pos_ + 1 == length ? 0 : pos_ + 1;
+        delay_[pos_] = samples[i];
+        samples[i] = delay_[pos_ + 1 == length ? 0 : pos_ + 1];
+    }
+    time_ += count;
+    idle_samples_ += count;
+}
+
+void LoudnessProcessor::limit(float* samples, int32_t count) {
+    const int32_t length = static_cast<int32_t>(delay_.size());
+
+    // Nothing to turn down and nothing pending: only the delay applies
+    if (idle_samples_ >= length && peakAbs(samples, static_cast<size_t>(count)) <= ceiling_) {
+        passThrough(samples, count);
+        return;
+    }
+
+    for (int32_t i = 0; i < count; ++i, ++time_) {
+        const float x = samples[i];
+        const float a = std::fabs(x);
+        const float need = a > ceiling_ ? ceiling_ / a : 1.0f;
+
+        // Minimum gain needed over the look-ahead window
+        while (min_size_ > 0 && min_index_[min_head_] <= time_ - length) {
+            min_head_ = min_head_ + 1 == length ? 0 : min_head_ + 1;
+            --min_size_;
+        }
+        if (need < 1.0f) {
+            while (min_size_ > 0 && min_value_[(min_head_ + min_size_ - 1) % length] >= need) {
+                --min_size_;
+            }
+            const int32_t slot = (min_head_ + min_size_) % length;
+            min_index_[slot] = time_;
+            min_value_[slot] = need;
+            ++min_size_;
+        }
+        const float window_min = min_size_ > 0 ? min_value_[min_head_] : 1.0f;
+
+        // Hold the reduction and release it smoothly
+        float held = std::min(window_min, held_gain_ + (1.0f - held_gain_) * release_coef_);
+        if (held > 1.0f - kUnityEpsilon) {
+            held = 1.0f;
+        }
+        held_gain_ = held;
+
+        // Averaging the held gain over the window turns steps into ramps
+        // that are already down when the peak leaves the delay line
+        pos_ = pos_ + 1 == length ? 0 : pos_ + 1;
+        held_sum_ += held - held_[pos_];
+        held_[pos_] = held;
+        delay_[pos_] = x;
+        const float gain = std::min(1.0f, static_cast<float>(held_sum_ / length));
+        samples[i] = delay_[pos_ + 1 == length ? 0 : pos_ + 1] * gain;
+
+        if (gain < 1.0f - kUnityEpsilon) {
+            ++limited_samples_;
+            max_reduction_db_ = std::max(max_reduction_db_, -20.0f * std::log10(gain));
+        }
+        if (held == 1.0f && min_size_ == 0) {
+            if (++idle_samples_ == length) {
+                // Every held gain in the window is exactly 1; drop accumulated rounding
+                held_sum_ = static_cast<double>(length);
+            }
+        } else {
+            idle_samples_ = 0;
+        }
+    }
+}
+
+} // namespace unamentis
@@ -0,0 +1,139 @@
+// UnaMentis - Loudness Processor Header
+// Streaming loudness normalization and look-ahead peak limiting for playback
+//
+// TTS providers deliver speech at very different levels. The processor
+// measures short-term loudness (ITU-R BS.1770 K-weighting over the last
+// 3 s in 100 ms blocks, ignoring silent blocks) and moves a gain toward the
+// target level. It reacts fast when the level has to come down and slowly
+// when it has to go up. A limiter with a few milliseconds of look-ahead
+// keeps the boosted signal under the ceiling. The gain
+// has already come down when a peak reaches the output, so nothing clips or
+// clicks.
+//
+// Runs in the playback callback: no allocation or locking after configure().
+
+#ifndef UNAMENTIS_LOUDNESS_H
+#define UNAMENTIS_LOUDNESS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace unamentis {
+
+/**
+ * Loudness targets.
+ */
+struct LoudnessConfig {
+    bool enabled = true;
+    float target_lufs = -16.0f;        // Short-term loudness to aim for
+    float max_gain_db = 12.0f;         // Boost/cut limit, so noise isn't raised to speech level
+    float ceiling_db = -1.0f;          // Limiter ceiling (dBFS)
+    float lookahead_ms = 5.0f;         // Limiter look-ahead (added output latency)
+    float release_ms = 80.0f;          // Limiter recovery time
+};
+
+/**
+ * Current loudness and limiter state.
+ */
+struct LoudnessStats {
+    float short_term_lufs = -70.0f;    // Measured input loudness (-70 = nothing measured)
+    float gain_db = 0.0f;              // Normalization gain being applied
+    float max_reduction_db = 0.0f;     // Deepest limiter reduction since the last reset
+    int64_t limited_samples = 0;       // Samples the limiter turned down
+};
+
+/**
+ * Loudness normalizer followed by a look-ahead peak limiter.
+ *
+ * Not thread-safe; the audio engine calls it under its playback lock.
+ */
+class LoudnessProcessor {
+public:
+    static constexpr float kMaxLookaheadMs = 20.0f;
+
+    /**
+     * Set the targets and stream layout; clears all state.
+     */
+    void configure(const LoudnessConfig& config, int32_t sample_rate, int32_t channel_count);
+
+    bool enabled() const { return config_.enabled; }
+
+    /**
+     * Process interleaved samples in place. Output lags input by
+     * latencySamples().
+     */
+    void process(float* samples, int32_t count);
+
+    /**
+     * Drop audio held in the look-ahead (e.g. on barge-in), keeping the
+     * loudness history so the next utterance starts at the right level.
+     */
+    void flush();
+
+    int32_t latencySamples() const { return static_cast<int32_t>(delay_.size()) - 1; }
+
+    LoudnessStats getStats() const;
+    void resetStats();
+
+private:
+    // Direct form I biquad, one state per channel
+    struct Biquad {
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+    };
+    struct BiquadState {
+        float x1 = 0.0f, x2 = 0.0f, y1 = 0.0f, y2 = 0.0f;
+    };
+
+    static constexpr int32_t kShortTermBlocks = 30;   // 3 s of 100 ms blocks
+
+    LoudnessConfig config_;
+    int32_t channels_ = 1;
+    float sample_rate_ = 16000.0f;
+
+    // Loudness measurement
+    Biquad shelf_;
+    Biquad highpass_;
+    std::vector<BiquadState> shelf_state_;
+    std::vector<BiquadState> highpass_state_;
+    int32_t block_samples_ = 1600;
+    int32_t block_fill_ = 0;
+    double block_energy_ = 0.0;
+    std::vector<float> block_ms_;      // Mean square per block, 0 for gated blocks
+    int32_t block_index_ = 0;
+    float short_term_lufs_ = -70.0f;
+
+    // Normalization gain (linear), ramping toward gain_target_
+    float gain_ = 1.0f;
+    float gain_step_ = 0.0f;
+    float gain_target_db_ = 0.0f;
+    float gain_db_ = 0.0f;
+
+    // Limiter
+    float ceiling_ = 1.0f;
+    float release_coef_ = 0.0f;
+    std::vector<float> delay_;         // Last L inputs; the oldest is the output
+    std::vector<float> held_;          // Last L held gains for the box filter
+    std::vector<int64_t> min_index_;   // Sliding-window minimum (monotonic queue)
+    std::vector<float> min_value_;
+    int32_t min_head_ = 0;
+    int32_t min_size_ = 0;
+    int32_t pos_ = 0;
+    int64_t time_ = 0;
+    float held_gain_ = 1.0f;
+    double held_sum_ = 0.0;
+    int64_t idle_samples_ = 0;         // Consecutive samples the limiter left alone
+
+    // Counters
+    float max_reduction_db_ = 0.0f;
+    int64_t limited_samples_ = 0;
+
+    void measure(const float* samples, int32_t count);
+    void finishBlock();
+    void limit(float* samples, int32_t count);
+    void passThrough(float* samples, int32_t count);
+    static float filter(const Biquad& q, BiquadState& s, float x);
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_LOUDNESS_H
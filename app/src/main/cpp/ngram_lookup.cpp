@@ -0,0 +1,86 @@
+// UnaMentis - N-gram Prompt Lookup Implementation
+// Draft-free speculation source for LlamaInference
+
+#include "ngram_lookup.h"
+#include <algorithm>
+
+namespace unamentis {
+
+NgramLookup::NgramLookup(int32_t ngram_min, int32_t ngram_max)
+    : ngram_min_(std::max(1, ngram_min)),
+      ngram_max_(std::max(std::max(1, ngram_min), ngram_max)) {
+}
+
+void NgramLookup::reset() {
+    history_.clear();
+    index_.clear();
+}
+
+void NgramLookup::push(llama_token token) {
+    history_.push_back(token);
+
+    // The n-grams ending just before the new token now have a continuation
+    const size_t cont = history_.size() - 1;
+    for (int32_t n = ngram_min_; n <= ngram_max_; ++n) {
+        if (cont < static_cast<size_t>(n)) {
+            break;
+        }
+        index_[hashAt(cont, n)] = static_cast<int32_t>(cont);
+    }
+}
+
+void NgramLookup::push(const std::vector<llama_token>& tokens) {
+    history_.reserve(history_.size() + tokens.size());
+    for (llama_token token : tokens) {
+        push(token);
+    }
+}
+
+size_t NgramLookup::draft(int32_t max_tokens, std::vector<llama_token>& out) const {
+    out.clear();
+    if (max_tokens <= 0) {
+        return 0;
+    }
+
+    const size_t end = history_.size();
+    for (int32_t n = ngram_max_; n >= ngram_min_; --n) {
+        if (end < static_cast<size_t>(n)) {
+            continue;
+        }
+
+        auto it = index_.find(hashAt(end, n));
+        if (it == index_.end()) {
+            continue;
+        }
+
+        // Guard against hash collisions before trusting the match
+        const size_t cont = static_cast<size_t>(it->second);
+        if (!matchesAt(cont, end, n)) {
+            continue;
+        }
+
+        const size_t count = std::min(static_cast<size_t>(max_tokens), end - cont);
+        out.assign(history_.begin() + cont, history_.begin() + cont + count);
+        return count;
+    }
+
+    return 0;
+}
+
+uint64_t NgramLookup::hashAt(size_t end, int32_t n) const {
+    // FNV-1a over the token ids, seeded with n so different orders don't collide
+    uint64_t hash = 14695981039346656037ULL ^ static_cast<uint64_t>(n);
+    for (size_t i = end - n; i < end; ++i) {
+        hash ^= static_cast<uint32_t>(history_[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool NgramLookup::matchesAt(size_t lhs_end, size_t rhs_end, int32_t n) const {
+    return std::equal(
+        history_.begin() + (lhs_end - n), history_.begin() + lhs_end,
+        history_.begin() + (rhs_end - n));
+}
+
+} // namespace unamentis
@@ -0,0 +1,76 @@
+// UnaMentis - N-gram Prompt Lookup Header
+// Draft-free speculation source for LlamaInference
+//
+// Indexes the prompt and generated tokens by n-gram so that, when the
+// most recent tokens repeat an earlier span, the tokens that followed
+// that span can be proposed as a speculative draft.
+
+#ifndef UNAMENTIS_NGRAM_LOOKUP_H
+#define UNAMENTIS_NGRAM_LOOKUP_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "llama.h"
+
+namespace unamentis {
+
+/**
+ * N-gram index over a growing token history.
+ *
+ * Each n-gram (for every n in [ngram_min, ngram_max]) maps to the
+ * position of the token that followed its most recent occurrence.
+ * An n-gram is only indexed once its continuation exists, so the
+ * current suffix never matches itself.
+ *
+ * Not thread-safe; owned by the generation thread.
+ */
+class NgramLookup {
+public:
+    NgramLookup(int32_t ngram_min, int32_t ngram_max);
+
+    /**
+     * Clear the history and the index.
+     */
+    void reset();
+
+    /**
+     * Append a token to the history and index the n-grams it completes.
+     */
+    void push(llama_token token);
+
+    /**
+     * Append a sequence of tokens (e.g. the prompt).
+     */
+    void push(const std::vector<llama_token>& tokens);
+
+    /**
+     * Propose a continuation for the current suffix.
+     *
+     * Longer n-grams are tried first. The draft is the run of tokens that
+     * followed the matched n-gram, truncated to max_tokens.
+     *
+     * @param max_tokens Maximum number of draft tokens
+     * @param out Receives the draft (cleared first)
+     * @return Number of draft tokens proposed
+     */
+    size_t draft(int32_t max_tokens, std::vector<llama_token>& out) const;
+
+    /**
+     * Number of tokens in the history.
+     */
+    size_t size() const { return history_.size(); }
+
+private:
+    int32_t ngram_min_;
+    int32_t ngram_max_;
+    std::vector<llama_token> history_;
+    std::unordered_map<uint64_t, int32_t> index_;
+
+    uint64_t hashAt(size_t end, int32_t n) const;
+    bool matchesAt(size_t lhs_end, size_t rhs_end, int32_t n) const;
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_NGRAM_LOOKUP_H
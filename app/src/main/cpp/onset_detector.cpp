@@ -0,0 +1,171 @@
+// UnaMentis - Onset Detector Implementation
+// Sample-accurate speech onset detection on the capture thread
+
+#include "onset_detector.h"
+#include <algorithm>
+#include <cmath>
+
+namespace unamentis {
+
+static constexpr float kHopMs = 2.5f;
+static constexpr float kBandSplitHz = 1000.0f;
+
+// Quiet hops a candidate may contain (stop closures) before it is dropped
+static constexpr int32_t kMaxGapHops = 2;
+
+// Noise floor follows quiet hops down fast and up slowly
+static constexpr float kFloorDown = 0.2f;
+static constexpr float kFloorUp = 0.01f;
+static constexpr float kMinFloorDb = -90.0f;
+static constexpr float kMaxFloorDb = -20.0f;
+
+// Band references trail the signal by a few hops so a rise over ~10 ms counts as flux
+static constexpr float kReferenceCoef = 0.3f;
+
+static float toDb(double energy, int32_t count) {
+    return 10.0f * static_cast<float>(std::log10(energy / std::max(1, count) + 1e-12));
+}
+
+void OnsetDetector::configure(const OnsetConfig& config) {
+    config_ = config;
+    const float rate = static_cast<float>(std::max(1, config_.sample_rate));
+    hop_ = std::max(1, static_cast<int32_t>(rate * kHopMs / 1000.0f));
+    lowpass_coef_ = 1.0f - std::exp(-2.0f * 3.14159265f * kBandSplitHz / rate);
+    const float hop_ms = static_cast<float>(hop_) * 1000.0f / rate;
+    confirm_hops_ = std::max(1, static_cast<int32_t>(std::lround(config_.confirm_ms / hop_ms)));
+    release_hops_ = std::max(1, static_cast<int32_t>(std::lround(config_.release_ms / hop_ms)));
+    reset();
+}
+
+void OnsetDetector::reset() {
+    hop_fill_ = 0;
+    hop_low_energy_ = 0.0;
+    hop_high_energy_ = 0.0;
+    lowpass_ = 0.0f;
+    first_loud_frame_ = -1;
+    noise_floor_db_ = -60.0f;
+    low_ref_db_ = kMinFloorDb;
+    high_ref_db_ = kMinFloorDb;
+    state_ = State::IDLE;
+    state_hops_ = 0;
+    gap_hops_ = 0;
+    trigger_level_ = std::pow(10.0f, (noise_floor_db_ + config_.margin_db) / 20.0f);
+}
+
+bool OnsetDetector::process(const float* samples, int32_t count, int64_t first_frame,
+                            int64_t& onset_frame, float& level_db) {
+    if (!config_.enabled || samples == nullptr || count <= 0) {
+        return false;
+    }
+
+    bool found = false;
+    for (int32_t i = 0; i < count; ++i) {
+        const float x = samples[i];
+        if (hop_fill_ == 0) {
+            hop_start_frame_ = first_frame + i;
+        }
+
+        // One-pole split into a voicing band and a burst/fricative band
+        lowpass_ += (x - lowpass_) * lowpass_coef_;
+        const float high = x - lowpass_;
+        hop_low_energy_ += static_cast<double>(lowpass_) * lowpass_;
+        hop_high_energy_ += static_cast<double>(high) * high;
+
+        if (first_loud_frame_ < 0 && std::fabs(x) > trigger_level_) {
+            first_loud_frame_ = first_frame + i;
+        }
+
+        if (++hop_fill_ == hop_) {
+            int64_t frame = 0;
+            float level = 0.0f;
+            if (finishHop(frame, level) && !found) {
+                found = true;
+                onset_frame = frame;
+                level_db = level;
+            }
+        }
+    }
+    return found;
+}
+
+bool OnsetDetector::finishHop(int64_t& onset_frame, float& level_db) {
+    const float low_db = toDb(hop_low_energy_, hop_);
+    const float high_db = toDb(hop_high_energy_, hop_);
+    const float total_db = toDb(hop_low_energy_ + hop_high_energy_, hop_);
+    const float flux = std::max(0.0f, low_db - low_ref_db_) + std::max(0.0f, high_db - high_ref_db_);
+    const bool loud = total_db > noise_floor_db_ + config_.margin_db;
+    const int64_t first_loud = first_loud_frame_;
+
+    low_ref_db_ += (low_db - low_ref_db_) * kReferenceCoef;
+    high_ref_db_ += (high_db - high_ref_db_) * kReferenceCoef;
+    hop_fill_ = 0;
+    hop_low_energy_ = 0.0;
+    hop_high_energy_ = 0.0;
+    first_loud_frame_ = -1;
+
+    bool confirmed = false;
+    switch (state_) {
+        case State::IDLE:
+            if (loud && flux >= config_.flux_db) {
+                state_ = State::CANDIDATE;
+                candidate_frame_ = first_loud >= 0 ? first_loud : hop_start_frame_;
+                state_hops_ = 1;
+                gap_hops_ = 0;
+            } else if (!loud) {
+                const float coef = total_db < noise_floor_db_ ? kFloorDown : kFloorUp;
+                noise_floor_db_ = std::clamp(noise_floor_db_ + (total_db - noise_floor_db_) * coef,
+                                             kMinFloorDb, kMaxFloorDb);
+                trigger_level_ = std::pow(10.0f, (noise_floor_db_ + config_.margin_db) / 20.0f);
+            }
+            break;
+
+        case State::CANDIDATE:
+            if (loud) {
+                gap_hops_ = 0;
+                if (++state_hops_ >= confirm_hops_) {
+                    state_ = State::ACTIVE;
+                    state_hops_ = 0;
+                    onset_frame = candidate_frame_;
+                    level_db = total_db;
+                    confirmed = true;
+                }
+            } else if (++gap_hops_ > kMaxGapHops) {
+                // Too short for speech: a click, tap or breath
+                state_ = State::IDLE;
+            }
+            break;
+
+        case State::ACTIVE:
+            // Half the margin keeps trailing syllables from re-arming the detector
+            if (total_db > noise_floor_db_ + config_.margin_db * 0.5f) {
+                state_hops_ = 0;
+            } else if (++state_hops_ >= release_hops_) {
+                state_ = State::IDLE;
+            }
+            break;
+    }
+    return confirmed;
+}
+
+void OnsetDetector::publish(const OnsetEvent& event) {
+    const uint32_t write = write_index_.load(std::memory_order_relaxed);
+    const uint32_t read = read_index_.load(std::memory_order_acquire);
+    if (write - read >= static_cast<uint32_t>(kMaxEvents)) {
+        return;
+    }
+    events_[write % kMaxEvents] = event;
+    write_index_.store(write + 1, std::memory_order_release);
+}
+
+int32_t OnsetDetector::drain(OnsetEvent* out, int32_t capacity) {
+    const uint32_t read = read_index_.load(std::memory_order_relaxed);
+    const uint32_t write = write_index_.load(std::memory_order_acquire);
+    const int32_t count = std::min(static_cast<int32_t>(write - read), capacity);
+    for (int32_t i = 0; i < count; ++i) {
+        out[i] = events_[(read + i) % kMaxEvents];
+    }
+    read_index_.store(read + count, std::memory_order_release);
+    return count;
+}
+
+} // namespace unamentis
@@ -0,0 +1,131 @@
+// UnaMentis - Onset Detector Header
+// Sample-accurate speech onset detection on the capture thread
+//
+// Knowledge Bowl timing needs to know when the learner started speaking,
+// not when Kotlin heard about it. The detector runs inside the capture
+// callback on 2.5 ms hops:
+// - energy over an adaptive noise floor says something is there
+// - band flux (rise in low- and high-band log energy over the previous
+//   hops) separates a speech attack from a slow swell of background noise
+// - a candidate becomes an onset once it holds for confirm_ms, so clicks
+//   and taps are dropped
+//
+// The onset is placed on the first sample of the candidate hop that clears
+// the trigger level. It is reported as a frame position in the capture
+// stream, which the audio engine maps to CLOCK_MONOTONIC.
+
+#ifndef UNAMENTIS_ONSET_DETECTOR_H
+#define UNAMENTIS_ONSET_DETECTOR_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace unamentis {
+
+/**
+ * Onset thresholds.
+ */
+struct OnsetConfig {
+    bool enabled = false;
+    int32_t sample_rate = 16000;
+    float margin_db = 12.0f;           // Hop energy over the noise floor that can start speech
+    float flux_db = 6.0f;              // Band-energy rise that marks an attack
+    int32_t confirm_ms = 30;           // Speech needed after the attack before it counts
+    int32_t release_ms = 250;          // Quiet needed before the next onset can fire
+};
+
+/**
+ * One detected onset.
+ */
+struct OnsetEvent {
+    int64_t frame = 0;                 // Capture stream frame position of the first speech sample
+    int64_t time_ns = 0;               // CLOCK_MONOTONIC time the frame was captured
+    float level_db = 0.0f;             // Hop energy when confirmed (dBFS)
+    bool precise = false;              // Timed from the stream's hardware timestamp
+};
+
+/**
+ * Speech onset detector for one mono capture stream.
+ *
+ * process() runs on the capture thread. Events are handed to one reader
+ * thread through a lock-free queue, so the callback never blocks.
+ */
+class OnsetDetector {
+public:
+    static constexpr int32_t kMaxEvents = 32;
+
+    /**
+     * Replace the thresholds and clear state. Not safe to call while
+     * process() runs; the engine calls it while capture is stopped or under
+     * its callback lock.
+     */
+    void configure(const OnsetConfig& config);
+
+    bool enabled() const { return config_.enabled; }
+
+    /**
+     * Scan mono samples.
+     *
+     * @param samples Mono samples in [-1, 1]
+     * @param count Number of samples
+     * @param first_frame Stream frame position of samples[0]
+     * @param onset_frame Set to the onset's frame position when one is confirmed
+     * @param level_db Set to the confirming hop's level
+     * @return true if an onset was confirmed in this block
+     */
+    bool process(const float* samples, int32_t count, int64_t first_frame,
+                 int64_t& onset_frame, float& level_db);
+
+    /**
+     * Queue a timed onset for the reader (capture thread only). Drops the
+     * event if the reader has fallen kMaxEvents behind.
+     */
+    void publish(const OnsetEvent& event);
+
+    /**
+     * Take queued onsets (reader thread only).
+     *
+     * @return Number of events written to out
+     */
+    int32_t drain(OnsetEvent* out, int32_t capacity);
+
+    /**
+     * Forget the noise floor and any speech in progress (capture thread or
+     * while stopped).
+     */
+    void reset();
+
+private:
+    enum class State { IDLE, CANDIDATE, ACTIVE };
+
+    OnsetConfig config_;
+    int32_t hop_ = 40;
+    int32_t hop_fill_ = 0;
+    int64_t hop_start_frame_ = 0;
+    double hop_low_energy_ = 0.0;      // Energy under ~1 kHz (voicing)
+    double hop_high_energy_ = 0.0;     // Energy above it (fricatives, plosive bursts)
+    float lowpass_ = 0.0f;
+    float lowpass_coef_ = 0.3f;
+    int64_t first_loud_frame_ = -1;    // First sample in the hop over the trigger level
+    float trigger_level_ = 0.0f;
+
+    float noise_floor_db_ = -60.0f;
+    float low_ref_db_ = -90.0f;        // Smoothed band levels the flux is measured against
+    float high_ref_db_ = -90.0f;
+    State state_ = State::IDLE;
+    int64_t candidate_frame_ = 0;
+    int32_t state_hops_ = 0;
+    int32_t gap_hops_ = 0;
+    int32_t confirm_hops_ = 12;
+    int32_t release_hops_ = 100;
+
+    OnsetEvent events_[kMaxEvents];
+    std::atomic<uint32_t> write_index_{0};
+    std::atomic<uint32_t> read_index_{0};
+
+    bool finishHop(int64_t& onset_frame, float& level_db);
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_ONSET_DETECTOR_H
@@ -0,0 +1,53 @@
+// UnaMentis - PCM Ring Buffer
+// Two-segment copies in and out of the playback queue
+//
+// The ring keeps one slot free so read_pos == write_pos always means empty.
+// Callers hold their own lock; nothing here allocates. Kept apart from the
+// engine so host benchmarks can exercise it without Oboe.
+
+#ifndef UNAMENTIS_PCM_RING_H
+#define UNAMENTIS_PCM_RING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace unamentis {
+
+// Append samples to the ring, dropping the oldest on overflow (caller holds the lock)
+template <typename T>
+inline void writeRing(std::vector<T>& ring, size_t& read_pos, size_t& write_pos,
+                      const T* data, size_t count) {
+    const size_t capacity = ring.size();
+    if (count > capacity - 1) {
+        data += count - (capacity - 1);
+        count = capacity - 1;
+    }
+    const size_t used = (write_pos + capacity - read_pos) % capacity;
+    const size_t first = std::min(count, capacity - write_pos);
+    std::copy(data, data + first, ring.begin() + write_pos);
+    std::copy(data + first, data + count, ring.begin());
+    write_pos = (write_pos + count) % capacity;
+    if (used + count > capacity - 1) {
+        read_pos = (write_pos + 1) % capacity;
+    }
+}
+
+// Take up to count samples from the ring, padding an underrun with silence;
+// returns the number of queued samples taken
+template <typename T>
+inline size_t readRing(std::vector<T>& ring, size_t& read_pos, size_t write_pos,
+                       T* out, size_t count) {
+    const size_t capacity = ring.size();
+    const size_t available = std::min(count, (write_pos + capacity - read_pos) % capacity);
+    const size_t first = std::min(available, capacity - read_pos);
+    std::copy(ring.begin() + read_pos, ring.begin() + read_pos + first, out);
+    std::copy(ring.begin(), ring.begin() + (available - first), out + first);
+    std::fill(out + available, out + count, T{});
+    read_pos = (read_pos + available) % capacity;
+    return available;
+}
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_PCM_RING_H
@@ -0,0 +1,224 @@
+// UnaMentis - Prefix Cache Implementation
+// Radix tree of prompt prefixes whose KV is held in dedicated sequences
+
+#include "prefix_cache.h"
+#include <algorithm>
+
+namespace unamentis {
+
+PrefixCache::PrefixCache(llama_seq_id first_slot, int32_t n_slots)
+    : first_slot_(first_slot), n_slots_(std::max(0, n_slots)) {
+    clear();
+}
+
+void PrefixCache::clear() {
+    root_.children.clear();
+    free_slots_.clear();
+    for (int32_t i = n_slots_ - 1; i >= 0; --i) {
+        free_slots_.push_back(first_slot_ + i);
+    }
+    cached_tokens_ = 0;
+}
+
+PrefixCache::Node* PrefixCache::walk(
+    const std::vector<llama_token>& tokens,
+    size_t& length,
+    size_t& edge_matched
+) {
+    Node* node = &root_;
+    length = 0;
+    edge_matched = 0;
+
+    while (length < tokens.size()) {
+        auto it = node->children.find(tokens[length]);
+        if (it == node->children.end()) {
+            break;
+        }
+
+        Node* child = it->second.get();
+        size_t k = 0;
+        while (k < child->edge.size() && length + k < tokens.size() &&
+               child->edge[k] == tokens[length + k]) {
+            k++;
+        }
+        length += k;
+        node = child;
+        edge_matched = k;
+        if (k < child->edge.size()) {
+            break;
+        }
+    }
+    return node;
+}
+
+PrefixCache::Node* PrefixCache::leafBelow(Node* node) {
+    while (node->slot < 0 && !node->children.empty()) {
+        Node* next = nullptr;
+        for (auto& entry : node->children) {
+            if (next == nullptr || entry.second->last_used > next->last_used) {
+                next = entry.second.get();
+            }
+        }
+        node = next;
+    }
+    return node;
+}
+
+void PrefixCache::touch(Node* node) {
+    const uint64_t now = ++clock_;
+    for (; node != nullptr; node = node->parent) {
+        node->last_used = now;
+    }
+}
+
+llama_seq_id PrefixCache::match(const std::vector<llama_token>& tokens, size_t& length) {
+    size_t edge_matched = 0;
+    Node* node = walk(tokens, length, edge_matched);
+
+    Node* leaf = node == &root_ ? nullptr : leafBelow(node);
+    if (leaf == nullptr || leaf->slot < 0 || length == 0) {
+        length = 0;
+        return -1;
+    }
+
+    touch(leaf);
+    return leaf->slot;
+}
+
+void PrefixCache::recordLookup(size_t reused) {
+    if (reused > 0) {
+        stats_.hits++;
+        stats_.reused_tokens += static_cast<int64_t>(reused);
+    } else {
+        stats_.misses++;
+    }
+}
+
+llama_seq_id PrefixCache::insert(
+    const std::vector<llama_token>& tokens,
+    std::vector<llama_seq_id>& released
+) {
+    released.clear();
+    if (n_slots_ == 0 || tokens.empty()) {
+        return -1;
+    }
+
+    size_t length = 0;
+    size_t edge_matched = 0;
+    Node* node = walk(tokens, length, edge_matched);
+
+    // Already covered by a cached prompt
+    if (length == tokens.size()) {
+        touch(leafBelow(node));
+        return -1;
+    }
+
+    // Extends a cached prompt: grow the leaf and refill its slot
+    if (node != &root_ && node->slot >= 0 && edge_matched == node->edge.size()) {
+        node->edge.insert(node->edge.end(), tokens.begin() + length, tokens.end());
+        cached_tokens_ += static_cast<int32_t>(tokens.size() - length);
+        released.push_back(node->slot);
+        touch(node);
+        return node->slot;
+    }
+
+    // A new leaf needs a slot; evicting may reshape the tree, so walk again
+    if (free_slots_.empty()) {
+        llama_seq_id evicted = evictLeastRecent();
+        if (evicted < 0) {
+            return -1;
+        }
+        released.push_back(evicted);
+        node = walk(tokens, length, edge_matched);
+    }
+
+    // Split the edge where the prompt diverges from it
+    if (node != &root_ && edge_matched < node->edge.size()) {
+        auto mid = std::make_unique<Node>();
+        mid->edge.assign(node->edge.begin(), node->edge.begin() + edge_matched);
+        mid->parent = node->parent;
+        mid->last_used = node->last_used;
+
+        Node* parent = node->parent;
+        std::unique_ptr<Node> lower = std::move(parent->children[mid->edge[0]]);
+        lower->edge.erase(lower->edge.begin(), lower->edge.begin() + edge_matched);
+        lower->parent = mid.get();
+        mid->children[lower->edge[0]] = std::move(lower);
+
+        node = mid.get();
+        parent->children[node->edge[0]] = std::move(mid);
+    }
+
+    auto leaf = std::make_unique<Node>();
+    leaf->edge.assign(tokens.begin() + length, tokens.end());
+    leaf->parent = node;
+    leaf->slot = free_slots_.back();
+    free_slots_.pop_back();
+    cached_tokens_ += static_cast<int32_t>(leaf->edge.size());
+
+    Node* added = leaf.get();
+    node->children[added->edge[0]] = std::move(leaf);
+    touch(added);
+    return added->slot;
+}
+
+void PrefixCache::collectLeaves(Node* node, std::vector<Node*>& leaves) {
+    if (node->slot >= 0) {
+        leaves.push_back(node);
+    }
+    for (auto& entry : node->children) {
+        collectLeaves(entry.second.get(), leaves);
+    }
+}
+
+llama_seq_id PrefixCache::evictLeastRecent() {
+    std::vector<Node*> leaves;
+    collectLeaves(&root_, leaves);
+    if (leaves.empty()) {
+        return -1;
+    }
+
+    Node* victim = *std::min_element(leaves.begin(), leaves.end(),
+        [](const Node* a, const Node* b) { return a->last_used < b->last_used; });
+    const llama_seq_id slot = victim->slot;
+    removeLeaf(victim);
+    free_slots_.push_back(slot);
+    stats_.evictions++;
+    return slot;
+}
+
+void PrefixCache::removeLeaf(Node* leaf) {
+    Node* parent = leaf->parent;
+    cached_tokens_ -= static_cast<int32_t>(leaf->edge.size());
+    parent->children.erase(leaf->edge[0]);
+
+    // Drop prefixes nothing depends on any more
+    while (parent != &root_ && parent->children.empty() && parent->slot < 0) {
+        Node* grandparent = parent->parent;
+        cached_tokens_ -= static_cast<int32_t>(parent->edge.size());
+        grandparent->children.erase(parent->edge[0]);
+        parent = grandparent;
+    }
+
+    // Keep the tree compressed: merge a lone child into its parent
+    if (parent != &root_ && parent->children.size() == 1 && parent->slot < 0) {
+        std::unique_ptr<Node> child = std::move(parent->children.begin()->second);
+        parent->children.clear();
+        parent->edge.insert(parent->edge.end(), child->edge.begin(), child->edge.end());
+        parent->slot = child->slot;
+        parent->last_used = child->last_used;
+        parent->children = std::move(child->children);
+        for (auto& entry : parent->children) {
+            entry.second->parent = parent;
+        }
+    }
+}
+
+PrefixCacheStats PrefixCache::stats() const {
+    PrefixCacheStats result = stats_;
+    result.cached_prompts = n_slots_ - static_cast<int32_t>(free_slots_.size());
+    result.cached_tokens = cached_tokens_;
+    return result;
+}
+
+} // namespace unamentis
@@ -0,0 +1,140 @@
+// UnaMentis - Prefix Cache Header
+// Radix tree of prompt prefixes whose KV is held in dedicated sequences
+//
+// Recurring workflows (tutor persona, quiz generator, answer validator,
+// summarizer) each start with a long fixed preamble. Every prefilled
+// prompt is remembered here together with a KV sequence ("slot") that
+// holds it, so a later prompt can copy the deepest shared prefix into
+// its own sequence instead of prefilling it again.
+
+#ifndef UNAMENTIS_PREFIX_CACHE_H
+#define UNAMENTIS_PREFIX_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "llama.h"
+
+namespace unamentis {
+
+/**
+ * Prefix cache counters.
+ */
+struct PrefixCacheStats {
+    int64_t hits = 0;                  // Lookups that matched a cached prefix
+    int64_t misses = 0;                // Lookups without a usable match
+    int64_t reused_tokens = 0;         // Prompt tokens copied from cached prefixes
+    int32_t cached_prompts = 0;        // Slots in use
+    int32_t cached_tokens = 0;         // Distinct tokens held by the tree
+    int64_t evictions = 0;             // Slots released by LRU eviction
+};
+
+/**
+ * Radix tree over token sequences with one KV slot per leaf.
+ *
+ * Each leaf owns a sequence id whose KV holds the full path from the root,
+ * so any prefix of it can be copied with llama_memory_seq_cp. Internal
+ * nodes are shared prefixes and own no slot. The tree itself never calls
+ * llama.cpp; insert() and evictLeastRecent() report which slots the caller
+ * must fill or clear.
+ *
+ * Not thread-safe; owned by the generation thread.
+ */
+class PrefixCache {
+public:
+    /**
+     * @param first_slot First sequence id reserved for the cache
+     * @param n_slots Number of sequence ids reserved (0 = disabled)
+     */
+    PrefixCache(llama_seq_id first_slot, int32_t n_slots);
+
+    /**
+     * Check whether any slots are reserved.
+     */
+    bool enabled() const { return n_slots_ > 0; }
+
+    /**
+     * Find the cached prefix sharing the most leading tokens with a prompt.
+     * Counters are updated by recordLookup() once the caller knows whether
+     * the match was used.
+     *
+     * @param tokens Prompt tokens
+     * @param length Receives the number of shared leading tokens
+     * @return Slot holding that prefix, or -1 if nothing matches
+     */
+    llama_seq_id match(const std::vector<llama_token>& tokens, size_t& length);
+
+    /**
+     * Count a lookup.
+     *
+     * @param reused Prompt tokens copied from a cached prefix (0 = miss)
+     */
+    void recordLookup(size_t reused);
+
+    /**
+     * Remember a prefilled prompt.
+     *
+     * @param tokens Prompt tokens
+     * @param released Receives slots whose KV the caller must clear
+     *                 (evicted to make room, or superseded by this prompt)
+     * @return Slot the caller must fill with the prompt's KV, or -1 if the
+     *         prompt is already covered by a cached one
+     */
+    llama_seq_id insert(const std::vector<llama_token>& tokens, std::vector<llama_seq_id>& released);
+
+    /**
+     * Drop the least recently used leaf.
+     *
+     * @return Released slot, or -1 if the cache is empty
+     */
+    llama_seq_id evictLeastRecent();
+
+    /**
+     * Forget every prefix. The caller clears the slots' KV.
+     */
+    void clear();
+
+    /**
+     * Number of distinct tokens held by the tree (KV cells in use).
+     */
+    int32_t cachedTokens() const { return cached_tokens_; }
+
+    /**
+     * Get cache counters.
+     */
+    PrefixCacheStats stats() const;
+
+private:
+    struct Node {
+        std::vector<llama_token> edge;                     // Tokens from the parent to this node
+        std::map<llama_token, std::unique_ptr<Node>> children;
+        Node* parent = nullptr;
+        llama_seq_id slot = -1;                            // Set on leaves only
+        uint64_t last_used = 0;
+    };
+
+    llama_seq_id first_slot_;
+    int32_t n_slots_;
+    Node root_;
+    std::vector<llama_seq_id> free_slots_;
+    int32_t cached_tokens_ = 0;
+    uint64_t clock_ = 0;
+    PrefixCacheStats stats_;
+
+    // Deepest node reached by tokens and how many of them matched
+    Node* walk(const std::vector<llama_token>& tokens, size_t& length, size_t& edge_matched);
+
+    // Any leaf below node, preferring the most recently used branch
+    static Node* leafBelow(Node* node);
+
+    // Mark node and its ancestors as used
+    void touch(Node* node);
+
+    void collectLeaves(Node* node, std::vector<Node*>& leaves);
+    void removeLeaf(Node* leaf);
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_PREFIX_CACHE_H
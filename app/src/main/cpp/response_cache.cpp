@@ -0,0 +1,196 @@
+// UnaMentis - Response Cache Implementation
+// Replays earlier LLM answers for repeated or near-identical prompts
+
+#include "response_cache.h"
+#include <chrono>
+#include <cmath>
+#include <iterator>
+
+namespace unamentis {
+
+void ResponseCache::configure(const ResponseCacheConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    evictToFit();
+}
+
+bool ResponseCache::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_.max_entries > 0;
+}
+
+void ResponseCache::setContext(const std::string& context_key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (context_key == context_key_) {
+        return;
+    }
+    context_key_ = context_key;
+
+    // Every entry was produced under the previous context
+    entries_.clear();
+    by_key_.clear();
+    bytes_ = 0;
+}
+
+bool ResponseCache::lookup(
+    const std::vector<llama_token>& prompt,
+    const std::vector<float>& embedding,
+    int32_t max_tokens,
+    std::vector<std::string>& pieces
+) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (config_.max_entries == 0) {
+        return false;
+    }
+
+    const int64_t now = nowMs();
+    EntryList::iterator hit = entries_.end();
+    bool semantic = false;
+
+    // Exact match on the token sequence
+    auto it = by_key_.find(hashTokens(prompt));
+    if (it != by_key_.end() && it->second->prompt == prompt) {
+        if (now - it->second->created_ms > config_.ttl_ms) {
+            erase(it->second);
+        } else {
+            hit = it->second;
+        }
+    }
+
+    // Nearest embedding above the similarity threshold. Expired entries are
+    // dropped on the way, so they can't shadow a fresh match.
+    if (hit == entries_.end() && !embedding.empty()) {
+        float best = config_.similarity_threshold;
+        for (auto e = entries_.begin(); e != entries_.end();) {
+            const auto current = e++;
+            if (now - current->created_ms > config_.ttl_ms) {
+                erase(current);
+                continue;
+            }
+            if (current->embedding.size() != embedding.size()) {
+                continue;
+            }
+            float similarity = cosineSimilarity(current->embedding, embedding);
+            if (similarity >= best) {
+                best = similarity;
+                hit = current;
+                semantic = true;
+            }
+        }
+    }
+
+    if (hit == entries_.end() || hit->n_tokens > max_tokens) {
+        stats_.misses++;
+        return false;
+    }
+
+    entries_.splice(entries_.begin(), entries_, hit);
+    pieces = hit->pieces;
+    if (semantic) {
+        stats_.semantic_hits++;
+    } else {
+        stats_.exact_hits++;
+    }
+    return true;
+}
+
+void ResponseCache::insert(
+    const std::vector<llama_token>& prompt,
+    const std::vector<float>& embedding,
+    const std::vector<std::string>& pieces,
+    int32_t n_tokens
+) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (config_.max_entries == 0) {
+        return;
+    }
+
+    const uint64_t key = hashTokens(prompt);
+    auto existing = by_key_.find(key);
+    if (existing != by_key_.end()) {
+        erase(existing->second);
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.prompt = prompt;
+    entry.embedding = embedding;
+    entry.pieces = pieces;
+    entry.n_tokens = n_tokens;
+    entry.created_ms = nowMs();
+    entry.bytes = sizeof(Entry)
+        + prompt.size() * sizeof(llama_token)
+        + embedding.size() * sizeof(float);
+    for (const std::string& piece : pieces) {
+        entry.bytes += sizeof(std::string) + piece.size();
+    }
+
+    if (entry.bytes > config_.max_bytes) {
+        return;
+    }
+
+    bytes_ += entry.bytes;
+    entries_.push_front(std::move(entry));
+    by_key_[key] = entries_.begin();
+    evictToFit();
+}
+
+void ResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    by_key_.clear();
+    bytes_ = 0;
+}
+
+ResponseCacheStats ResponseCache::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ResponseCacheStats result = stats_;
+    result.entries = static_cast<int64_t>(entries_.size());
+    result.bytes = static_cast<int64_t>(bytes_);
+    return result;
+}
+
+uint64_t ResponseCache::hashTokens(const std::vector<llama_token>& tokens) {
+    // FNV-1a over the token ids
+    uint64_t hash = 14695981039346656037ULL;
+    for (llama_token token : tokens) {
+        hash ^= static_cast<uint32_t>(token);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+float ResponseCache::cosineSimilarity(const std::vector<float>& a, const std::vector<float>& b) {
+    float dot = 0.0f;
+    float norm_a = 0.0f;
+    float norm_b = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) {
+        dot += a[i] * b[i];
+        norm_a += a[i] * a[i];
+        norm_b += b[i] * b[i];
+    }
+    if (norm_a <= 0.0f || norm_b <= 0.0f) {
+        return 0.0f;
+    }
+    return dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
+}
+
+int64_t ResponseCache::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ResponseCache::erase(EntryList::iterator it) {
+    by_key_.erase(it->key);
+    bytes_ -= it->bytes;
+    entries_.erase(it);
+}
+
+void ResponseCache::evictToFit() {
+    while (!entries_.empty() &&
+           (entries_.size() > config_.max_entries || bytes_ > config_.max_bytes)) {
+        erase(std::prev(entries_.end()));
+    }
+}
+
+} // namespace unamentis
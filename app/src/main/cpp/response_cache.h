@@ -0,0 +1,145 @@
+// UnaMentis - Response Cache Header
+// Replays earlier LLM answers for repeated or near-identical prompts
+//
+// Entries are keyed by a hash of the prompt token sequence and can also
+// carry a caller-supplied query embedding, so a differently worded
+// question with the same meaning can be answered from the cache.
+
+#ifndef UNAMENTIS_RESPONSE_CACHE_H
+#define UNAMENTIS_RESPONSE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "llama.h"
+
+namespace unamentis {
+
+/**
+ * Configuration for the response cache.
+ */
+struct ResponseCacheConfig {
+    size_t max_entries = 0;              // Maximum cached responses (0 = disabled)
+    size_t max_bytes = 1024 * 1024;      // Maximum memory for cached prompts/responses
+    int64_t ttl_ms = 10 * 60 * 1000;     // Entry lifetime in milliseconds
+    float similarity_threshold = 0.95f;  // Minimum cosine similarity for embedding hits
+};
+
+/**
+ * Response cache counters.
+ */
+struct ResponseCacheStats {
+    int64_t exact_hits = 0;
+    int64_t semantic_hits = 0;
+    int64_t misses = 0;
+    int64_t entries = 0;
+    int64_t bytes = 0;
+};
+
+/**
+ * LRU cache of completed responses.
+ *
+ * A lookup first tries an exact match on the prompt tokens, then, if a
+ * query embedding is given, the most similar entry above the threshold.
+ * Entries belong to a context key (e.g. the current curriculum topic);
+ * changing the key drops entries from the previous context.
+ *
+ * Thread-safe.
+ */
+class ResponseCache {
+public:
+    ResponseCache() = default;
+
+    /**
+     * Apply a configuration, evicting entries that no longer fit.
+     */
+    void configure(const ResponseCacheConfig& config);
+
+    /**
+     * Check whether caching is enabled.
+     */
+    bool enabled() const;
+
+    /**
+     * Set the context that new entries and lookups belong to.
+     * Entries from a different context are invalidated.
+     */
+    void setContext(const std::string& context_key);
+
+    /**
+     * Look up a cached response.
+     *
+     * @param prompt Prompt tokens
+     * @param embedding Optional query embedding (empty for exact-only)
+     * @param max_tokens Token budget of the request; longer responses don't match
+     * @param pieces Receives the cached output pieces on a hit
+     * @return true on a cache hit
+     */
+    bool lookup(
+        const std::vector<llama_token>& prompt,
+        const std::vector<float>& embedding,
+        int32_t max_tokens,
+        std::vector<std::string>& pieces
+    );
+
+    /**
+     * Store a completed response.
+     *
+     * @param prompt Prompt tokens
+     * @param embedding Optional query embedding
+     * @param pieces Output pieces in emission order
+     * @param n_tokens Number of tokens generated
+     */
+    void insert(
+        const std::vector<llama_token>& prompt,
+        const std::vector<float>& embedding,
+        const std::vector<std::string>& pieces,
+        int32_t n_tokens
+    );
+
+    /**
+     * Remove all entries.
+     */
+    void clear();
+
+    /**
+     * Get cache counters.
+     */
+    ResponseCacheStats stats();
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        std::vector<llama_token> prompt;
+        std::vector<float> embedding;
+        std::vector<std::string> pieces;
+        int32_t n_tokens = 0;
+        int64_t created_ms = 0;
+        size_t bytes = 0;
+    };
+
+    // Most recently used entries at the front
+    using EntryList = std::list<Entry>;
+
+    ResponseCacheConfig config_;
+    std::string context_key_;
+    EntryList entries_;
+    std::unordered_map<uint64_t, EntryList::iterator> by_key_;
+    size_t bytes_ = 0;
+    ResponseCacheStats stats_;
+    mutable std::mutex mutex_;
+
+    static uint64_t hashTokens(const std::vector<llama_token>& tokens);
+    static float cosineSimilarity(const std::vector<float>& a, const std::vector<float>& b);
+    static int64_t nowMs();
+
+    void erase(EntryList::iterator it);
+    void evictToFit();
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_RESPONSE_CACHE_H
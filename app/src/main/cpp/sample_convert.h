@@ -0,0 +1,105 @@
+// UnaMentis - Sample Format Conversion
+// Vectorized int16 <-> float PCM conversion
+//
+// int16 maps to float by dividing by 32768, so -32768 becomes exactly -1.
+// The way back rounds to nearest and saturates, so out-of-range floats clip
+// instead of wrapping. NEON (AArch64) and SSE2 paths handle eight samples
+// per step and match the scalar tail for finite input.
+//
+// Header-only so the audio engine, the ASR decoder JNI and host benchmarks
+// can all use it without another shared library.
+
+#ifndef UNAMENTIS_SAMPLE_CONVERT_H
+#define UNAMENTIS_SAMPLE_CONVERT_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define UNAMENTIS_CONVERT_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UNAMENTIS_CONVERT_SSE2 1
+#endif
+
+namespace unamentis {
+
+/**
+ * PCM sample formats a stream or consumer can use.
+ */
+enum class SampleFormat : int32_t {
+    FLOAT = 0,                         // 32-bit float, -1.0 to 1.0
+    I16 = 1,                           // 16-bit signed integer
+};
+
+inline size_t bytesPerSample(SampleFormat format) {
+    return format == SampleFormat::I16 ? sizeof(int16_t) : sizeof(float);
+}
+
+/**
+ * Convert int16 samples to float.
+ */
+inline void int16ToFloat(const int16_t* in, float* out, size_t count) {
+    constexpr float kScale = 1.0f / 32768.0f;
+    size_t i = 0;
+#if defined(UNAMENTIS_CONVERT_NEON)
+    const float32x4_t scale = vdupq_n_f32(kScale);
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t s = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), scale));
+        vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), scale));
+    }
+#elif defined(UNAMENTIS_CONVERT_SSE2)
+    const __m128 scale = _mm_set1_ps(kScale);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by placing each sample in the high half and shifting back
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = static_cast<float>(in[i]) * kScale;
+    }
+}
+
+/**
+ * Convert float samples to int16, rounding to nearest and saturating.
+ */
+inline void floatToInt16(const float* in, int16_t* out, size_t count) {
+    constexpr float kScale = 32768.0f;
+    size_t i = 0;
+#if defined(UNAMENTIS_CONVERT_NEON)
+    const float32x4_t scale = vdupq_n_f32(kScale);
+    for (; i + 8 <= count; i += 8) {
+        // Round-to-nearest conversion, then saturating narrow
+        const int32x4_t lo = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i), scale));
+        const int32x4_t hi = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i + 4), scale));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#elif defined(UNAMENTIS_CONVERT_SSE2)
+    const __m128 scale = _mm_set1_ps(kScale);
+    const __m128 upper = _mm_set1_ps(32767.0f);
+    const __m128 lower = _mm_set1_ps(-32768.0f);
+    for (; i + 8 <= count; i += 8) {
+        // Clamp first: cvtps rounds to nearest (default MXCSR) but overflows to INT_MIN
+        const __m128 a = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), upper), lower);
+        const __m128 b = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), upper), lower);
+        const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+#endif
+    for (; i < count; ++i) {
+        float scaled = std::nearbyint(in[i] * kScale);
+        scaled = scaled > 32767.0f ? 32767.0f : (scaled >= -32768.0f ? scaled : -32768.0f);
+        out[i] = static_cast<int16_t>(scaled);
+    }
+}
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_SAMPLE_CONVERT_H
@@ -0,0 +1,82 @@
+// UnaMentis - Shared Model Implementation
+// Process-wide llama.cpp model instances shared between native engines
+
+#include "shared_model.h"
+#include <android/log.h>
+#include <chrono>
+#include <map>
+
+#define LOG_TAG "SharedModel"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+namespace unamentis {
+
+// Models by path and offload settings; entries expire with their last user
+static std::mutex g_models_mutex;
+static std::map<std::string, std::weak_ptr<SharedModel>> g_models;
+
+SharedModel::SharedModel(llama_model* model, std::string key)
+    : model_(model), key_(std::move(key)) {}
+
+SharedModel::~SharedModel() {
+    LOGI("Releasing model %s", key_.c_str());
+    llama_model_free(model_);
+}
+
+void SharedModel::beginPriority() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    priority_users_++;
+}
+
+void SharedModel::endPriority() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--priority_users_ == 0) {
+        idle_.notify_all();
+    }
+}
+
+bool SharedModel::priorityActive() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return priority_users_ > 0;
+}
+
+int64_t SharedModel::yieldToPriority() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (priority_users_ == 0) {
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    idle_.wait(lock, [this]() { return priority_users_ == 0; });
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+std::shared_ptr<SharedModel> acquireSharedModel(
+    const std::string& path,
+    const llama_model_params& params
+) {
+    const std::string key = path + "#gpu" + std::to_string(params.n_gpu_layers);
+
+    // Loading can take seconds; holding the registry lock keeps a second
+    // engine asking for the same file from loading it twice
+    std::lock_guard<std::mutex> lock(g_models_mutex);
+    auto it = g_models.find(key);
+    if (it != g_models.end()) {
+        if (std::shared_ptr<SharedModel> existing = it->second.lock()) {
+            LOGI("Sharing loaded model %s", key.c_str());
+            return existing;
+        }
+    }
+
+    llama_model* model = llama_model_load_from_file(path.c_str(), params);
+    if (model == nullptr) {
+        return nullptr;
+    }
+
+    auto shared = std::make_shared<SharedModel>(model, key);
+    g_models[key] = shared;
+    return shared;
+}
+
+} // namespace unamentis
@@ -0,0 +1,102 @@
+// UnaMentis - Shared Model Header
+// Process-wide llama.cpp model instances shared between native engines
+//
+// GLMASRDecoder and LlamaInference each load a GGUF. When both are given
+// the same file (on low-RAM devices the GLM-ASR decoder backbone doubles as
+// the tutoring model), they hold one copy of the weights through this
+// registry and keep their own contexts. ASR decoding is marked as priority
+// work; text generation on the same weights pauses between tokens while it
+// runs, so the two roles take turns instead of competing for the cores.
+
+#ifndef UNAMENTIS_SHARED_MODEL_H
+#define UNAMENTIS_SHARED_MODEL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "llama.h"
+
+namespace unamentis {
+
+/**
+ * A loaded model and the cooperative schedule of the engines using it.
+ *
+ * The model is freed when the last engine releases it. Thread-safe.
+ */
+class SharedModel {
+public:
+    SharedModel(llama_model* model, std::string key);
+    ~SharedModel();
+
+    // Disable copy
+    SharedModel(const SharedModel&) = delete;
+    SharedModel& operator=(const SharedModel&) = delete;
+
+    llama_model* get() const { return model_; }
+
+    /**
+     * Mark the start/end of latency-critical work (ASR decoding).
+     */
+    void beginPriority();
+    void endPriority();
+
+    /**
+     * Check whether priority work is running.
+     */
+    bool priorityActive();
+
+    /**
+     * Block until no priority work is running.
+     *
+     * @return Time spent waiting in microseconds (0 if none was running)
+     */
+    int64_t yieldToPriority();
+
+private:
+    llama_model* model_;
+    std::string key_;
+
+    int32_t priority_users_ = 0;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+};
+
+/**
+ * Get the model loaded from path with the given parameters, loading it if
+ * no engine holds it yet.
+ *
+ * @return Shared model, or nullptr if loading failed
+ */
+std::shared_ptr<SharedModel> acquireSharedModel(
+    const std::string& path,
+    const llama_model_params& params
+);
+
+/**
+ * Marks priority work on a shared model for the lifetime of the scope.
+ */
+class PriorityScope {
+public:
+    explicit PriorityScope(SharedModel* model) : model_(model) {
+        if (model_ != nullptr) {
+            model_->beginPriority();
+        }
+    }
+    ~PriorityScope() {
+        if (model_ != nullptr) {
+            model_->endPriority();
+        }
+    }
+
+    PriorityScope(const PriorityScope&) = delete;
+    PriorityScope& operator=(const PriorityScope&) = delete;
+
+private:
+    SharedModel* model_;
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_SHARED_MODEL_H
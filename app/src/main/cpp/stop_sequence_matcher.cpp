@@ -0,0 +1,121 @@
+// UnaMentis - Stop Sequence Matcher Implementation
+// Multi-pattern stop-string detection over a streamed byte sequence
+
+#include "stop_sequence_matcher.h"
+#include <algorithm>
+#include <queue>
+
+namespace unamentis {
+
+StopSequenceMatcher::StopSequenceMatcher() {
+    setPatterns({});
+}
+
+int32_t StopSequenceMatcher::addState(int32_t depth) {
+    State state;
+    state.next.fill(-1);
+    state.depth = depth;
+    states_.push_back(state);
+    return static_cast<int32_t>(states_.size()) - 1;
+}
+
+void StopSequenceMatcher::setPatterns(const std::vector<std::string>& patterns) {
+    patterns_.clear();
+    states_.clear();
+    addState(0);
+
+    // Build the trie
+    for (const std::string& pattern : patterns) {
+        if (pattern.empty()) {
+            continue;
+        }
+        patterns_.push_back(pattern);
+
+        int32_t s = 0;
+        for (unsigned char c : pattern) {
+            if (states_[s].next[c] < 0) {
+                int32_t child = addState(states_[s].depth + 1);
+                states_[s].next[c] = child;
+            }
+            s = states_[s].next[c];
+        }
+        states_[s].match_len = std::max(states_[s].match_len, static_cast<int32_t>(pattern.size()));
+    }
+
+    // Resolve failure links breadth-first and turn the trie into a full DFA
+    std::queue<int32_t> queue;
+    for (int32_t c = 0; c < 256; ++c) {
+        int32_t child = states_[0].next[c];
+        if (child < 0) {
+            states_[0].next[c] = 0;
+        } else {
+            states_[child].fail = 0;
+            queue.push(child);
+        }
+    }
+
+    while (!queue.empty()) {
+        int32_t s = queue.front();
+        queue.pop();
+
+        // A suffix that is itself a stop string ends here too
+        const int32_t fail = states_[s].fail;
+        states_[s].match_len = std::max(states_[s].match_len, states_[fail].match_len);
+
+        for (int32_t c = 0; c < 256; ++c) {
+            int32_t child = states_[s].next[c];
+            if (child < 0) {
+                states_[s].next[c] = states_[fail].next[c];
+            } else {
+                states_[child].fail = states_[fail].next[c];
+                queue.push(child);
+            }
+        }
+    }
+
+    reset();
+}
+
+bool StopSequenceMatcher::feed(const std::string& piece, std::string& out) {
+    out.clear();
+
+    if (patterns_.empty()) {
+        out = piece;
+        return false;
+    }
+
+    for (unsigned char c : piece) {
+        state_ = states_[state_].next[c];
+        pending_.push_back(static_cast<char>(c));
+
+        const int32_t match_len = states_[state_].match_len;
+        if (match_len > 0) {
+            // Release everything before the stop string and drop the rest
+            out.assign(pending_, 0, pending_.size() - match_len);
+            reset();
+            return true;
+        }
+    }
+
+    // Hold back only the bytes that are still a prefix of some stop string
+    const size_t held = static_cast<size_t>(states_[state_].depth);
+    if (pending_.size() > held) {
+        out.assign(pending_, 0, pending_.size() - held);
+        pending_.erase(0, pending_.size() - held);
+    }
+    return false;
+}
+
+std::string StopSequenceMatcher::flush() {
+    std::string rest;
+    rest.swap(pending_);
+    state_ = 0;
+    return rest;
+}
+
+void StopSequenceMatcher::reset() {
+    state_ = 0;
+    pending_.clear();
+}
+
+} // namespace unamentis
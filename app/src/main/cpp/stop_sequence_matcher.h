@@ -0,0 +1,86 @@
+// UnaMentis - Stop Sequence Matcher Header
+// Multi-pattern stop-string detection over a streamed byte sequence
+//
+// Stop strings are compiled into an Aho-Corasick automaton (as a dense
+// byte DFA) and the detokenized output is fed through it piece by piece,
+// so a stop that spans several tokens is caught on the token that
+// completes it.
+
+#ifndef UNAMENTIS_STOP_SEQUENCE_MATCHER_H
+#define UNAMENTIS_STOP_SEQUENCE_MATCHER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace unamentis {
+
+/**
+ * Streaming multi-pattern stop-sequence matcher.
+ *
+ * Only the bytes that could still be the start of a stop string are held
+ * back; everything before them is released immediately. When a stop string
+ * completes, the text preceding it is released and the match is reported.
+ *
+ * Not thread-safe; owned by the generation thread.
+ */
+class StopSequenceMatcher {
+public:
+    StopSequenceMatcher();
+
+    /**
+     * Compile a set of stop strings. Empty strings are ignored.
+     * Resets the streaming state.
+     */
+    void setPatterns(const std::vector<std::string>& patterns);
+
+    /**
+     * Check whether any stop strings are configured.
+     */
+    bool empty() const { return patterns_.empty(); }
+
+    /**
+     * Get the configured stop strings.
+     */
+    const std::vector<std::string>& patterns() const { return patterns_; }
+
+    /**
+     * Feed the next piece of output.
+     *
+     * @param piece Detokenized bytes of the next token
+     * @param out Receives the bytes that are safe to emit (cleared first)
+     * @return true if a stop string completed within this piece; out then
+     *         holds the text up to the start of the match
+     */
+    bool feed(const std::string& piece, std::string& out);
+
+    /**
+     * Release any held-back bytes at the end of generation.
+     */
+    std::string flush();
+
+    /**
+     * Reset streaming state, keeping the compiled patterns.
+     */
+    void reset();
+
+private:
+    struct State {
+        std::array<int32_t, 256> next;  // Dense transitions (goto + failure resolved)
+        int32_t fail = 0;               // Failure link
+        int32_t depth = 0;              // Length of the prefix this state represents
+        int32_t match_len = 0;          // Longest stop string ending here, 0 if none
+    };
+
+    std::vector<std::string> patterns_;
+    std::vector<State> states_;
+    int32_t state_ = 0;
+    std::string pending_;
+
+    int32_t addState(int32_t depth);
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_STOP_SEQUENCE_MATCHER_H
@@ -0,0 +1,162 @@
+// UnaMentis - Telemetry Block
+// Live engine counters shared with Kotlin through a direct ByteBuffer
+//
+// Dashboards poll engine state several times a second, and every native
+// getter costs a JNI transition. Instead, each engine writes its counters
+// into memory Kotlin allocated with ByteBuffer.allocateDirect(), and readers
+// use plain buffer loads (see NativeTelemetryBlock.kt).
+//
+// Layout, native byte order:
+//   0   uint32 magic ('UNTB'; 0 while no engine is attached)
+//   4   uint32 layout (which engine's fields follow)
+//   8   uint32 sequence (odd while a write is in progress)
+//   12  uint32 field count
+//   16  int64 fields[field count]
+//
+// The sequence makes it a seqlock: a reader copies the fields between two
+// reads of the sequence and retries if they differ or are odd. Writers
+// never wait. A publish that finds another one in progress asks that
+// writer to publish again, so audio callbacks can publish too.
+
+#ifndef UNAMENTIS_TELEMETRY_BLOCK_H
+#define UNAMENTIS_TELEMETRY_BLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+namespace unamentis {
+
+/**
+ * Field layouts, one per engine. Field order is documented next to each
+ * engine's publishTelemetry().
+ */
+enum class TelemetryLayout : uint32_t {
+    AUDIO = 1,
+    LLM = 2,
+    ASR = 3,
+};
+
+/**
+ * Seqlock-protected counters in caller-owned shared memory.
+ */
+class TelemetryBlock {
+public:
+    static constexpr uint32_t kMagic = 0x42544e55;     // "UNTB" in little-endian memory
+    static constexpr size_t kHeaderBytes = 16;
+    static constexpr int32_t kMaxFields = 32;
+
+    static constexpr size_t bytesFor(int32_t fields) {
+        return kHeaderBytes + static_cast<size_t>(fields) * sizeof(int64_t);
+    }
+
+    /**
+     * Start publishing into memory (8-byte aligned, at least
+     * bytesFor(fields) long). Replaces any previous attachment.
+     *
+     * @return false if the memory is too small or misaligned
+     */
+    bool attach(void* memory, size_t capacity, TelemetryLayout layout, int32_t fields) {
+        detach();
+        if (memory == nullptr || fields <= 0 || fields > kMaxFields || capacity < bytesFor(fields) ||
+            reinterpret_cast<uintptr_t>(memory) % alignof(int64_t) != 0) {
+            return false;
+        }
+        auto* base = static_cast<unsigned char*>(memory);
+        for (int32_t i = 0; i < fields; ++i) {
+            __atomic_store_n(field(base, i), 0, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(word(base, 4), static_cast<uint32_t>(layout), __ATOMIC_RELAXED);
+        __atomic_store_n(word(base, 8), 0u, __ATOMIC_RELAXED);
+        __atomic_store_n(word(base, 12), static_cast<uint32_t>(fields), __ATOMIC_RELAXED);
+        // Readers check the magic first, so it goes in last
+        __atomic_store_n(word(base, 0), kMagic, __ATOMIC_RELEASE);
+        fields_ = fields;
+        base_.store(base, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Stop publishing and mark the memory as detached. Returns once no
+     * publish is using the memory, so the caller may then free it.
+     */
+    void detach() {
+        unsigned char* base = base_.exchange(nullptr, std::memory_order_acq_rel);
+        while (busy_.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        if (base != nullptr) {
+            __atomic_store_n(word(base, 0), 0u, __ATOMIC_RELEASE);
+        }
+        busy_.clear(std::memory_order_release);
+    }
+
+    bool attached() const { return base_.load(std::memory_order_relaxed) != nullptr; }
+
+    /**
+     * Publish a new set of values. fill(int64_t* values) writes the fields
+     * in layout order; it reads the engine's atomics and may run again if
+     * another thread published at the same time.
+     */
+    template <typename Fill>
+    void publish(Fill&& fill) {
+        if (!attached()) {
+            return;
+        }
+        for (;;) {
+            if (busy_.test_and_set(std::memory_order_acquire)) {
+                // The writer holding the block will publish again; if it
+                // released in the meantime, take it over
+                pending_.store(true);
+                if (busy_.test_and_set(std::memory_order_acquire)) {
+                    return;
+                }
+            }
+            pending_.store(false);
+            write(fill);
+            busy_.clear(std::memory_order_release);
+            if (!pending_.load()) {
+                return;
+            }
+        }
+    }
+
+private:
+    std::atomic<unsigned char*> base_{nullptr};
+    int32_t fields_ = 0;
+    std::atomic_flag busy_ = ATOMIC_FLAG_INIT;
+    std::atomic<bool> pending_{false};
+
+    static uint32_t* word(unsigned char* base, size_t offset) {
+        return reinterpret_cast<uint32_t*>(base + offset);
+    }
+
+    static int64_t* field(unsigned char* base, int32_t index) {
+        return reinterpret_cast<int64_t*>(base + kHeaderBytes) + index;
+    }
+
+    // Caller holds busy_
+    template <typename Fill>
+    void write(Fill& fill) {
+        unsigned char* base = base_.load(std::memory_order_acquire);
+        if (base == nullptr) {
+            return;
+        }
+        int64_t values[kMaxFields] = {};
+        fill(values);
+
+        uint32_t* sequence = word(base, 8);
+        const uint32_t start = __atomic_load_n(sequence, __ATOMIC_RELAXED);
+        __atomic_store_n(sequence, start + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        for (int32_t i = 0; i < fields_; ++i) {
+            __atomic_store_n(field(base, i), values[i], __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(sequence, start + 2, __ATOMIC_RELEASE);
+    }
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_TELEMETRY_BLOCK_H
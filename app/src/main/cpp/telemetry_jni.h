@@ -0,0 +1,58 @@
+// UnaMentis - Telemetry Block JNI Helpers
+// Keeps the Kotlin ByteBuffers behind engines' telemetry blocks alive
+
+#ifndef UNAMENTIS_TELEMETRY_JNI_H
+#define UNAMENTIS_TELEMETRY_JNI_H
+
+#include <jni.h>
+#include <map>
+#include <mutex>
+
+namespace unamentis {
+
+/**
+ * Global references to the direct ByteBuffers engines publish into, keyed
+ * by engine pointer. An engine must be detached from its block before
+ * release(), which lets the buffer be collected.
+ */
+class TelemetryBuffers {
+public:
+    /**
+     * Hold a buffer for an engine, replacing any previous one.
+     *
+     * @return The buffer's memory, or nullptr if it isn't a direct buffer
+     */
+    void* hold(JNIEnv* env, jlong engine, jobject buffer, jlong& capacity) {
+        release(env, engine);
+        void* memory = buffer != nullptr ? env->GetDirectBufferAddress(buffer) : nullptr;
+        if (memory == nullptr) {
+            return nullptr;
+        }
+        capacity = env->GetDirectBufferCapacity(buffer);
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffers_[engine] = env->NewGlobalRef(buffer);
+        return memory;
+    }
+
+    void release(JNIEnv* env, jlong engine) {
+        jobject buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = buffers_.find(engine);
+            if (it == buffers_.end()) {
+                return;
+            }
+            buffer = it->second;
+            buffers_.erase(it);
+        }
+        env->DeleteGlobalRef(buffer);
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<jlong, jobject> buffers_;
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_TELEMETRY_JNI_H
@@ -0,0 +1,140 @@
+// UnaMentis - Thread Policy Implementation
+// Keeps the audio callback clear of inference compute threads
+
+#include "thread_policy.h"
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace unamentis {
+
+// Niceness for the audio thread when SCHED_FIFO isn't granted
+// (ANDROID_PRIORITY_URGENT_AUDIO)
+static constexpr int kAudioNice = -19;
+static constexpr int32_t kMinCoresForIsolation = 4;
+
+static std::atomic<bool> g_isolation{true};
+static std::atomic<int32_t> g_compute_users{0};
+
+// Cores the process may run on, captured before any thread narrows its mask
+static const std::vector<int32_t>& usableCores() {
+    static const std::vector<int32_t> cores = [] {
+        std::vector<int32_t> result;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    result.push_back(cpu);
+                }
+            }
+        }
+        return result;
+    }();
+    return cores;
+}
+
+static int64_t maxFrequencyKhz(int32_t cpu) {
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        return 0;
+    }
+    long long khz = 0;
+    if (fscanf(file, "%lld", &khz) != 1) {
+        khz = 0;
+    }
+    fclose(file);
+    return khz;
+}
+
+static int32_t pickAudioCore() {
+    const std::vector<int32_t>& cores = usableCores();
+    if (static_cast<int32_t>(cores.size()) < kMinCoresForIsolation) {
+        return -1;
+    }
+
+    // Last core of the slowest cluster; without cpufreq, the last core
+    int32_t chosen = cores.back();
+    int64_t slowest = INT64_MAX;
+    for (int32_t cpu : cores) {
+        const int64_t khz = maxFrequencyKhz(cpu);
+        if (khz > 0 && khz <= slowest) {
+            slowest = khz;
+            chosen = cpu;
+        }
+    }
+    return chosen;
+}
+
+void setAudioIsolation(bool enabled) {
+    g_isolation.store(enabled);
+}
+
+bool audioIsolationEnabled() {
+    return g_isolation.load();
+}
+
+int32_t reservedAudioCore() {
+    static const int32_t core = pickAudioCore();
+    return g_isolation.load() ? core : -1;
+}
+
+std::vector<int32_t> computeCores() {
+    const int32_t reserved = reservedAudioCore();
+    std::vector<int32_t> result;
+    for (int32_t cpu : usableCores()) {
+        if (cpu != reserved) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+int32_t fillComputeCpumask(bool* mask, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        mask[i] = false;
+    }
+    int32_t marked = 0;
+    for (int32_t cpu : computeCores()) {
+        if (static_cast<size_t>(cpu) < size) {
+            mask[cpu] = true;
+            marked++;
+        }
+    }
+    return marked;
+}
+
+bool promoteAudioThread() {
+    const int32_t core = reservedAudioCore();
+    if (core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+
+    const int policy = sched_getscheduler(0);
+    if (policy == SCHED_FIFO || policy == SCHED_RR) {
+        return true;
+    }
+    return setpriority(PRIO_PROCESS, 0, kAudioNice) == 0;
+}
+
+void beginComputeLoad() {
+    g_compute_users.fetch_add(1);
+}
+
+void endComputeLoad() {
+    g_compute_users.fetch_sub(1);
+}
+
+bool computeLoadActive() {
+    return g_compute_users.load() > 0;
+}
+
+} // namespace unamentis
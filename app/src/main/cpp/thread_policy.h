@@ -0,0 +1,89 @@
+// UnaMentis - Thread Policy Header
+// Keeps the audio callback clear of inference compute threads
+//
+// With isolation on, one core is reserved for audio: ggml thread pools are
+// restricted to the remaining cores, and the Oboe callback thread pins
+// itself to the reserved core at raised priority. Engines mark their decode
+// work with ComputeLoadScope so audio deadline misses can be split into
+// periods with and without inference load.
+//
+// The policy is process-wide; compute pools pick it up at the start of the
+// next turn that finds them idle.
+
+#ifndef UNAMENTIS_THREAD_POLICY_H
+#define UNAMENTIS_THREAD_POLICY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace unamentis {
+
+/**
+ * Enable or disable reserving a core for audio (enabled by default).
+ */
+void setAudioIsolation(bool enabled);
+
+/**
+ * Check whether a core is reserved for audio.
+ */
+bool audioIsolationEnabled();
+
+/**
+ * Get the core reserved for audio: the highest-numbered core of the
+ * slowest cluster, so the big cores stay with inference.
+ *
+ * @return Core index, or -1 when isolation is off or there are fewer than
+ *         four usable cores
+ */
+int32_t reservedAudioCore();
+
+/**
+ * Get the cores inference threads may run on (all usable cores except the
+ * reserved one).
+ */
+std::vector<int32_t> computeCores();
+
+/**
+ * Mark the compute cores in a ggml-style cpumask.
+ *
+ * @param mask Mask to fill (cleared first)
+ * @param size Number of entries in the mask
+ * @return Number of cores marked
+ */
+int32_t fillComputeCpumask(bool* mask, size_t size);
+
+/**
+ * Pin the calling audio thread to the reserved core and raise its priority.
+ * Threads already running SCHED_FIFO (AAudio MMAP) keep their scheduling.
+ *
+ * @return true if the thread runs at real-time or raised priority
+ */
+bool promoteAudioThread();
+
+/**
+ * Mark the start/end of inference compute.
+ */
+void beginComputeLoad();
+void endComputeLoad();
+
+/**
+ * Check whether any engine is decoding.
+ */
+bool computeLoadActive();
+
+/**
+ * Marks inference compute for the lifetime of the scope.
+ */
+class ComputeLoadScope {
+public:
+    ComputeLoadScope() { beginComputeLoad(); }
+    ~ComputeLoadScope() { endComputeLoad(); }
+
+    ComputeLoadScope(const ComputeLoadScope&) = delete;
+    ComputeLoadScope& operator=(const ComputeLoadScope&) = delete;
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_THREAD_POLICY_H
@@ -0,0 +1,96 @@
+// UnaMentis - Transcript Stitcher Implementation
+// Merges transcripts of overlapping audio windows
+
+#include "transcript_stitcher.h"
+#include <algorithm>
+
+namespace unamentis {
+
+// Extra tokens searched beyond the estimated overlap (speech rate varies)
+static constexpr int32_t kAlignSlackTokens = 4;
+
+// A shared run must be this long, and cover this fraction of the expected
+// overlap, to be trusted; shorter ones are usually a common word or
+// punctuation matching by chance
+static constexpr int32_t kMinAlignTokens = 3;
+static constexpr int32_t kMinAlignFraction = 3;   // 1/3 of the overlap
+
+TranscriptStitcher::TranscriptStitcher(int32_t overlap_ms)
+    : overlap_ms_(std::max(0, overlap_ms)) {
+}
+
+void TranscriptStitcher::reset() {
+    tokens_.clear();
+    last_tokens_ = 0;
+    last_duration_ms_ = 0;
+}
+
+int32_t TranscriptStitcher::overlapTokens(int32_t n_tokens, int32_t duration_ms) const {
+    if (duration_ms <= 0) {
+        return 0;
+    }
+    const int64_t share = (static_cast<int64_t>(n_tokens) * overlap_ms_ + duration_ms - 1) / duration_ms;
+    return static_cast<int32_t>(std::min<int64_t>(share, n_tokens));
+}
+
+void TranscriptStitcher::append(const std::vector<llama_token>& tokens, int32_t duration_ms) {
+    const int32_t n_new = static_cast<int32_t>(tokens.size());
+
+    if (tokens_.empty() || overlap_ms_ == 0) {
+        tokens_.insert(tokens_.end(), tokens.begin(), tokens.end());
+        last_tokens_ = n_new;
+        last_duration_ms_ = duration_ms;
+        return;
+    }
+
+    // Only the edges that can overlap are searched
+    const int32_t n_tail = std::min(
+        static_cast<int32_t>(tokens_.size()),
+        overlapTokens(last_tokens_, last_duration_ms_) + kAlignSlackTokens);
+    const int32_t n_head = std::min(n_new, overlapTokens(n_new, duration_ms) + kAlignSlackTokens);
+    const size_t tail_start = tokens_.size() - n_tail;
+
+    // Longest common run between the tail and the head (dynamic programming)
+    int32_t best_len = 0;
+    int32_t best_tail_end = 0;
+    int32_t best_head_end = 0;
+    std::vector<int32_t> prev(n_head + 1, 0);
+    std::vector<int32_t> cur(n_head + 1, 0);
+    for (int32_t i = 1; i <= n_tail; ++i) {
+        for (int32_t j = 1; j <= n_head; ++j) {
+            if (tokens_[tail_start + i - 1] == tokens[j - 1]) {
+                cur[j] = prev[j - 1] + 1;
+                if (cur[j] > best_len) {
+                    best_len = cur[j];
+                    best_tail_end = i;
+                    best_head_end = j;
+                }
+            } else {
+                cur[j] = 0;
+            }
+        }
+        std::swap(prev, cur);
+    }
+
+    const int32_t expected = overlapTokens(n_new, duration_ms);
+    const int32_t min_run = std::max(kMinAlignTokens, expected / kMinAlignFraction);
+
+    size_t keep;   // Tokens of the stitched text to keep
+    size_t skip;   // Leading tokens of the new window to drop
+    if (best_len >= min_run) {
+        // Join in the middle of the shared run
+        const int32_t half = best_len / 2;
+        keep = tail_start + (best_tail_end - best_len) + half;
+        skip = static_cast<size_t>((best_head_end - best_len) + half);
+    } else {
+        keep = tokens_.size();
+        skip = static_cast<size_t>(expected);
+    }
+
+    tokens_.resize(keep);
+    tokens_.insert(tokens_.end(), tokens.begin() + std::min(skip, tokens.size()), tokens.end());
+    last_tokens_ = n_new;
+    last_duration_ms_ = duration_ms;
+}
+
+} // namespace unamentis
@@ -0,0 +1,68 @@
+// UnaMentis - Transcript Stitcher Header
+// Merges transcripts of overlapping audio windows
+//
+// Long recordings are decoded as overlapping windows so that no word is
+// cut at a window edge. The overlap is transcribed twice; the stitcher
+// aligns the end of one window's tokens with the start of the next and
+// keeps each word once.
+
+#ifndef UNAMENTIS_TRANSCRIPT_STITCHER_H
+#define UNAMENTIS_TRANSCRIPT_STITCHER_H
+
+#include <cstdint>
+#include <vector>
+#include "llama.h"
+
+namespace unamentis {
+
+/**
+ * Accumulates window transcripts and joins them by token alignment.
+ *
+ * For each new window, the longest run of tokens shared between the
+ * tail of the text so far and the head of the window is located. The
+ * two are joined in the middle of that run, so each side contributes
+ * the part of the overlap that was furthest from its own window edge.
+ * Without a shared run long enough to rule out a chance match (at least
+ * three tokens and a third of the expected overlap), the window's share
+ * of the overlap is estimated from its duration and skipped.
+ *
+ * Not thread-safe.
+ */
+class TranscriptStitcher {
+public:
+    /**
+     * @param overlap_ms Audio shared by consecutive windows
+     */
+    explicit TranscriptStitcher(int32_t overlap_ms);
+
+    /**
+     * Clear the stitched transcript.
+     */
+    void reset();
+
+    /**
+     * Append the next window's transcript.
+     *
+     * @param tokens Tokens decoded from the window
+     * @param duration_ms Audio length of the window
+     */
+    void append(const std::vector<llama_token>& tokens, int32_t duration_ms);
+
+    /**
+     * Get the stitched transcript.
+     */
+    const std::vector<llama_token>& tokens() const { return tokens_; }
+
+private:
+    int32_t overlap_ms_;
+    std::vector<llama_token> tokens_;
+    int32_t last_tokens_ = 0;       // Token count of the previous window
+    int32_t last_duration_ms_ = 0;  // Duration of the previous window
+
+    // Tokens of a window's transcript expected to fall in the overlap
+    int32_t overlapTokens(int32_t n_tokens, int32_t duration_ms) const;
+};
+
+} // namespace unamentis
+
+#endif // UNAMENTIS_TRANSCRIPT_STITCHER_H
@@ -1,20 +1,107 @@
 package com.unamentis.core.audio
 
+import com.unamentis.core.telemetry.NativeTelemetryBlock
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.asStateFlow
+import java.nio.ByteBuffer
+
+/**
+ * PCM sample format exchanged with the audio engine.
+ */
+enum class SampleFormat {
+    /** 32-bit float, -1.0 to 1.0 */
+    FLOAT,
+
+    /** 16-bit signed integer */
+    I16,
+}
 
 /**
  * Audio engine configuration.
  *
+ * The formats are what the app hands to and receives from the engine. The
+ * engine asks the device for the same format and converts in native code
+ * only when the device picks the other one.
+ *
  * @property sampleRate Sample rate in Hz (default: 16000 for STT compatibility)
  * @property channelCount Number of audio channels (default: 1 for mono)
  * @property framesPerBurst Frames per audio burst (default: 192, ~12ms at 16kHz)
+ * @property captureFormat Format of captured audio ([AudioEngine.startCapture] or [AudioEngine.startCaptureI16])
+ * @property playbackFormat Format the playback queue holds; the other format is converted when queued
  */
 data class AudioConfig(
     val sampleRate: Int = 16000,
     val channelCount: Int = 1,
     val framesPerBurst: Int = 192,
+    val captureFormat: SampleFormat = SampleFormat.FLOAT,
+    val playbackFormat: SampleFormat = SampleFormat.FLOAT,
+)
+
+/**
+ * Playback loudness normalization and limiting.
+ *
+ * Audio from every TTS provider is brought to the same short-term loudness
+ * in the native playback path, and a look-ahead limiter keeps peaks under
+ * the ceiling, so chunks can be queued as soon as they arrive.
+ *
+ * @property enabled Whether playback is normalized and limited
+ * @property targetLufs Short-term loudness to aim for
+ * @property maxGainDb Largest boost or cut applied
+ * @property ceilingDb Limiter ceiling in dBFS
+ * @property lookaheadMs Limiter look-ahead (added output latency, at most 20 ms)
+ */
+data class LoudnessConfig(
+    val enabled: Boolean = true,
+    val targetLufs: Float = -16f,
+    val maxGainDb: Float = 12f,
+    val ceilingDb: Float = -1f,
+    val lookaheadMs: Float = 5f,
+)
+
+/**
+ * Playback loudness state.
+ *
+ * @property shortTermLufs Measured loudness of the queued audio (-70 = nothing measured yet)
+ * @property gainDb Normalization gain being applied
+ * @property maxReductionDb Deepest limiter gain reduction
+ * @property limitedSamples Samples the limiter turned down
+ */
+data class LoudnessStats(
+    val shortTermLufs: Float = -70f,
+    val gainDb: Float = 0f,
+    val maxReductionDb: Float = 0f,
+    val limitedSamples: Long = 0,
+)
+
+/**
+ * Speech onset detection on the native capture thread.
+ *
+ * @property enabled Whether onsets are detected (mono capture only)
+ * @property marginDb Level over the noise floor that can start speech
+ * @property fluxDb Band-energy rise that marks a speech attack
+ * @property confirmMs Speech needed after the attack before it counts
+ * @property releaseMs Quiet needed before the next onset can fire
+ */
+data class OnsetConfig(
+    val enabled: Boolean = true,
+    val marginDb: Float = 12f,
+    val fluxDb: Float = 6f,
+    val confirmMs: Int = 30,
+    val releaseMs: Int = 250,
+)
+
+/**
+ * A speech onset found in captured audio.
+ *
+ * @property frame Capture stream frame position of the first speech sample
+ * @property timeNanos When that frame was captured, on the [System.nanoTime] clock (CLOCK_MONOTONIC)
+ * @property precise Whether the time comes from the stream's hardware timestamp rather than callback timing
+ */
+data class SpeechOnset(
+    val frame: Long,
+    val timeNanos: Long,
+    val precise: Boolean,
 )
 
 /**
@@ -28,6 +115,49 @@ data class AudioLevel(
     val peak: Float = 0f,
 )
 
+/**
+ * Audio callback deadline counters, split by whether an inference engine
+ * was decoding when the callback ran.
+ *
+ * @property callbacks Callbacks without inference running
+ * @property misses Callbacks that overran their period or started a burst late, without inference
+ * @property loadedCallbacks Callbacks while an engine was decoding
+ * @property loadedMisses Missed deadlines while an engine was decoding
+ * @property maxCallbackUs Longest callback in microseconds
+ * @property maxIntervalUs Longest gap between callbacks in microseconds
+ */
+data class AudioDeadlineStats(
+    val callbacks: Long = 0,
+    val misses: Long = 0,
+    val loadedCallbacks: Long = 0,
+    val loadedMisses: Long = 0,
+    val maxCallbackUs: Long = 0,
+    val maxIntervalUs: Long = 0,
+)
+
+/**
+ * Live audio engine counters, read from shared memory without a JNI call.
+ *
+ * @property capturing Whether the capture stream is running
+ * @property playing Whether the playback stream is running
+ * @property queuedPlaybackSamples Samples queued for playback but not yet played
+ * @property capturedFrames Frames captured since the stream started
+ * @property captureXRuns Capture stream overruns reported by the device
+ * @property playbackXRuns Playback stream underruns reported by the device
+ * @property captureDeadlineMisses Capture callbacks that missed their deadline
+ * @property playbackDeadlineMisses Playback callbacks that missed their deadline
+ */
+data class AudioTelemetry(
+    val capturing: Boolean = false,
+    val playing: Boolean = false,
+    val queuedPlaybackSamples: Long = 0,
+    val capturedFrames: Long = 0,
+    val captureXRuns: Long = 0,
+    val playbackXRuns: Long = 0,
+    val captureDeadlineMisses: Long = 0,
+    val playbackDeadlineMisses: Long = 0,
+)
+
 /**
  * Low-latency audio engine for voice conversations.
  *
@@ -48,10 +178,17 @@ data class AudioLevel(
  *     // Process captured audio
  * }
  * ```
+ *
+ * Consumers that work on 16-bit PCM (e.g. an int16 ASR front end) set
+ * [AudioConfig.captureFormat] to [SampleFormat.I16] and use
+ * [startCaptureI16], so samples aren't converted to float and back.
  */
 class AudioEngine {
     private var nativeEnginePtr: Long = 0
+    private var config = AudioConfig()
     private var captureCallback: ((FloatArray) -> Unit)? = null
+    private var captureCallbackI16: ((ShortArray) -> Unit)? = null
+    private val telemetry = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_AUDIO, TELEMETRY_FIELDS)
 
     private val _audioLevel = MutableStateFlow(AudioLevel())
     val audioLevel: StateFlow<AudioLevel> = _audioLevel.asStateFlow()
@@ -63,6 +200,12 @@ class AudioEngine {
     val isPlaying: StateFlow<Boolean> = _isPlaying.asStateFlow()
 
     companion object {
+        private const val PCM16_SCALE = 32768f
+        private const val ONSET_FIELDS = 3
+        private const val TELEMETRY_FIELDS = 7
+        private const val FLAG_CAPTURING = 1L
+        private const val FLAG_PLAYING = 2L
+
         init {
             try {
                 System.loadLibrary("audio_engine")
@@ -96,9 +239,16 @@ class AudioEngine {
                 config.sampleRate,
                 config.channelCount,
                 config.framesPerBurst,
+                config.captureFormat.ordinal,
+                config.playbackFormat.ordinal,
             )
 
-        if (!success) {
+        if (success) {
+            this.config = config
+            if (!nativeAttachTelemetry(nativeEnginePtr, telemetry.buffer)) {
+                android.util.Log.w("AudioEngine", "Live telemetry unavailable")
+            }
+        } else {
             nativeDestroy(nativeEnginePtr)
             nativeEnginePtr = 0
         }
@@ -123,11 +273,53 @@ class AudioEngine {
             return false
         }
 
+        if (config.captureFormat != SampleFormat.FLOAT) {
+            android.util.Log.e("AudioEngine", "Capture format is ${config.captureFormat}; use startCaptureI16")
+            return false
+        }
+
         captureCallback = callback
         val success = nativeStartCapture(nativeEnginePtr)
 
         if (success) {
             _isCapturing.value = true
+        } else {
+            captureCallback = null
+        }
+
+        return success
+    }
+
+    /**
+     * Start capturing 16-bit audio. Requires [AudioConfig.captureFormat]
+     * [SampleFormat.I16].
+     *
+     * @param callback Callback invoked with captured audio data
+     * @return true if capture started successfully
+     */
+    fun startCaptureI16(callback: (ShortArray) -> Unit): Boolean {
+        if (nativeEnginePtr == 0L) {
+            android.util.Log.e("AudioEngine", "Engine not initialized")
+            return false
+        }
+
+        if (_isCapturing.value) {
+            android.util.Log.w("AudioEngine", "Already capturing")
+            return false
+        }
+
+        if (config.captureFormat != SampleFormat.I16) {
+            android.util.Log.e("AudioEngine", "Capture format is ${config.captureFormat}; use startCapture")
+            return false
+        }
+
+        captureCallbackI16 = callback
+        val success = nativeStartCapture(nativeEnginePtr)
+
+        if (success) {
+            _isCapturing.value = true
+        } else {
+            captureCallbackI16 = null
         }
 
         return success
@@ -144,6 +336,7 @@ class AudioEngine {
         nativeStopCapture(nativeEnginePtr)
         _isCapturing.value = false
         captureCallback = null
+        captureCallbackI16 = null
         _audioLevel.value = AudioLevel()
     }
 
@@ -168,6 +361,27 @@ class AudioEngine {
         return success
     }
 
+    /**
+     * Queue 16-bit audio data for playback.
+     *
+     * @param audioData Audio samples (16-bit PCM)
+     * @return true if data was queued successfully
+     */
+    fun queuePlayback(audioData: ShortArray): Boolean {
+        if (nativeEnginePtr == 0L) {
+            android.util.Log.e("AudioEngine", "Engine not initialized")
+            return false
+        }
+
+        val success = nativeQueuePlaybackI16(nativeEnginePtr, audioData)
+
+        if (success && !_isPlaying.value) {
+            _isPlaying.value = true
+        }
+
+        return success
+    }
+
     /**
      * Stop audio playback.
      */
@@ -180,6 +394,141 @@ class AudioEngine {
         _isPlaying.value = false
     }
 
+    /**
+     * Reserve a CPU core for audio callbacks, away from inference threads.
+     *
+     * Process-wide and enabled by default; inference thread pools pick it
+     * up at the start of their next turn.
+     */
+    fun setAudioIsolation(enabled: Boolean) {
+        nativeSetAudioIsolation(enabled)
+    }
+
+    /**
+     * Configure speech onset detection on captured audio (off until called).
+     */
+    fun setOnsetDetection(config: OnsetConfig) {
+        if (nativeEnginePtr != 0L) {
+            nativeSetOnsetDetection(
+                nativeEnginePtr,
+                config.enabled,
+                config.marginDb,
+                config.fluxDb,
+                config.confirmMs,
+                config.releaseMs,
+            )
+        }
+    }
+
+    /**
+     * Take the speech onsets detected since the last call, oldest first.
+     */
+    fun drainOnsets(): List<SpeechOnset> {
+        if (nativeEnginePtr == 0L) {
+            return emptyList()
+        }
+        val values = nativeDrainOnsets(nativeEnginePtr)
+        return (0 until values.size / ONSET_FIELDS).map { i ->
+            SpeechOnset(
+                frame = values[i * ONSET_FIELDS],
+                timeNanos = values[i * ONSET_FIELDS + 1],
+                precise = values[i * ONSET_FIELDS + 2] != 0L,
+            )
+        }
+    }
+
+    /**
+     * Configure playback loudness normalization and limiting.
+     */
+    fun setLoudness(config: LoudnessConfig) {
+        if (nativeEnginePtr != 0L) {
+            nativeSetLoudness(
+                nativeEnginePtr,
+                config.enabled,
+                config.targetLufs,
+                config.maxGainDb,
+                config.ceilingDb,
+                config.lookaheadMs,
+            )
+        }
+    }
+
+    /**
+     * Get playback loudness and limiter state.
+     */
+    fun getLoudnessStats(): LoudnessStats {
+        if (nativeEnginePtr == 0L) {
+            return LoudnessStats()
+        }
+        val values = nativeGetLoudnessStats(nativeEnginePtr)
+        return LoudnessStats(
+            shortTermLufs = values[0],
+            gainDb = values[1],
+            maxReductionDb = values[2],
+            limitedSamples = values[3].toLong(),
+        )
+    }
+
+    /**
+     * Get callback deadline counters for the capture or playback stream.
+     */
+    fun getDeadlineStats(capture: Boolean = true): AudioDeadlineStats {
+        if (nativeEnginePtr == 0L) {
+            return AudioDeadlineStats()
+        }
+        val values = nativeGetDeadlineStats(nativeEnginePtr, capture)
+        return AudioDeadlineStats(
+            callbacks = values[0],
+            misses = values[1],
+            loadedCallbacks = values[2],
+            loadedMisses = values[3],
+            maxCallbackUs = values[4],
+            maxIntervalUs = values[5],
+        )
+    }
+
+    /**
+     * Clear callback deadline counters.
+     */
+    fun resetDeadlineStats() {
+        if (nativeEnginePtr != 0L) {
+            nativeResetDeadlineStats(nativeEnginePtr)
+        }
+    }
+
+    /**
+     * Read live engine counters without a JNI call, cheap enough to poll
+     * every frame.
+     *
+     * @return The latest counters, or null if the engine isn't initialized
+     */
+    fun readTelemetry(): AudioTelemetry? {
+        if (nativeEnginePtr == 0L) {
+            return null
+        }
+        val values = telemetry.snapshot() ?: return null
+        return AudioTelemetry(
+            capturing = (values[0] and FLAG_CAPTURING) != 0L,
+            playing = (values[0] and FLAG_PLAYING) != 0L,
+            queuedPlaybackSamples = values[1],
+            capturedFrames = values[2],
+            captureXRuns = values[3],
+            playbackXRuns = values[4],
+            captureDeadlineMisses = values[5],
+            playbackDeadlineMisses = values[6],
+        )
+    }
+
+    /**
+     * Get seconds of audio queued for playback but not yet played.
+     */
+    fun getQueuedPlaybackSeconds(): Float {
+        if (nativeEnginePtr == 0L) {
+            return 0f
+        }
+        return nativeGetQueuedPlaybackSeconds(nativeEnginePtr)
+    }
+
     /**
      * Calculate audio level from samples.
      *
@@ -216,6 +565,28 @@ class AudioEngine {
         captureCallback?.invoke(audioData)
     }
 
+    /**
+     * Called from native code when 16-bit audio is captured.
+     * This method is invoked from the native audio thread via JNI.
+     * Do not call directly.
+     *
+     * @param audioData Captured audio samples (16-bit PCM)
+     */
+    @Suppress("unused")
+    fun onNativeAudioDataI16(audioData: ShortArray) {
+        if (audioData.isNotEmpty()) {
+            var sumSquares = 0f
+            var peak = 0f
+            for (sample in audioData) {
+                val value = sample / PCM16_SCALE
+                sumSquares += value * value
+                peak = maxOf(peak, kotlin.math.abs(value))
+            }
+            _audioLevel.value = AudioLevel(rms = kotlin.math.sqrt(sumSquares / audioData.size), peak = peak)
+        }
+        captureCallbackI16?.invoke(audioData)
+    }
+
     /**
      * Release native resources.
      */
@@ -237,6 +608,8 @@ class AudioEngine {
         sampleRate: Int,
         channelCount: Int,
         framesPerBurst: Int,
+        captureFormat: Int,
+        playbackFormat: Int,
     ): Boolean
 
     private external fun nativeStartCapture(enginePtr: Long): Boolean
@@ -248,7 +621,50 @@ class AudioEngine {
         audioData: FloatArray,
     ): Boolean
 
+    private external fun nativeQueuePlaybackI16(
+        enginePtr: Long,
+        audioData: ShortArray,
+    ): Boolean
+
     private external fun nativeStopPlayback(enginePtr: Long)
 
+    private external fun nativeGetQueuedPlaybackSeconds(enginePtr: Long): Float
+
+    private external fun nativeSetAudioIsolation(enabled: Boolean)
+
+    private external fun nativeSetOnsetDetection(
+        enginePtr: Long,
+        enabled: Boolean,
+        marginDb: Float,
+        fluxDb: Float,
+        confirmMs: Int,
+        releaseMs: Int,
+    )
+
+    private external fun nativeDrainOnsets(enginePtr: Long): LongArray
+
+    private external fun nativeSetLoudness(
+        enginePtr: Long,
+        enabled: Boolean,
+        targetLufs: Float,
+        maxGainDb: Float,
+        ceilingDb: Float,
+        lookaheadMs: Float,
+    )
+
+    private external fun nativeGetLoudnessStats(enginePtr: Long): FloatArray
+
+    private external fun nativeGetDeadlineStats(
+        enginePtr: Long,
+        capture: Boolean,
+    ): LongArray
+
+    private external fun nativeResetDeadlineStats(enginePtr: Long)
+
+    private external fun nativeAttachTelemetry(
+        enginePtr: Long,
+        buffer: ByteBuffer?,
+    ): Boolean
+
     private external fun nativeDestroy(enginePtr: Long)
 }
@@ -0,0 +1,200 @@
+package com.unamentis.core.audio
+
+/**
+ * Endpointing thresholds.
+ *
+ * @property sampleRate Sample rate of the frames fed to the detector
+ * @property speechThreshold VAD confidence that counts as speech
+ * @property minSpeechMs Speech needed before a turn starts
+ * @property baseHangoverMs Silence that ends a turn without other cues
+ * @property minHangoverMs Silence that ends a turn after a complete sentence
+ * @property maxHangoverMs Upper bound for hesitant speakers and open sentences
+ */
+data class EndpointConfig(
+    val sampleRate: Int = 16000,
+    val speechThreshold: Float = 0.5f,
+    val minSpeechMs: Int = 60,
+    val baseHangoverMs: Int = 600,
+    val minHangoverMs: Int = 250,
+    val maxHangoverMs: Int = 1200,
+)
+
+/**
+ * Result of feeding one frame to the [EndpointDetector].
+ */
+enum class EndpointEvent {
+    NONE,
+    SPEECH_START,
+    END_OF_UTTERANCE,
+}
+
+/**
+ * Endpoint counters. Latency is the silence between the learner's last
+ * speech frame and the endpoint.
+ *
+ * @property endpoints Turns ended
+ * @property resumedPauses Pauses the learner broke before the hangover ran out
+ * @property punctuationEndpoints Turns ended early on a transcript cue
+ */
+data class EndpointStats(
+    val endpoints: Long = 0,
+    val resumedPauses: Long = 0,
+    val punctuationEndpoints: Long = 0,
+    val meanLatencyMs: Long = 0,
+    val p50LatencyMs: Long = 0,
+    val p90LatencyMs: Long = 0,
+    val maxLatencyMs: Long = 0,
+)
+
+/**
+ * Native end-of-utterance detector.
+ *
+ * Replaces a fixed silence timeout with a hangover chosen per pause from
+ * the VAD, the energy trend into the pause, the learner's earlier pauses
+ * and, when available, partial transcripts: a finished sentence ends the
+ * turn quickly, a trailing "and" or "um" waits longer.
+ *
+ * Usage:
+ * ```kotlin
+ * val detector = EndpointDetector()
+ * when (detector.process(frame, vadResult.confidence)) {
+ *     EndpointEvent.END_OF_UTTERANCE -> finalizeTurn()
+ *     else -> {}
+ * }
+ * ```
+ */
+class EndpointDetector(config: EndpointConfig = EndpointConfig()) {
+    private var nativeDetectorPtr: Long =
+        nativeCreate(
+            config.sampleRate,
+            config.speechThreshold,
+            config.minSpeechMs,
+            config.baseHangoverMs,
+            config.minHangoverMs,
+            config.maxHangoverMs,
+        )
+
+    companion object {
+        init {
+            try {
+                System.loadLibrary("audio_engine")
+            } catch (e: UnsatisfiedLinkError) {
+                android.util.Log.e("EndpointDetector", "Failed to load native library", e)
+            }
+        }
+    }
+
+    /**
+     * Feed one capture frame.
+     *
+     * @param samples Audio samples (float, -1.0 to 1.0)
+     * @param speechProbability VAD confidence for the frame
+     * @return Event raised by this frame
+     */
+    fun process(
+        samples: FloatArray,
+        speechProbability: Float,
+    ): EndpointEvent {
+        if (nativeDetectorPtr == 0L || samples.isEmpty()) {
+            return EndpointEvent.NONE
+        }
+        return when (nativeProcess(nativeDetectorPtr, samples, speechProbability)) {
+            1 -> EndpointEvent.SPEECH_START
+            2 -> EndpointEvent.END_OF_UTTERANCE
+            else -> EndpointEvent.NONE
+        }
+    }
+
+    /**
+     * Report the latest partial transcript of the current turn.
+     *
+     * @param text Transcript so far
+     * @param endOfGeneration Whether the recognizer finished its hypothesis
+     */
+    fun reportTranscript(
+        text: String,
+        endOfGeneration: Boolean = false,
+    ) {
+        if (nativeDetectorPtr != 0L) {
+            nativeReportTranscript(nativeDetectorPtr, text, endOfGeneration)
+        }
+    }
+
+    /**
+     * Drop the current turn (e.g. when capture stops or the turn was ended
+     * manually).
+     */
+    fun reset() {
+        if (nativeDetectorPtr != 0L) {
+            nativeReset(nativeDetectorPtr)
+        }
+    }
+
+    /**
+     * Get endpoint counters and latency percentiles.
+     */
+    fun getStats(): EndpointStats {
+        if (nativeDetectorPtr == 0L) {
+            return EndpointStats()
+        }
+        val values = nativeGetStats(nativeDetectorPtr)
+        return EndpointStats(
+            endpoints = values[0],
+            resumedPauses = values[1],
+            punctuationEndpoints = values[2],
+            meanLatencyMs = values[3],
+            p50LatencyMs = values[4],
+            p90LatencyMs = values[5],
+            maxLatencyMs = values[6],
+        )
+    }
+
+    /**
+     * Clear endpoint counters.
+     */
+    fun resetStats() {
+        if (nativeDetectorPtr != 0L) {
+            nativeResetStats(nativeDetectorPtr)
+        }
+    }
+
+    /**
+     * Release native resources.
+     */
+    fun release() {
+        if (nativeDetectorPtr != 0L) {
+            nativeDestroy(nativeDetectorPtr)
+            nativeDetectorPtr = 0
+        }
+    }
+
+    // Native method declarations
+    private external fun nativeCreate(
+        sampleRate: Int,
+        speechThreshold: Float,
+        minSpeechMs: Int,
+        baseHangoverMs: Int,
+        minHangoverMs: Int,
+        maxHangoverMs: Int,
+    ): Long
+
+    private external fun nativeProcess(
+        detectorPtr: Long,
+        samples: FloatArray,
+        speechProbability: Float,
+    ): Int
+
+    private external fun nativeReportTranscript(
+        detectorPtr: Long,
+        text: String,
+        endOfGeneration: Boolean,
+    )
+
+    private external fun nativeReset(detectorPtr: Long)
+
+    private external fun nativeGetStats(detectorPtr: Long): LongArray
+
+    private external fun nativeResetStats(detectorPtr: Long)
+
+    private external fun nativeDestroy(detectorPtr: Long)
+}
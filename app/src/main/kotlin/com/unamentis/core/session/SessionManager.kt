@@ -2,6 +2,8 @@ package com.unamentis.core.session
 
 import android.util.Log
 import com.unamentis.core.audio.AudioEngine
+import com.unamentis.core.audio.EndpointDetector
+import com.unamentis.core.audio.EndpointEvent
 import com.unamentis.core.config.RecordingMode
 import com.unamentis.core.curriculum.CurriculumEngine
 import com.unamentis.data.model.*
@@ -21,6 +23,7 @@ import java.util.concurrent.atomic.AtomicInteger
  * @property ttsService Text-to-speech provider
  * @property llmService Language model provider
  * @property curriculumEngine Curriculum progress tracking
+ * @property endpointDetector Adaptive end-of-utterance detection (fixed silence timeout when null)
  */
 data class SessionDependencies(
     val audioEngine: AudioEngine,
@@ -29,6 +32,7 @@ data class SessionDependencies(
     val ttsService: TTSService,
     val llmService: LLMService,
     val curriculumEngine: CurriculumEngine,
+    val endpointDetector: EndpointDetector? = null,
 )
 
 /**
@@ -46,7 +50,7 @@ data class SessionDependencies(
  *
  * Conversation Flow:
  * 1. VAD detects speech start → USER_SPEAKING
- * 2. VAD detects 1.5s silence → PROCESSING_UTTERANCE
+ * 2. Endpoint detector ends the turn (adaptive silence, 1.5s at most) → PROCESSING_UTTERANCE
  * 3. STT finalizes → AI_THINKING
  * 4. LLM starts streaming → AI_SPEAKING (concurrent with TTS)
  * 5. TTS completes → Back to listening (IDLE or USER_SPEAKING)
@@ -69,6 +73,7 @@ class SessionManager(
     private val ttsService get() = dependencies.ttsService
     private val llmService get() = dependencies.llmService
     private val curriculumEngine get() = dependencies.curriculumEngine
+    private val endpointDetector get() = dependencies.endpointDetector
     private val _sessionState = MutableStateFlow<SessionState>(SessionState.IDLE)
     val sessionState: StateFlow<SessionState> = _sessionState.asStateFlow()
 
@@ -178,6 +183,10 @@ class SessionManager(
     private var aiSpeechStartTime = 0L
     private val bargeInConfirmationWindowMs = 600L
 
+    // Text handed to TTS but not yet synthesized, counted toward playback lag
+    private val pendingTtsChars = AtomicInteger(0)
+    private val speechCharsPerSecond = 15f
+
     // Active jobs for cancellation
     private var sttJob: Job? = null
     private var llmJob: Job? = null
@@ -188,7 +197,7 @@ class SessionManager(
     private val ttsJobs = mutableListOf<Job>()
 
     // Configuration
-    private val silenceThresholdMs = 1500L // 1.5 seconds of silence to finalize utterance
+    private val silenceThresholdMs = 1500L // Silence that always finalizes an utterance
 
     // Speech debouncing - prevent false triggers from brief noise
     private val minimumSpeechFrames = 3 // ~36ms at 12ms frames
@@ -605,10 +614,11 @@ class SessionManager(
                 when (_recordingMode.value) {
                     RecordingMode.VAD -> {
                         // Automatic voice detection mode
+                        val endpoint = endpointDetector?.process(amplifiedSamples, vadResult.confidence)
                         if (vadResult.isSpeech) {
                             handleSpeechDetected()
                         } else {
-                            handleSilenceDetected()
+                            handleSilenceDetected(endpoint == EndpointEvent.END_OF_UTTERANCE)
                         }
                     }
                     RecordingMode.PUSH_TO_TALK, RecordingMode.TOGGLE -> {
@@ -674,15 +684,20 @@ class SessionManager(
 
     /**
      * Handle silence detected by VAD.
+     *
+     * @param endpointReached Whether the endpoint detector ended the turn
      */
-    private suspend fun handleSilenceDetected() {
+    private suspend fun handleSilenceDetected(endpointReached: Boolean) {
         // Reset consecutive speech counter on silence
         consecutiveSpeechFrames.set(0)
 
         if (_sessionState.value == SessionState.USER_SPEAKING) {
             val silenceDuration = System.currentTimeMillis() - lastSpeechDetectedTime
 
-            if (silenceDuration >= silenceThresholdMs) {
+            // The fixed threshold still applies if the detector never saw the turn start
+            if (endpointReached || silenceDuration >= silenceThresholdMs) {
+                endpointDetector?.reset()
+
                 // User finished speaking
                 _sessionState.value = SessionState.PROCESSING_UTTERANCE
 
@@ -709,6 +724,13 @@ class SessionManager(
         Log.i("SessionManager", "Barge-in detected")
 
         // Cancel AI operations
+        try {
+            llmService.bargeIn()
+        } catch (e: CancellationException) {
+            throw e
+        } catch (e: Exception) {
+            Log.w("SessionManager", "LLM barge-in failed", e)
+        }
         llmJob?.cancel()
 
         // Cancel ALL TTS jobs (not just one)
@@ -746,6 +768,9 @@ class SessionManager(
                     sttService.startStreaming().collect { result ->
                         Log.d("SessionManager", "STT: ${result.text} (final=${result.isFinal})")
 
+                        // Partial transcripts tell the endpoint detector whether the sentence is finished
+                        endpointDetector?.reportTranscript(result.text, endOfGeneration = false)
+
                         if (result.isFinal) {
                             // Final transcription received
                             handleFinalTranscription(result.text)
@@ -883,6 +908,15 @@ class SessionManager(
         processLLMResponse()
     }
 
+    /**
+     * Response cache context for the current curriculum topic, or free
+     * conversation when no curriculum is loaded.
+     */
+    private fun responseCacheContext(): String {
+        val curriculum = curriculumEngine.currentCurriculum.value ?: return "free"
+        return "${curriculum.id}/${curriculumEngine.currentTopic.value?.id.orEmpty()}"
+    }
+
     /**
      * Process LLM response.
      */
@@ -895,6 +929,12 @@ class SessionManager(
         val responseBuffer = StringBuilder() // Buffer for TTS chunks (cleared after each chunk)
         val fullResponse = StringBuilder() // Complete response for conversation history
 
+        // Lets a provider with a response cache replay its answer when the
+        // learner asks the same question again in this topic
+        conversationHistory.lastOrNull { it.role == "user" }?.let { message ->
+            llmService.setResponseCacheQuery(responseCacheContext(), message.content)
+        }
+
         llmJob?.cancel()
         llmJob =
             scope.launch {
@@ -924,6 +964,7 @@ class SessionManager(
                         if (!token.isDone) {
                             responseBuffer.append(token.content)
                             fullResponse.append(token.content) // Track complete response
+                            reportPlaybackLag()
 
                             // Stream to TTS in chunks (every ~20 tokens or sentence boundary)
                             if (shouldSendToTTS(responseBuffer.toString())) {
@@ -975,6 +1016,15 @@ class SessionManager(
             }
     }
 
+    /**
+     * Tell the LLM how much of its output is still waiting to be spoken so it
+     * can stop decoding far ahead of playback.
+     */
+    private fun reportPlaybackLag() {
+        val queuedSeconds = audioEngine.getQueuedPlaybackSeconds() + pendingTtsChars.get() / speechCharsPerSecond
+        llmService.reportConsumerLag(queuedSeconds)
+    }
+
     /**
      * Determine if accumulated text should be sent to TTS.
      */
@@ -991,6 +1041,7 @@ class SessionManager(
      * All jobs are awaited in finalizeLLMResponse() before transitioning state.
      */
     private fun synthesizeAndPlay(text: String) {
+        pendingTtsChars.addAndGet(text.length)
         val job =
             scope.launch {
                 try {
@@ -1020,11 +1071,15 @@ class SessionManager(
                             audioEngine.queuePlayback(floatSamples)
                         }
                     }
+                    pendingTtsChars.addAndGet(-text.length)
+                    reportPlaybackLag()
 
                     Log.d("SessionManager", "TTS synthesis complete: $text")
                 } catch (e: CancellationException) {
+                    pendingTtsChars.addAndGet(-text.length)
                     throw e
                 } catch (e: Exception) {
+                    pendingTtsChars.addAndGet(-text.length)
                     Log.e("SessionManager", "TTS error", e)
                 }
             }
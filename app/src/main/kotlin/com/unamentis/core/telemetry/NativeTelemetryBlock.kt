@@ -0,0 +1,79 @@
+package com.unamentis.core.telemetry
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Live counters a native engine publishes into shared memory.
+ *
+ * The engine writes into [buffer] (see telemetry_block.h) and [snapshot]
+ * reads it with plain buffer loads, so polling doesn't cost a JNI call.
+ * Writes are guarded by a sequence number: a snapshot copies the fields
+ * between two reads of it and retries if a write was in progress.
+ *
+ * @param layout Which engine's fields the buffer holds (one of the LAYOUT_ constants)
+ * @param fieldCount Number of 64-bit fields the engine publishes
+ */
+class NativeTelemetryBlock(
+    private val layout: Int,
+    private val fieldCount: Int,
+) {
+    /** Direct buffer to hand to the engine's nativeAttachTelemetry. */
+    val buffer: ByteBuffer =
+        ByteBuffer.allocateDirect(HEADER_BYTES + fieldCount * FIELD_BYTES).order(ByteOrder.nativeOrder())
+
+    // API 28 has no VarHandle fences. A volatile write followed by a
+    // volatile read keeps the plain buffer loads on either side in order.
+    @Volatile
+    private var fence = 0
+
+    /**
+     * Copy the latest published values.
+     *
+     * @return The fields in the engine's layout order, or null if no engine
+     *   is attached or it kept writing through every retry
+     */
+    fun snapshot(): LongArray? {
+        val values = LongArray(fieldCount)
+        repeat(MAX_RETRIES) {
+            val start = buffer.getInt(SEQUENCE_OFFSET)
+            loadFence()
+            if (buffer.getInt(MAGIC_OFFSET) != MAGIC || buffer.getInt(LAYOUT_OFFSET) != layout) {
+                return null
+            }
+            if ((start and 1) == 0) {
+                for (i in 0 until fieldCount) {
+                    values[i] = buffer.getLong(HEADER_BYTES + i * FIELD_BYTES)
+                }
+                loadFence()
+                if (buffer.getInt(SEQUENCE_OFFSET) == start) {
+                    return values
+                }
+            }
+        }
+        return null
+    }
+
+    private fun loadFence(): Int {
+        fence = 0
+        return fence
+    }
+
+    companion object {
+        const val LAYOUT_AUDIO = 1
+        const val LAYOUT_LLM = 2
+        const val LAYOUT_ASR = 3
+
+        /** "UNTB" as a little-endian int */
+        const val MAGIC = 0x42544e55
+
+        const val MAGIC_OFFSET = 0
+        const val LAYOUT_OFFSET = 4
+        const val SEQUENCE_OFFSET = 8
+        const val COUNT_OFFSET = 12
+        const val HEADER_BYTES = 16
+        const val FIELD_BYTES = 8
+
+        private const val MAX_RETRIES = 8
+    }
+}
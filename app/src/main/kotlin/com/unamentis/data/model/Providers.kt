@@ -146,6 +146,31 @@ interface LLMService {
      */
     suspend fun stop()
 
+    /**
+     * Report how many seconds of generated output are still waiting to be
+     * spoken, so providers that run locally can pace generation to playback.
+     */
+    fun reportConsumerLag(queuedSeconds: Float) {}
+
+    /**
+     * Stop generation because the user interrupted playback.
+     */
+    suspend fun bargeIn() = stop()
+
+    /**
+     * Tell providers that cache answers which curriculum context and learner
+     * utterance the next completion responds to, so a repeated question in
+     * the same context can be answered from the cache. Providers without a
+     * response cache ignore it.
+     *
+     * @param contextKey Curriculum and topic the conversation is in
+     * @param utterance The learner message the next completion answers
+     */
+    fun setResponseCacheQuery(
+        contextKey: String,
+        utterance: String,
+    ) {}
+
     /**
      * Provider name for logging and metrics.
      */
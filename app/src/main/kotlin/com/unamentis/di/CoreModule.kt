@@ -2,6 +2,7 @@ package com.unamentis.di
 
 import android.content.Context
 import com.unamentis.core.audio.AudioEngine
+import com.unamentis.core.audio.EndpointDetector
 import com.unamentis.core.curriculum.CurriculumEngine
 import com.unamentis.core.readinglist.ReadingListManager
 import com.unamentis.core.session.SessionDependencies
@@ -31,6 +32,7 @@ import javax.inject.Singleton
  * Provides:
  * - AudioEngine for low-latency audio I/O
  * - VADService for voice activity detection
+ * - EndpointDetector for adaptive end-of-utterance detection
  * - CurriculumEngine for curriculum management
  * - SessionManager for voice session orchestration
  */
@@ -88,6 +90,16 @@ object CoreModule {
         // }
     }
 
+    /**
+     * Provides the EndpointDetector that decides when the learner has
+     * finished speaking.
+     */
+    @Provides
+    @Singleton
+    fun provideEndpointDetector(): EndpointDetector {
+        return EndpointDetector()
+    }
+
     /**
      * Provides the CurriculumEngine for curriculum management.
      */
@@ -148,6 +160,7 @@ object CoreModule {
         ttsService: TTSService,
         llmService: LLMService,
         curriculumEngine: CurriculumEngine,
+        endpointDetector: EndpointDetector,
         scope: CoroutineScope,
     ): SessionManager {
         val dependencies =
@@ -158,6 +171,7 @@ object CoreModule {
                 ttsService = ttsService,
                 llmService = llmService,
                 curriculumEngine = curriculumEngine,
+                endpointDetector = endpointDetector,
             )
         return SessionManager(
             dependencies = dependencies,
@@ -5,6 +5,8 @@ import android.media.AudioAttributes
 import android.media.AudioFormat
 import android.media.AudioTrack
 import android.util.Log
+import com.unamentis.core.audio.AudioEngine
+import com.unamentis.core.audio.OnsetConfig
 import com.unamentis.data.model.STTService
 import com.unamentis.data.model.TTSService
 import com.unamentis.data.model.VADService
@@ -25,6 +27,10 @@ import javax.inject.Singleton
  *
  * Automatically speaks questions via TTS and listens for
  * verbal answers via STT, working alongside the text UI.
+ *
+ * While listening, the native audio engine timestamps the learner's speech
+ * onset on its capture thread, so response times don't include STT or
+ * scheduling delays.
  */
 @Suppress(
     "TooManyFunctions",
@@ -41,6 +47,7 @@ class KBVoiceCoordinator
         private val ttsService: TTSService,
         private val sttService: STTService,
         private val vadService: VADService,
+        private val audioEngine: AudioEngine,
     ) {
         companion object {
             private const val TAG = "KBVoiceCoordinator"
@@ -71,6 +78,11 @@ class KBVoiceCoordinator
         // Silence detection for utterance completion
         private var hasDetectedSpeech = false
 
+        // Speech onset timing (System.nanoTime clock)
+        private var listeningStartNanos = 0L
+        private var speechOnsetNanos: Long? = null
+        private var ownsCapture = false
+
         // Callbacks
         private var onTranscriptComplete: ((String) -> Unit)? = null
 
@@ -411,6 +423,7 @@ class KBVoiceCoordinator
             _isListening.value = true
             _currentTranscript.value = ""
             hasDetectedSpeech = false
+            startOnsetTiming()
 
             sttStreamJob =
                 scope.launch {
@@ -443,10 +456,25 @@ class KBVoiceCoordinator
             _isListening.value = false
             hasDetectedSpeech = false
             _currentTranscript.value = ""
+            stopOnsetTiming()
 
             Log.i(TAG, "KB voice listening stopped")
         }
 
+        /**
+         * When the learner started speaking since listening began, on the
+         * [System.nanoTime] clock, or null if no onset was detected.
+         */
+        fun speechOnsetNanos(): Long? {
+            if (speechOnsetNanos == null) {
+                speechOnsetNanos =
+                    audioEngine.drainOnsets()
+                        .firstOrNull { it.timeNanos >= listeningStartNanos }
+                        ?.timeNanos
+            }
+            return speechOnsetNanos
+        }
+
         /**
          * Set callback for when a complete transcript is available.
          *
@@ -464,6 +492,29 @@ class KBVoiceCoordinator
             hasDetectedSpeech = false
         }
 
+        // Private: Onset Timing
+
+        private fun startOnsetTiming() {
+            listeningStartNanos = System.nanoTime()
+            speechOnsetNanos = null
+            audioEngine.setOnsetDetection(OnsetConfig())
+            audioEngine.drainOnsets()
+            if (!audioEngine.isCapturing.value) {
+                // Capture only for timing; STT gets its audio on its own path
+                ownsCapture = audioEngine.startCapture { }
+            }
+        }
+
+        private fun stopOnsetTiming() {
+            // Keep the onset for the answer that's being submitted
+            speechOnsetNanos()
+            if (ownsCapture) {
+                audioEngine.stopCapture()
+                ownsCapture = false
+            }
+            audioEngine.setOnsetDetection(OnsetConfig(enabled = false))
+        }
+
         // Private: STT Result Handling
 
         private fun handleSTTResult(
@@ -58,6 +58,7 @@ class KBOralSessionViewModel
     ) : ViewModel() {
         companion object {
             private const val CONFERENCE_TICK_MS = 100L
+            private const val NANOS_PER_SECOND = 1_000_000_000f
         }
 
         // Session configuration
@@ -116,6 +117,7 @@ class KBOralSessionViewModel
         // Session timing
         private var sessionStartTime: Long = 0L
         private var questionStartTime: Long = 0L
+        private var questionStartNanos: Long = 0L
 
         // Attempts
         private val attempts = mutableListOf<KBQuestionAttempt>()
@@ -287,6 +289,7 @@ class KBOralSessionViewModel
             _transcript.value = ""
             _sttError.value = null
             questionStartTime = System.currentTimeMillis()
+            questionStartNanos = System.nanoTime()
             _state.value = OralSessionState.LISTENING_FOR_ANSWER
 
             // Set up transcript callback
@@ -329,7 +332,11 @@ class KBOralSessionViewModel
 
                 // Validate answer
                 val result = answerValidator.validate(userAnswer, question)
-                val responseTime = (System.currentTimeMillis() - questionStartTime) / 1000f
+                // Prefer the native speech onset; fall back to when the answer arrived
+                val responseTime =
+                    voiceCoordinator.speechOnsetNanos()
+                        ?.let { (it - questionStartNanos).coerceAtLeast(0L) / NANOS_PER_SECOND }
+                        ?: ((System.currentTimeMillis() - questionStartTime) / 1000f)
                 val pointsEarned =
                     if (result.isCorrect) _regionalConfig.oralPointsPerCorrect else 0
 
@@ -276,6 +276,21 @@ internal class LlamaCppBackendAdapter(
         service.stop()
     }
 
+    override fun reportConsumerLag(queuedSeconds: Float) {
+        service.reportConsumerLag(queuedSeconds)
+    }
+
+    override suspend fun bargeIn() {
+        service.bargeIn()
+    }
+
+    override fun setResponseCacheQuery(
+        contextKey: String,
+        utterance: String,
+    ) {
+        service.setResponseCacheQuery(contextKey, utterance)
+    }
+
     override fun getMetrics(): LLMBackendMetrics {
         val metrics = service.getMetrics()
         return LLMBackendMetrics(
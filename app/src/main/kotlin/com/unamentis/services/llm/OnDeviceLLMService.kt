@@ -3,21 +3,29 @@ package com.unamentis.services.llm
 import android.content.Context
 import android.util.Log
 import com.unamentis.R
+import com.unamentis.core.telemetry.NativeTelemetryBlock
 import com.unamentis.data.model.LLMMessage
 import com.unamentis.data.model.LLMService
 import com.unamentis.data.model.LLMToken
+import com.unamentis.services.stt.GLMASROnDeviceConfig
 import dagger.hilt.android.qualifiers.ApplicationContext
+import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.SupervisorJob
 import kotlinx.coroutines.channels.awaitClose
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.callbackFlow
 import kotlinx.coroutines.flow.flowOn
+import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
 import java.io.File
+import java.nio.ByteBuffer
 import java.util.concurrent.CopyOnWriteArrayList
 import java.util.concurrent.atomic.AtomicBoolean
 import java.util.concurrent.atomic.AtomicInteger
 import java.util.concurrent.atomic.AtomicLong
+import java.util.concurrent.atomic.AtomicReference
 import javax.inject.Inject
 import javax.inject.Singleton
 
@@ -36,7 +44,7 @@ import javax.inject.Singleton
  *
  * Matching iOS implementation for feature parity.
  */
-@Suppress("TooManyFunctions")
+@Suppress("TooManyFunctions", "LargeClass") // Native engine facade: one wrapper per llama.cpp feature
 @Singleton
 class OnDeviceLLMService
     @Inject
@@ -67,7 +75,48 @@ class OnDeviceLLMService
             private const val DEFAULT_CONTEXT_SIZE = 4096
             private const val DEFAULT_GPU_LAYERS = 99 // All layers to GPU
             private const val DEFAULT_MAX_TOKENS = 512
+            private const val DEFAULT_MAX_SESSIONS = 4 // Resident learner sessions (shared KV buffer)
+            private const val SESSION_CACHE_DIR = "llm_sessions"
+            private const val DOCUMENT_CACHE_DIR = "llm_documents"
+            private const val DEFAULT_PREFIX_CACHE_SLOTS = 4 // Tutor, quiz, validator, summarizer preambles
             private const val MAX_TTFT_MEASUREMENTS = 100 // Limit metrics history
+            private const val DEFAULT_LOOKUP_NGRAM_MAX = 4
+            private const val DEFAULT_LOOKUP_DRAFT_MAX = 8
+
+            // Pacing to TTS playback
+            private const val DEFAULT_PACING_HIGH_WATERMARK_SECONDS = 8f
+            private const val DEFAULT_PACING_LOW_WATERMARK_SECONDS = 4f
+            private const val SPEECH_TOKENS_PER_SECOND = 3.5f // ~150 words per minute
+
+            // Compute thread pools shared with the ASR decoder
+            private const val DEFAULT_COMPUTE_POOL_POLL = 100 // Spin hardest between decode steps
+            private const val MAX_COMPUTE_POOL_POLL = 100
+
+            // Small/large cascade escalation policy
+            private const val DEFAULT_CASCADE_CONTEXT_SIZE = 2048
+            private const val DEFAULT_CASCADE_PROBE_TOKENS = 8
+            private const val DEFAULT_CASCADE_MIN_PROBABILITY = 0.35f
+            private const val DEFAULT_CASCADE_MAX_MEAN_ENTROPY = 2.0f
+
+            // Background conversation compaction
+            private const val DEFAULT_COMPACTION_THRESHOLD_TOKENS = 2048 // Half the default context
+            private const val COMPACTION_KEEP_RECENT_MESSAGES = 4 // Turns left verbatim after compaction
+            private const val COMPACTION_MAX_SUMMARY_TOKENS = 256
+            private const val CHARS_PER_TOKEN = 4
+            private const val SUMMARY_PLACEHOLDER = "{{conversation_summary}}"
+            private const val COMPACTION_INSTRUCTION =
+                "Summarize the tutoring conversation below in a few sentences. Keep the topics covered, " +
+                    "what the learner understood or struggled with, and any open questions. " +
+                    "Reply with the summary only."
+
+            // Live telemetry block (see llama_inference.h)
+            private const val TELEMETRY_FIELDS = 8
+            private const val MILLI = 1000.0
+
+            // Turn delimiters that end a reply, matched natively across token boundaries
+            private val MISTRAL_STOP_SEQUENCES = arrayOf("</s>", "[INST]")
+            private val CHATML_STOP_SEQUENCES = arrayOf("</s>", "<|user|>", "<|system|>", "<|im_end|>")
+            private val GLM_STOP_SEQUENCES = arrayOf("<|user|>", "<|system|>", "<|observation|>", "<|endoftext|>")
 
             init {
                 try {
@@ -86,6 +135,9 @@ class OnDeviceLLMService
             val modelPath: String,
             val contextSize: Int = DEFAULT_CONTEXT_SIZE,
             val gpuLayers: Int = DEFAULT_GPU_LAYERS,
+            val maxSessions: Int = DEFAULT_MAX_SESSIONS,
+            val prefixCacheSlots: Int = DEFAULT_PREFIX_CACHE_SLOTS,
+            val compactionThresholdTokens: Int = DEFAULT_COMPACTION_THRESHOLD_TOKENS,
         )
 
         override val providerName: String = context.getString(R.string.provider_on_device_llm)
@@ -104,6 +156,43 @@ class OnDeviceLLMService
         private val totalOutputTokens = AtomicInteger(0)
         private val ttftMeasurements = CopyOnWriteArrayList<Long>()
 
+        // Live engine counters, published by native code while a model is loaded
+        private val telemetry = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_LLM, TELEMETRY_FIELDS)
+
+        // Prompt-lookup speculation settings, re-applied whenever a model loads
+        @Volatile
+        private var lookupSettings = LookupSettings()
+
+        // Response cache settings and context, re-applied whenever a model loads
+        @Volatile
+        private var responseCacheConfig = ResponseCacheConfig()
+
+        @Volatile
+        private var responseCacheContext = ""
+
+        // Learner utterance the next completion answers (see setResponseCacheQuery)
+        private val pendingCacheQuery = AtomicReference<CacheQuery?>(null)
+
+        // Playback pacing settings, re-applied whenever a model loads
+        @Volatile
+        private var pacingConfig = PacingConfig()
+
+        // Session that completions run in (native default is "")
+        @Volatile
+        private var activeSessionId = ""
+
+        // Conversation compaction: prompts longer than the threshold schedule
+        // a background summary of their oldest turns
+        @Volatile
+        private var compactionThresholdTokens = DEFAULT_COMPACTION_THRESHOLD_TOKENS
+
+        @Volatile
+        private var compaction: Compaction? = null
+
+        @Volatile
+        private var compactionJob: Job? = null
+        private val compactionScope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
+
         /**
          * Load model from specified path.
          *
@@ -137,6 +226,10 @@ class OnDeviceLLMService
                         config.contextSize,
                         config.gpuLayers,
                         optimalThreads,
+                        config.maxSessions,
+                        getSessionCacheDirectory().absolutePath,
+                        config.prefixCacheSlots,
+                        getDocumentCacheDirectory().absolutePath,
                     )
                 nativeContextPtr.set(ptr)
 
@@ -147,16 +240,95 @@ class OnDeviceLLMService
 
                 isModelLoaded.set(true)
                 currentModelPath = config.modelPath
+                compactionThresholdTokens = config.compactionThresholdTokens
+                compaction = null
+                applyLookupSettings(ptr)
+                applyResponseCacheConfig(ptr)
+                nativeSetResponseCacheContext(ptr, responseCacheContext)
+                applyPacingConfig(ptr)
+                nativeSetStopSequences(ptr, stopSequencesFor(config.modelPath))
+                if (!nativeAttachTelemetry(ptr, telemetry.buffer)) {
+                    Log.w(TAG, "Live telemetry unavailable")
+                }
                 Log.i(TAG, "Model loaded successfully with $optimalThreads threads")
                 true
             }
 
+        /**
+         * Switch to another model without an unavailable period.
+         *
+         * The replacement loads while the current model keeps serving (for
+         * example after [ModelDownloadManager] finishes a better
+         * quantization); the switch happens between requests once any
+         * in-flight generation completes. Sessions, cached prefixes,
+         * documents and the cascade model are dropped with the old weights.
+         *
+         * Falls back to a regular [loadModel] when nothing is loaded yet.
+         *
+         * @param modelPath Path to the replacement GGUF
+         * @return true if the new model is serving
+         */
+        suspend fun swapModel(modelPath: String): Boolean =
+            withContext(Dispatchers.IO) {
+                val ptr = nativeContextPtr.get()
+                if (ptr == 0L) {
+                    return@withContext loadModel(ModelConfig(modelPath))
+                }
+                if (!File(modelPath).exists()) {
+                    Log.e(TAG, "Model file not found: $modelPath")
+                    return@withContext false
+                }
+
+                nativeCancelCompaction(ptr)
+                val swapped = nativeSwapModel(ptr, modelPath, stopSequencesFor(modelPath))
+                if (swapped) {
+                    currentModelPath = modelPath
+                    compaction = null
+                    val stats = getSwapStats()
+                    Log.i(
+                        TAG,
+                        "Swapped to $modelPath: handover ${stats.handoverUs / 1000} ms, " +
+                            "peak overlap ${stats.overlapBytes / (1024 * 1024)} MB",
+                    )
+                }
+                swapped
+            }
+
+        /**
+         * Get timing and footprint of the last model swap.
+         */
+        fun getSwapStats(): SwapStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return SwapStats(0, 0, 0, 0)
+            }
+            val values = nativeGetSwapStats(ptr)
+            return SwapStats(
+                swaps = values[0],
+                loadUs = values[1],
+                handoverUs = values[2],
+                overlapBytes = values[3],
+            )
+        }
+
+        /**
+         * Model swap timing; [handoverUs] is how long requests were blocked.
+         */
+        data class SwapStats(
+            val swaps: Long,
+            val loadUs: Long,
+            val handoverUs: Long,
+            val overlapBytes: Long,
+        )
+
         /**
          * Unload model and free resources.
          */
         fun unloadModel() {
             val ptr = nativeContextPtr.get()
             if (ptr != 0L) {
+                nativeCancelCompaction(ptr)
+                compaction = null
                 nativeFreeModel(ptr)
                 nativeContextPtr.set(0)
                 isModelLoaded.set(false)
@@ -165,6 +337,158 @@ class OnDeviceLLMService
             }
         }
 
+        /**
+         * Change the context window and/or thread count without reloading the
+         * model, e.g. to shrink the KV cache under thermal or memory pressure.
+         *
+         * The active conversation is kept when it fits the new window; other
+         * sessions are restored from their snapshots on next use.
+         *
+         * @param contextSize New context window in tokens (0 keeps the current one)
+         * @param threads New thread count (0 keeps the current one)
+         * @return true if the new settings are in effect
+         */
+        fun reconfigure(
+            contextSize: Int,
+            threads: Int = 0,
+        ): Boolean {
+            val ptr = nativeContextPtr.get()
+            return ptr != 0L && nativeReconfigure(ptr, contextSize, threads)
+        }
+
+        /**
+         * Get timing of the last context reconfiguration.
+         */
+        fun getReconfigureStats(): ReconfigureStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return ReconfigureStats(0, 0, 0)
+            }
+            val values = nativeGetReconfigureStats(ptr)
+            return ReconfigureStats(
+                reconfigures = values[0],
+                carriedTokens = values[1].toInt(),
+                reconfigureUs = values[2],
+            )
+        }
+
+        /**
+         * Context reconfiguration counters.
+         */
+        data class ReconfigureStats(
+            val reconfigures: Long,
+            val carriedTokens: Int,
+            val reconfigureUs: Long,
+        )
+
+        /**
+         * Release the KV cache and compute buffers under memory pressure while
+         * keeping the model weights mapped, avoiding a full reload later.
+         *
+         * The next completion resumes automatically; call [resume] to pay the
+         * (millisecond) context recreation cost ahead of time.
+         *
+         * @param snapshotSessions Save resident sessions to disk so they can be restored
+         * @return true if the engine was hibernated
+         */
+        fun hibernate(snapshotSessions: Boolean = true): Boolean {
+            val ptr = nativeContextPtr.get()
+            val hibernated = ptr != 0L && nativeHibernate(ptr, snapshotSessions)
+            if (hibernated) {
+                val stats = getHibernateStats()
+                Log.i(
+                    TAG,
+                    "Hibernated: freed ${stats.stateBytes / 1024} KB state, " +
+                        "${stats.modelBytes / (1024 * 1024)} MB weights stay mapped",
+                )
+            }
+            return hibernated
+        }
+
+        /**
+         * Recreate the native context after [hibernate].
+         */
+        fun resume(): Boolean {
+            val ptr = nativeContextPtr.get()
+            return ptr != 0L && nativeResume(ptr)
+        }
+
+        /**
+         * Get footprint and timing of the last hibernate/resume cycle.
+         */
+        fun getHibernateStats(): HibernateStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return HibernateStats(0, 0, 0, 0, 0)
+            }
+            val values = nativeGetHibernateStats(ptr)
+            return HibernateStats(
+                stateBytes = values[0],
+                modelBytes = values[1],
+                snapshottedSessions = values[2].toInt(),
+                hibernateUs = values[3],
+                resumeUs = values[4],
+            )
+        }
+
+        /**
+         * Hibernate footprint and timing.
+         */
+        data class HibernateStats(
+            val stateBytes: Long,
+            val modelBytes: Long,
+            val snapshottedSessions: Int,
+            val hibernateUs: Long,
+            val resumeUs: Long,
+        )
+
+        /**
+         * Read live engine counters without a JNI call, cheap enough to
+         * poll from a dashboard every frame.
+         *
+         * @return The latest counters, or null if no model is loaded
+         */
+        fun getLiveTelemetry(): LiveTelemetry? {
+            val values = telemetry.snapshot() ?: return null
+            return LiveTelemetry(
+                state = LiveState.entries.getOrElse(values[0].toInt()) { LiveState.UNLOADED },
+                responseTokens = values[1],
+                tokensPerSecond = values[2] / MILLI,
+                totalTokens = values[3],
+                generations = values[4],
+                promptTokens = values[5],
+                consumerLagMs = values[6],
+                pacingPauses = values[7],
+            )
+        }
+
+        /**
+         * What the engine is doing, as published in its telemetry block.
+         */
+        enum class LiveState {
+            UNLOADED,
+            IDLE,
+            PREFILLING,
+            DECODING,
+            PAUSED,
+            HIBERNATED,
+        }
+
+        /**
+         * Live engine counters; the per-response ones cover the current or
+         * last generation.
+         */
+        data class LiveTelemetry(
+            val state: LiveState,
+            val responseTokens: Long,
+            val tokensPerSecond: Double,
+            val totalTokens: Long,
+            val generations: Long,
+            val promptTokens: Long,
+            val consumerLagMs: Long,
+            val pacingPauses: Long,
+        )
+
         /**
          * Check if model is loaded.
          */
@@ -208,6 +532,142 @@ class OnDeviceLLMService
             return null
         }
 
+        /**
+         * Escalation policy for the small/large cascade.
+         *
+         * @property probeTokens Tokens the small model generates before the decision
+         * @property minProbability Escalate if any probe token is less likely than this
+         * @property maxMeanEntropy Escalate if the probe's mean entropy (nats) exceeds this
+         */
+        data class CascadeConfig(
+            val contextSize: Int = DEFAULT_CASCADE_CONTEXT_SIZE,
+            val probeTokens: Int = DEFAULT_CASCADE_PROBE_TOKENS,
+            val minProbability: Float = DEFAULT_CASCADE_MIN_PROBABILITY,
+            val maxMeanEntropy: Float = DEFAULT_CASCADE_MAX_MEAN_ENTROPY,
+        )
+
+        /**
+         * Load a small model that answers first, escalating to the loaded
+         * model when it is unsure within its first tokens.
+         *
+         * Acknowledgments, short factual answers and "repeat that" turns
+         * then skip the large model entirely. The small model must share
+         * the large model's vocabulary (e.g. Llama 3.2 1B under a larger
+         * Llama 3 model), since the large model reuses the prompt tokens.
+         *
+         * @param smallModelPath Small GGUF model
+         * @return true if the cascade is active
+         */
+        suspend fun loadCascadeModel(
+            smallModelPath: String,
+            config: CascadeConfig = CascadeConfig(),
+        ): Boolean =
+            withContext(Dispatchers.IO) {
+                val ptr = nativeContextPtr.get()
+                if (ptr == 0L || !File(smallModelPath).exists()) {
+                    return@withContext false
+                }
+                nativeLoadCascadeModel(
+                    ptr,
+                    smallModelPath,
+                    config.contextSize,
+                    getOptimalThreadCount(),
+                    config.probeTokens,
+                    config.minProbability,
+                    config.maxMeanEntropy,
+                )
+            }
+
+        /**
+         * Unload the cascade model; every request goes to the large model.
+         */
+        fun unloadCascadeModel() {
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                nativeUnloadCascadeModel(ptr)
+            }
+        }
+
+        /**
+         * Get cascade counters.
+         */
+        fun getCascadeStats(): CascadeStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return CascadeStats(0, 0, 0, 0, 0)
+            }
+            val values = nativeGetCascadeStats(ptr)
+            return CascadeStats(
+                smallAnswers = values[0],
+                escalations = values[1],
+                smallTokens = values[2],
+                discardedTokens = values[3],
+                probeUs = values[4],
+            )
+        }
+
+        /**
+         * Cascade counters.
+         */
+        data class CascadeStats(
+            val smallAnswers: Long,
+            val escalations: Long,
+            val smallTokens: Long,
+            val discardedTokens: Long,
+            val probeUs: Long,
+        ) {
+            /**
+             * Fraction of cascaded requests handed to the large model.
+             */
+            val escalationRate: Float
+                get() {
+                    val total = smallAnswers + escalations
+                    return if (total > 0) escalations.toFloat() / total else 0f
+                }
+        }
+
+        /**
+         * Get the GLM-ASR decoder GGUF if it has been downloaded.
+         *
+         * Loading this file as the tutoring model (dual-role mode) shares one
+         * copy of the weights with the on-device ASR decoder instead of
+         * loading a second transformer, roughly halving resident memory on
+         * devices that use both. Generation pauses between tokens while the
+         * decoder transcribes.
+         */
+        fun getAsrBackbonePath(): String? {
+            val decoder =
+                GLMASROnDeviceConfig.getModelDirectory(context)
+                    .resolve(GLMASROnDeviceConfig.MODEL_DECODER)
+            return decoder.takeIf { it.exists() }?.absolutePath
+        }
+
+        /**
+         * Get weight-sharing counters.
+         */
+        fun getSharedModelStats(): SharedModelStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return SharedModelStats(0, 0, 0)
+            }
+            val values = nativeGetSharedModelStats(ptr)
+            return SharedModelStats(
+                modelUsers = values[0].toInt(),
+                yields = values[1],
+                yieldUs = values[2],
+            )
+        }
+
+        /**
+         * Weight-sharing counters; [modelUsers] is 2 when the ASR decoder
+         * runs on the same loaded weights.
+         */
+        data class SharedModelStats(
+            val modelUsers: Int,
+            val yields: Long,
+            val yieldUs: Long,
+        )
+
         /**
          * Get the models directory.
          */
@@ -220,6 +680,311 @@ class OnDeviceLLMService
             return modelsDir
         }
 
+        /**
+         * Get the directory for evicted session KV snapshots.
+         */
+        private fun getSessionCacheDirectory(): File {
+            val dir = File(context.cacheDir, SESSION_CACHE_DIR)
+            if (!dir.exists()) {
+                dir.mkdirs()
+            }
+            return dir
+        }
+
+        /**
+         * Get the directory for precomputed document KV files.
+         *
+         * Kept in app files rather than the cache so lesson blocks survive
+         * storage pressure and app restarts.
+         */
+        private fun getDocumentCacheDirectory(): File {
+            val dir = File(context.filesDir, DOCUMENT_CACHE_DIR)
+            if (!dir.exists()) {
+                dir.mkdirs()
+            }
+            return dir
+        }
+
+        /**
+         * Switch the learner session that subsequent completions run in.
+         *
+         * Each session keeps its KV state resident in the native context, so
+         * returning to a recent session costs no prefill. Least recently used
+         * sessions are snapshotted to disk when the pool is full.
+         *
+         * @param sessionId Learner profile or tutoring thread identifier
+         * @return true if the session is ready
+         */
+        fun switchSession(sessionId: String): Boolean {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L || !nativeSwitchSession(ptr, sessionId)) {
+                return false
+            }
+            if (sessionId != activeSessionId) {
+                // A summary belongs to the conversation it was made from
+                nativeCancelCompaction(ptr)
+                compaction = null
+                activeSessionId = sessionId
+            }
+            return true
+        }
+
+        /**
+         * Forget a learner session's cached KV state.
+         */
+        fun dropSession(sessionId: String) {
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                nativeDropSession(ptr, sessionId)
+            }
+        }
+
+        /**
+         * Evict inactive sessions to disk under memory pressure.
+         *
+         * @param maxResident Sessions to keep resident (the active one is always kept)
+         * @return Number of sessions evicted
+         */
+        fun trimSessions(maxResident: Int = 1): Int {
+            val ptr = nativeContextPtr.get()
+            return if (ptr != 0L) nativeTrimSessions(ptr, maxResident) else 0
+        }
+
+        /**
+         * Get session pool counters for the loaded model.
+         */
+        fun getSessionStats(): SessionStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return SessionStats(0, 0, 0, 0, 0, 0)
+            }
+            val values = nativeGetSessionStats(ptr)
+            return SessionStats(
+                residentSessions = values[0].toInt(),
+                snapshotSessions = values[1].toInt(),
+                prefillTokens = values[2],
+                reusedTokens = values[3],
+                evictions = values[4],
+                restores = values[5],
+            )
+        }
+
+        /**
+         * Session pool counters.
+         */
+        data class SessionStats(
+            val residentSessions: Int,
+            val snapshotSessions: Int,
+            val prefillTokens: Long,
+            val reusedTokens: Long,
+            val evictions: Long,
+            val restores: Long,
+        )
+
+        /**
+         * Get prompt-prefix cache counters.
+         *
+         * Every prefilled prompt is kept in a radix tree of KV-resident
+         * prefixes, so a request whose preamble was seen before (in any
+         * session) starts from the deepest shared prefix.
+         */
+        fun getPrefixCacheStats(): PrefixCacheStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return PrefixCacheStats(0, 0, 0, 0, 0, 0)
+            }
+            val values = nativeGetPrefixCacheStats(ptr)
+            return PrefixCacheStats(
+                hits = values[0],
+                misses = values[1],
+                reusedTokens = values[2],
+                cachedPrompts = values[3].toInt(),
+                cachedTokens = values[4].toInt(),
+                evictions = values[5],
+            )
+        }
+
+        /**
+         * Prompt-prefix cache counters.
+         */
+        data class PrefixCacheStats(
+            val hits: Long,
+            val misses: Long,
+            val reusedTokens: Long,
+            val cachedPrompts: Int,
+            val cachedTokens: Int,
+            val evictions: Long,
+        )
+
+        /**
+         * Precompute the KV state of a curriculum document.
+         *
+         * The block is written to disk once per document and model. Later
+         * prompts that contain the text verbatim load it at the document's
+         * position instead of prefilling it, so a lesson's source material
+         * costs no prefill when a session starts.
+         *
+         * @param text Document text exactly as it will appear in prompts
+         * @return Document key, or null if the model isn't loaded or the text is too short
+         */
+        suspend fun precomputeDocument(text: String): String? =
+            withContext(Dispatchers.IO) {
+                val ptr = nativeContextPtr.get()
+                if (ptr == 0L) {
+                    return@withContext null
+                }
+                nativePrecomputeDocument(ptr, text).ifEmpty { null }
+            }
+
+        /**
+         * Unregister a precomputed document and delete its KV file.
+         */
+        fun removeDocument(key: String) {
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                nativeRemoveDocument(ptr, key)
+            }
+        }
+
+        /**
+         * Get precomputed document counters.
+         */
+        fun getDocumentStats(): DocumentStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return DocumentStats(0, 0, 0, 0, 0)
+            }
+            val values = nativeGetDocumentStats(ptr)
+            return DocumentStats(
+                registeredDocuments = values[0].toInt(),
+                precomputedTokens = values[1],
+                splices = values[2],
+                splicedTokens = values[3],
+                lastSpliceUs = values[4],
+            )
+        }
+
+        /**
+         * Precomputed document counters.
+         */
+        data class DocumentStats(
+            val registeredDocuments: Int,
+            val precomputedTokens: Long,
+            val splices: Long,
+            val splicedTokens: Long,
+            val lastSpliceUs: Long,
+        )
+
+        /**
+         * Configure the native response cache.
+         *
+         * Completed answers are replayed as a token stream when the same
+         * prompt, or a query with a similar embedding (see [setQueryEmbedding]),
+         * is seen again in the same cache context.
+         *
+         * @param config Cache limits; maxEntries == 0 disables caching
+         */
+        fun configureResponseCache(config: ResponseCacheConfig) {
+            responseCacheConfig = config
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                applyResponseCacheConfig(ptr)
+            }
+        }
+
+        private fun applyResponseCacheConfig(ptr: Long) {
+            val config = responseCacheConfig
+            nativeConfigureResponseCache(
+                ptr,
+                config.maxEntries,
+                config.maxBytes,
+                config.ttlMs,
+                config.similarityThreshold,
+            )
+        }
+
+        /**
+         * Set the context cached responses belong to, such as the current
+         * curriculum topic. Changing it invalidates previously cached answers.
+         */
+        fun setResponseCacheContext(contextKey: String) {
+            responseCacheContext = contextKey
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                nativeSetResponseCacheContext(ptr, contextKey)
+            }
+        }
+
+        /**
+         * Provide an embedding of the next query so near-identical questions
+         * can be answered from the response cache. Used by the next completion only.
+         */
+        fun setQueryEmbedding(embedding: FloatArray?) {
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                nativeSetQueryEmbedding(ptr, embedding)
+            }
+        }
+
+        /**
+         * Scope the response cache to [contextKey] and embed the learner's
+         * utterance (see [QueryEmbedding]) for the next completion, so the
+         * same question asked again in this context is replayed even though
+         * the conversation history in the prompt has grown.
+         */
+        override fun setResponseCacheQuery(
+            contextKey: String,
+            utterance: String,
+        ) {
+            setResponseCacheContext(contextKey)
+            pendingCacheQuery.set(CacheQuery(utterance, QueryEmbedding.of(utterance)))
+        }
+
+        // An utterance and its embedding, waiting for the completion that answers it
+        private class CacheQuery(
+            val utterance: String,
+            val embedding: FloatArray?,
+        )
+
+        /**
+         * Get response cache counters for the loaded model.
+         */
+        fun getResponseCacheStats(): ResponseCacheStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return ResponseCacheStats(0, 0, 0, 0, 0)
+            }
+            val values = nativeGetResponseCacheStats(ptr)
+            return ResponseCacheStats(
+                exactHits = values[0],
+                semanticHits = values[1],
+                misses = values[2],
+                entries = values[3].toInt(),
+                bytes = values[4],
+            )
+        }
+
+        /**
+         * Response cache limits.
+         */
+        data class ResponseCacheConfig(
+            val maxEntries: Int = 32,
+            val maxBytes: Long = 512L * 1024,
+            val ttlMs: Long = 10L * 60 * 1000,
+            val similarityThreshold: Float = 0.95f,
+        )
+
+        /**
+         * Response cache counters.
+         */
+        data class ResponseCacheStats(
+            val exactHits: Long,
+            val semanticHits: Long,
+            val misses: Long,
+            val entries: Int,
+            val bytes: Long,
+        )
+
         override fun streamCompletion(
             messages: List<LLMMessage>,
             temperature: Float,
@@ -242,7 +1007,7 @@ class OnDeviceLLMService
                     }
                 }
 
-                val prompt = formatPrompt(messages)
+                val prompt = formatPrompt(applyCompaction(messages))
                 val startTime = System.currentTimeMillis()
                 var firstTokenEmitted = false
                 var generatedTokens = 0
@@ -250,6 +1015,12 @@ class OnDeviceLLMService
 
                 Log.d(TAG, "Starting generation with ${prompt.length} char prompt")
 
+                // Only the completion answering the reported utterance gets its
+                // embedding; any other caller (e.g. answer validation) is exact-only
+                val lastUserMessage = messages.lastOrNull { it.role == "user" }?.content
+                val cacheQuery = pendingCacheQuery.getAndSet(null)?.takeIf { it.utterance == lastUserMessage }
+                nativeSetQueryEmbedding(contextPtr, cacheQuery?.embedding)
+
                 // Start native generation with callback
                 nativeStartGeneration(
                     contextPtr,
@@ -278,6 +1049,7 @@ class OnDeviceLLMService
                     if (isDone) {
                         totalOutputTokens.addAndGet(generatedTokens)
                         Log.i(TAG, "Generation complete: $generatedTokens tokens")
+                        scheduleCompaction(messages, prompt.length)
                         close()
                     }
                 }
@@ -298,6 +1070,264 @@ class OnDeviceLLMService
             }
         }
 
+        override fun reportConsumerLag(queuedSeconds: Float) {
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                nativeReportConsumerLag(ptr, queuedSeconds)
+            }
+        }
+
+        override suspend fun bargeIn() {
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                nativeBargeIn(ptr)
+            }
+        }
+
+        /**
+         * Configure how far generation may run ahead of playback. Decoding
+         * pauses once [PacingConfig.highWatermarkSeconds] of speech is queued
+         * (see [reportConsumerLag]) and resumes below the low watermark.
+         * While paused, calls that need the native generation lock (model
+         * load and swap, hibernate, reconfigure, compaction, session and
+         * document changes, the next completion) wait until playback drains;
+         * [stop] or [bargeIn] end the pause at once.
+         */
+        fun configurePacing(config: PacingConfig) {
+            pacingConfig = config
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                applyPacingConfig(ptr)
+            }
+        }
+
+        private fun applyPacingConfig(ptr: Long) {
+            val config = pacingConfig
+            nativeConfigurePacing(
+                ptr,
+                config.highWatermarkSeconds,
+                config.lowWatermarkSeconds,
+                SPEECH_TOKENS_PER_SECOND,
+            )
+        }
+
+        /**
+         * Get playback pacing and barge-in counters.
+         */
+        fun getPacingStats(): PacingStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return PacingStats(0, 0, 0, 0, 0)
+            }
+            val values = nativeGetPacingStats(ptr)
+            return PacingStats(
+                pauses = values[0],
+                pausedUs = values[1],
+                bargeIns = values[2],
+                discardedTokens = values[3],
+                generatedTokens = values[4],
+            )
+        }
+
+        /**
+         * Playback pacing settings (a high watermark of 0 disables pacing).
+         */
+        data class PacingConfig(
+            val highWatermarkSeconds: Float = DEFAULT_PACING_HIGH_WATERMARK_SECONDS,
+            val lowWatermarkSeconds: Float = DEFAULT_PACING_LOW_WATERMARK_SECONDS,
+        )
+
+        /**
+         * Playback pacing and barge-in counters.
+         */
+        data class PacingStats(
+            val pauses: Long,
+            val pausedUs: Long,
+            val bargeIns: Long,
+            val discardedTokens: Long,
+            val generatedTokens: Long,
+        ) {
+            /**
+             * Fraction of generated tokens thrown away by barge-ins.
+             */
+            val discardRate: Float
+                get() = if (generatedTokens > 0) discardedTokens.toFloat() / generatedTokens else 0f
+        }
+
+        /**
+         * Set how inference worker threads wait, for this engine and the ASR
+         * decoder alike. Workers poll between graphs while a turn runs and
+         * are parked between turns; a lower poll level trades per-token
+         * latency for less CPU burnt while waiting.
+         *
+         * Takes effect from the next turn that finds the pool idle.
+         */
+        fun configureComputePools(config: ComputePoolConfig) {
+            nativeConfigureComputePools(config.poll.coerceIn(0, MAX_COMPUTE_POOL_POLL), config.pauseBetweenTurns)
+        }
+
+        /**
+         * Get compute pool usage counters (process-wide).
+         */
+        fun getComputePoolStats(): ComputePoolStats {
+            val values = nativeGetComputePoolStats()
+            return ComputePoolStats(
+                turns = values[0],
+                sharedTurns = values[1],
+                poolsCreated = values[2],
+                pauses = values[3],
+                livePools = values[4].toInt(),
+            )
+        }
+
+        /**
+         * Compute pool policy.
+         *
+         * @property poll ggml poll level during a turn, 0 (sleep at once) to 100
+         * @property pauseBetweenTurns Park workers when a turn ends
+         */
+        data class ComputePoolConfig(
+            val poll: Int = DEFAULT_COMPUTE_POOL_POLL,
+            val pauseBetweenTurns: Boolean = true,
+        )
+
+        /**
+         * Compute pool usage counters.
+         */
+        data class ComputePoolStats(
+            val turns: Long,
+            val sharedTurns: Long,
+            val poolsCreated: Long,
+            val pauses: Long,
+            val livePools: Int,
+        )
+
+        /**
+         * Get background compaction counters.
+         */
+        fun getCompactionStats(): CompactionStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return CompactionStats(0, 0, 0, 0, 0, 0, 0)
+            }
+            val values = nativeGetCompactionStats(ptr)
+            return CompactionStats(
+                compactions = values[0],
+                aborted = values[1],
+                summarizedTokens = values[2],
+                summaryTokens = values[3],
+                rebuiltTokens = values[4],
+                yields = values[5],
+                lastCompactionMs = values[6],
+            )
+        }
+
+        /**
+         * Background compaction counters.
+         */
+        data class CompactionStats(
+            val compactions: Long,
+            val aborted: Long,
+            val summarizedTokens: Long,
+            val summaryTokens: Long,
+            val rebuiltTokens: Long,
+            val yields: Long,
+            val lastCompactionMs: Long,
+        )
+
+        /**
+         * Summary that replaces the first [headSize] messages of a conversation.
+         */
+        private data class Compaction(
+            val headSize: Int,
+            val headHash: Int,
+            val summary: String,
+        )
+
+        /**
+         * Replace the compacted head of a conversation with its summary.
+         * Conversations that don't start with the compacted messages are returned unchanged.
+         */
+        private fun applyCompaction(messages: List<LLMMessage>): List<LLMMessage> {
+            val current = compaction ?: return messages
+            if (messages.size < current.headSize ||
+                messages.subList(0, current.headSize).hashCode() != current.headHash
+            ) {
+                return messages
+            }
+            val system = messages.first().takeIf { it.role == "system" }
+            return listOf(summarySystemMessage(system, current.summary)) + messages.drop(current.headSize)
+        }
+
+        private fun summarySystemMessage(
+            system: LLMMessage?,
+            summary: String,
+        ): LLMMessage {
+            val note = "Summary of the conversation so far: $summary"
+            return LLMMessage("system", if (system != null) "${system.content}\n\n$note" else note)
+        }
+
+        /**
+         * Summarize the oldest turns in the background once the prompt grows
+         * past the threshold.
+         *
+         * Natively, the summary is generated between turns in short steps on
+         * half the decode threads, and the session KV is rebuilt for the
+         * compacted prompt, so the next turn starts from a short, warm prefix.
+         */
+        private fun scheduleCompaction(
+            messages: List<LLMMessage>,
+            promptChars: Int,
+        ) {
+            val ptr = nativeContextPtr.get()
+            val headSize = messages.size - COMPACTION_KEEP_RECENT_MESSAGES
+            if (ptr == 0L || compactionThresholdTokens <= 0 ||
+                promptChars / CHARS_PER_TOKEN < compactionThresholdTokens ||
+                headSize <= 1 || compactionJob?.isActive == true
+            ) {
+                return
+            }
+
+            val head = messages.subList(0, headSize).toList()
+            val tail = messages.drop(headSize)
+            val system = messages.first().takeIf { it.role == "system" }
+
+            // Earlier summary plus the turns since, as plain text
+            val effectiveHead = applyCompaction(head)
+            val earlier = compaction?.summary?.takeIf { effectiveHead !== head }
+            val transcript =
+                buildString {
+                    earlier?.let { appendLine("Earlier: $it") }
+                    for (message in effectiveHead) {
+                        when (message.role) {
+                            "user" -> appendLine("Learner: ${message.content}")
+                            "assistant" -> appendLine("Tutor: ${message.content}")
+                        }
+                    }
+                }
+            val summaryPrompt =
+                formatPrompt(listOf(LLMMessage("system", COMPACTION_INSTRUCTION), LLMMessage("user", transcript)))
+            val compacted = formatPrompt(listOf(summarySystemMessage(system, SUMMARY_PLACEHOLDER)) + tail)
+            val sessionId = activeSessionId
+
+            compactionJob =
+                compactionScope.launch {
+                    val summary =
+                        nativeCompactSession(
+                            ptr,
+                            sessionId,
+                            summaryPrompt,
+                            compacted.substringBefore(SUMMARY_PLACEHOLDER),
+                            compacted.substringAfter(SUMMARY_PLACEHOLDER),
+                            COMPACTION_MAX_SUMMARY_TOKENS,
+                        )
+                    if (summary.isNotEmpty() && sessionId == activeSessionId) {
+                        compaction = Compaction(headSize, head.hashCode(), summary)
+                        Log.i(TAG, "Compacted $headSize messages into ${summary.length} chars")
+                    }
+                }
+        }
+
         /**
          * Format messages into model-specific prompt.
          * Detects model type from filename and uses appropriate format.
@@ -307,11 +1337,28 @@ class OnDeviceLLMService
 
             return if (modelName.contains("ministral") || modelName.contains("mistral")) {
                 formatMistralPrompt(messages)
+            } else if (modelName.contains("glm")) {
+                formatGlmPrompt(messages)
             } else {
                 formatChatMLPrompt(messages)
             }
         }
 
+        /**
+         * Stop strings for the prompt format used with the given model.
+         * Kept in sync with [formatPrompt].
+         */
+        private fun stopSequencesFor(modelPath: String): Array<String> {
+            val modelName = modelPath.lowercase()
+            return if (modelName.contains("ministral") || modelName.contains("mistral")) {
+                MISTRAL_STOP_SEQUENCES
+            } else if (modelName.contains("glm")) {
+                GLM_STOP_SEQUENCES
+            } else {
+                CHATML_STOP_SEQUENCES
+            }
+        }
+
         /**
          * Format for Mistral/Ministral models: [INST] ... [/INST]
          */
@@ -340,6 +1387,24 @@ class OnDeviceLLMService
             return sb.toString()
         }
 
+        /**
+         * Format for GLM models (the shared ASR backbone): [gMASK]<sop><|system|> ...
+         */
+        private fun formatGlmPrompt(messages: List<LLMMessage>): String {
+            val sb = StringBuilder("[gMASK]<sop>")
+
+            for (message in messages) {
+                when (message.role) {
+                    "system" -> sb.append("<|system|>\n${message.content}")
+                    "user" -> sb.append("<|user|>\n${message.content}")
+                    "assistant" -> sb.append("<|assistant|>\n${message.content}")
+                }
+            }
+
+            sb.append("<|assistant|>\n")
+            return sb.toString()
+        }
+
         /**
          * Format for TinyLlama/ChatML models: <|system|> ... <|user|> ...
          */
@@ -368,6 +1433,73 @@ class OnDeviceLLMService
             return maxOf(1, minOf(8, cores - 2))
         }
 
+        /**
+         * Enable or disable prompt-lookup speculative decoding.
+         *
+         * Drafts continuations from n-grams already present in the prompt or
+         * output and verifies several tokens per decode step. Output is
+         * unchanged; extractive replies (quoting curriculum text) get faster.
+         *
+         * @param enabled Whether to speculate
+         * @param ngramMax Longest suffix n-gram to match
+         * @param draftMax Maximum draft tokens verified per decode
+         */
+        fun setLookupDecoding(
+            enabled: Boolean,
+            ngramMax: Int = DEFAULT_LOOKUP_NGRAM_MAX,
+            draftMax: Int = DEFAULT_LOOKUP_DRAFT_MAX,
+        ) {
+            lookupSettings = LookupSettings(enabled, ngramMax, draftMax)
+            val ptr = nativeContextPtr.get()
+            if (ptr != 0L) {
+                applyLookupSettings(ptr)
+            }
+        }
+
+        private fun applyLookupSettings(ptr: Long) {
+            val settings = lookupSettings
+            nativeSetLookupDecoding(ptr, settings.enabled, settings.ngramMax, settings.draftMax)
+        }
+
+        /**
+         * Get prompt-lookup speculation counters for the loaded model.
+         */
+        fun getLookupStats(): LookupStats {
+            val ptr = nativeContextPtr.get()
+            if (ptr == 0L) {
+                return LookupStats(0, 0, 0, 0)
+            }
+            val values = nativeGetLookupStats(ptr)
+            return LookupStats(
+                draftedTokens = values[0],
+                acceptedTokens = values[1],
+                decodeCalls = values[2],
+                generatedTokens = values[3],
+            )
+        }
+
+        private data class LookupSettings(
+            val enabled: Boolean = false,
+            val ngramMax: Int = DEFAULT_LOOKUP_NGRAM_MAX,
+            val draftMax: Int = DEFAULT_LOOKUP_DRAFT_MAX,
+        )
+
+        /**
+         * Prompt-lookup speculation counters.
+         */
+        data class LookupStats(
+            val draftedTokens: Long,
+            val acceptedTokens: Long,
+            val decodeCalls: Long,
+            val generatedTokens: Long,
+        ) {
+            val acceptanceRate: Float
+                get() = if (draftedTokens > 0) acceptedTokens.toFloat() / draftedTokens else 0f
+
+            val tokensPerDecode: Float
+                get() = if (decodeCalls > 0) generatedTokens.toFloat() / decodeCalls else 0f
+        }
+
         /**
          * Get metrics for telemetry.
          */
@@ -417,11 +1549,16 @@ class OnDeviceLLMService
         }
 
         // Native method declarations
+        @Suppress("LongParameterList")
         private external fun nativeLoadModel(
             modelPath: String,
             contextSize: Int,
             gpuLayers: Int,
             nThreads: Int,
+            maxSessions: Int,
+            sessionCacheDir: String,
+            prefixCacheSlots: Int,
+            documentCacheDir: String,
         ): Long
 
         private external fun nativeStartGeneration(
@@ -435,4 +1572,153 @@ class OnDeviceLLMService
         private external fun nativeStopGeneration(contextPtr: Long)
 
         private external fun nativeFreeModel(contextPtr: Long)
+
+        private external fun nativeSetLookupDecoding(
+            contextPtr: Long,
+            enabled: Boolean,
+            ngramMax: Int,
+            draftMax: Int,
+        )
+
+        private external fun nativeGetLookupStats(contextPtr: Long): LongArray
+
+        private external fun nativeSetStopSequences(
+            contextPtr: Long,
+            stopSequences: Array<String>,
+        )
+
+        private external fun nativeSwitchSession(
+            contextPtr: Long,
+            sessionId: String,
+        ): Boolean
+
+        private external fun nativeDropSession(
+            contextPtr: Long,
+            sessionId: String,
+        )
+
+        private external fun nativeTrimSessions(
+            contextPtr: Long,
+            maxResident: Int,
+        ): Int
+
+        private external fun nativeGetSessionStats(contextPtr: Long): LongArray
+
+        private external fun nativeGetPrefixCacheStats(contextPtr: Long): LongArray
+
+        private external fun nativePrecomputeDocument(
+            contextPtr: Long,
+            text: String,
+        ): String
+
+        private external fun nativeRemoveDocument(
+            contextPtr: Long,
+            key: String,
+        )
+
+        private external fun nativeGetDocumentStats(contextPtr: Long): LongArray
+
+        @Suppress("LongParameterList")
+        private external fun nativeCompactSession(
+            contextPtr: Long,
+            sessionId: String,
+            summaryPrompt: String,
+            prefixBefore: String,
+            prefixAfter: String,
+            maxSummaryTokens: Int,
+        ): String
+
+        private external fun nativeCancelCompaction(contextPtr: Long)
+
+        private external fun nativeGetSharedModelStats(contextPtr: Long): LongArray
+
+        @Suppress("LongParameterList")
+        private external fun nativeLoadCascadeModel(
+            contextPtr: Long,
+            modelPath: String,
+            contextSize: Int,
+            nThreads: Int,
+            probeTokens: Int,
+            minProbability: Float,
+            maxMeanEntropy: Float,
+        ): Boolean
+
+        private external fun nativeUnloadCascadeModel(contextPtr: Long)
+
+        private external fun nativeSwapModel(
+            contextPtr: Long,
+            modelPath: String,
+            stopSequences: Array<String>,
+        ): Boolean
+
+        private external fun nativeGetSwapStats(contextPtr: Long): LongArray
+
+        private external fun nativeGetCascadeStats(contextPtr: Long): LongArray
+
+        private external fun nativeGetCompactionStats(contextPtr: Long): LongArray
+
+        private external fun nativeConfigureResponseCache(
+            contextPtr: Long,
+            maxEntries: Int,
+            maxBytes: Long,
+            ttlMs: Long,
+            similarityThreshold: Float,
+        )
+
+        private external fun nativeSetResponseCacheContext(
+            contextPtr: Long,
+            contextKey: String,
+        )
+
+        private external fun nativeSetQueryEmbedding(
+            contextPtr: Long,
+            embedding: FloatArray?,
+        )
+
+        private external fun nativeGetResponseCacheStats(contextPtr: Long): LongArray
+
+        private external fun nativeReconfigure(
+            contextPtr: Long,
+            contextSize: Int,
+            threads: Int,
+        ): Boolean
+
+        private external fun nativeGetReconfigureStats(contextPtr: Long): LongArray
+
+        private external fun nativeConfigurePacing(
+            contextPtr: Long,
+            highWatermarkSeconds: Float,
+            lowWatermarkSeconds: Float,
+            speechTokensPerSecond: Float,
+        )
+
+        private external fun nativeReportConsumerLag(
+            contextPtr: Long,
+            queuedSeconds: Float,
+        )
+
+        private external fun nativeBargeIn(contextPtr: Long)
+
+        private external fun nativeGetPacingStats(contextPtr: Long): LongArray
+
+        private external fun nativeConfigureComputePools(
+            poll: Int,
+            pauseBetweenTurns: Boolean,
+        )
+
+        private external fun nativeGetComputePoolStats(): LongArray
+
+        private external fun nativeHibernate(
+            contextPtr: Long,
+            snapshotSessions: Boolean,
+        ): Boolean
+
+        private external fun nativeResume(contextPtr: Long): Boolean
+
+        private external fun nativeGetHibernateStats(contextPtr: Long): LongArray
+
+        private external fun nativeAttachTelemetry(
+            contextPtr: Long,
+            buffer: ByteBuffer?,
+        ): Boolean
     }
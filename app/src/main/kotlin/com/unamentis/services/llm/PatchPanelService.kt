@@ -78,6 +78,22 @@ class PatchPanelService(
         currentProvider?.stop()
     }
 
+    override fun reportConsumerLag(queuedSeconds: Float) {
+        currentProvider?.reportConsumerLag(queuedSeconds)
+    }
+
+    override suspend fun bargeIn() {
+        currentProvider?.bargeIn()
+    }
+
+    override fun setResponseCacheQuery(
+        contextKey: String,
+        utterance: String,
+    ) {
+        // The next completion may be routed to any of them
+        providers.values.forEach { it.setResponseCacheQuery(contextKey, utterance) }
+    }
+
     /**
      * Select the optimal provider based on routing context.
      */
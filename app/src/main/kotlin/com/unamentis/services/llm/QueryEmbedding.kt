@@ -0,0 +1,49 @@
+package com.unamentis.services.llm
+
+/**
+ * Lexical embedding of a learner utterance for response-cache lookups.
+ *
+ * Counts hashed character trigrams of the normalized text (lowercase,
+ * letters and digits only, single spaces), so the same question asked again
+ * with different casing, punctuation or filler spacing lands on a cosine
+ * similarity near 1, while a different question does not. It is computed
+ * on the calling thread in microseconds and needs no model or network.
+ *
+ * Utterances under [MIN_WORDS] words get no embedding: replies like "yes"
+ * or "go on" mean something different at every turn, so they only ever hit
+ * the cache on an exact prompt match.
+ */
+object QueryEmbedding {
+    const val DIMENSIONS = 256
+    const val MIN_WORDS = 3
+
+    private const val FNV_OFFSET = 0x811c9dc5.toInt()
+    private const val FNV_PRIME = 0x01000193
+
+    /**
+     * Embed an utterance.
+     *
+     * @param utterance What the learner said
+     * @return Trigram counts, or null if the utterance is too short to embed
+     */
+    fun of(utterance: String): FloatArray? {
+        val words =
+            utterance.lowercase()
+                .split(Regex("[^\\p{L}\\p{N}]+"))
+                .filter { it.isNotEmpty() }
+        if (words.size < MIN_WORDS) {
+            return null
+        }
+
+        val text = words.joinToString(" ", prefix = " ", postfix = " ")
+        val vector = FloatArray(DIMENSIONS)
+        for (i in 0..text.length - 3) {
+            var hash = FNV_OFFSET
+            for (j in i until i + 3) {
+                hash = (hash xor text[j].code) * FNV_PRIME
+            }
+            vector[Math.floorMod(hash, DIMENSIONS)] += 1f
+        }
+        return vector
+    }
+}
@@ -23,6 +23,8 @@ import java.io.File
  * @property numThreads Number of CPU threads for inference
  * @property contextSize Context window size for llama.cpp decoder
  * @property language Language hint for recognition ("auto", "en", "zh", "yue")
+ * @property rollingContextTokens Previous transcript tokens kept as decoder context
+ *           across utterances (0 = each chunk decodes from an empty context)
  */
 data class GLMASROnDeviceConfig(
     val modelDirectory: File,
@@ -32,6 +34,7 @@ data class GLMASROnDeviceConfig(
     val numThreads: Int = 4,
     val contextSize: Int = 4096,
     val language: String = "auto",
+    val rollingContextTokens: Int = DEFAULT_ROLLING_CONTEXT_TOKENS,
 ) {
     /**
      * Path to Whisper encoder ONNX model.
@@ -118,6 +121,9 @@ data class GLMASROnDeviceConfig(
         const val N_MELS = 128
         const val CHUNK_LENGTH_SECONDS = 30
 
+        // Transcript tokens carried into the next decode (roughly two sentences)
+        const val DEFAULT_ROLLING_CONTEXT_TOKENS = 64
+
         /**
          * Hugging Face model repository URL.
          */
@@ -4,6 +4,7 @@ import android.content.Context
 import android.util.Log
 import com.unamentis.R
 import com.unamentis.core.device.DeviceCapabilityDetector
+import com.unamentis.core.telemetry.NativeTelemetryBlock
 import com.unamentis.data.model.STTResult
 import com.unamentis.data.model.STTService
 import dagger.hilt.android.qualifiers.ApplicationContext
@@ -69,6 +70,20 @@ class GLMASROnDeviceSTTService
             private const val CHUNK_DURATION_MS = 3000 // Process 3 seconds at a time
             private const val CHUNK_SAMPLES = SAMPLE_RATE * CHUNK_DURATION_MS / 1000
 
+            // Printable ASCII: every character an English transcript needs
+            private val ENGLISH_CHARSET = (0x20..0x7E).map { it.toChar() }.joinToString("")
+
+            // Long-form transcription: full encoder windows sharing a short overlap
+            private const val LONG_FORM_WINDOW_MS = GLMASROnDeviceConfig.CHUNK_LENGTH_SECONDS * 1000
+            private const val LONG_FORM_OVERLAP_MS = 2000
+            private const val LONG_FORM_WINDOW_SAMPLES = SAMPLE_RATE / 1000 * LONG_FORM_WINDOW_MS
+            private const val LONG_FORM_HOP_SAMPLES =
+                SAMPLE_RATE / 1000 * (LONG_FORM_WINDOW_MS - LONG_FORM_OVERLAP_MS)
+
+            // Live decoder telemetry block (see glm_asr_decoder.h)
+            private const val TELEMETRY_FIELDS = 9
+            private const val MILLI = 1000.0
+
             // Stub transcript resource for testing when ONNX Runtime is not available
             private val STUB_TRANSCRIPT_RES = R.string.stt_stub_transcript
 
@@ -123,6 +138,9 @@ class GLMASROnDeviceSTTService
         // llama.cpp context for text decoding
         private val llamaContextPtr = AtomicLong(0)
 
+        // Live decoder counters, published by native code while the decoder is loaded
+        private val telemetry = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_ASR, TELEMETRY_FIELDS)
+
         // Number of mel bands for spectrogram
         private val nMels = GLMASROnDeviceConfig.N_MELS
 
@@ -228,6 +246,131 @@ class GLMASROnDeviceSTTService
          */
         fun isLoaded(): Boolean = isLoaded.get()
 
+        /**
+         * Limit decoder output to tokens made of the given characters.
+         *
+         * Scanning only this subset for the most likely token shortens the
+         * greedy choice after each decode step; the forward pass still
+         * projects onto the full vocabulary. Transcripts are unchanged as long
+         * as the speech is in the language the charset covers.
+         *
+         * @param charset Allowed characters, or null for the full vocabulary
+         * @return Number of allowed tokens (0 = unrestricted)
+         */
+        fun restrictVocabulary(charset: String?): Int {
+            val ptr = llamaContextPtr.get()
+            if (ptr == 0L || !decoderAvailable) {
+                return 0
+            }
+            return nativeRestrictVocabulary(ptr, charset)
+        }
+
+        /**
+         * Charset used to restrict the decoder for a language hint, or null
+         * when the language needs the full vocabulary.
+         */
+        private fun vocabularyCharsetFor(language: String): String? =
+            when (language) {
+                "en" -> ENGLISH_CHARSET
+                else -> null
+            }
+
+        /**
+         * Forget the transcript carried over as decoder context, e.g. when the
+         * conversation moves to a new topic or speaker.
+         */
+        fun resetTranscriptContext() {
+            val ptr = llamaContextPtr.get()
+            if (ptr != 0L && decoderAvailable) {
+                nativeClearRollingContext(ptr)
+            }
+        }
+
+        /**
+         * Change the decoder's context window and/or thread count without
+         * reloading its weights. The rolling transcript context is kept when
+         * it fits.
+         *
+         * @param contextSize New context window in tokens (0 keeps the current one)
+         * @param threads New thread count (0 keeps the current one)
+         * @return true if the new settings are in effect
+         */
+        fun reconfigureDecoder(
+            contextSize: Int,
+            threads: Int = 0,
+        ): Boolean {
+            val ptr = llamaContextPtr.get()
+            return ptr != 0L && decoderAvailable && nativeReconfigureDecoder(ptr, contextSize, threads)
+        }
+
+        /**
+         * Release the decoder's KV cache and compute buffers under memory
+         * pressure while keeping its weights mapped. Decoding resumes
+         * automatically on the next chunk.
+         *
+         * @param snapshotState Keep decoder state in memory and restore it on resume
+         * @return true if the decoder was hibernated
+         */
+        fun hibernateDecoder(snapshotState: Boolean = false): Boolean {
+            val ptr = llamaContextPtr.get()
+            if (ptr == 0L || !decoderAvailable) {
+                return false
+            }
+            val hibernated = nativeHibernateDecoder(ptr, snapshotState)
+            if (hibernated) {
+                val stats = getDecoderHibernateStats()
+                Log.i(TAG, "Decoder hibernated: freed ${stats.stateBytes / 1024} KB state")
+            }
+            return hibernated
+        }
+
+        /**
+         * Recreate the decoder context after [hibernateDecoder].
+         */
+        fun resumeDecoder(): Boolean {
+            val ptr = llamaContextPtr.get()
+            return ptr != 0L && decoderAvailable && nativeResumeDecoder(ptr)
+        }
+
+        /**
+         * Get footprint and timing of the decoder's last hibernate/resume cycle.
+         */
+        fun getDecoderHibernateStats(): DecoderHibernateStats {
+            val ptr = llamaContextPtr.get()
+            if (ptr == 0L || !decoderAvailable) {
+                return DecoderHibernateStats(0, 0, 0, 0, 0)
+            }
+            val values = nativeGetDecoderHibernateStats(ptr)
+            return DecoderHibernateStats(
+                stateBytes = values[0],
+                modelBytes = values[1],
+                snapshotBytes = values[2],
+                hibernateUs = values[3],
+                resumeUs = values[4],
+            )
+        }
+
+        /**
+         * Read live decoder counters without a JNI call, cheap enough to
+         * poll from a dashboard every frame.
+         *
+         * @return The latest counters, or null if the decoder isn't loaded
+         */
+        fun getDecoderTelemetry(): DecoderTelemetry? {
+            val values = telemetry.snapshot() ?: return null
+            return DecoderTelemetry(
+                state = DecoderState.entries.getOrElse(values[0].toInt()) { DecoderState.UNLOADED },
+                decodeTokens = values[1],
+                tokensPerSecond = values[2] / MILLI,
+                decodes = values[3],
+                totalTokens = values[4],
+                queuedLongFormWindows = values[5],
+                injectedAudioTokens = values[6],
+                stepMicrosPerToken = values[7],
+                sampleNanosPerToken = values[8],
+            )
+        }
+
         // ==================== STTService Implementation ====================
 
         override fun startStreaming(): Flow<STTResult> =
@@ -384,10 +527,72 @@ class GLMASROnDeviceSTTService
         }
 
         /**
-         * Run the full GLM-ASR pipeline on audio samples.
+         * Transcribe a long recording (e.g. a lecture or an extended oral answer).
+         *
+         * The audio is cut into 30 s windows that overlap by 2 s so no word is
+         * lost at a boundary. Each window is encoded here and handed to the
+         * native decoder, which decodes several windows at once on separate
+         * sequences and merges the duplicated overlap by token alignment.
+         *
+         * @param samples 16kHz mono float samples
+         * @return Stitched transcript, or null if the decoder is unavailable
          */
         @Suppress("ReturnCount")
+        suspend fun transcribeLongForm(samples: FloatArray): String? =
+            withContext(Dispatchers.Default) {
+                val ptr = llamaContextPtr.get()
+                if (!isLoaded.get() || ptr == 0L || !decoderAvailable) {
+                    Log.w(TAG, "Long-form transcription requires the native decoder")
+                    return@withContext null
+                }
+
+                val startTime = System.currentTimeMillis()
+                nativeBeginLongForm(ptr, LONG_FORM_OVERLAP_MS)
+
+                var start = 0
+                var windows = 0
+                while (start < samples.size) {
+                    val end = minOf(samples.size, start + LONG_FORM_WINDOW_SAMPLES)
+                    val embeddings = computeEmbeddings(samples.copyOfRange(start, end))
+                    val durationMs = ((end - start).toLong() * 1000 / SAMPLE_RATE).toInt()
+                    if (embeddings == null ||
+                        !nativeAddLongFormWindow(ptr, embeddings, numEmbeddingTokens, embeddingDim, durationMs)
+                    ) {
+                        Log.w(TAG, "Long-form window $windows failed, returning partial transcript")
+                        break
+                    }
+                    windows++
+                    if (end == samples.size) {
+                        break
+                    }
+                    start += LONG_FORM_HOP_SAMPLES
+                }
+
+                val transcript = nativeFinishLongForm(ptr)
+                val audioMs = samples.size.toLong() * 1000 / SAMPLE_RATE
+                Log.i(
+                    TAG,
+                    "Long-form: $windows windows, ${audioMs}ms audio in " +
+                        "${System.currentTimeMillis() - startTime}ms",
+                )
+                transcript
+            }
+
+        /**
+         * Run the full GLM-ASR pipeline on audio samples.
+         */
         private fun runPipeline(samples: FloatArray): String? {
+            val embeddings = computeEmbeddings(samples) ?: return null
+
+            // Run llama.cpp decoder on the part of the window that holds audio
+            val durationMs = (samples.size.toLong() * 1000 / SAMPLE_RATE).toInt()
+            return runLlamaDecoder(embeddings, durationMs)
+        }
+
+        /**
+         * Encode audio samples into decoder input embeddings.
+         */
+        private fun computeEmbeddings(samples: FloatArray): FloatArray? {
             // Step 1: Compute mel spectrogram
             val melSpec2D = melSpectrogram.compute(samples)
             if (melSpec2D.isEmpty() || melSpec2D[0].isEmpty()) {
@@ -405,10 +610,7 @@ class GLMASROnDeviceSTTService
             }
 
             // Step 2: Run through ONNX pipeline
-            val embeddings = runONNXPipeline(melSpecFlat, nFrames) ?: return null
-
-            // Step 3: Run llama.cpp decoder
-            return runLlamaDecoder(embeddings)
+            return runONNXPipeline(melSpecFlat, nFrames)
         }
 
         /**
@@ -525,6 +727,14 @@ class GLMASROnDeviceSTTService
                 }
 
                 llamaContextPtr.set(contextPtr)
+                nativeSetRollingContext(contextPtr, cfg.rollingContextTokens)
+                if (!nativeAttachTelemetry(contextPtr, telemetry.buffer)) {
+                    Log.w(TAG, "Live decoder telemetry unavailable")
+                }
+                vocabularyCharsetFor(cfg.language)?.let { charset ->
+                    val allowed = nativeRestrictVocabulary(contextPtr, charset)
+                    Log.i(TAG, "Decoder vocabulary restricted to $allowed tokens for ${cfg.language}")
+                }
                 Log.i(TAG, "GLM-ASR decoder loaded successfully")
                 return true
             } catch (e: Exception) {
@@ -549,9 +759,14 @@ class GLMASROnDeviceSTTService
          * Run llama.cpp decoder on embeddings to produce text.
          *
          * @param embeddings Token embeddings from embed head
+         * @param audioDurationMs Length of the audio behind the embeddings; the
+         *        padded remainder of the 30 s window is not decoded
          * @return Transcribed text, or null on error
          */
-        private fun runLlamaDecoder(embeddings: FloatArray): String {
+        private fun runLlamaDecoder(
+            embeddings: FloatArray,
+            audioDurationMs: Int,
+        ): String {
             val ptr = llamaContextPtr.get()
 
             if (ptr == 0L || !decoderAvailable) {
@@ -567,6 +782,7 @@ class GLMASROnDeviceSTTService
                         numEmbeddingTokens,
                         embeddingDim,
                         maxOutputTokens,
+                        audioDurationMs,
                     )
                 result.ifEmpty { context.getString(STUB_TRANSCRIPT_RES) }
             } catch (e: Exception) {
@@ -601,14 +817,17 @@ class GLMASROnDeviceSTTService
          * @param numTokens Number of audio tokens (e.g., 375)
          * @param embeddingDim Dimension of each embedding (e.g., 4096)
          * @param maxOutputTokens Maximum tokens to generate
+         * @param audioDurationMs True audio length, or 0 to detect trailing padding
          * @return Transcribed text
          */
+        @Suppress("LongParameterList")
         private external fun nativeDecodeEmbeddingsSync(
             contextPtr: Long,
             embeddings: FloatArray,
             numTokens: Int,
             embeddingDim: Int,
             maxOutputTokens: Int,
+            audioDurationMs: Int,
         ): String
 
         /**
@@ -620,6 +839,7 @@ class GLMASROnDeviceSTTService
          * @param embeddingDim Dimension of each embedding
          * @param maxOutputTokens Maximum tokens to generate
          * @param callback Called for each token (token: String, isDone: Boolean) -> Unit
+         * @param audioDurationMs True audio length, or 0 to detect trailing padding
          */
         @Suppress("UnusedPrivateMember", "LongParameterList")
         private external fun nativeDecodeEmbeddings(
@@ -629,6 +849,7 @@ class GLMASROnDeviceSTTService
             embeddingDim: Int,
             maxOutputTokens: Int,
             callback: (String, Boolean) -> Unit,
+            audioDurationMs: Int,
         )
 
         /**
@@ -660,6 +881,95 @@ class GLMASROnDeviceSTTService
         @Suppress("UnusedPrivateMember")
         private external fun nativeGetEmbeddingDim(contextPtr: Long): Int
 
+        /**
+         * Change decoder context size and/or threads (<= 0 keeps a setting).
+         */
+        private external fun nativeReconfigureDecoder(
+            contextPtr: Long,
+            contextSize: Int,
+            threads: Int,
+        ): Boolean
+
+        /**
+         * Free decoder KV cache and compute buffers, keeping weights mapped.
+         */
+        private external fun nativeHibernateDecoder(
+            contextPtr: Long,
+            snapshotState: Boolean,
+        ): Boolean
+
+        /**
+         * Recreate the decoder context after hibernation.
+         */
+        private external fun nativeResumeDecoder(contextPtr: Long): Boolean
+
+        /**
+         * Get hibernate counters [stateBytes, modelBytes, snapshotBytes, hibernateUs, resumeUs].
+         */
+        private external fun nativeGetDecoderHibernateStats(contextPtr: Long): LongArray
+
+        /**
+         * Publish live counters into a direct buffer (null stops publishing).
+         */
+        private external fun nativeAttachTelemetry(
+            contextPtr: Long,
+            buffer: ByteBuffer?,
+        ): Boolean
+
+        /**
+         * Keep up to maxTokens of previous transcript as decoder context (0 = off).
+         */
+        private external fun nativeSetRollingContext(
+            contextPtr: Long,
+            maxTokens: Int,
+        )
+
+        /**
+         * Forget the retained transcript context.
+         */
+        private external fun nativeClearRollingContext(contextPtr: Long)
+
+        /**
+         * Convert 16-bit little-endian PCM bytes to float samples (vectorized).
+         */
+        private external fun nativeInt16ToFloat(audioData: ByteArray): FloatArray
+
+        /**
+         * Restrict decoding to tokens made of the given characters.
+         *
+         * @return Number of allowed tokens (0 = unrestricted)
+         */
+        private external fun nativeRestrictVocabulary(
+            contextPtr: Long,
+            charset: String?,
+        ): Int
+
+        /**
+         * Start a long-form transcription with the given window overlap.
+         */
+        private external fun nativeBeginLongForm(
+            contextPtr: Long,
+            overlapMs: Int,
+        )
+
+        /**
+         * Queue one long-form window; groups are decoded in parallel as they fill.
+         *
+         * @return false if the window was rejected or decoding failed
+         */
+        private external fun nativeAddLongFormWindow(
+            contextPtr: Long,
+            embeddings: FloatArray,
+            numTokens: Int,
+            embeddingDim: Int,
+            audioDurationMs: Int,
+        ): Boolean
+
+        /**
+         * Decode the remaining windows and return the stitched transcript.
+         */
+        private external fun nativeFinishLongForm(contextPtr: Long): String
+
         // ==================== Utilities ====================
 
         private fun unloadAllModels() {
@@ -671,6 +981,10 @@ class GLMASROnDeviceSTTService
          * Convert Int16 PCM bytes to float samples.
          */
         private fun int16ToFloat(audioData: ByteArray): FloatArray {
+            if (decoderAvailable) {
+                return nativeInt16ToFloat(audioData)
+            }
+
             val numSamples = audioData.size / 2
             val samples = FloatArray(numSamples)
 
@@ -727,6 +1041,45 @@ class GLMASROnDeviceSTTService
             )
         }
 
+        /**
+         * Decoder hibernate footprint and timing.
+         */
+        data class DecoderHibernateStats(
+            val stateBytes: Long,
+            val modelBytes: Long,
+            val snapshotBytes: Long,
+            val hibernateUs: Long,
+            val resumeUs: Long,
+        )
+
+        /**
+         * What the decoder is doing, as published in its telemetry block.
+         */
+        enum class DecoderState {
+            UNLOADED,
+            IDLE,
+            DECODING,
+            HIBERNATED,
+        }
+
+        /**
+         * Live decoder counters; the per-decode ones cover the current or
+         * last decode. [stepMicrosPerToken] is the forward pass per generated
+         * token and [sampleNanosPerToken] the greedy choice that follows it,
+         * which is the part [restrictVocabulary] shortens.
+         */
+        data class DecoderTelemetry(
+            val state: DecoderState,
+            val decodeTokens: Long,
+            val tokensPerSecond: Double,
+            val decodes: Long,
+            val totalTokens: Long,
+            val queuedLongFormWindows: Long,
+            val injectedAudioTokens: Long,
+            val stepMicrosPerToken: Long,
+            val sampleNanosPerToken: Long,
+        )
+
         /**
          * Metrics for on-device GLM-ASR.
          */
@@ -87,6 +87,54 @@ class AudioEngineTest {
         assertEquals(192, config.framesPerBurst)
     }
 
+    @Test
+    fun `loudness is inert before initialize`() {
+        audioEngine.setLoudness(LoudnessConfig(targetLufs = -20f))
+
+        assertEquals(LoudnessStats(), audioEngine.getLoudnessStats())
+    }
+
+    @Test
+    fun `telemetry is null before initialize`() {
+        assertNull(audioEngine.readTelemetry())
+    }
+
+    @Test
+    fun `16-bit capture reports level on the float scale`() =
+        runTest {
+            audioEngine.onNativeAudioDataI16(ShortArray(4) { 16384 })
+
+            val level = audioEngine.audioLevel.first()
+            assertEquals(0.5f, level.rms, 0.001f)
+            assertEquals(0.5f, level.peak, 0.001f)
+        }
+
+    @Test
+    fun `16-bit capture peak uses the magnitude of negative full scale`() =
+        runTest {
+            audioEngine.onNativeAudioDataI16(shortArrayOf(0, Short.MIN_VALUE, 100))
+
+            val level = audioEngine.audioLevel.first()
+            assertEquals(1f, level.peak, 0.001f)
+        }
+
+    @Test
+    fun `empty 16-bit capture keeps the previous level`() =
+        runTest {
+            audioEngine.onNativeAudioDataI16(ShortArray(4) { 16384 })
+            audioEngine.onNativeAudioDataI16(ShortArray(0))
+
+            val level = audioEngine.audioLevel.first()
+            assertEquals(0.5f, level.rms, 0.001f)
+        }
+
+    @Test
+    fun `16-bit playback and capture are refused before initialize`() {
+        assertFalse(audioEngine.queuePlayback(ShortArray(16)))
+        assertFalse(audioEngine.startCaptureI16 { })
+        assertFalse(audioEngine.isPlaying.value)
+    }
+
     @Test
     fun `AudioConfig can be customized`() {
         val config =
@@ -0,0 +1,76 @@
+package com.unamentis.core.telemetry
+
+import org.junit.Assert.*
+import org.junit.Test
+
+/**
+ * Unit tests for NativeTelemetryBlock.
+ *
+ * Native publishing is simulated by writing the block layout from
+ * telemetry_block.h directly into the shared buffer.
+ */
+class NativeTelemetryBlockTest {
+    private fun publish(
+        block: NativeTelemetryBlock,
+        layout: Int,
+        sequence: Int,
+        vararg values: Long,
+    ) {
+        val buffer = block.buffer
+        buffer.putInt(NativeTelemetryBlock.LAYOUT_OFFSET, layout)
+        buffer.putInt(NativeTelemetryBlock.SEQUENCE_OFFSET, sequence)
+        buffer.putInt(NativeTelemetryBlock.COUNT_OFFSET, values.size)
+        values.forEachIndexed { i, value ->
+            buffer.putLong(NativeTelemetryBlock.HEADER_BYTES + i * NativeTelemetryBlock.FIELD_BYTES, value)
+        }
+        buffer.putInt(NativeTelemetryBlock.MAGIC_OFFSET, NativeTelemetryBlock.MAGIC)
+    }
+
+    @Test
+    fun `buffer is direct and sized for header and fields`() {
+        val block = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_AUDIO, 7)
+
+        assertTrue(block.buffer.isDirect)
+        assertEquals(16 + 7 * 8, block.buffer.capacity())
+    }
+
+    @Test
+    fun `snapshot is null before an engine attaches`() {
+        val block = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_LLM, 8)
+
+        assertNull(block.snapshot())
+    }
+
+    @Test
+    fun `snapshot returns published fields`() {
+        val block = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_ASR, 3)
+        publish(block, NativeTelemetryBlock.LAYOUT_ASR, 4, 2L, 150L, 42_500L)
+
+        assertArrayEquals(longArrayOf(2L, 150L, 42_500L), block.snapshot())
+    }
+
+    @Test
+    fun `snapshot is null while a write is in progress`() {
+        val block = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_ASR, 3)
+        publish(block, NativeTelemetryBlock.LAYOUT_ASR, 5, 1L, 2L, 3L)
+
+        assertNull(block.snapshot())
+    }
+
+    @Test
+    fun `snapshot is null for another engine's layout`() {
+        val block = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_LLM, 2)
+        publish(block, NativeTelemetryBlock.LAYOUT_AUDIO, 2, 1L, 2L)
+
+        assertNull(block.snapshot())
+    }
+
+    @Test
+    fun `snapshot is null after the engine detaches`() {
+        val block = NativeTelemetryBlock(NativeTelemetryBlock.LAYOUT_AUDIO, 2)
+        publish(block, NativeTelemetryBlock.LAYOUT_AUDIO, 2, 1L, 2L)
+        block.buffer.putInt(NativeTelemetryBlock.MAGIC_OFFSET, 0)
+
+        assertNull(block.snapshot())
+    }
+}
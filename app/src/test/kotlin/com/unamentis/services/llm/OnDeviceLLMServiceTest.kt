@@ -3,8 +3,10 @@ package com.unamentis.services.llm
 import android.content.Context
 import io.mockk.every
 import io.mockk.mockk
+import kotlinx.coroutines.test.runTest
 import org.junit.Assert.assertEquals
 import org.junit.Assert.assertFalse
+import org.junit.Assert.assertNull
 import org.junit.Assert.assertTrue
 import org.junit.Before
 import org.junit.Test
@@ -198,6 +200,33 @@ class OnDeviceLLMServiceTest {
         assertEquals(99, config.gpuLayers)
     }
 
+    @Test
+    fun `pacing and barge-in without a loaded model stay on the Kotlin side`() =
+        runTest {
+            // The native library isn't loaded here, so any JNI call would throw
+            val service = OnDeviceLLMService(mockContext)
+            service.configurePacing(OnDeviceLLMService.PacingConfig(highWatermarkSeconds = 2f))
+            service.reportConsumerLag(10f)
+            service.bargeIn()
+
+            assertEquals(OnDeviceLLMService.PacingStats(0, 0, 0, 0, 0), service.getPacingStats())
+            assertNull(service.getLiveTelemetry())
+        }
+
+    @Test
+    fun `pacing stats report the discarded share of generated tokens`() {
+        val stats = OnDeviceLLMService.PacingStats(0, 0, 2, 30, 120)
+
+        assertEquals(0.25f, stats.discardRate)
+    }
+
+    @Test
+    fun `pacing discard rate is zero before anything was generated`() {
+        val stats = OnDeviceLLMService.PacingStats(0, 0, 1, 0, 0)
+
+        assertEquals(0f, stats.discardRate)
+    }
+
     @Test
     fun `detects Mistral model from filename`() {
         // Test model detection logic
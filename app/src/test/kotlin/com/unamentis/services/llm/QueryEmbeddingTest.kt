@@ -0,0 +1,78 @@
+package com.unamentis.services.llm
+
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertNull
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import kotlin.math.sqrt
+
+/**
+ * Unit tests for QueryEmbedding.
+ *
+ * The response cache treats a cosine similarity of 0.95 or more as the same
+ * question, so these check which side of that line rephrasings fall on.
+ */
+class QueryEmbeddingTest {
+    @Test
+    fun `short utterances get no embedding`() {
+        assertNull(QueryEmbedding.of("yes"))
+        assertNull(QueryEmbedding.of("go on!"))
+        assertNotNull(QueryEmbedding.of("what is osmosis"))
+    }
+
+    @Test
+    fun `embedding has the fixed dimensions`() {
+        assertEquals(QueryEmbedding.DIMENSIONS, QueryEmbedding.of("what is osmosis")!!.size)
+    }
+
+    @Test
+    fun `casing punctuation and spacing do not change the embedding`() {
+        assertArrayEquals(
+            QueryEmbedding.of("What is osmosis?")!!,
+            QueryEmbedding.of("  what   IS osmosis ")!!,
+            0f,
+        )
+    }
+
+    @Test
+    fun `different questions fall below the cache threshold`() {
+        val similarity =
+            cosine(
+                QueryEmbedding.of("what is osmosis")!!,
+                QueryEmbedding.of("how do plants make food")!!,
+            )
+        assertTrue("similarity $similarity", similarity < CACHE_THRESHOLD)
+    }
+
+    @Test
+    fun `near identical questions clear the cache threshold`() {
+        val similarity =
+            cosine(
+                QueryEmbedding.of("can you explain what osmosis is")!!,
+                QueryEmbedding.of("can you explain what osmosis is please")!!,
+            )
+        assertTrue("similarity $similarity", similarity < 1f)
+        assertTrue("similarity $similarity", similarity > 0.8f)
+    }
+
+    private fun cosine(
+        a: FloatArray,
+        b: FloatArray,
+    ): Float {
+        var dot = 0f
+        var normA = 0f
+        var normB = 0f
+        for (i in a.indices) {
+            dot += a[i] * b[i]
+            normA += a[i] * a[i]
+            normB += b[i] * b[i]
+        }
+        return dot / sqrt(normA * normB)
+    }
+
+    private companion object {
+        const val CACHE_THRESHOLD = 0.95f
+    }
+}
@@ -1,7 +1,9 @@
 package com.unamentis.services.stt
 
+import io.mockk.mockk
 import org.junit.Assert.assertEquals
 import org.junit.Assert.assertFalse
+import org.junit.Assert.assertNull
 import org.junit.Assert.assertTrue
 import org.junit.Before
 import org.junit.Test
@@ -15,6 +17,7 @@ import kotlin.math.sin
  * Tests cover:
  * - GLMASROnDeviceConfig - configuration class
  * - GLMASRMelSpectrogram - audio preprocessing
+ * - GLMASROnDeviceSTTService - behavior without a loaded decoder
  *
  * Note: GLMASROnDeviceSTTService requires Android context and native libraries,
  * so full service tests are done as instrumented tests.
@@ -192,6 +195,19 @@ class GLMASROnDeviceSTTServiceTest {
         assertTrue(total < 3_000_000_000L)
     }
 
+    // ==================== GLMASROnDeviceSTTService Tests ====================
+
+    @Test
+    fun `unloaded decoder ignores context resets and publishes no telemetry`() {
+        val service = GLMASROnDeviceSTTService(mockk(relaxed = true), mockk(relaxed = true))
+
+        // No decoder is loaded, so neither call may reach native code
+        service.resetTranscriptContext()
+
+        assertFalse(service.isLoaded())
+        assertNull(service.getDecoderTelemetry())
+    }
+
     // ==================== GLMASRMelSpectrogram Tests ====================
 
     private lateinit var melSpectrogram: GLMASRMelSpectrogram